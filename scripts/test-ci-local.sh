@@ -20,7 +20,7 @@ docker run --rm \
 		apt-get install -y -qq make gcc pkg-config check lcov \
 			libao-dev libavcodec-dev libavformat-dev libavutil-dev \
 			libavfilter-dev libjson-c-dev libgcrypt20-dev \
-			libcurl4-openssl-dev libwebsockets-dev libasound2-dev \
+			libcurl4-openssl-dev libwebsockets-dev zlib1g-dev libasound2-dev \
 			libblas-dev liblapack-dev >/dev/null
 		export PIANOBAR_INTEGRATION=1
 		export PIANOBAR_TEST_NO_DEVICE=1
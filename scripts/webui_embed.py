@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Compile the built web UI (dist/webui) into a C source for `make EMBED_WEBUI=1`:
+  - src/websocket/http/webui_embed_gen.c (generated — not checked in)
+
+Each file becomes a read-only byte array. `x.br` and `x.gz` next to `x` (written
+by the Vite precompress plugin) become its precompressed variants, as when the
+directory is read at runtime (src/websocket/http/asset_cache.c). The index is
+sorted by URL path so the server can bsearch it.
+"""
+from __future__ import annotations
+
+import argparse
+import sys
+from pathlib import Path
+
+# Order of BarHttpEncoding_t: identity, gzip, br
+VARIANT_SUFFIXES = ("", ".gz", ".br")
+BYTES_PER_LINE = 16
+
+
+def collect(root: Path) -> dict[str, Path]:
+    """URL path -> file, skipping hidden files like the runtime scan does."""
+    files: dict[str, Path] = {}
+    for path in sorted(root.rglob("*")):
+        rel = path.relative_to(root)
+        if any(part.startswith(".") for part in rel.parts) or not path.is_file():
+            continue
+        files["/" + rel.as_posix()] = path
+    return files
+
+
+def c_string(s: str) -> str:
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def c_array(name: str, data: bytes) -> list[str]:
+    lines = [f"static const unsigned char {name}[] = {{"]
+    for i in range(0, len(data), BYTES_PER_LINE):
+        chunk = data[i : i + BYTES_PER_LINE]
+        lines.append("\t" + ",".join(f"0x{b:02x}" for b in chunk) + ",")
+    if not data:
+        lines.append("\t0")
+    lines.append("};")
+    return lines
+
+
+def generate(root: Path) -> tuple[str, int, int]:
+    files = collect(root)
+    variants = {
+        path + suffix
+        for path in files
+        for suffix in VARIANT_SUFFIXES[1:]
+        if path + suffix in files
+    }
+    assets = sorted(
+        (p for p in files if p not in variants), key=lambda p: p.encode("utf-8")
+    )
+
+    out = [
+        "/* Generated by scripts/webui_embed.py from dist/webui — do not edit by hand.",
+        " * Rebuild: make EMBED_WEBUI=1 */",
+        "",
+        '#include "asset_cache.h"',
+        "",
+    ]
+    entries = []
+    total = 0
+    for n, path in enumerate(assets):
+        names = []
+        lens = []
+        for e, suffix in enumerate(VARIANT_SUFFIXES):
+            src = files.get(path + suffix) if e == 0 or path + suffix in variants else None
+            if src is None:
+                names.append("NULL")
+                lens.append("0")
+                continue
+            data = src.read_bytes()
+            name = f"webuiFile{n}_{e}"
+            out.extend(c_array(name, data))
+            names.append(name)
+            lens.append(str(len(data)))
+            total += len(data)
+        mtime = int(files[path].stat().st_mtime)
+        entries.append(
+            f"\t{{{c_string(path)}, {{{', '.join(names)}}}, "
+            f"{{{', '.join(lens)}}}, {mtime}}},"
+        )
+
+    out.append("")
+    out.append("const BarHttpEmbeddedFile_t barWebuiFiles[] = {")
+    out.extend(entries)
+    out.append("};")
+    out.append(f"const size_t barWebuiFileCount = {len(entries)};")
+    out.append("")
+    return "\n".join(out), len(entries), total
+
+
+def main() -> int:
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    ap.add_argument("--input", type=Path, default=Path("dist/webui"))
+    ap.add_argument(
+        "--output", type=Path, default=Path("src/websocket/http/webui_embed_gen.c")
+    )
+    args = ap.parse_args()
+
+    if not (args.input / "index.html").is_file():
+        print(
+            f"{args.input}/index.html not found; build the web UI first "
+            "(cd webui && npm run build)",
+            file=sys.stderr,
+        )
+        return 1
+    source, count, total = generate(args.input)
+    # Leave an unchanged file alone so make does not recompile it
+    if not args.output.exists() or args.output.read_text(encoding="utf-8") != source:
+        args.output.write_text(source, encoding="utf-8")
+    print(f"  GEN   {args.output} ({count} files, {total} bytes)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
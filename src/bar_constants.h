@@ -8,15 +8,30 @@
 /* --- WebSocket --- */
 #define WEBSOCKET_PING_TIMEOUT_SEC    25   /* Send PING after this many seconds idle */
 #define WEBSOCKET_HANGUP_TIMEOUT_SEC  60   /* Hang up if no valid PING response within this */
-#define WEBSOCKET_POLL_MS             50   /* lws_service() poll interval (ms) */
+#define WEBSOCKET_IDLE_WAIT_MS        60000 /* Longest lws_service() sleep without deadlines (ms) */
+#define WEBSOCKET_VOLUME_POLL_MS      1000 /* System volume poll interval (ms) */
+#define WEBSOCKET_VOLUME_APPLY_MS     50   /* Minimum time between two volume.set applies (ms) */
 #define LWS_RX_BUFFER_SIZE            4096 /* Per-protocol receive buffer size (libwebsockets) */
 #define WEBSOCKET_FILEPATH_MAX        512  /* Max filepath length for webui / static files */
+#define HTTP_ASSET_RELOAD_MS          250  /* Quiet time after web UI changes before reloading them (ms) */
+#define HTTP_ASSET_MAX_DEPTH          8    /* Deepest web UI subdirectory cached */
+#define HTTP_ASSET_HASH_LEN           8    /* Length of the content hash in built asset names */
+#define HTTP_ASSET_IMMUTABLE_MAX_AGE  31536000 /* Cache lifetime of content-hashed assets (s) */
+#define HTTP_BODY_CHUNK_SIZE          16384 /* HTTP response body bytes written per writeable callback */
+#define HTTP_TRANSFER_PARTS           5    /* Pieces of one response body (index.html with a snapshot) */
+#define WEBSOCKET_QUEUE_LIMIT_DEFAULT 64   /* Outbound frames queued per client before dropping */
+#define WEBSOCKET_MAX_CLIENTS_DEFAULT 256  /* Concurrent WebSocket clients before rejecting */
+#define WEBSOCKET_COMMAND_QUEUE_MAX   256  /* Inbound commands waiting for the worker before dropping */
+#define WEBSOCKET_MAX_MESSAGE_DEFAULT 65536 /* Largest inbound client message (bytes) before closing */
+#define WEBSOCKET_COMPRESSION_REPORT_MIN_DEFAULT 256 /* Frames from this size (bytes) are measured deflated */
+#define WEBSOCKET_SERVICE_THREADS_MAX 8    /* lws service threads (websocket_threads) */
 #define LOG_MESSAGE_TRUNCATE_LEN      100  /* Truncate long messages in log output to this many chars */
 
 /* --- Volume --- */
 #define VOLUME_FALLBACK_PERCENT       50   /* Use when OS/volume read fails (0-100 scale) */
 #define DEFAULT_VOLUME_PERCENT        50   /* Default volume at startup / reset (0-100 scale) */
 #define VOLUME_MAX_PERCENT            100  /* Upper bound for volume clamp (0-100 scale) */
+#define SYSTEM_VOLUME_STALE_MS        2000 /* Polled system volume older than this is read again (ms) */
 
 /* --- Buffer sizes (shared across files) --- */
 #define BAR_BUF_SMALL                256  /* Small buffers (lines, error messages) */
@@ -37,8 +52,9 @@
 #define BAR_RELAUNCH_PARENT_WAIT_S     1   /* seconds parent waits after exec */
 
 /* --- System / platform --- */
-#define BAR_PA_READY_TRIES           50   /* Max PulseAudio connection wait iterations */
-#define BAR_PA_OP_MAX_ITERATIONS     100  /* Max PulseAudio operation wait iterations (~1s) */
+#define BAR_PACTL_RESPAWN_MS         1000 /* Wait before restarting an exited `pactl subscribe` */
+#define BAR_PULSEAUDIO_RETRY_MS      1000 /* Least time between reconnects to a lost PulseAudio server */
+#define BAR_ALSA_POLL_FDS_MAX        8    /* Mixer poll descriptors watched for volume changes */
 #define BAR_JOIN_THREAD_ITERATIONS   100  /* Main: wait iterations for player thread exit (100 * 100ms = 10s) */
 #define BAR_STATION_ID_MAX           50   /* Max length for station ID string buffer */
 
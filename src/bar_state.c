@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include "ui.h"
 #include "log.h"
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <pthread.h>
@@ -36,7 +37,8 @@ THE SOFTWARE.
  *	(BAR_UI_MODE_BOTH and BAR_UI_MODE_WEB).
  *	LOCK HIERARCHY: This is Lock #1 in the hierarchy
  *	Must be acquired BEFORE player.lock if both are needed
- *	PROTECTS: Pointer fields playlist, curStation, nextStation, ph list heads
+ *	PROTECTS: Pointer fields playlist, curStation, nextStation, ph list heads,
+ *	songHistory (including the ring contents)
  *	DURATION: Should be held for microseconds, not milliseconds
  *	NO I/O: Never hold this lock during network calls, disk I/O, or console output
  *	Pandora HTTP is serialized separately in BarUiPianoCall via pianoHttpMutex.
@@ -240,6 +242,18 @@ PianoStation_t *BarStateGetStationList(const BarApp_t *app) {
 	return stations;
 }
 
+/*	Count stations in the list (thread-safe)
+ */
+size_t BarStateGetStationCount(const BarApp_t *app) {
+	assert(app != NULL);
+	
+	size_t count;
+	WITH_STATE_LOCK_RETURN(app, "GetStationCount", count, NULL) {
+		count = app->ph.stations ? PianoListCountP(app->ph.stations) : 0;
+	}
+	return count;
+}
+
 /*	Get playlist (thread-safe)
  */
 PianoSong_t *BarStateGetPlaylist(const BarApp_t *app) {
@@ -296,6 +310,76 @@ void BarStateDrainPlaylist(BarApp_t *app) {
 	BarStateSignalPlaybackManager(app);
 }
 
+/*	Record finished song in history (thread-safe)
+ */
+void BarStateHistoryPush(BarApp_t *app, const PianoSong_t *song) {
+	assert(app != NULL);
+	assert(song != NULL);
+
+	if (app->settings.history == 0 && app->songHistory == NULL) {
+		return;
+	}
+
+	WITH_STATE_LOCK(app, "HistoryPush", NULL) {
+		if (app->songHistory == NULL) {
+			app->songHistory = calloc(1, sizeof(*app->songHistory));
+		}
+		if (app->songHistory != NULL) {
+			BarSongHistoryPush(app->songHistory, app->settings.history, song);
+		}
+	}
+}
+
+/*	Update rating of a history entry after love/ban (thread-safe)
+ */
+void BarStateHistorySetRating(BarApp_t *app, const char *trackToken,
+		PianoSongRating_t rating) {
+	assert(app != NULL);
+
+	WITH_STATE_LOCK(app, "HistorySetRating", NULL) {
+		if (app->songHistory != NULL) {
+			BarSongHistorySetRating(app->songHistory, trackToken, rating);
+		}
+	}
+}
+
+/*	Visit history entries newest first (thread-safe)
+ *	Returns the number of entries visited.
+ */
+size_t BarStateHistoryForeach(const BarApp_t *app,
+		BarStateHistoryVisitor_fn visit, void *ctx) {
+	assert(app != NULL);
+	assert(visit != NULL);
+
+	size_t visited = 0;
+	state_rwlock_rdlock_internal(app, "HistoryForeach");
+	const BarSongHistoryEntry_t *e;
+	while ((e = BarSongHistoryAt(app->songHistory, visited)) != NULL) {
+		++visited;
+		if (!visit(e, ctx)) {
+			break;
+		}
+	}
+	state_rwlock_unlock_internal(app, "HistoryForeach", NULL);
+	return visited;
+}
+
+/*	Free song history (thread-safe)
+ */
+void BarStateHistoryClear(BarApp_t *app) {
+	assert(app != NULL);
+
+	BarSongHistory_t *history = NULL;
+	WITH_STATE_LOCK(app, "HistoryClear", NULL) {
+		history = app->songHistory;
+		app->songHistory = NULL;
+	}
+	if (history != NULL) {
+		BarSongHistoryDestroy(history);
+		free(history);
+	}
+}
+
 /*	Switch station (drain playlist and set next station) (thread-safe)
  */
 void BarStateSwitchStation(BarApp_t *app, PianoStation_t *station) {
@@ -181,6 +181,7 @@ PianoStation_t *BarStateGetCurrentStation(const BarApp_t *app);
 void BarStateSetCurrentStation(BarApp_t *app, PianoStation_t *station);
 PianoStation_t *BarStateFindStationById(const BarApp_t *app, const char *id);
 PianoStation_t *BarStateGetStationList(const BarApp_t *app);
+size_t BarStateGetStationCount(const BarApp_t *app);
 
 /* Playlist access (thread-safe) */
 PianoSong_t *BarStateGetPlaylist(const BarApp_t *app);
@@ -190,6 +191,18 @@ PianoSong_t *BarStateAdvancePlaylist(BarApp_t *app);
 void BarStateDrainPlaylist(BarApp_t *app);
 void BarStateSwitchStation(BarApp_t *app, PianoStation_t *station);
 
+/* Song history (thread-safe). Push copies the song; the caller keeps
+ * ownership. The visitor is called newest first, under the state read lock,
+ * until it returns false; it must not block or call back into BarState*. */
+typedef bool (*BarStateHistoryVisitor_fn) (const BarSongHistoryEntry_t *entry,
+		void *ctx);
+void BarStateHistoryPush(BarApp_t *app, const PianoSong_t *song);
+void BarStateHistorySetRating(BarApp_t *app, const char *trackToken,
+		PianoSongRating_t rating);
+size_t BarStateHistoryForeach(const BarApp_t *app,
+		BarStateHistoryVisitor_fn visit, void *ctx);
+void BarStateHistoryClear(BarApp_t *app);
+
 /* Player state access (thread-safe) */
 BarPlayerMode BarStateGetPlayerMode(const BarApp_t *app);
 void BarStateGetPlayerTime(const BarApp_t *app, unsigned int *played, unsigned int *duration);
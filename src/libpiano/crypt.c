@@ -65,34 +65,56 @@ char *PianoDecryptString (gcry_cipher_hd_t h, const char * const input,
 	return (char *) output;
 }
 
+/*	blowfish-encrypt buffer in place and hex-encode the result
+ *	@param gcrypt handle
+ *	@param NUL-padded input, length must be a multiple of the block size;
+ *			contents are overwritten with the ciphertext
+ *	@param input length
+ *	@return encrypted, hex-encoded string
+ */
+char *PianoEncryptBuffer (gcry_cipher_hd_t h, unsigned char * const buf,
+		const size_t len) {
+	static const char hexDigits[] = "0123456789abcdef";
+	char *hexOutput;
+
+	assert (len % PIANO_CRYPT_BLOCKSIZE == 0);
+
+	if (gcry_cipher_encrypt (h, buf, len, NULL, 0)) {
+		return NULL;
+	}
+
+	if ((hexOutput = malloc (len*2+1)) == NULL) {
+		return NULL;
+	}
+	for (size_t i = 0; i < len; i++) {
+		hexOutput[i*2] = hexDigits[buf[i] >> 4];
+		hexOutput[i*2+1] = hexDigits[buf[i] & 0xf];
+	}
+	hexOutput[len*2] = '\0';
+
+	return hexOutput;
+}
+
 /*	blowfish-encrypt/hex-encode string
  *	@param gcrypt handle
  *	@param encrypt this
  *	@return encrypted, hex-encoded string
  */
 char *PianoEncryptString (gcry_cipher_hd_t h, const char *s) {
-	unsigned char *paddedInput, *hexOutput;
+	unsigned char *paddedInput;
+	char *hexOutput;
 	size_t inputLen = strlen (s);
-	/* blowfish expects two 32 bit blocks */
-	size_t paddedInputLen = (inputLen % 8 == 0) ? inputLen : inputLen + (8-inputLen%8);
-	gcry_error_t gret;
+	size_t paddedInputLen = PianoCryptPaddedLen (inputLen);
 
 	paddedInput = calloc (paddedInputLen+1, sizeof (*paddedInput));
-	memcpy (paddedInput, s, inputLen);
-
-	gret = gcry_cipher_encrypt (h, paddedInput, paddedInputLen, NULL, 0);
-	if (gret) {
-		free (paddedInput);
+	if (paddedInput == NULL) {
 		return NULL;
 	}
+	memcpy (paddedInput, s, inputLen);
 
-	hexOutput = calloc (paddedInputLen*2+1, sizeof (*hexOutput));
-	for (size_t i = 0; i < paddedInputLen; i++) {
-		snprintf ((char * restrict) &hexOutput[i*2], 3, "%02x", paddedInput[i]);
-	}
+	hexOutput = PianoEncryptBuffer (h, paddedInput, paddedInputLen);
 
 	free (paddedInput);
 
-	return (char *) hexOutput;
+	return hexOutput;
 }
-
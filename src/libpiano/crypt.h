@@ -31,4 +31,10 @@ THE SOFTWARE.
 char *PianoDecryptString (gcry_cipher_hd_t, const char * const,
 		size_t * const);
 char *PianoEncryptString (gcry_cipher_hd_t, const char *);
+char *PianoEncryptBuffer (gcry_cipher_hd_t, unsigned char * const, const size_t);
+
+/* blowfish works on 64 bit blocks, inputs are NUL-padded to a multiple */
+#define PIANO_CRYPT_BLOCKSIZE 8
+#define PianoCryptPaddedLen(len) (((len) + PIANO_CRYPT_BLOCKSIZE - 1) / \
+		PIANO_CRYPT_BLOCKSIZE * PIANO_CRYPT_BLOCKSIZE)
 
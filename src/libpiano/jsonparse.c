@@ -0,0 +1,591 @@
+/*
+Copyright (c) 2008-2011
+	Lars-Dominik Braun <lars@6xq.net>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "../config.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jsonparse.h"
+
+/* nesting limit, responses are at most five levels deep */
+#define PIANO_JSON_MAX_DEPTH 64
+
+typedef struct {
+	PianoJson_t *j;
+	const char *s;
+	size_t pos;
+} PianoJsonParser_t;
+
+static void PianoJsonSkipSpace (PianoJsonParser_t * const p) {
+	while (p->s[p->pos] == ' ' || p->s[p->pos] == '\t' ||
+			p->s[p->pos] == '\n' || p->s[p->pos] == '\r') {
+		++p->pos;
+	}
+}
+
+/*	append token, growing the token array as needed
+ *	@return token index or -1 if out of memory
+ */
+static int PianoJsonNewToken (PianoJsonParser_t * const p,
+		const PianoJsonType_t type, const int parent) {
+	PianoJson_t * const j = p->j;
+
+	if (j->count >= j->alloc) {
+		const int alloc = j->alloc == 0 ? 64 : j->alloc * 2;
+		PianoJsonToken_t * const tok = realloc (j->tok,
+				(size_t) alloc * sizeof (*tok));
+		if (tok == NULL) {
+			return -1;
+		}
+		j->tok = tok;
+		j->alloc = alloc;
+	}
+
+	const int idx = j->count++;
+	PianoJsonToken_t * const t = &j->tok[idx];
+	memset (t, 0, sizeof (*t));
+	t->type = type;
+	t->parent = parent;
+	t->start = p->pos;
+	return idx;
+}
+
+static bool PianoJsonIsHex (const char c) {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+			(c >= 'A' && c <= 'F');
+}
+
+static bool PianoJsonIsDigit (const char c) {
+	return c >= '0' && c <= '9';
+}
+
+/*	tokenize string, p->pos points to the opening quote
+ */
+static int PianoJsonParseString (PianoJsonParser_t * const p,
+		const int parent) {
+	assert (p->s[p->pos] == '"');
+	++p->pos;
+
+	const int idx = PianoJsonNewToken (p, PIANO_JSON_STRING, parent);
+	if (idx < 0) {
+		return -1;
+	}
+
+	bool escaped = false;
+	while (true) {
+		const unsigned char c = (unsigned char) p->s[p->pos];
+		if (c == '"') {
+			break;
+		} else if (c < 0x20) {
+			/* unterminated or raw control character */
+			return -1;
+		} else if (c == '\\') {
+			escaped = true;
+			++p->pos;
+			switch (p->s[p->pos]) {
+				case '"':
+				case '\\':
+				case '/':
+				case 'b':
+				case 'f':
+				case 'n':
+				case 'r':
+				case 't':
+					break;
+
+				case 'u':
+					for (size_t i = 1; i <= 4; i++) {
+						if (!PianoJsonIsHex (p->s[p->pos+i])) {
+							return -1;
+						}
+					}
+					p->pos += 4;
+					break;
+
+				default:
+					return -1;
+			}
+		}
+		++p->pos;
+	}
+
+	PianoJsonToken_t * const t = &p->j->tok[idx];
+	t->end = p->pos;
+	t->next = idx+1;
+	t->escaped = escaped;
+	/* closing quote */
+	++p->pos;
+	return idx;
+}
+
+static int PianoJsonParseNumber (PianoJsonParser_t * const p,
+		const int parent) {
+	const int idx = PianoJsonNewToken (p, PIANO_JSON_NUMBER, parent);
+	if (idx < 0) {
+		return -1;
+	}
+
+	const char *s = p->s;
+	size_t pos = p->pos;
+	if (s[pos] == '-') {
+		++pos;
+	}
+	if (s[pos] == '0') {
+		++pos;
+	} else if (PianoJsonIsDigit (s[pos])) {
+		while (PianoJsonIsDigit (s[pos])) {
+			++pos;
+		}
+	} else {
+		return -1;
+	}
+	if (s[pos] == '.') {
+		++pos;
+		if (!PianoJsonIsDigit (s[pos])) {
+			return -1;
+		}
+		while (PianoJsonIsDigit (s[pos])) {
+			++pos;
+		}
+	}
+	if (s[pos] == 'e' || s[pos] == 'E') {
+		++pos;
+		if (s[pos] == '+' || s[pos] == '-') {
+			++pos;
+		}
+		if (!PianoJsonIsDigit (s[pos])) {
+			return -1;
+		}
+		while (PianoJsonIsDigit (s[pos])) {
+			++pos;
+		}
+	}
+
+	p->pos = pos;
+	PianoJsonToken_t * const t = &p->j->tok[idx];
+	t->end = pos;
+	t->next = idx+1;
+	return idx;
+}
+
+static int PianoJsonParseLiteral (PianoJsonParser_t * const p,
+		const int parent, const char * const lit,
+		const PianoJsonType_t type) {
+	const size_t len = strlen (lit);
+	if (strncmp (p->s + p->pos, lit, len) != 0) {
+		return -1;
+	}
+
+	const int idx = PianoJsonNewToken (p, type, parent);
+	if (idx < 0) {
+		return -1;
+	}
+	p->pos += len;
+	PianoJsonToken_t * const t = &p->j->tok[idx];
+	t->end = p->pos;
+	t->next = idx+1;
+	return idx;
+}
+
+static int PianoJsonParseValue (PianoJsonParser_t * const p, const int parent,
+		const unsigned int depth) {
+	if (depth > PIANO_JSON_MAX_DEPTH) {
+		return -1;
+	}
+
+	PianoJsonSkipSpace (p);
+
+	switch (p->s[p->pos]) {
+		case '{':
+		case '[': {
+			const bool isObject = p->s[p->pos] == '{';
+			const char close = isObject ? '}' : ']';
+			const int idx = PianoJsonNewToken (p,
+					isObject ? PIANO_JSON_OBJECT : PIANO_JSON_ARRAY, parent);
+			if (idx < 0) {
+				return -1;
+			}
+			++p->pos;
+
+			PianoJsonSkipSpace (p);
+			if (p->s[p->pos] != close) {
+				while (true) {
+					if (isObject) {
+						PianoJsonSkipSpace (p);
+						if (p->s[p->pos] != '"' ||
+								PianoJsonParseString (p, idx) < 0) {
+							return -1;
+						}
+						PianoJsonSkipSpace (p);
+						if (p->s[p->pos] != ':') {
+							return -1;
+						}
+						++p->pos;
+					}
+					if (PianoJsonParseValue (p, idx, depth+1) < 0) {
+						return -1;
+					}
+					++p->j->tok[idx].size;
+
+					PianoJsonSkipSpace (p);
+					if (p->s[p->pos] == ',') {
+						++p->pos;
+					} else if (p->s[p->pos] == close) {
+						break;
+					} else {
+						return -1;
+					}
+				}
+			}
+			/* closing bracket */
+			++p->pos;
+
+			PianoJsonToken_t * const t = &p->j->tok[idx];
+			t->end = p->pos;
+			t->next = p->j->count;
+			return idx;
+		}
+
+		case '"':
+			return PianoJsonParseString (p, parent);
+
+		case 't':
+			return PianoJsonParseLiteral (p, parent, "true", PIANO_JSON_TRUE);
+
+		case 'f':
+			return PianoJsonParseLiteral (p, parent, "false",
+					PIANO_JSON_FALSE);
+
+		case 'n':
+			return PianoJsonParseLiteral (p, parent, "null", PIANO_JSON_NULL);
+
+		default:
+			return PianoJsonParseNumber (p, parent);
+	}
+}
+
+/*	tokenize a complete JSON document, the source string must outlive j
+ *	@param uninitialized json handle, must be destroyed even on failure
+ *	@param NUL-terminated source
+ *	@return true if src is well-formed, the root value is token 0
+ */
+bool PianoJsonParse (PianoJson_t * const j, const char * const src) {
+	assert (j != NULL);
+
+	memset (j, 0, sizeof (*j));
+	j->src = src;
+	if (src == NULL) {
+		return false;
+	}
+
+	PianoJsonParser_t p = {.j = j, .s = src, .pos = 0};
+	if (PianoJsonParseValue (&p, -1, 0) < 0) {
+		j->count = 0;
+		return false;
+	}
+	PianoJsonSkipSpace (&p);
+	if (src[p.pos] != '\0') {
+		j->count = 0;
+		return false;
+	}
+	return true;
+}
+
+void PianoJsonDestroy (PianoJson_t * const j) {
+	free (j->tok);
+	memset (j, 0, sizeof (*j));
+}
+
+static bool PianoJsonIsType (const PianoJson_t * const j, const int t,
+		const PianoJsonType_t type) {
+	return t >= 0 && t < j->count && j->tok[t].type == type;
+}
+
+static unsigned int PianoJsonHexValue (const char * const s) {
+	unsigned int v = 0;
+	for (size_t i = 0; i < 4; i++) {
+		const char c = s[i];
+		v <<= 4;
+		if (c >= '0' && c <= '9') {
+			v |= c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			v |= c - 'a' + 10;
+		} else {
+			v |= c - 'A' + 10;
+		}
+	}
+	return v;
+}
+
+static size_t PianoJsonPutUtf8 (char * const out, const uint32_t cp) {
+	unsigned char * const o = (unsigned char *) out;
+	if (cp < 0x80) {
+		o[0] = cp;
+		return 1;
+	} else if (cp < 0x800) {
+		o[0] = 0xc0 | (cp >> 6);
+		o[1] = 0x80 | (cp & 0x3f);
+		return 2;
+	} else if (cp < 0x10000) {
+		o[0] = 0xe0 | (cp >> 12);
+		o[1] = 0x80 | ((cp >> 6) & 0x3f);
+		o[2] = 0x80 | (cp & 0x3f);
+		return 3;
+	} else {
+		o[0] = 0xf0 | (cp >> 18);
+		o[1] = 0x80 | ((cp >> 12) & 0x3f);
+		o[2] = 0x80 | ((cp >> 6) & 0x3f);
+		o[3] = 0x80 | (cp & 0x3f);
+		return 4;
+	}
+}
+
+/*	decode escaped string into out, which must hold at least end-start+1
+ *	bytes (decoding never grows the string)
+ */
+static void PianoJsonUnescape (const char *in, const char * const end,
+		char *out) {
+	while (in < end) {
+		if (*in != '\\') {
+			*out++ = *in++;
+			continue;
+		}
+		++in;
+		switch (*in) {
+			case 'b':
+				*out++ = '\b';
+				break;
+
+			case 'f':
+				*out++ = '\f';
+				break;
+
+			case 'n':
+				*out++ = '\n';
+				break;
+
+			case 'r':
+				*out++ = '\r';
+				break;
+
+			case 't':
+				*out++ = '\t';
+				break;
+
+			case 'u': {
+				uint32_t cp = PianoJsonHexValue (in+1);
+				in += 4;
+				if (cp >= 0xd800 && cp <= 0xdbff && end - in >= 7 &&
+						in[1] == '\\' && in[2] == 'u') {
+					const uint32_t low = PianoJsonHexValue (in+3);
+					if (low >= 0xdc00 && low <= 0xdfff) {
+						cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+						in += 6;
+					}
+				}
+				if (cp >= 0xd800 && cp <= 0xdfff) {
+					/* unpaired surrogate */
+					cp = 0xfffd;
+				}
+				out += PianoJsonPutUtf8 (out, cp);
+				break;
+			}
+
+			default:
+				/* quote, backslash, slash */
+				*out++ = *in;
+				break;
+		}
+		++in;
+	}
+	*out = '\0';
+}
+
+/*	compare string token t with s, without allocating for the common
+ *	unescaped case
+ */
+bool PianoJsonStrEq (const PianoJson_t * const j, const int t,
+		const char * const s) {
+	assert (s != NULL);
+
+	if (!PianoJsonIsType (j, t, PIANO_JSON_STRING)) {
+		return false;
+	}
+
+	const PianoJsonToken_t * const tok = &j->tok[t];
+	const size_t len = tok->end - tok->start;
+	if (!tok->escaped) {
+		return strlen (s) == len && memcmp (j->src + tok->start, s, len) == 0;
+	}
+
+	char * const buf = malloc (len+1);
+	if (buf == NULL) {
+		return false;
+	}
+	PianoJsonUnescape (j->src + tok->start, j->src + tok->end, buf);
+	const bool equal = strcmp (buf, s) == 0;
+	free (buf);
+	return equal;
+}
+
+/*	look up key in object o
+ *	@return value token or -1 if o is not an object or has no such key
+ */
+int PianoJsonGet (const PianoJson_t * const j, const int o,
+		const char * const key) {
+	assert (j != NULL);
+	assert (key != NULL);
+
+	if (!PianoJsonIsType (j, o, PIANO_JSON_OBJECT)) {
+		return -1;
+	}
+
+	int k = o+1;
+	for (unsigned int i = 0; i < j->tok[o].size; i++) {
+		if (PianoJsonStrEq (j, k, key)) {
+			return k+1;
+		}
+		/* skip key and value subtree */
+		k = j->tok[k+1].next;
+	}
+	return -1;
+}
+
+unsigned int PianoJsonArrayLength (const PianoJson_t * const j, const int a) {
+	return PianoJsonIsType (j, a, PIANO_JSON_ARRAY) ? j->tok[a].size : 0;
+}
+
+int PianoJsonArrayFirst (const PianoJson_t * const j, const int a) {
+	return PianoJsonArrayLength (j, a) > 0 ? a+1 : -1;
+}
+
+int PianoJsonArrayNext (const PianoJson_t * const j, const int e) {
+	assert (e >= 0 && e < j->count);
+
+	const int parent = j->tok[e].parent;
+	assert (parent >= 0);
+	const int next = j->tok[e].next;
+	return next < j->tok[parent].next ? next : -1;
+}
+
+/*	copy value of key in object o
+ *	@return decoded string, raw JSON text for non-string values or NULL if the
+ *		key does not exist or is null
+ */
+char *PianoJsonStrdup (const PianoJson_t * const j, const int o,
+		const char * const key) {
+	const int v = PianoJsonGet (j, o, key);
+	if (v < 0 || j->tok[v].type == PIANO_JSON_NULL) {
+		return NULL;
+	}
+
+	const PianoJsonToken_t * const tok = &j->tok[v];
+	const size_t len = tok->end - tok->start;
+	char * const ret = malloc (len+1);
+	if (ret == NULL) {
+		return NULL;
+	}
+	if (tok->escaped) {
+		PianoJsonUnescape (j->src + tok->start, j->src + tok->end, ret);
+	} else {
+		memcpy (ret, j->src + tok->start, len);
+		ret[len] = '\0';
+	}
+	return ret;
+}
+
+bool PianoJsonGetBool (const PianoJson_t * const j, const int o,
+		const char * const key, const bool def) {
+	const int v = PianoJsonGet (j, o, key);
+	if (v < 0) {
+		return def;
+	}
+
+	const PianoJsonToken_t * const tok = &j->tok[v];
+	switch (tok->type) {
+		case PIANO_JSON_TRUE:
+			return true;
+
+		case PIANO_JSON_NUMBER:
+			return strtod (j->src + tok->start, NULL) != 0.0;
+
+		case PIANO_JSON_STRING:
+			return tok->end > tok->start;
+
+		default:
+			return false;
+	}
+}
+
+long PianoJsonGetInt (const PianoJson_t * const j, const int o,
+		const char * const key, const long def) {
+	const int v = PianoJsonGet (j, o, key);
+	if (v < 0) {
+		return def;
+	}
+
+	const PianoJsonToken_t * const tok = &j->tok[v];
+	switch (tok->type) {
+		case PIANO_JSON_NUMBER:
+		case PIANO_JSON_STRING: {
+			/* numbers are delimited by the following token, strings by their
+			 * closing quote */
+			char *end;
+			const long ret = strtol (j->src + tok->start, &end, 10);
+			if (*end == '.' || *end == 'e' || *end == 'E') {
+				return (long) strtod (j->src + tok->start, NULL);
+			}
+			return ret;
+		}
+
+		case PIANO_JSON_TRUE:
+			return 1;
+
+		default:
+			return 0;
+	}
+}
+
+double PianoJsonGetDouble (const PianoJson_t * const j, const int o,
+		const char * const key, const double def) {
+	const int v = PianoJsonGet (j, o, key);
+	if (v < 0) {
+		return def;
+	}
+
+	const PianoJsonToken_t * const tok = &j->tok[v];
+	switch (tok->type) {
+		case PIANO_JSON_NUMBER:
+		case PIANO_JSON_STRING:
+			return strtod (j->src + tok->start, NULL);
+
+		case PIANO_JSON_TRUE:
+			return 1.0;
+
+		default:
+			return 0.0;
+	}
+}
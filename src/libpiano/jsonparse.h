@@ -0,0 +1,82 @@
+/*
+Copyright (c) 2008-2011
+	Lars-Dominik Braun <lars@6xq.net>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Lazy JSON reader for API responses. The input is tokenized once into a flat
+ * array of (type, byte range) records; nothing is copied or decoded until a
+ * caller asks for a specific value. Values are addressed by token index, -1
+ * means "absent" and is accepted everywhere. */
+
+typedef enum {
+	PIANO_JSON_OBJECT = 0,
+	PIANO_JSON_ARRAY,
+	PIANO_JSON_STRING,
+	PIANO_JSON_NUMBER,
+	PIANO_JSON_TRUE,
+	PIANO_JSON_FALSE,
+	PIANO_JSON_NULL,
+} PianoJsonType_t;
+
+typedef struct {
+	/* byte range in source, excluding quotes for strings */
+	size_t start, end;
+	/* index of the first token after this value (and all of its children) */
+	int next;
+	/* enclosing object/array, -1 for the root */
+	int parent;
+	/* object: number of keys, array: number of elements */
+	unsigned int size;
+	PianoJsonType_t type;
+	/* string contains escape sequences and must be decoded */
+	bool escaped;
+} PianoJsonToken_t;
+
+typedef struct {
+	const char *src;
+	PianoJsonToken_t *tok;
+	int count, alloc;
+} PianoJson_t;
+
+bool PianoJsonParse (PianoJson_t *, const char *);
+void PianoJsonDestroy (PianoJson_t *);
+
+int PianoJsonGet (const PianoJson_t *, int, const char *);
+unsigned int PianoJsonArrayLength (const PianoJson_t *, int);
+int PianoJsonArrayFirst (const PianoJson_t *, int);
+int PianoJsonArrayNext (const PianoJson_t *, int);
+bool PianoJsonStrEq (const PianoJson_t *, int, const char *);
+
+char *PianoJsonStrdup (const PianoJson_t *, int, const char *);
+bool PianoJsonGetBool (const PianoJson_t *, int, const char *, bool);
+long PianoJsonGetInt (const PianoJson_t *, int, const char *, long);
+double PianoJsonGetDouble (const PianoJson_t *, int, const char *, double);
+
+/* iterate over the elements of array a */
+#define PianoJsonArrayForeach(j, a, e) \
+	for (int e = PianoJsonArrayFirst ((j), (a)); e >= 0; \
+			e = PianoJsonArrayNext ((j), e))
+
@@ -196,6 +196,16 @@ void PianoDestroyStationMode (PianoStationMode_t * const modes) {
 	}
 }
 
+/*	free station list diff, including the removed stations
+ *	@param diff returned by PIANO_REQUEST_GET_STATIONS
+ */
+void PianoDestroyGetStations (PianoRequestDataGetStations_t *data) {
+	PianoDestroyStations (data->removed);
+	free (data->added);
+	free (data->changed);
+	memset (data, 0, sizeof (*data));
+}
+
 /*	frees the whole piano handle structure
  *	@param piano handle
  *	@return nothing
@@ -204,6 +214,7 @@ void PianoDestroy (PianoHandle_t *ph) {
 	PianoDestroyUserInfo (&ph->user);
 	PianoDestroyStations (ph->stations);
 	PianoDestroyPartner (&ph->partner);
+	free (ph->requestBuf.data);
 	/* destroy genre stations */
 	PianoGenreCategory_t *curGenreCat = ph->genreStations, *lastGenreCat;
 	while (curGenreCat != NULL) {
@@ -130,6 +130,12 @@ typedef struct PianoPartner {
 	unsigned int id;
 } PianoPartner_t;
 
+/* growable byte buffer */
+typedef struct {
+	char *data;
+	size_t len, size;
+} PianoBuffer_t;
+
 typedef struct PianoHandle {
 	PianoUserInfo_t user;
 	/* linked lists */
@@ -137,6 +143,8 @@ typedef struct PianoHandle {
 	PianoGenreCategory_t *genreStations;
 	PianoPartner_t partner;
 	int timeOffset;
+	/* request body scratch space, reused by every PianoRequest call */
+	PianoBuffer_t requestBuf;
 } PianoHandle_t;
 
 typedef struct PianoSearchResult {
@@ -224,6 +232,16 @@ typedef struct {
 	PianoSongRating_t rating;
 } PianoRequestDataAddFeedback_t;
 
+/* optional, receives the difference to the previous station list */
+typedef struct {
+	/* stations no longer in the account; unlinked from ph->stations but not
+	 * freed, so callers can drop references first */
+	PianoStation_t *removed;
+	/* new and modified stations, still owned by ph->stations */
+	PianoStation_t **added, **changed;
+	size_t addedCount, changedCount;
+} PianoRequestDataGetStations_t;
+
 typedef struct {
 	PianoStation_t *station;
 	char *newName;
@@ -376,6 +394,7 @@ void PianoDestroyPlaylist (PianoSong_t *);
 void PianoDestroySearchResult (PianoSearchResult_t *);
 void PianoDestroyStationInfo (PianoStationInfo_t *);
 void PianoDestroyStationMode (PianoStationMode_t * const);
+void PianoDestroyGetStations (PianoRequestDataGetStations_t *);
 
 /* pandora rpc */
 PianoReturn_t PianoRequest (PianoHandle_t *, PianoRequest_t *,
@@ -23,15 +23,285 @@ THE SOFTWARE.
 
 #include "../config.h"
 
-#include <curl/curl.h>
-#include <json.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "piano.h"
 #include "crypt.h"
 
+/* minimal streaming json writer, emits request bodies directly into the
+ * handle's reusable request buffer */
+typedef struct {
+	PianoBuffer_t *buf;
+	bool needComma;
+	bool failed;
+} PianoJsonWriter_t;
+
+/*	make room for at least n more bytes (plus block padding and NUL)
+ *	@param writer
+ *	@param bytes
+ *	@return true on success
+ */
+static bool PianoJsonReserve (PianoJsonWriter_t * const w, const size_t n) {
+	PianoBuffer_t * const b = w->buf;
+
+	if (w->failed) {
+		return false;
+	}
+
+	const size_t need = b->len + n + PIANO_CRYPT_BLOCKSIZE + 1;
+	if (need > b->size) {
+		size_t newSize = b->size > 0 ? b->size : 512;
+		while (newSize < need) {
+			newSize *= 2;
+		}
+		char * const newData = realloc (b->data, newSize);
+		if (newData == NULL) {
+			w->failed = true;
+			return false;
+		}
+		b->data = newData;
+		b->size = newSize;
+	}
+	return true;
+}
+
+static void PianoJsonPutRaw (PianoJsonWriter_t * const w, const char * const s,
+		const size_t len) {
+	if (PianoJsonReserve (w, len)) {
+		memcpy (&w->buf->data[w->buf->len], s, len);
+		w->buf->len += len;
+	}
+}
+
+static void PianoJsonPutChar (PianoJsonWriter_t * const w, const char c) {
+	if (PianoJsonReserve (w, 1)) {
+		w->buf->data[w->buf->len++] = c;
+	}
+}
+
+/*	write quoted and escaped json string
+ */
+static void PianoJsonPutString (PianoJsonWriter_t * const w,
+		const char *s) {
+	static const char hexDigits[] = "0123456789abcdef";
+
+	PianoJsonPutChar (w, '"');
+	while (*s != '\0') {
+		/* copy runs of characters that need no escaping in one go */
+		const char *start = s;
+		while (*s != '\0' && *s != '"' && *s != '\\' &&
+				(unsigned char) *s >= 0x20) {
+			++s;
+		}
+		PianoJsonPutRaw (w, start, s - start);
+		if (*s == '\0') {
+			break;
+		}
+
+		char esc[6] = {'\\', 0, 0, 0, 0, 0};
+		size_t escLen = 2;
+		switch (*s) {
+			case '"':
+			case '\\':
+				esc[1] = *s;
+				break;
+
+			case '\b':
+				esc[1] = 'b';
+				break;
+
+			case '\f':
+				esc[1] = 'f';
+				break;
+
+			case '\n':
+				esc[1] = 'n';
+				break;
+
+			case '\r':
+				esc[1] = 'r';
+				break;
+
+			case '\t':
+				esc[1] = 't';
+				break;
+
+			default:
+				esc[1] = 'u';
+				esc[2] = '0';
+				esc[3] = '0';
+				esc[4] = hexDigits[((unsigned char) *s) >> 4];
+				esc[5] = hexDigits[((unsigned char) *s) & 0xf];
+				escLen = 6;
+				break;
+		}
+		PianoJsonPutRaw (w, esc, escLen);
+		++s;
+	}
+	PianoJsonPutChar (w, '"');
+}
+
+/*	write separator and "key": prefix of an object member
+ */
+static void PianoJsonPutKey (PianoJsonWriter_t * const w,
+		const char * const key) {
+	if (w->needComma) {
+		PianoJsonPutChar (w, ',');
+	}
+	PianoJsonPutString (w, key);
+	PianoJsonPutChar (w, ':');
+	w->needComma = true;
+}
+
+/*	start a new request body in the handle's buffer
+ */
+static void PianoJsonBegin (PianoJsonWriter_t * const w,
+		PianoBuffer_t * const buf) {
+	w->buf = buf;
+	w->needComma = false;
+	w->failed = false;
+	buf->len = 0;
+	PianoJsonPutChar (w, '{');
+}
+
+static void PianoJsonAddString (PianoJsonWriter_t * const w,
+		const char * const key, const char * const value) {
+	assert (value != NULL);
+	PianoJsonPutKey (w, key);
+	PianoJsonPutString (w, value);
+}
+
+static void PianoJsonAddBool (PianoJsonWriter_t * const w,
+		const char * const key, const bool value) {
+	PianoJsonPutKey (w, key);
+	if (value) {
+		PianoJsonPutRaw (w, "true", 4);
+	} else {
+		PianoJsonPutRaw (w, "false", 5);
+	}
+}
+
+static void PianoJsonAddInt (PianoJsonWriter_t * const w,
+		const char * const key, const long long value) {
+	char num[24];
+	const int len = snprintf (num, sizeof (num), "%lld", value);
+	PianoJsonPutKey (w, key);
+	PianoJsonPutRaw (w, num, len);
+}
+
+static void PianoJsonBeginArray (PianoJsonWriter_t * const w,
+		const char * const key) {
+	PianoJsonPutKey (w, key);
+	PianoJsonPutChar (w, '[');
+	w->needComma = false;
+}
+
+static void PianoJsonArrayAddString (PianoJsonWriter_t * const w,
+		const char * const value) {
+	if (w->needComma) {
+		PianoJsonPutChar (w, ',');
+	}
+	PianoJsonPutString (w, value);
+	w->needComma = true;
+}
+
+static void PianoJsonEndArray (PianoJsonWriter_t * const w) {
+	PianoJsonPutChar (w, ']');
+	w->needComma = true;
+}
+
+/*	close the request body, NUL-pad it to the cipher block size
+ *	@param writer
+ *	@return padded body length or 0 on allocation failure
+ */
+static size_t PianoJsonFinish (PianoJsonWriter_t * const w) {
+	PianoJsonPutChar (w, '}');
+	if (w->failed) {
+		return 0;
+	}
+
+	/* PianoJsonReserve always leaves room for padding and terminator */
+	PianoBuffer_t * const b = w->buf;
+	const size_t paddedLen = PianoCryptPaddedLen (b->len);
+	memset (&b->data[b->len], 0, paddedLen - b->len + 1);
+	return paddedLen;
+}
+
+/*	url-encode string, everything but RFC 3986 unreserved characters
+ *	@param input string
+ *	@param output buffer
+ *	@param output buffer size
+ *	@return false if output buffer is too small
+ */
+static bool PianoUrlEscape (const char *in, char * const out,
+		const size_t outSize) {
+	static const char hexDigits[] = "0123456789ABCDEF";
+	size_t pos = 0;
+
+	assert (outSize > 0);
+
+	for (; *in != '\0'; ++in) {
+		const unsigned char c = *in;
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+				(c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+				c == '~') {
+			if (pos + 1 >= outSize) {
+				return false;
+			}
+			out[pos++] = c;
+		} else {
+			if (pos + 3 >= outSize) {
+				return false;
+			}
+			out[pos++] = '%';
+			out[pos++] = hexDigits[c >> 4];
+			out[pos++] = hexDigits[c & 0xf];
+		}
+	}
+	out[pos] = '\0';
+
+	return true;
+}
+
+/*	set rpc url path, auth token is url-encoded in place
+ *	@param request structure
+ *	@param api method
+ *	@param auth token
+ *	@param partner id
+ *	@param user id or NULL
+ *	@return false if the path does not fit
+ */
+static bool PianoRequestUrlPath (PianoRequest_t *req, const char *method,
+		const char *authToken, const int partnerId, const char *userId) {
+	char * const buf = req->urlPath;
+	const size_t size = sizeof (req->urlPath);
+	size_t pos;
+	int n;
+
+	n = snprintf (buf, size, PIANO_RPC_PATH "method=%s&auth_token=", method);
+	if (n < 0 || (size_t) n >= size) {
+		return false;
+	}
+	pos = (size_t) n;
+
+	if (!PianoUrlEscape (authToken, buf + pos, size - pos)) {
+		return false;
+	}
+	pos += strlen (buf + pos);
+
+	if (userId != NULL) {
+		n = snprintf (buf + pos, size - pos, "&partner_id=%i&user_id=%s",
+				partnerId, userId);
+	} else {
+		n = snprintf (buf + pos, size - pos, "&partner_id=%i", partnerId);
+	}
+	return n >= 0 && (size_t) n < size - pos;
+}
+
 /*	prepare piano request (initializes request type, urlpath and postData)
  *	@param piano handle
  *	@param request structure
@@ -40,9 +310,8 @@ THE SOFTWARE.
 PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 		PianoRequestType_t type) {
 	PianoReturn_t ret = PIANO_RET_OK;
-	const char *jsonSendBuf;
 	const char *method = NULL;
-	json_object *j = json_object_new_object ();
+	PianoJsonWriter_t j;
 	/* corrected timestamp */
 	time_t timestamp = time (NULL) - ph->timeOffset;
 	bool encrypted = true;
@@ -54,6 +323,8 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 	/* no tls by default */
 	req->secure = false;
 
+	PianoJsonBegin (&j, &ph->requestBuf);
+
 	switch (req->type) {
 		case PIANO_REQUEST_LOGIN: {
 			/* authenticate user */
@@ -66,46 +337,30 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 					encrypted = false;
 					req->secure = true;
 
-					json_object_object_add (j, "username",
-							json_object_new_string (ph->partner.user));
-					json_object_object_add (j, "password",
-							json_object_new_string (ph->partner.password));
-					json_object_object_add (j, "deviceModel",
-							json_object_new_string (ph->partner.device));
-					json_object_object_add (j, "version",
-							json_object_new_string ("5"));
-					json_object_object_add (j, "includeUrls",
-							json_object_new_boolean (true));
+					PianoJsonAddString (&j, "username", ph->partner.user);
+					PianoJsonAddString (&j, "password", ph->partner.password);
+					PianoJsonAddString (&j, "deviceModel", ph->partner.device);
+					PianoJsonAddString (&j, "version", "5");
+					PianoJsonAddBool (&j, "includeUrls", true);
 					snprintf (req->urlPath, sizeof (req->urlPath),
 							PIANO_RPC_PATH "method=auth.partnerLogin");
 					break;
 
 				case 1: {
-					char *urlencAuthToken;
-
 					req->secure = true;
 
-					json_object_object_add (j, "loginType",
-							json_object_new_string ("user"));
-					json_object_object_add (j, "username",
-							json_object_new_string (logindata->user));
-					json_object_object_add (j, "password",
-							json_object_new_string (logindata->password));
-					json_object_object_add (j, "partnerAuthToken",
-							json_object_new_string (ph->partner.authToken));
-					json_object_object_add (j, "syncTime",
-							json_object_new_int (timestamp));
-
-					CURL * const curl = curl_easy_init ();
-					urlencAuthToken = curl_easy_escape (curl,
-							ph->partner.authToken, 0);
-					assert (urlencAuthToken != NULL);
-					snprintf (req->urlPath, sizeof (req->urlPath),
-							PIANO_RPC_PATH "method=auth.userLogin&"
-							"auth_token=%s&partner_id=%i", urlencAuthToken,
-							ph->partner.id);
-					curl_free (urlencAuthToken);
-					curl_easy_cleanup (curl);
+					PianoJsonAddString (&j, "loginType", "user");
+					PianoJsonAddString (&j, "username", logindata->user);
+					PianoJsonAddString (&j, "password", logindata->password);
+					PianoJsonAddString (&j, "partnerAuthToken",
+							ph->partner.authToken);
+					PianoJsonAddInt (&j, "syncTime", timestamp);
+
+					if (!PianoRequestUrlPath (req, "auth.userLogin",
+							ph->partner.authToken, ph->partner.id, NULL)) {
+						ret = PIANO_RET_ERR;
+						goto cleanup;
+					}
 
 					break;
 				}
@@ -117,8 +372,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			/* get stations, user must be authenticated */
 			assert (ph->user.listenerId != NULL);
 
-			json_object_object_add (j, "returnAllStations",
-					json_object_new_boolean (true));
+			PianoJsonAddBool (&j, "returnAllStations", true);
 
 			method = "user.getStationList";
 			break;
@@ -134,10 +388,8 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 
 			req->secure = true;
 
-			json_object_object_add (j, "stationToken",
-					json_object_new_string (reqData->station->id));
-			json_object_object_add (j, "includeTrackLength",
-					json_object_new_boolean (true));
+			PianoJsonAddString (&j, "stationToken", reqData->station->id);
+			PianoJsonAddBool (&j, "includeTrackLength", true);
 
 			method = "station.getPlaylist";
 			break;
@@ -153,12 +405,9 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			assert (reqData->rating != PIANO_RATE_NONE &&
 					reqData->rating != PIANO_RATE_TIRED);
 
-			json_object_object_add (j, "stationToken",
-					json_object_new_string (reqData->stationId));
-			json_object_object_add (j, "trackToken",
-					json_object_new_string (reqData->trackToken));
-			json_object_object_add (j, "isPositive",
-					json_object_new_boolean (reqData->rating == PIANO_RATE_LOVE));
+			PianoJsonAddString (&j, "stationToken", reqData->stationId);
+			PianoJsonAddString (&j, "trackToken", reqData->trackToken);
+			PianoJsonAddBool (&j, "isPositive", reqData->rating == PIANO_RATE_LOVE);
 
 			method = "station.addFeedback";
 			break;
@@ -171,10 +420,8 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			assert (reqData->station != NULL);
 			assert (reqData->newName != NULL);
 
-			json_object_object_add (j, "stationToken",
-					json_object_new_string (reqData->station->id));
-			json_object_object_add (j, "stationName",
-					json_object_new_string (reqData->newName));
+			PianoJsonAddString (&j, "stationToken", reqData->station->id);
+			PianoJsonAddString (&j, "stationName", reqData->newName);
 
 			method = "station.renameStation";
 			break;
@@ -187,8 +434,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			assert (station != NULL);
 			assert (station->id != NULL);
 
-			json_object_object_add (j, "stationToken",
-					json_object_new_string (station->id));
+			PianoJsonAddString (&j, "stationToken", station->id);
 
 			method = "station.deleteStation";
 			break;
@@ -201,8 +447,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			assert (reqData != NULL);
 			assert (reqData->searchStr != NULL);
 
-			json_object_object_add (j, "searchText",
-					json_object_new_string (reqData->searchStr));
+			PianoJsonAddString (&j, "searchText", reqData->searchStr);
 
 			method = "music.search";
 			break;
@@ -216,20 +461,16 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			assert (reqData->token != NULL);
 
 			if (reqData->type == PIANO_MUSICTYPE_INVALID) {
-				json_object_object_add (j, "musicToken",
-						json_object_new_string (reqData->token));
+				PianoJsonAddString (&j, "musicToken", reqData->token);
 			} else {
-				json_object_object_add (j, "trackToken",
-						json_object_new_string (reqData->token));
+				PianoJsonAddString (&j, "trackToken", reqData->token);
 				switch (reqData->type) {
 					case PIANO_MUSICTYPE_SONG:
-						json_object_object_add (j, "musicType",
-								json_object_new_string ("song"));
+						PianoJsonAddString (&j, "musicType", "song");
 						break;
 
 					case PIANO_MUSICTYPE_ARTIST:
-						json_object_object_add (j, "musicType",
-								json_object_new_string ("artist"));
+						PianoJsonAddString (&j, "musicType", "artist");
 						break;
 
 					default:
@@ -250,10 +491,8 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			assert (reqData->station != NULL);
 			assert (reqData->musicId != NULL);
 
-			json_object_object_add (j, "musicToken",
-					json_object_new_string (reqData->musicId));
-			json_object_object_add (j, "stationToken",
-					json_object_new_string (reqData->station->id));
+			PianoJsonAddString (&j, "musicToken", reqData->musicId);
+			PianoJsonAddString (&j, "stationToken", reqData->station->id);
 
 			method = "station.addMusic";
 			break;
@@ -265,8 +504,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 
 			assert (song != NULL);
 
-			json_object_object_add (j, "trackToken",
-					json_object_new_string (song->trackToken));
+			PianoJsonAddString (&j, "trackToken", song->trackToken);
 
 			method = "user.sleepSong";
 			break;
@@ -276,17 +514,15 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			/* select stations included in quickmix (see useQuickMix flag of
 			 * PianoStation_t) */
 			PianoStation_t *curStation = ph->stations;
-			json_object *a = json_object_new_array ();
 
+			PianoJsonBeginArray (&j, "quickMixStationIds");
 			PianoListForeachP (curStation) {
 				/* quick mix can't contain itself */
 				if (curStation->useQuickMix && !curStation->isQuickMix) {
-					json_object_array_add (a,
-							json_object_new_string (curStation->id));
+					PianoJsonArrayAddString (&j, curStation->id);
 				}
 			}
-
-			json_object_object_add (j, "quickMixStationIds", a);
+			PianoJsonEndArray (&j);
 
 			method = "user.setQuickMix";
 			break;
@@ -304,8 +540,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 
 			assert (station != NULL);
 
-			json_object_object_add (j, "stationToken",
-					json_object_new_string (station->id));
+			PianoJsonAddString (&j, "stationToken", station->id);
 
 			method = "station.transformSharedStation";
 			break;
@@ -318,8 +553,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			assert (reqData != NULL);
 			assert (reqData->song != NULL);
 
-			json_object_object_add (j, "trackToken",
-					json_object_new_string (reqData->song->trackToken));
+			PianoJsonAddString (&j, "trackToken", reqData->song->trackToken);
 
 			method = "track.explainTrack";
 			break;
@@ -331,8 +565,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 
 			assert (song != NULL);
 
-			json_object_object_add (j, "trackToken",
-					json_object_new_string (song->trackToken));
+			PianoJsonAddString (&j, "trackToken", song->trackToken);
 
 			method = "bookmark.addSongBookmark";
 			break;
@@ -344,8 +577,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 
 			assert (song != NULL);
 
-			json_object_object_add (j, "trackToken",
-					json_object_new_string (song->trackToken));
+			PianoJsonAddString (&j, "trackToken", song->trackToken);
 
 			method = "bookmark.addArtistBookmark";
 			break;
@@ -358,12 +590,9 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			assert (reqData != NULL);
 			assert (reqData->station != NULL);
 
-			json_object_object_add (j, "stationToken",
-					json_object_new_string (reqData->station->id));
-			json_object_object_add (j, "includeExtendedAttributes",
-					json_object_new_boolean (true));
-			json_object_object_add (j, "includeExtraParams",
-					json_object_new_boolean (true));
+			PianoJsonAddString (&j, "stationToken", reqData->station->id);
+			PianoJsonAddBool (&j, "includeExtendedAttributes", true);
+			PianoJsonAddBool (&j, "includeExtraParams", true);
 
 			method = "station.getStation";
 			break;
@@ -375,8 +604,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			PianoStation_t * const station = reqData->station;
 			assert (station != NULL);
 
-			json_object_object_add (j, "stationId",
-					json_object_new_string (station->id));
+			PianoJsonAddString (&j, "stationId", station->id);
 
 			method = "interactiveradio.v1.getAvailableModesSimple";
 			req->secure = true;
@@ -389,10 +617,8 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			PianoStation_t * const station = reqData->station;
 			assert (station != NULL);
 
-			json_object_object_add (j, "stationId",
-					json_object_new_string (station->id));
-			json_object_object_add (j, "modeId",
-					json_object_new_int (reqData->id));
+			PianoJsonAddString (&j, "stationId", station->id);
+			PianoJsonAddInt (&j, "modeId", reqData->id);
 
 			method = "interactiveradio.v1.setAndGetAvailableModes";
 			req->secure = true;
@@ -404,8 +630,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 
 			assert (song != NULL);
 
-			json_object_object_add (j, "feedbackId",
-					json_object_new_string (song->feedbackId));
+			PianoJsonAddString (&j, "feedbackId", song->feedbackId);
 
 			method = "station.deleteFeedback";
 			break;
@@ -429,8 +654,7 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 
 			assert (seedId != NULL);
 
-			json_object_object_add (j, "seedId",
-					json_object_new_string (seedId));
+			PianoJsonAddString (&j, "seedId", seedId);
 
 			method = "station.deleteMusic";
 			break;
@@ -447,23 +671,18 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 			assert (reqData->currentPassword != NULL);
 			assert (reqData->currentUsername != NULL);
 
-			json_object_object_add (j, "userInitiatedChange",
-					json_object_new_boolean (true));
-			json_object_object_add (j, "currentUsername",
-					json_object_new_string (reqData->currentUsername));
-			json_object_object_add (j, "currentPassword",
-					json_object_new_string (reqData->currentPassword));
+			PianoJsonAddBool (&j, "userInitiatedChange", true);
+			PianoJsonAddString (&j, "currentUsername", reqData->currentUsername);
+			PianoJsonAddString (&j, "currentPassword", reqData->currentPassword);
 
 			if (reqData->explicitContentFilter != PIANO_UNDEFINED) {
-				json_object_object_add (j, "isExplicitContentFilterEnabled",
-						json_object_new_boolean (
-						reqData->explicitContentFilter == PIANO_TRUE));
+				PianoJsonAddBool (&j, "isExplicitContentFilterEnabled",
+						reqData->explicitContentFilter == PIANO_TRUE);
 			}
 
 #define changeIfSet(field) \
 	if (reqData->field != NULL) { \
-		json_object_object_add (j, #field, \
-				json_object_new_string (reqData->field)); \
+		PianoJsonAddString (&j, #field, reqData->field); \
 	}
 
 			changeIfSet (newUsername);
@@ -504,50 +723,34 @@ PianoReturn_t PianoRequest (PianoHandle_t *ph, PianoRequest_t *req,
 
 	/* standard parameter */
 	if (method != NULL) {
-		char *urlencAuthToken;
-
 		assert (ph->user.authToken != NULL);
 
-		CURL * const curl = curl_easy_init ();
-		if (curl == NULL) {
-			ret = PIANO_RET_OUT_OF_MEMORY;
+		if (!PianoRequestUrlPath (req, method, ph->user.authToken,
+				ph->partner.id, ph->user.listenerId)) {
+			ret = PIANO_RET_ERR;
 			goto cleanup;
 		}
-		urlencAuthToken = curl_easy_escape (curl,
-				ph->user.authToken, 0);
-		if (urlencAuthToken == NULL) {
-			ret = PIANO_RET_OUT_OF_MEMORY;
-			curl_easy_cleanup (curl);
-			goto cleanup;
-		}
-
-		snprintf (req->urlPath, sizeof (req->urlPath), PIANO_RPC_PATH
-				"method=%s&auth_token=%s&partner_id=%i&user_id=%s", method,
-				urlencAuthToken, ph->partner.id, ph->user.listenerId);
 
-		curl_free (urlencAuthToken);
-		curl_easy_cleanup (curl);
-
-		json_object_object_add (j, "userAuthToken",
-				json_object_new_string (ph->user.authToken));
-		json_object_object_add (j, "syncTime",
-				json_object_new_int (timestamp));
+		PianoJsonAddString (&j, "userAuthToken", ph->user.authToken);
+		PianoJsonAddInt (&j, "syncTime", timestamp);
 	}
 
-	/* json to string */
-	jsonSendBuf = json_object_to_json_string (j);
-	if (encrypted) {
-		if ((req->postData = PianoEncryptString (ph->partner.out,
-				jsonSendBuf)) == NULL) {
+	/* close body; it is already NUL-padded to the cipher block size, so it
+	 * can be encrypted in place */
+	const size_t bodyLen = PianoJsonFinish (&j);
+	if (bodyLen == 0) {
+		ret = PIANO_RET_OUT_OF_MEMORY;
+	} else if (encrypted) {
+		if ((req->postData = PianoEncryptBuffer (ph->partner.out,
+				(unsigned char *) ph->requestBuf.data, bodyLen)) == NULL) {
 			ret = PIANO_RET_OUT_OF_MEMORY;
 		}
 	} else {
-		req->postData = strdup (jsonSendBuf);
+		if ((req->postData = strdup (ph->requestBuf.data)) == NULL) {
+			ret = PIANO_RET_OUT_OF_MEMORY;
+		}
 	}
 
 cleanup:
-	json_object_put (j);
-
 	return ret;
 }
-
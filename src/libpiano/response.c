@@ -23,7 +23,6 @@ THE SOFTWARE.
 
 #include "../config.h"
 
-#include <json.h>
 #include <string.h>
 #include <assert.h>
 #include <time.h>
@@ -32,36 +31,163 @@ THE SOFTWARE.
 #include "piano.h"
 #include "piano_private.h"
 #include "crypt.h"
+#include "jsonparse.h"
+
+static void PianoJsonParseStation (const PianoJson_t * const j, const int o,
+		PianoStation_t *s) {
+	s->name = PianoJsonStrdup (j, o, "stationName");
+	s->id = PianoJsonStrdup (j, o, "stationToken");
+	s->isCreator = !PianoJsonGetBool (j, o, "isShared", !false);
+	s->isQuickMix = PianoJsonGetBool (j, o, "isQuickMix", false);
+}
 
-static char *PianoJsonStrdup (json_object *j, const char *key) {
-	assert (j != NULL);
-	assert (key != NULL);
-
-	json_object *v;
-	if (json_object_object_get_ex (j, key, &v)) {
-		return strdup (json_object_get_string (v));
-	} else {
-		return NULL;
+static void PianoDestroyStationList (PianoStation_t *s) {
+	while (s != NULL) {
+		PianoStation_t * const next = (PianoStation_t *) s->head.next;
+		PianoDestroyStation (s);
+		free (s);
+		s = next;
 	}
 }
 
-static bool getBoolDefault (json_object * const j, const char * const key, const bool def) {
-	assert (j != NULL);
-	assert (key != NULL);
+static int PianoStationIdCmp (const void *a, const void *b) {
+	const PianoStation_t * const sa = *(PianoStation_t * const *) a;
+	const PianoStation_t * const sb = *(PianoStation_t * const *) b;
+	return strcmp (sa->id, sb->id);
+}
+
+static bool PianoStrEqual (const char * const a, const char * const b) {
+	return (a == NULL || b == NULL) ? a == b : strcmp (a, b) == 0;
+}
+
+/*	replace ph->stations by fresh, reusing existing station structs (matched
+ *	by token) so pointers held by the caller stay valid
+ *	@param piano handle
+ *	@param freshly parsed station list, consumed
+ *	@param optional diff output, without it removed stations are freed
+ */
+static PianoReturn_t PianoMergeStations (PianoHandle_t * const ph,
+		PianoStation_t *fresh, PianoRequestDataGetStations_t * const diff) {
+	size_t oldCount = 0, freshCount = 0;
+	PianoStation_t *s;
+
+	s = ph->stations;
+	PianoListForeachP (s) {
+		++oldCount;
+	}
+	s = fresh;
+	PianoListForeachP (s) {
+		++freshCount;
+	}
+
+	/* index of the current list, sorted by token */
+	PianoStation_t **old = NULL;
+	bool *kept = NULL;
+	size_t indexed = 0;
+	if (oldCount > 0) {
+		old = malloc (oldCount * sizeof (*old));
+		kept = calloc (oldCount, sizeof (*kept));
+	}
+	if (diff != NULL) {
+		memset (diff, 0, sizeof (*diff));
+		if (freshCount > 0) {
+			diff->added = malloc (freshCount * sizeof (*diff->added));
+			diff->changed = malloc (freshCount * sizeof (*diff->changed));
+		}
+	}
+	if ((oldCount > 0 && (old == NULL || kept == NULL)) ||
+			(diff != NULL && freshCount > 0 &&
+			(diff->added == NULL || diff->changed == NULL))) {
+		free (old);
+		free (kept);
+		if (diff != NULL) {
+			free (diff->added);
+			free (diff->changed);
+			memset (diff, 0, sizeof (*diff));
+		}
+		PianoDestroyStationList (fresh);
+		return PIANO_RET_OUT_OF_MEMORY;
+	}
+
+	/* stations without token cannot be matched and are dropped */
+	PianoStation_t *removed = NULL;
+	s = ph->stations;
+	while (s != NULL) {
+		PianoStation_t * const next = (PianoStation_t *) s->head.next;
+		if (s->id != NULL) {
+			old[indexed++] = s;
+		} else {
+			s->head.next = NULL;
+			removed = PianoListPrependP (removed, s);
+		}
+		s = next;
+	}
+	if (indexed > 1) {
+		qsort (old, indexed, sizeof (*old), PianoStationIdCmp);
+	}
+
+	/* relink in server order */
+	PianoStation_t *head = NULL, *tail = NULL;
+	while (fresh != NULL) {
+		PianoStation_t * const f = fresh, *keep = f;
+		fresh = (PianoStation_t *) f->head.next;
+		f->head.next = NULL;
+
+		PianoStation_t ** const found = (f->id == NULL || indexed == 0) ?
+				NULL : bsearch (&f, old, indexed, sizeof (*old),
+				PianoStationIdCmp);
+		if (found != NULL && !kept[found - old]) {
+			PianoStation_t * const o = *found;
+			kept[found - old] = true;
+			keep = o;
+
+			if (!PianoStrEqual (o->name, f->name) ||
+					o->isCreator != f->isCreator ||
+					o->isQuickMix != f->isQuickMix ||
+					o->useQuickMix != f->useQuickMix) {
+				char * const name = o->name;
+				o->name = f->name;
+				f->name = name;
+				o->isCreator = f->isCreator;
+				o->isQuickMix = f->isQuickMix;
+				o->useQuickMix = f->useQuickMix;
+				if (diff != NULL) {
+					diff->changed[diff->changedCount++] = o;
+				}
+			}
+			PianoDestroyStation (f);
+			free (f);
+		} else if (diff != NULL) {
+			diff->added[diff->addedCount++] = f;
+		}
 
-	json_object *v;
-	if (json_object_object_get_ex (j, key, &v)) {
-		return json_object_get_boolean (v);
+		keep->head.next = NULL;
+		if (tail == NULL) {
+			head = keep;
+		} else {
+			tail->head.next = &keep->head;
+		}
+		tail = keep;
+	}
+
+	/* whatever was not matched is gone */
+	for (size_t i = 0; i < indexed; i++) {
+		if (!kept[i]) {
+			old[i]->head.next = NULL;
+			removed = PianoListPrependP (removed, old[i]);
+		}
+	}
+
+	ph->stations = head;
+	if (diff != NULL) {
+		diff->removed = removed;
 	} else {
-		return def;
+		PianoDestroyStationList (removed);
 	}
-}
 
-static void PianoJsonParseStation (json_object *j, PianoStation_t *s) {
-	s->name = PianoJsonStrdup (j, "stationName");
-	s->id = PianoJsonStrdup (j, "stationToken");
-	s->isCreator = !getBoolDefault (j, "isShared", !false);
-	s->isQuickMix = getBoolDefault (j, "isQuickMix", false);
+	free (old);
+	free (kept);
+	return PIANO_RET_OK;
 }
 
 /*	concat strings
@@ -95,25 +221,27 @@ static void PianoStrpcat (char * restrict dest, const char * restrict src,
  */
 PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 	PianoReturn_t ret = PIANO_RET_OK;
+	PianoJson_t json, * const j = &json;
 
 	assert (ph != NULL);
 	assert (req != NULL);
 
-	json_object * const j = json_tokener_parse (req->responseData);
+	/* tokenize only; values are decoded when a case below asks for them */
+	const int root = PianoJsonParse (j, req->responseData) ? 0 : -1;
 
-	json_object *status;
-	if (!json_object_object_get_ex (j, "stat", &status)) {
+	const int status = PianoJsonGet (j, root, "stat");
+	if (status < 0) {
 		ret = PIANO_RET_INVALID_RESPONSE;
 		goto cleanup;
 	}
 
 	/* error handling */
-	if (strcmp (json_object_get_string (status), "ok") != 0) {
-		json_object *code;
-		if (!json_object_object_get_ex (j, "code", &code)) {
+	if (!PianoJsonStrEq (j, status, "ok")) {
+		const int code = PianoJsonGet (j, root, "code");
+		if (code < 0) {
 			ret = PIANO_RET_INVALID_RESPONSE;
 		} else {
-			ret = json_object_get_int (code)+PIANO_RET_OFFSET;
+			ret = PianoJsonGetInt (j, root, "code", 0)+PIANO_RET_OFFSET;
 
 			if (ret == PIANO_RET_P_INVALID_PARTNER_LOGIN &&
 					req->type == PIANO_REQUEST_LOGIN) {
@@ -130,9 +258,8 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 		goto cleanup;
 	}
 
-	json_object *result = NULL;
 	/* missing for some request types */
-	json_object_object_get_ex (j, "result", &result);
+	const int result = PianoJsonGet (j, root, "result");
 
 	switch (req->type) {
 		case PIANO_REQUEST_LOGIN: {
@@ -145,14 +272,12 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 			switch (reqData->step) {
 				case 0: {
 					/* decrypt timestamp */
-					json_object *jsonTimestamp;
-					if (!json_object_object_get_ex (result, "syncTime", &jsonTimestamp)) {
+					char * const cryptedTimestamp = PianoJsonStrdup (j, result,
+							"syncTime");
+					if (cryptedTimestamp == NULL) {
 						ret = PIANO_RET_INVALID_RESPONSE;
 						break;
 					}
-					assert (jsonTimestamp != NULL);
-					const char * const cryptedTimestamp = json_object_get_string (jsonTimestamp);
-					assert (cryptedTimestamp != NULL);
 					const time_t realTimestamp = time (NULL);
 					char *decryptedTimestamp = NULL;
 					size_t decryptedSize;
@@ -169,15 +294,15 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 						ret = PIANO_RET_CONTINUE_REQUEST;
 					}
 					free (decryptedTimestamp);
+					free (cryptedTimestamp);
 					/* get auth token */
-					ph->partner.authToken = PianoJsonStrdup (result,
+					ph->partner.authToken = PianoJsonStrdup (j, result,
 							"partnerAuthToken");
-					json_object *partnerId;
-					if (!json_object_object_get_ex (result, "partnerId", &partnerId)) {
+					if (PianoJsonGet (j, result, "partnerId") < 0) {
 						ret = PIANO_RET_INVALID_RESPONSE;
 						break;
 					}
-					ph->partner.id = json_object_get_int (partnerId);
+					ph->partner.id = PianoJsonGetInt (j, result, "partnerId", 0);
 					++reqData->step;
 					break;
 				}
@@ -188,8 +313,8 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 					if (ph->user.listenerId != NULL) {
 						PianoDestroyUserInfo (&ph->user);
 					}
-					ph->user.listenerId = PianoJsonStrdup (result, "userId");
-					ph->user.authToken = PianoJsonStrdup (result,
+					ph->user.listenerId = PianoJsonStrdup (j, result, "userId");
+					ph->user.authToken = PianoJsonStrdup (j, result,
 							"userAuthToken");
 					break;
 			}
@@ -197,47 +322,50 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 		}
 
 		case PIANO_REQUEST_GET_STATIONS: {
-			/* get stations */
+			/* get stations, merged into the existing list */
 			assert (req->responseData != NULL);
 
-			json_object *stations, *mix = NULL;
-
-			if (!json_object_object_get_ex (result, "stations", &stations)) {
-				break;
-			}
+			int mix = -1;
+			const int stations = PianoJsonGet (j, result, "stations");
+			PianoStation_t *fresh = NULL, *freshTail = NULL;
 
-			for (unsigned int i = 0; i < json_object_array_length (stations); i++) {
+			PianoJsonArrayForeach (j, stations, s) {
 				PianoStation_t *tmpStation;
-				json_object *s = json_object_array_get_idx (stations, i);
 
 				if ((tmpStation = calloc (1, sizeof (*tmpStation))) == NULL) {
-					return PIANO_RET_OUT_OF_MEMORY;
+					PianoDestroyStationList (fresh);
+					ret = PIANO_RET_OUT_OF_MEMORY;
+					goto cleanup;
 				}
 
-				PianoJsonParseStation (s, tmpStation);
+				PianoJsonParseStation (j, s, tmpStation);
 
 				if (tmpStation->isQuickMix) {
 					/* fix flags on other stations later */
-					json_object_object_get_ex (s, "quickMixStationIds", &mix);
+					mix = PianoJsonGet (j, s, "quickMixStationIds");
 				}
 
-				/* start new linked list or append */
-				ph->stations = PianoListAppendP (ph->stations, tmpStation);
+				if (freshTail == NULL) {
+					fresh = tmpStation;
+				} else {
+					freshTail->head.next = &tmpStation->head;
+				}
+				freshTail = tmpStation;
 			}
 
 			/* fix quickmix flags */
-			if (mix != NULL) {
-				PianoStation_t *curStation = ph->stations;
+			if (mix >= 0) {
+				PianoStation_t *curStation = fresh;
 				PianoListForeachP (curStation) {
-					for (unsigned int i = 0; i < json_object_array_length (mix); i++) {
-						json_object *id = json_object_array_get_idx (mix, i);
-						if (strcmp (json_object_get_string (id),
-								curStation->id) == 0) {
+					PianoJsonArrayForeach (j, mix, id) {
+						if (PianoJsonStrEq (j, id, curStation->id)) {
 							curStation->useQuickMix = true;
 						}
 					}
 				}
 			}
+
+			ret = PianoMergeStations (ph, fresh, req->data);
 			break;
 		}
 
@@ -250,23 +378,23 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 			assert (reqData != NULL);
 			assert (reqData->quality != PIANO_AQ_UNKNOWN);
 
-			json_object *items = NULL;
-			if (!json_object_object_get_ex (result, "items", &items)) {
+			const int items = PianoJsonGet (j, result, "items");
+			if (items < 0) {
 				break;
 			}
-			assert (items != NULL);
 
-			for (unsigned int i = 0; i < json_object_array_length (items); i++) {
-				json_object *s = json_object_array_get_idx (items, i);
+			PianoJsonArrayForeach (j, items, s) {
 				PianoSong_t *song;
 
-				if ((song = calloc (1, sizeof (*song))) == NULL) {
-					return PIANO_RET_OUT_OF_MEMORY;
+				if (PianoJsonGet (j, s, "artistName") < 0) {
+					/* ads */
+					continue;
 				}
 
-				if (!json_object_object_get_ex (s, "artistName", NULL)) {
-					free (song);
-					continue;
+				if ((song = calloc (1, sizeof (*song))) == NULL) {
+					PianoDestroyPlaylist (playlist);
+					ret = PIANO_RET_OUT_OF_MEMORY;
+					goto cleanup;
 				}
 
 				/* get audio url based on selected quality */
@@ -275,22 +403,19 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 				assert (reqData->quality < sizeof (qualityMap)/sizeof (*qualityMap));
 				static const char *formatMap[] = {"", "aacplus", "mp3"};
 
-				json_object *umap;
-				if (json_object_object_get_ex (s, "audioUrlMap", &umap)) {
-					assert (umap != NULL);
-					json_object *jsonEncoding, *qmap;
-					if (json_object_object_get_ex (umap, qualityMap[reqData->quality], &qmap) &&
-							json_object_object_get_ex (qmap, "encoding", &jsonEncoding)) {
-						assert (qmap != NULL);
-						const char *encoding = json_object_get_string (jsonEncoding);
-						assert (encoding != NULL);
+				const int umap = PianoJsonGet (j, s, "audioUrlMap");
+				if (umap >= 0) {
+					const int qmap = PianoJsonGet (j, umap,
+							qualityMap[reqData->quality]);
+					const int encoding = PianoJsonGet (j, qmap, "encoding");
+					if (encoding >= 0) {
 						for (size_t k = 0; k < sizeof (formatMap)/sizeof (*formatMap); k++) {
-							if (strcmp (formatMap[k], encoding) == 0) {
+							if (PianoJsonStrEq (j, encoding, formatMap[k])) {
 								song->audioFormat = k;
 								break;
 							}
 						}
-						song->audioUrl = PianoJsonStrdup (qmap, "audioUrl");
+						song->audioUrl = PianoJsonStrdup (j, qmap, "audioUrl");
 					} else {
 						/* requested quality is not available */
 						ret = PIANO_RET_QUALITY_UNAVAILABLE;
@@ -300,20 +425,16 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 					}
 				}
 
-				json_object *v;
-				song->artist = PianoJsonStrdup (s, "artistName");
-				song->album = PianoJsonStrdup (s, "albumName");
-				song->title = PianoJsonStrdup (s, "songName");
-				song->trackToken = PianoJsonStrdup (s, "trackToken");
-				song->stationId = PianoJsonStrdup (s, "stationId");
-				song->coverArt = PianoJsonStrdup (s, "albumArtUrl");
-				song->detailUrl = PianoJsonStrdup (s, "songDetailUrl");
-				song->fileGain = json_object_object_get_ex (s, "trackGain", &v) ?
-						json_object_get_double (v) : 0.0;
-				song->length = json_object_object_get_ex (s, "trackLength", &v) ?
-						json_object_get_int (v) : 0;
-				switch (json_object_object_get_ex (s, "songRating", &v) ?
-						json_object_get_int (v) : 0) {
+				song->artist = PianoJsonStrdup (j, s, "artistName");
+				song->album = PianoJsonStrdup (j, s, "albumName");
+				song->title = PianoJsonStrdup (j, s, "songName");
+				song->trackToken = PianoJsonStrdup (j, s, "trackToken");
+				song->stationId = PianoJsonStrdup (j, s, "stationId");
+				song->coverArt = PianoJsonStrdup (j, s, "albumArtUrl");
+				song->detailUrl = PianoJsonStrdup (j, s, "songDetailUrl");
+				song->fileGain = PianoJsonGetDouble (j, s, "trackGain", 0.0);
+				song->length = PianoJsonGetInt (j, s, "trackLength", 0);
+				switch (PianoJsonGetInt (j, s, "songRating", 0)) {
 					case 1:
 						song->rating = PIANO_RATE_LOVE;
 						break;
@@ -375,42 +496,38 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 			memset (searchResult, 0, sizeof (*searchResult));
 
 			/* get artists */
-			json_object *artists;
-			if (json_object_object_get_ex (result, "artists", &artists)) {
-				for (unsigned int i = 0; i < json_object_array_length (artists); i++) {
-					json_object *a = json_object_array_get_idx (artists, i);
-					PianoArtist_t *artist;
-
-					if ((artist = calloc (1, sizeof (*artist))) == NULL) {
-						return PIANO_RET_OUT_OF_MEMORY;
-					}
-
-					artist->name = PianoJsonStrdup (a, "artistName");
-					artist->musicId = PianoJsonStrdup (a, "musicToken");
+			const int artists = PianoJsonGet (j, result, "artists");
+			PianoJsonArrayForeach (j, artists, a) {
+				PianoArtist_t *artist;
 
-					searchResult->artists =
-							PianoListAppendP (searchResult->artists, artist);
+				if ((artist = calloc (1, sizeof (*artist))) == NULL) {
+					ret = PIANO_RET_OUT_OF_MEMORY;
+					goto cleanup;
 				}
+
+				artist->name = PianoJsonStrdup (j, a, "artistName");
+				artist->musicId = PianoJsonStrdup (j, a, "musicToken");
+
+				searchResult->artists =
+						PianoListAppendP (searchResult->artists, artist);
 			}
 
 			/* get songs */
-			json_object *songs;
-			if (json_object_object_get_ex (result, "songs", &songs)) {
-				for (unsigned int i = 0; i < json_object_array_length (songs); i++) {
-					json_object *s = json_object_array_get_idx (songs, i);
-					PianoSong_t *song;
-
-					if ((song = calloc (1, sizeof (*song))) == NULL) {
-						return PIANO_RET_OUT_OF_MEMORY;
-					}
-
-					song->title = PianoJsonStrdup (s, "songName");
-					song->artist = PianoJsonStrdup (s, "artistName");
-					song->musicId = PianoJsonStrdup (s, "musicToken");
+			const int songs = PianoJsonGet (j, result, "songs");
+			PianoJsonArrayForeach (j, songs, s) {
+				PianoSong_t *song;
 
-					searchResult->songs =
-							PianoListAppendP (searchResult->songs, song);
+				if ((song = calloc (1, sizeof (*song))) == NULL) {
+					ret = PIANO_RET_OUT_OF_MEMORY;
+					goto cleanup;
 				}
+
+				song->title = PianoJsonStrdup (j, s, "songName");
+				song->artist = PianoJsonStrdup (j, s, "artistName");
+				song->musicId = PianoJsonStrdup (j, s, "musicToken");
+
+				searchResult->songs =
+						PianoListAppendP (searchResult->songs, song);
 			}
 			break;
 		}
@@ -420,10 +537,11 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 			PianoStation_t *tmpStation;
 
 			if ((tmpStation = calloc (1, sizeof (*tmpStation))) == NULL) {
-				return PIANO_RET_OUT_OF_MEMORY;
+				ret = PIANO_RET_OUT_OF_MEMORY;
+				goto cleanup;
 			}
 
-			PianoJsonParseStation (result, tmpStation);
+			PianoJsonParseStation (j, result, tmpStation);
 
 			PianoStation_t *search = PianoFindStationById (ph->stations,
 					tmpStation->id);
@@ -454,49 +572,40 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 
 		case PIANO_REQUEST_GET_GENRE_STATIONS: {
 			/* get genre stations */
-			json_object *categories;
-			if (json_object_object_get_ex (result, "categories", &categories)) {
-				for (unsigned int i = 0; i < json_object_array_length (categories); i++) {
-					json_object *c = json_object_array_get_idx (categories, i);
-					PianoGenreCategory_t *tmpGenreCategory;
-
-					if ((tmpGenreCategory = calloc (1,
-							sizeof (*tmpGenreCategory))) == NULL) {
-						return PIANO_RET_OUT_OF_MEMORY;
-					}
+			const int categories = PianoJsonGet (j, result, "categories");
+			PianoJsonArrayForeach (j, categories, c) {
+				PianoGenreCategory_t *tmpGenreCategory;
+
+				if ((tmpGenreCategory = calloc (1,
+						sizeof (*tmpGenreCategory))) == NULL) {
+					ret = PIANO_RET_OUT_OF_MEMORY;
+					goto cleanup;
+				}
 
-					tmpGenreCategory->name = PianoJsonStrdup (c,
-							"categoryName");
-
-					/* get genre subnodes */
-					json_object *stations;
-					if (json_object_object_get_ex (c, "stations", &stations)) {
-						for (unsigned int k = 0;
-								k < json_object_array_length (stations); k++) {
-							json_object *s =
-									json_object_array_get_idx (stations, k);
-							PianoGenre_t *tmpGenre;
-
-							if ((tmpGenre = calloc (1,
-									sizeof (*tmpGenre))) == NULL) {
-								return PIANO_RET_OUT_OF_MEMORY;
-							}
+				tmpGenreCategory->name = PianoJsonStrdup (j, c,
+						"categoryName");
 
-							/* get genre attributes */
-							tmpGenre->name = PianoJsonStrdup (s,
-									"stationName");
-							tmpGenre->musicId = PianoJsonStrdup (s,
-									"stationToken");
+				/* get genre subnodes */
+				const int stations = PianoJsonGet (j, c, "stations");
+				PianoJsonArrayForeach (j, stations, s) {
+					PianoGenre_t *tmpGenre;
 
-							tmpGenreCategory->genres =
-									PianoListAppendP (tmpGenreCategory->genres,
-									tmpGenre);
-						}
+					if ((tmpGenre = calloc (1, sizeof (*tmpGenre))) == NULL) {
+						ret = PIANO_RET_OUT_OF_MEMORY;
+						goto cleanup;
 					}
 
-					ph->genreStations = PianoListAppendP (ph->genreStations,
-							tmpGenreCategory);
+					/* get genre attributes */
+					tmpGenre->name = PianoJsonStrdup (j, s, "stationName");
+					tmpGenre->musicId = PianoJsonStrdup (j, s, "stationToken");
+
+					tmpGenreCategory->genres =
+							PianoListAppendP (tmpGenreCategory->genres,
+							tmpGenre);
 				}
+
+				ph->genreStations = PianoListAppendP (ph->genreStations,
+						tmpGenreCategory);
 			}
 			break;
 		}
@@ -519,29 +628,30 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 
 			assert (reqData != NULL);
 
-			json_object *explanations;
-			if (json_object_object_get_ex (result, "explanations", &explanations) &&
-					json_object_array_length (explanations) > 0) {
+			const int explanations = PianoJsonGet (j, result, "explanations");
+			const unsigned int count = PianoJsonArrayLength (j, explanations);
+			if (count > 0) {
 				reqData->retExplain = malloc (strSize *
 						sizeof (*reqData->retExplain));
 				strncpy (reqData->retExplain, "We're playing this track "
 						"because it features ", strSize);
-				for (unsigned int i = 0; i < json_object_array_length (explanations); i++) {
-					json_object *e = json_object_array_get_idx (explanations,
-							i);
-					json_object *f;
-					if (!json_object_object_get_ex (e, "focusTraitName", &f)) {
+				unsigned int i = 0;
+				PianoJsonArrayForeach (j, explanations, e) {
+					char * const s = PianoJsonStrdup (j, e, "focusTraitName");
+					if (s == NULL) {
+						++i;
 						continue;
 					}
-					const char *s = json_object_get_string (f);
 					PianoStrpcat (reqData->retExplain, s, strSize);
-					if (i < json_object_array_length (explanations)-2) {
+					free (s);
+					if (i < count-2) {
 						PianoStrpcat (reqData->retExplain, ", ", strSize);
-					} else if (i == json_object_array_length (explanations)-2) {
+					} else if (i == count-2) {
 						PianoStrpcat (reqData->retExplain, " and ", strSize);
 					} else {
 						PianoStrpcat (reqData->retExplain, ".", strSize);
 					}
+					++i;
 				}
 			}
 			break;
@@ -552,9 +662,9 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 
 			assert (settings != NULL);
 
-			settings->explicitContentFilter = getBoolDefault (result,
+			settings->explicitContentFilter = PianoJsonGetBool (j, result,
 					"isExplicitContentFilterEnabled", false);
-			settings->username = PianoJsonStrdup (result, "username");
+			settings->username = PianoJsonStrdup (j, result, "username");
 			break;
 		}
 
@@ -569,85 +679,71 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 			assert (info != NULL);
 
 			/* parse music seeds */
-			json_object *music;
-			if (json_object_object_get_ex (result, "music", &music)) {
-				/* songs */
-				json_object *songs;
-				if (json_object_object_get_ex (music, "songs", &songs)) {
-					for (unsigned int i = 0; i < json_object_array_length (songs); i++) {
-						json_object *s = json_object_array_get_idx (songs, i);
-						PianoSong_t *seedSong;
-
-						seedSong = calloc (1, sizeof (*seedSong));
-						if (seedSong == NULL) {
-							return PIANO_RET_OUT_OF_MEMORY;
-						}
+			const int music = PianoJsonGet (j, result, "music");
 
-						seedSong->title = PianoJsonStrdup (s, "songName");
-						seedSong->artist = PianoJsonStrdup (s, "artistName");
-						seedSong->seedId = PianoJsonStrdup (s, "seedId");
+			/* songs */
+			const int songs = PianoJsonGet (j, music, "songs");
+			PianoJsonArrayForeach (j, songs, s) {
+				PianoSong_t *seedSong;
 
-						info->songSeeds = PianoListAppendP (info->songSeeds,
-								seedSong);
-					}
+				seedSong = calloc (1, sizeof (*seedSong));
+				if (seedSong == NULL) {
+					ret = PIANO_RET_OUT_OF_MEMORY;
+					goto cleanup;
 				}
 
-				/* artists */
-				json_object *artists;
-				if (json_object_object_get_ex (music, "artists", &artists)) {
-					for (unsigned int i = 0; i < json_object_array_length (artists); i++) {
-						json_object *a = json_object_array_get_idx (artists, i);
-						PianoArtist_t *seedArtist;
+				seedSong->title = PianoJsonStrdup (j, s, "songName");
+				seedSong->artist = PianoJsonStrdup (j, s, "artistName");
+				seedSong->seedId = PianoJsonStrdup (j, s, "seedId");
 
-						seedArtist = calloc (1, sizeof (*seedArtist));
-						if (seedArtist == NULL) {
-							return PIANO_RET_OUT_OF_MEMORY;
-						}
+				info->songSeeds = PianoListAppendP (info->songSeeds,
+						seedSong);
+			}
 
-						seedArtist->name = PianoJsonStrdup (a, "artistName");
-						seedArtist->seedId = PianoJsonStrdup (a, "seedId");
+			/* artists */
+			const int artists = PianoJsonGet (j, music, "artists");
+			PianoJsonArrayForeach (j, artists, a) {
+				PianoArtist_t *seedArtist;
 
-						info->artistSeeds =
-								PianoListAppendP (info->artistSeeds, seedArtist);
-					}
+				seedArtist = calloc (1, sizeof (*seedArtist));
+				if (seedArtist == NULL) {
+					ret = PIANO_RET_OUT_OF_MEMORY;
+					goto cleanup;
 				}
+
+				seedArtist->name = PianoJsonStrdup (j, a, "artistName");
+				seedArtist->seedId = PianoJsonStrdup (j, a, "seedId");
+
+				info->artistSeeds =
+						PianoListAppendP (info->artistSeeds, seedArtist);
 			}
 
 			/* parse feedback */
-			json_object *feedback;
-			if (json_object_object_get_ex (result, "feedback", &feedback)) {
-				static const char * const keys[] = {"thumbsUp", "thumbsDown"};
-				for (size_t i = 0; i < sizeof (keys)/sizeof (*keys); i++) {
-					json_object *val;
-					if (!json_object_object_get_ex (feedback, keys[i], &val)) {
-						continue;
+			const int feedback = PianoJsonGet (j, result, "feedback");
+			static const char * const keys[] = {"thumbsUp", "thumbsDown"};
+			for (size_t i = 0; i < sizeof (keys)/sizeof (*keys); i++) {
+				const int val = PianoJsonGet (j, feedback, keys[i]);
+				PianoJsonArrayForeach (j, val, s) {
+					PianoSong_t *feedbackSong;
+
+					feedbackSong = calloc (1, sizeof (*feedbackSong));
+					if (feedbackSong == NULL) {
+						ret = PIANO_RET_OUT_OF_MEMORY;
+						goto cleanup;
 					}
-					assert (json_object_is_type (val, json_type_array));
-					for (unsigned int i = 0; i < json_object_array_length (val); i++) {
-						json_object *s = json_object_array_get_idx (val, i);
-						PianoSong_t *feedbackSong;
-
-						feedbackSong = calloc (1, sizeof (*feedbackSong));
-						if (feedbackSong == NULL) {
-							return PIANO_RET_OUT_OF_MEMORY;
-						}
 
-						feedbackSong->title = PianoJsonStrdup (s, "songName");
-						feedbackSong->artist = PianoJsonStrdup (s,
-								"artistName");
-						feedbackSong->feedbackId = PianoJsonStrdup (s,
-								"feedbackId");
-						feedbackSong->rating = getBoolDefault (s, "isPositive",
-								false) ?  PIANO_RATE_LOVE : PIANO_RATE_BAN;
-
-						json_object *v;
-						feedbackSong->length =
-								json_object_object_get_ex (s, "trackLength", &v) ?
-								json_object_get_int (v) : 0;
-
-						info->feedback = PianoListAppendP (info->feedback,
-								feedbackSong);
-					}
+					feedbackSong->title = PianoJsonStrdup (j, s, "songName");
+					feedbackSong->artist = PianoJsonStrdup (j, s,
+							"artistName");
+					feedbackSong->feedbackId = PianoJsonStrdup (j, s,
+							"feedbackId");
+					feedbackSong->rating = PianoJsonGetBool (j, s, "isPositive",
+							false) ?  PIANO_RATE_LOVE : PIANO_RATE_BAN;
+					feedbackSong->length = PianoJsonGetInt (j, s, "trackLength",
+							0);
+
+					info->feedback = PianoListAppendP (info->feedback,
+							feedbackSong);
 				}
 			}
 			break;
@@ -657,40 +753,31 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 			PianoRequestDataGetStationModes_t *reqData = req->data;
 			assert (reqData != NULL);
 
-			int active = -1;
-
-			json_object *activeMode;
-			if (json_object_object_get_ex (result, "currentModeId", &activeMode)) {
-				active = json_object_get_int (activeMode);
-			}
-
-			json_object *availableModes;
-			if (json_object_object_get_ex (result, "availableModes", &availableModes)) {
-				for (unsigned int i = 0; i < json_object_array_length (availableModes); i++) {
-					json_object *val = json_object_array_get_idx (availableModes, i);
-
-					assert (json_object_is_type (val, json_type_object));
+			const int active = PianoJsonGetInt (j, result, "currentModeId", -1);
 
-					PianoStationMode_t *mode;
-					if ((mode = calloc (1, sizeof (*mode))) == NULL) {
-						return PIANO_RET_OUT_OF_MEMORY;
-					}
-
-					json_object *modeId;
-					if (json_object_object_get_ex (val, "modeId", &modeId)) {
-						mode->id = json_object_get_int (modeId);
-						mode->name = PianoJsonStrdup (val, "modeName");
-						mode->description = PianoJsonStrdup (val, "modeDescription");
-						mode->isAlgorithmic = getBoolDefault (val, "isAlgorithmicMode",
-								false);
-						mode->isTakeover = getBoolDefault (val, "isTakeoverMode",
-								false);
-						mode->active = active == mode->id;
-					}
+			const int availableModes = PianoJsonGet (j, result,
+					"availableModes");
+			PianoJsonArrayForeach (j, availableModes, val) {
+				PianoStationMode_t *mode;
+				if ((mode = calloc (1, sizeof (*mode))) == NULL) {
+					ret = PIANO_RET_OUT_OF_MEMORY;
+					goto cleanup;
+				}
 
-					reqData->retModes = PianoListAppendP (reqData->retModes,
-							mode);
+				if (PianoJsonGet (j, val, "modeId") >= 0) {
+					mode->id = PianoJsonGetInt (j, val, "modeId", 0);
+					mode->name = PianoJsonStrdup (j, val, "modeName");
+					mode->description = PianoJsonStrdup (j, val,
+							"modeDescription");
+					mode->isAlgorithmic = PianoJsonGetBool (j, val,
+							"isAlgorithmicMode", false);
+					mode->isTakeover = PianoJsonGetBool (j, val,
+							"isTakeoverMode", false);
+					mode->active = active == mode->id;
 				}
+
+				reqData->retModes = PianoListAppendP (reqData->retModes,
+						mode);
 			}
 			break;
 		}
@@ -699,24 +786,18 @@ PianoReturn_t PianoResponse (PianoHandle_t *ph, PianoRequest_t *req) {
 			PianoRequestDataSetStationMode_t *reqData = req->data;
 			assert (reqData != NULL);
 
-			int active = -1;
-
-			json_object *activeMode;
-			if (json_object_object_get_ex (result, "currentModeId", &activeMode)) {
-				active = json_object_get_int (activeMode);
-			}
+			const int active = PianoJsonGetInt (j, result, "currentModeId", -1);
 
 			if (active != reqData->id) {
 				/* this did not work */
-				return PIANO_RET_ERR;
+				ret = PIANO_RET_ERR;
 			}
 			break;
 		}
 	}
 
 cleanup:
-	json_object_put (j);
+	PianoJsonDestroy (j);
 
 	return ret;
 }
-
@@ -179,6 +179,16 @@ bool log_is_debug_cli_enabled(void)
 #endif
 }
 
+bool log_is_debug_enabled(logKind kind)
+{
+#ifdef HAVE_DEBUGLOG
+	return (debug_mask & kind) != 0;
+#else
+	(void) kind;
+	return false;
+#endif
+}
+
 void log_write(logKind kind, const char *format, ...)
 {
 	va_list args;
@@ -47,6 +47,9 @@ bool log_is_any_debug_enabled(void);
 /* True when log_write(DEBUG_CLI, ...) would emit (debug_mask & DEBUG_CLI); HAVE_DEBUGLOG only. */
 bool log_is_debug_cli_enabled(void);
 
+/* True when log_write(kind, ...) would emit for a DEBUG_* kind; HAVE_DEBUGLOG only. */
+bool log_is_debug_enabled(logKind kind);
+
 /* Log message. LOG_ERROR always emits; DEBUG_* use debug_mask (DEBUG_CLI OR'd at init when any bit set);
  * other DEBUG_* kinds emit when the corresponding PIANOBAR_DEBUG bit is set. */
 void log_write(logKind kind, const char *format, ...)
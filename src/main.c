@@ -72,7 +72,6 @@ THE SOFTWARE.
 #include "ui.h"
 #include "ui_dispatch.h"
 #include "bar_state.h"
-#include "station_display.h"
 #include "playback_manager.h"
 #include "system_volume.h"
 
@@ -313,16 +312,10 @@ static bool BarMainGetStations (BarApp_t *app) {
 
 	BarUiMsg (&app->settings, MSG_INFO, "%s",
 			BarL10nGet (&app->l10n, "cli.get_stations"));
-	ret = BarUiPianoCall (app, PIANO_REQUEST_GET_STATIONS, NULL, &pRet, &wRet);
-	
-	/* Update display names after stations are fetched */
-	if (ret) {
-		BarUpdateStationDisplayNames(app);
-		/* Broadcast to WebSocket clients: early connections may have received
-		 * an empty unicast from query before getStationList completed. */
-		BarWsBroadcastStations(app);
-	}
-	
+	/* also broadcasts to WebSocket clients: early connections may have
+	 * received an empty unicast from query before the list was fetched */
+	ret = BarUiGetStations (app, &pRet, &wRet);
+
 	BarUiStartEventCmd (&app->settings, "usergetstations", NULL, NULL, &app->player,
 			BarStateGetStationList(app), pRet, wRet);
 	return ret;
@@ -971,7 +964,7 @@ int main (int argc, char **argv) {
 	BarSettingsWrite (app.curStation, &app.settings);
 
 	PianoDestroy (&app.ph);
-	PianoDestroyPlaylist (app.songHistory);
+	BarStateHistoryClear (&app);
 	PianoDestroyPlaylist (app.playlist);
 	BarUiPianoHttpMutexDestroy (&app);
 	curl_easy_cleanup (app.http);
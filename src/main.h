@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include "player.h"
 #include "l10n.h"
 #include "settings.h"
+#include "song_history.h"
 #include "ui_readline.h"
 
 typedef struct {
@@ -40,7 +41,9 @@ typedef struct {
 	BarSettings_t settings;
 	/* first item is current song */
 	PianoSong_t *playlist;
-	PianoSong_t *songHistory;
+	/* compact records of played songs, allocated on first use; access
+	 * through BarStateHistory* */
+	BarSongHistory_t *songHistory;
 	/* station of current song and station used to fetch songs from if playlist
 	 * is empty */
 	PianoStation_t *curStation, *nextStation;
@@ -205,6 +205,23 @@ static void cfgUiMode (BarSettings_t *s, const char *v, const char *h) {
 	else if (streq (v, "web")) { s->uiMode = BAR_UI_MODE_WEB; }
 	else { s->uiMode = BAR_UI_MODE_BOTH; }
 }
+
+static void cfgSlowClient (BarSettings_t *s, const char *v, const char *h) {
+	(void)h;
+	if (streq (v, "drop")) { s->websocketSlowClient = BAR_WS_SLOW_CLIENT_DROP; }
+	else { s->websocketSlowClient = BAR_WS_SLOW_CLIENT_DISCONNECT; }
+}
+
+static void cfgCompression (BarSettings_t *s, const char *v, const char *h) {
+	(void)h;
+	if (streq (v, "off")) { s->websocketCompression = BAR_WS_COMPRESSION_OFF; }
+	else { s->websocketCompression = BAR_WS_COMPRESSION_DEFLATE; }
+}
+
+static void cfgInlineState (BarSettings_t *s, const char *v, const char *h) {
+	(void)h;
+	s->webuiInlineState = streq (v, "on");
+}
 #endif
 
 /* Apply a single key entry to settings */
@@ -309,8 +326,16 @@ static const BarConfigKey_t wsKeys[] = {
 	{"websocket_port",CFG_INT,    offsetof (BarSettings_t, websocketPort), 1, 65535, NULL},
 	{"websocket_host",CFG_STR,    offsetof (BarSettings_t, websocketHost), 0, 0, NULL},
 	{"webui_path",    CFG_STR,    offsetof (BarSettings_t, webuiPath),     0, 0, NULL},
+	{"webui_inline_state", CFG_CUSTOM, 0, 0, 0, cfgInlineState},
 	{"pid_file",      CFG_TILDE,  offsetof (BarSettings_t, pidFile),       0, 0, NULL},
 	{"log_file",      CFG_TILDE,  offsetof (BarSettings_t, logFile),       0, 0, NULL},
+	{"websocket_queue_limit", CFG_UINT, offsetof (BarSettings_t, websocketQueueLimit), 1, 4096, NULL},
+	{"websocket_max_clients", CFG_UINT, offsetof (BarSettings_t, websocketMaxClients), 1, 65535, NULL},
+	{"websocket_max_message", CFG_UINT, offsetof (BarSettings_t, websocketMaxMessage), 1024, 16777216, NULL},
+	{"websocket_threads", CFG_UINT, offsetof (BarSettings_t, websocketThreads), 1, WEBSOCKET_SERVICE_THREADS_MAX, NULL},
+	{"websocket_slow_client", CFG_CUSTOM, 0, 0, 0, cfgSlowClient},
+	{"websocket_compression", CFG_CUSTOM, 0, 0, 0, cfgCompression},
+	{"websocket_compression_report_min", CFG_UINT, offsetof (BarSettings_t, websocketCompressionReportMin), 1, 16777216, NULL},
 	{NULL, CFG_STR, 0, 0, 0, NULL}
 };
 #endif
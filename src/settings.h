@@ -92,6 +92,18 @@ typedef enum {
 	BAR_UI_MODE_CLI = 1,   /* CLI only, no WebSocket */
 	BAR_UI_MODE_WEB = 2,   /* Web only (daemon), no CLI */
 } BarUiMode_t;
+
+/* What to do with a WebSocket client whose outbound queue is full */
+typedef enum {
+	BAR_WS_SLOW_CLIENT_DISCONNECT = 0, /* Drop frames, then disconnect (default) */
+	BAR_WS_SLOW_CLIENT_DROP = 1,       /* Keep dropping the oldest frames */
+} BarWsSlowClient_t;
+
+/* permessage-deflate for WebSocket clients that offer it */
+typedef enum {
+	BAR_WS_COMPRESSION_DEFLATE = 0,    /* Negotiate permessage-deflate (default) */
+	BAR_WS_COMPRESSION_OFF = 1,
+} BarWsCompression_t;
 #endif
 
 /* Volume control mode - defined outside WEBSOCKET_ENABLED since it's independent */
@@ -172,6 +184,14 @@ typedef struct {
 	char *webuiPath;
 	char *pidFile;
 	char *logFile;
+	unsigned int websocketQueueLimit;
+	unsigned int websocketMaxClients;
+	unsigned int websocketMaxMessage;
+	BarWsCompression_t websocketCompression;
+	unsigned int websocketCompressionReportMin;
+	BarWsSlowClient_t websocketSlowClient;
+	unsigned int websocketThreads;
+	bool webuiInlineState;      /* Put the current state into index.html */
 	#endif
 	
 	/* ALSA mixer control name (e.g., "Digital", "Master") */
@@ -0,0 +1,214 @@
+/*
+Copyright (c) 2025
+	Kyle Hawes
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "song_history.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Entry string fields, in the order they are packed into ->strings */
+#define BAR_SONG_HISTORY_FIELDS 9
+
+static const char **BarSongHistoryEntryField (BarSongHistoryEntry_t *e, size_t i) {
+	const char **fields[BAR_SONG_HISTORY_FIELDS] = {
+			&e->title, &e->artist, &e->album, &e->coverArt, &e->stationId,
+			&e->trackToken, &e->musicId, &e->detailUrl, &e->feedbackId,
+	};
+	return fields[i];
+}
+
+static void BarSongHistoryEntryDestroy (BarSongHistoryEntry_t *e) {
+	free (e->strings);
+	memset (e, 0, sizeof (*e));
+}
+
+/*	change capacity, keeping the most recent entries
+ */
+static bool BarSongHistoryResize (BarSongHistory_t *h, size_t capacity) {
+	BarSongHistoryEntry_t *entries = NULL;
+
+	if (capacity > 0) {
+		entries = calloc (capacity, sizeof (*entries));
+		if (entries == NULL) {
+			return false;
+		}
+	}
+
+	/* move newest-first into slots capacity-1, capacity-2, ... so the
+	 * ring continues with newest = count-1 */
+	size_t keep = h->count < capacity ? h->count : capacity;
+	for (size_t i = 0; i < h->count; i++) {
+		BarSongHistoryEntry_t *e = &h->entries[(h->newest + h->capacity - i) %
+				h->capacity];
+		if (i < keep) {
+			entries[keep - 1 - i] = *e;
+		} else {
+			BarSongHistoryEntryDestroy (e);
+		}
+	}
+	free (h->entries);
+
+	h->entries = entries;
+	h->capacity = capacity;
+	h->count = keep;
+	h->newest = keep > 0 ? keep - 1 : 0;
+	return true;
+}
+
+/*	add song to history, O(1) unless the capacity changed
+ *	@param history
+ *	@param maximum number of entries (settings.history)
+ *	@param song, only copied
+ *	@return false if the song was not recorded (disabled, out of memory)
+ */
+bool BarSongHistoryPush (BarSongHistory_t *h, size_t capacity,
+		const PianoSong_t *song) {
+	assert (h != NULL);
+	assert (song != NULL);
+
+	if (capacity != h->capacity && !BarSongHistoryResize (h, capacity)) {
+		return false;
+	}
+	if (capacity == 0) {
+		return false;
+	}
+
+	const char *src[BAR_SONG_HISTORY_FIELDS] = {
+			song->title, song->artist, song->album, song->coverArt,
+			song->stationId, song->trackToken, song->musicId, song->detailUrl,
+			song->feedbackId,
+	};
+	size_t len[BAR_SONG_HISTORY_FIELDS];
+	size_t total = 0;
+	for (size_t i = 0; i < BAR_SONG_HISTORY_FIELDS; i++) {
+		len[i] = src[i] != NULL ? strlen (src[i]) + 1 : 0;
+		total += len[i];
+	}
+
+	size_t slot = h->count == 0 ? h->newest : (h->newest + 1) % h->capacity;
+	BarSongHistoryEntry_t *e = &h->entries[slot];
+
+	/* evicted entry's buffer is reused when large enough */
+	char *strings = e->strings;
+	size_t stringsSize = e->stringsSize;
+	if (total > stringsSize) {
+		char *tmp = realloc (strings, total);
+		if (tmp == NULL) {
+			return false;
+		}
+		strings = tmp;
+		stringsSize = total;
+	}
+
+	memset (e, 0, sizeof (*e));
+	e->strings = strings;
+	e->stringsSize = stringsSize;
+	char *p = strings;
+	for (size_t i = 0; i < BAR_SONG_HISTORY_FIELDS; i++) {
+		if (src[i] != NULL) {
+			memcpy (p, src[i], len[i]);
+			*BarSongHistoryEntryField (e, i) = p;
+			p += len[i];
+		}
+	}
+	e->length = song->length;
+	e->rating = song->rating;
+	e->playedAt = time (NULL);
+
+	h->newest = slot;
+	if (h->count < h->capacity) {
+		++h->count;
+	}
+	return true;
+}
+
+const BarSongHistoryEntry_t *BarSongHistoryAt (const BarSongHistory_t *h,
+		size_t i) {
+	if (h == NULL || i >= h->count) {
+		return NULL;
+	}
+	return &h->entries[(h->newest + h->capacity - i) % h->capacity];
+}
+
+void BarSongHistorySetRating (BarSongHistory_t *h, const char *trackToken,
+		PianoSongRating_t rating) {
+	if (trackToken == NULL) {
+		return;
+	}
+	for (size_t i = 0; i < h->count; i++) {
+		BarSongHistoryEntry_t *e = (BarSongHistoryEntry_t *) BarSongHistoryAt (h, i);
+		if (e->trackToken != NULL && strcmp (e->trackToken, trackToken) == 0) {
+			e->rating = rating;
+			return;
+		}
+	}
+}
+
+static bool BarSongHistoryDup (char **dst, const char *src) {
+	if (src == NULL) {
+		return true;
+	}
+	*dst = strdup (src);
+	return *dst != NULL;
+}
+
+PianoSong_t *BarSongHistoryEntryToSong (const BarSongHistoryEntry_t *e) {
+	assert (e != NULL);
+
+	PianoSong_t *song = calloc (1, sizeof (*song));
+	if (song == NULL) {
+		return NULL;
+	}
+	if (!BarSongHistoryDup (&song->title, e->title) ||
+			!BarSongHistoryDup (&song->artist, e->artist) ||
+			!BarSongHistoryDup (&song->album, e->album) ||
+			!BarSongHistoryDup (&song->coverArt, e->coverArt) ||
+			!BarSongHistoryDup (&song->stationId, e->stationId) ||
+			!BarSongHistoryDup (&song->trackToken, e->trackToken) ||
+			!BarSongHistoryDup (&song->musicId, e->musicId) ||
+			!BarSongHistoryDup (&song->detailUrl, e->detailUrl) ||
+			!BarSongHistoryDup (&song->feedbackId, e->feedbackId)) {
+		PianoDestroyPlaylist (song);
+		return NULL;
+	}
+	song->length = e->length;
+	song->rating = e->rating;
+	return song;
+}
+
+void BarSongHistoryClear (BarSongHistory_t *h) {
+	assert (h != NULL);
+	for (size_t i = 0; i < h->capacity; i++) {
+		BarSongHistoryEntryDestroy (&h->entries[i]);
+	}
+	h->count = 0;
+	h->newest = 0;
+}
+
+void BarSongHistoryDestroy (BarSongHistory_t *h) {
+	assert (h != NULL);
+	BarSongHistoryClear (h);
+	free (h->entries);
+	memset (h, 0, sizeof (*h));
+}
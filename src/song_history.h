@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2025
+	Kyle Hawes
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include <piano.h>
+
+/* Song history: fixed-capacity ring of compact records. Only the fields the
+ * history menu and query.history need are kept (no audio URLs, gain or
+ * format); all strings of an entry share one allocation. */
+
+typedef struct {
+	const char *title;
+	const char *artist;
+	const char *album;
+	const char *coverArt;
+	const char *stationId;
+	const char *trackToken;
+	const char *musicId;
+	const char *detailUrl;
+	const char *feedbackId;
+	unsigned int length;
+	PianoSongRating_t rating;
+	time_t playedAt;
+	/* backing storage for the strings above */
+	char *strings;
+	size_t stringsSize;
+} BarSongHistoryEntry_t;
+
+typedef struct {
+	BarSongHistoryEntry_t *entries;
+	size_t capacity;
+	size_t count;
+	/* slot of the most recent entry */
+	size_t newest;
+} BarSongHistory_t;
+
+/* Record song as the most recent entry, evicting the oldest one if full.
+ * Capacity follows `capacity` (settings.history); 0 disables the history. */
+bool BarSongHistoryPush (BarSongHistory_t *h, size_t capacity,
+		const PianoSong_t *song);
+
+/* i-th most recent entry (0 = newest), NULL if out of range */
+const BarSongHistoryEntry_t *BarSongHistoryAt (const BarSongHistory_t *h, size_t i);
+
+/* Update the rating of the most recent entry with trackToken */
+void BarSongHistorySetRating (BarSongHistory_t *h, const char *trackToken,
+		PianoSongRating_t rating);
+
+/* Full PianoSong_t copy of an entry; caller frees with PianoDestroyPlaylist */
+PianoSong_t *BarSongHistoryEntryToSong (const BarSongHistoryEntry_t *e);
+
+void BarSongHistoryClear (BarSongHistory_t *h);
+void BarSongHistoryDestroy (BarSongHistory_t *h);
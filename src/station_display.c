@@ -144,6 +144,23 @@ char* BarApplyStationNameOverrides(const BarSettings_t *settings, const char *or
 	return current;
 }
 
+/* Recompute displayName for a single station */
+void BarUpdateStationDisplayName(const BarSettings_t *settings,
+		PianoStation_t *station) {
+	if (!settings || !station) {
+		return;
+	}
+	
+	/* Free old displayName */
+	free(station->displayName);
+	station->displayName = NULL;
+	
+	/* Compute new displayName */
+	if (station->name != NULL) {
+		station->displayName = BarApplyStationNameOverrides(settings, station->name);
+	}
+}
+
 /* Update displayName for all stations in the list */
 void BarUpdateStationDisplayNames(BarApp_t *app) {
 	if (!app || !app->ph.stations) {
@@ -152,16 +169,7 @@ void BarUpdateStationDisplayNames(BarApp_t *app) {
 	
 	PianoStation_t *station = app->ph.stations;
 	while (station) {
-		/* Free old displayName */
-		free(station->displayName);
-		station->displayName = NULL;
-		
-		/* Compute new displayName */
-		if (station->name != NULL) {
-			station->displayName = BarApplyStationNameOverrides(&app->settings, station->name);
-		}
-		
+		BarUpdateStationDisplayName(&app->settings, station);
 		station = (PianoStation_t *)station->head.next;
 	}
 }
-
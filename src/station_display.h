@@ -32,6 +32,10 @@ THE SOFTWARE.
  */
 char* BarApplyStationNameOverrides(const BarSettings_t *settings, const char *originalName);
 
+/* Recompute displayName of one station, e.g. after it was added or renamed
+ */
+void BarUpdateStationDisplayName(const BarSettings_t *settings, PianoStation_t *station);
+
 /* Update displayName field for all stations in the app
  * Should be called after station list fetch or config reload
  */
@@ -30,6 +30,7 @@ THE SOFTWARE.
 #include <unistd.h>
 #include <json-c/json.h>
 #include <time.h>
+#include <pthread.h>
 
 /* Track which backend is active */
 static enum {
@@ -44,6 +45,48 @@ static enum {
 /* ALSA mixer element name (configured or auto-detected) */
 static char *alsaMixerName = NULL;
 
+/* Change listener (BarSystemVolumeSetListener) */
+static pthread_mutex_t listenerMutex = PTHREAD_MUTEX_INITIALIZER;
+static BarSystemVolumeListener_t listener = NULL;
+static void *listenerData = NULL;
+
+/* What BarSystemVolumeGet returns (BarSystemVolumeState_t) */
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static BarSystemVolumeState_t cache = {.volume = -1, .muted = -1};
+static unsigned long cacheReads = 0, cacheMisses = 0;
+
+static uint64_t systemVolumeNowMs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/* Update the cache; muted < 0 and device NULL keep what is known */
+static void systemVolumeStore(int percent, int muted, const char *device) {
+	pthread_mutex_lock(&cacheMutex);
+	cache.volume = percent;
+	if (muted >= 0) {
+		cache.muted = muted;
+	}
+	if (device) {
+		snprintf(cache.device, sizeof(cache.device), "%s", device);
+	}
+	cache.updatedMs = systemVolumeNowMs();
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+#ifdef __linux__
+/* Report a volume change the backend learned about on its own */
+static void systemVolumeNotify(int percent) {
+	systemVolumeStore(percent, -1, NULL);
+	pthread_mutex_lock(&listenerMutex);
+	if (listener) {
+		listener(percent, listenerData);
+	}
+	pthread_mutex_unlock(&listenerMutex);
+}
+#endif
+
 /*
  * ============================================================================
  * macOS Implementation
@@ -277,214 +320,255 @@ static bool macosSetVolume(int percent) {
 #elif defined(__linux__)
 
 #include <alloca.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdatomic.h>
+#include <sys/wait.h>
 #include <alsa/asoundlib.h>
 
 #ifdef HAVE_PULSEAUDIO
 #include <pulse/pulseaudio.h>
-#include <pulse/simple.h>
-#include <pthread.h>
-
-static pa_mainloop *paMainloop = NULL;
+#include <stdint.h>
+
+/* libpulse runs its own thread (pa_threaded_mainloop). Sink and server
+ * events keep a cached copy of the default sink's state up to date, so
+ * reading the volume never talks to the server. If the server goes away
+ * (restart, logout) the cache is dropped and reads reconnect, at most every
+ * BAR_PULSEAUDIO_RETRY_MS. Everything but the atomics is only touched with
+ * the mainloop lock held. */
+static pa_threaded_mainloop *paMainloop = NULL;
 static pa_context *paContext = NULL;
-static int paVolume = -1;
+static atomic_int paVolume = -1;
+static atomic_bool paMuted = false;
+static atomic_bool paLost = false; /* context failed, not reconnected yet */
 static bool paReady = false;
-static pthread_mutex_t paMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t paRetryMs = 0;
+static uint8_t paChannels = 2;
+static char paSinkName[256];
+
+static void paSinkInfoCb(pa_context *c, const pa_sink_info *i, int eol, void *userdata);
 
-/* PulseAudio callback for context state */
+/* PulseAudio callback for context state: a failed or terminated context
+ * reports no more changes, so the volume is unknown until a reconnect */
 static void paContextStateCb(pa_context *c, void *userdata) {
 	(void)userdata;
-	pa_context_state_t state = pa_context_get_state(c);
-	if (state == PA_CONTEXT_READY) {
-		paReady = true;
+	if (!PA_CONTEXT_IS_GOOD(pa_context_get_state(c)) && paReady) {
+		paReady = false;
+		atomic_store(&paVolume, -1);
+		atomic_store(&paLost, true);
+		log_write(DEBUG_AUDIO, "PulseAudio connection lost\n");
+		systemVolumeNotify(-1);
 	}
+	pa_threaded_mainloop_signal(paMainloop, 0);
+}
+
+/* Ask for the default sink; the answer lands in paSinkInfoCb */
+static pa_operation *paQueryDefaultSink(void) {
+	return pa_context_get_sink_info_by_name(paContext, "@DEFAULT_SINK@",
+	                                        paSinkInfoCb, NULL);
 }
 
-/* PulseAudio callback for sink info (get volume) */
+/* PulseAudio callback for sink info: update the cache, report changes */
 static void paSinkInfoCb(pa_context *c, const pa_sink_info *i, int eol, void *userdata) {
 	(void)c;
 	(void)userdata;
 	if (eol > 0 || !i) {
+		pa_threaded_mainloop_signal(paMainloop, 0);
 		return;
 	}
 	/* Convert from PA volume to percentage */
-	paVolume = (int)((pa_cvolume_avg(&i->volume) * 100 + PA_VOLUME_NORM / 2) / PA_VOLUME_NORM);
+	const int volume = (int)((pa_cvolume_avg(&i->volume) * 100 + PA_VOLUME_NORM / 2) / PA_VOLUME_NORM);
+	const bool muted = i->mute != 0;
+	paChannels = i->volume.channels;
+	if (strcmp(paSinkName, i->name) != 0) {
+		snprintf(paSinkName, sizeof(paSinkName), "%s", i->name);
+		log_write(DEBUG_AUDIO, "PulseAudio default sink is %s\n", paSinkName);
+	}
+	
+	const int old = atomic_exchange(&paVolume, volume);
+	const bool wasMuted = atomic_exchange(&paMuted, muted);
+	systemVolumeStore(volume, muted, paSinkName);
+	if (old != volume || wasMuted != muted) {
+		log_write(DEBUG_AUDIO, "PulseAudio volume %d%%%s\n", volume,
+		          muted ? " (muted)" : "");
+		if (old >= 0) {
+			systemVolumeNotify(volume);
+		}
+	}
 }
 
-/* PulseAudio: Initialize connection (thread-safe) */
-static bool pulseaudioInit(void) {
-	pthread_mutex_lock(&paMutex);
-	
-	paMainloop = pa_mainloop_new();
-	if (!paMainloop) {
-		pthread_mutex_unlock(&paMutex);
-		return false;
+/* PulseAudio callback for subscribed events: any sink may be the default
+ * one, and a server change may have picked another default sink */
+static void paSubscribeCb(pa_context *c, pa_subscription_event_type_t t,
+                          uint32_t idx, void *userdata) {
+	(void)c;
+	(void)idx;
+	(void)userdata;
+	const pa_subscription_event_type_t facility = t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+	if (facility != PA_SUBSCRIPTION_EVENT_SINK &&
+	    facility != PA_SUBSCRIPTION_EVENT_SERVER) {
+		return;
 	}
-	
-	pa_mainloop_api *api = pa_mainloop_get_api(paMainloop);
-	paContext = pa_context_new(api, "pianobar");
+	pa_operation *op = paQueryDefaultSink();
+	if (op) {
+		pa_operation_unref(op);
+	}
+}
+
+/* Wait for op with the mainloop lock held */
+static void paWait(pa_operation *op) {
+	while (pa_operation_get_state(op) == PA_OPERATION_RUNNING &&
+	       pa_context_get_state(paContext) == PA_CONTEXT_READY) {
+		pa_threaded_mainloop_wait(paMainloop);
+	}
+	pa_operation_unref(op);
+}
+
+/* Drop the context without hearing about it; mainloop lock held or the
+ * mainloop stopped */
+static void paDisconnect(void) {
+	if (paContext) {
+		pa_context_set_state_callback(paContext, NULL, NULL);
+		pa_context_disconnect(paContext);
+		pa_context_unref(paContext);
+		paContext = NULL;
+	}
+}
+
+/* Connect a new context, subscribe to sink and server events and read the
+ * default sink once; mainloop lock held */
+static bool paConnect(void) {
+	paContext = pa_context_new(pa_threaded_mainloop_get_api(paMainloop), "pianobar");
 	if (!paContext) {
-		pa_mainloop_free(paMainloop);
-		paMainloop = NULL;
-		pthread_mutex_unlock(&paMutex);
 		return false;
 	}
-	
 	pa_context_set_state_callback(paContext, paContextStateCb, NULL);
+	pa_context_set_subscribe_callback(paContext, paSubscribeCb, NULL);
 	
 	if (pa_context_connect(paContext, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0) {
-		pa_context_unref(paContext);
-		pa_mainloop_free(paMainloop);
-		paContext = NULL;
-		paMainloop = NULL;
-		pthread_mutex_unlock(&paMutex);
 		return false;
 	}
-	
-	/* Wait for connection (with timeout) */
-	int tries = 0;
-	while (!paReady && tries < BAR_PA_READY_TRIES) {
-		pa_mainloop_iterate(paMainloop, 0, NULL);
-		if (pa_context_get_state(paContext) == PA_CONTEXT_FAILED ||
-		    pa_context_get_state(paContext) == PA_CONTEXT_TERMINATED) {
-			break;
-		}
-		usleep(10000); /* 10ms */
-		tries++;
+	pa_context_state_t state;
+	while ((state = pa_context_get_state(paContext)) != PA_CONTEXT_READY &&
+	       PA_CONTEXT_IS_GOOD(state)) {
+		pa_threaded_mainloop_wait(paMainloop);
 	}
-	
-	if (!paReady) {
-		pa_context_disconnect(paContext);
-		pa_context_unref(paContext);
-		pa_mainloop_free(paMainloop);
-		paContext = NULL;
-		paMainloop = NULL;
-		pthread_mutex_unlock(&paMutex);
+	if (state != PA_CONTEXT_READY) {
 		return false;
 	}
+	paReady = true;
+	atomic_store(&paLost, false);
 	
-	pthread_mutex_unlock(&paMutex);
-	return true;
+	pa_operation *op = pa_context_subscribe(paContext,
+	        PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SERVER, NULL, NULL);
+	if (op) {
+		pa_operation_unref(op);
+	}
+	op = paQueryDefaultSink();
+	if (op) {
+		paWait(op);
+	}
+	return atomic_load(&paVolume) >= 0;
 }
 
-/* PulseAudio: Get volume (thread-safe)
- * 
- * Lock optimization: Instead of holding paMutex for entire mainloop iteration,
- * we only hold it while accessing PA objects. The operation itself completes
- * asynchronously via callbacks.
- */
-static int pulseaudioGetVolume(void) {
-	pa_operation *op;
-	
-	pthread_mutex_lock(&paMutex);
-	if (!paContext || !paReady) {
-		pthread_mutex_unlock(&paMutex);
-		return -1;
+/* PulseAudio: Cleanup */
+static void pulseaudioDestroy(void) {
+	if (!paMainloop) {
+		return;
+	}
+	pa_threaded_mainloop_stop(paMainloop);
+	paDisconnect();
+	pa_threaded_mainloop_free(paMainloop);
+	paMainloop = NULL;
+	atomic_store(&paVolume, -1);
+	atomic_store(&paLost, false);
+	paReady = false;
+	paSinkName[0] = '\0';
+}
+
+/* PulseAudio: start the mainloop and connect */
+static bool pulseaudioInit(void) {
+	paMainloop = pa_threaded_mainloop_new();
+	if (!paMainloop) {
+		return false;
+	}
+	if (pa_threaded_mainloop_start(paMainloop) < 0) {
+		pulseaudioDestroy();
+		return false;
 	}
 	
-	paVolume = -1;
-	op = pa_context_get_sink_info_by_name(
-		paContext, "@DEFAULT_SINK@", paSinkInfoCb, NULL);
+	pa_threaded_mainloop_lock(paMainloop);
+	const bool ready = paConnect();
+	pa_threaded_mainloop_unlock(paMainloop);
 	
-	if (!op) {
-		pthread_mutex_unlock(&paMutex);
-		return -1;
+	if (!ready) {
+		pulseaudioDestroy();
 	}
-	
-	/* Iterate mainloop while holding lock, but with shorter iterations
-	 * to allow other threads access between iterations */
-	int iterations = 0;
-	while (pa_operation_get_state(op) == PA_OPERATION_RUNNING && iterations < BAR_PA_OP_MAX_ITERATIONS) {
-		pthread_mutex_unlock(&paMutex);
-		usleep(10000);  /* 10ms - allow other threads to run */
-		pthread_mutex_lock(&paMutex);
-		
-		if (paContext && paReady) {
-			pa_mainloop_iterate(paMainloop, 0, NULL);
+	return ready;
+}
+
+/* PulseAudio: replace a lost context with a new one */
+static void pulseaudioReconnect(void) {
+	pa_threaded_mainloop_lock(paMainloop);
+	const uint64_t now = systemVolumeNowMs();
+	if (atomic_load(&paLost) && now - paRetryMs >= BAR_PULSEAUDIO_RETRY_MS) {
+		paRetryMs = now;
+		paDisconnect();
+		if (paConnect()) {
+			log_write(DEBUG_AUDIO, "PulseAudio reconnected\n");
 		} else {
-			/* Context became invalid, abort */
-			break;
+			paDisconnect();
+			paReady = false;
+			atomic_store(&paVolume, -1);
+			atomic_store(&paLost, true);
 		}
-		iterations++;
 	}
-	
-	pa_operation_unref(op);
-	int result = paVolume;
-	pthread_mutex_unlock(&paMutex);
-	
-	return result;
+	pa_threaded_mainloop_unlock(paMainloop);
 }
 
-/* PulseAudio: Set volume (thread-safe)
- * 
- * Lock optimization: Release lock between mainloop iterations to allow
- * other threads (volume polling, concurrent set requests) to run.
- */
+/* PulseAudio: Get volume, from the cache; after the server went away, try
+ * to connect again first */
+static int pulseaudioGetVolume(void) {
+	if (atomic_load(&paLost)) {
+		pulseaudioReconnect();
+	}
+	return atomic_load(&paVolume);
+}
+
+/* PulseAudio: Set volume. Does not wait for the server; the cache is
+ * updated right away so a following read sees the new value, and the
+ * sink event confirms it. */
 static bool pulseaudioSetVolume(int percent) {
-	pa_operation *op;
-	
-	pthread_mutex_lock(&paMutex);
-	if (!paContext || !paReady) {
-		pthread_mutex_unlock(&paMutex);
+	pa_threaded_mainloop_lock(paMainloop);
+	if (!paContext || pa_context_get_state(paContext) != PA_CONTEXT_READY) {
+		pa_threaded_mainloop_unlock(paMainloop);
 		return false;
 	}
 	
 	pa_cvolume cv;
-	pa_cvolume_set(&cv, 2, (pa_volume_t)(percent * PA_VOLUME_NORM / 100));
-	
-	op = pa_context_set_sink_volume_by_name(
+	pa_cvolume_set(&cv, paChannels, (pa_volume_t)(percent * PA_VOLUME_NORM / 100));
+	pa_operation *op = pa_context_set_sink_volume_by_name(
 		paContext, "@DEFAULT_SINK@", &cv, NULL, NULL);
-	
-	if (!op) {
-		pthread_mutex_unlock(&paMutex);
-		return false;
-	}
-	
-	/* Iterate mainloop while releasing lock between iterations */
-	int iterations = 0;
-	while (pa_operation_get_state(op) == PA_OPERATION_RUNNING && iterations < BAR_PA_OP_MAX_ITERATIONS) {
-		pthread_mutex_unlock(&paMutex);
-		usleep(10000);  /* 10ms - allow other threads to run */
-		pthread_mutex_lock(&paMutex);
-		
-		if (paContext && paReady) {
-			pa_mainloop_iterate(paMainloop, 0, NULL);
-		} else {
-			/* Context became invalid, abort */
-			break;
-		}
-		iterations++;
-	}
-	
-	pa_operation_unref(op);
-	pthread_mutex_unlock(&paMutex);
-	
-	return true;
-}
-
-/* PulseAudio: Cleanup (thread-safe) */
-static void pulseaudioDestroy(void) {
-	pthread_mutex_lock(&paMutex);
-	
-	if (paContext) {
-		pa_context_disconnect(paContext);
-		pa_context_unref(paContext);
-		paContext = NULL;
+	if (op) {
+		pa_operation_unref(op);
+		atomic_store(&paVolume, percent);
 	}
-	if (paMainloop) {
-		pa_mainloop_free(paMainloop);
-		paMainloop = NULL;
-	}
-	paReady = false;
+	pa_threaded_mainloop_unlock(paMainloop);
 	
-	pthread_mutex_unlock(&paMutex);
+	return op != NULL;
 }
 #endif /* HAVE_PULSEAUDIO */
 
 /*
  * pactl fallback: used when libpulse headers are absent at build time.
  * Prefers pactl >= 16.0 --format=json to avoid locale/format-fragile text
- * parsing.  Falls back to the text pipeline on older installations
+ * parsing.  Falls back to the text output on older installations
  * (prefer building with HAVE_PULSEAUDIO to avoid the pactl dependency).
+ * pactl only runs at startup, on `pactl subscribe` events and for volume
+ * changes; reads come from a cache.
  */
 
 /* Parse volume percentage from pactl --format=json output.
@@ -529,130 +613,452 @@ done:
 	return result;
 }
 
-/* Read up to buf_size-1 bytes from fp into buf, NUL-terminated. */
-static void pactlReadAll(FILE *fp, char *buf, size_t buf_size) {
+/* Is this `pactl subscribe` line about something that can change the
+ * default sink's volume? Expects the untranslated (LC_ALL=C) output, e.g.
+ * "Event 'change' on sink #0" or "Event 'change' on server #-1". */
+bool BarSystemVolumeParsePactlEvent(const char *line) {
+	static const char prefix[] = "Event '";
+	if (line == NULL || strncmp(line, prefix, sizeof(prefix) - 1) != 0) {
+		return false;
+	}
+	const char *on = strstr(line, "' on ");
+	if (on == NULL) {
+		return false;
+	}
+	on += strlen("' on ");
+	return strncmp(on, "sink #", 6) == 0 || strncmp(on, "server", 6) == 0;
+}
+
+/* pactl: the environment it runs with, ours plus LC_ALL=C so its output
+ * is not translated. Built once, before any other thread forks. */
+extern char **environ;
+static char **pactlEnv = NULL;
+
+static bool pactlEnvInit(void) {
+	size_t n = 0;
+	while (environ[n]) {
+		n++;
+	}
+	pactlEnv = calloc(n + 2, sizeof(*pactlEnv));
+	if (!pactlEnv) {
+		return false;
+	}
+	size_t j = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (strncmp(environ[i], "LC_ALL=", 7) != 0) {
+			pactlEnv[j++] = environ[i];
+		}
+	}
+	pactlEnv[j] = "LC_ALL=C";
+	return true;
+}
+
+/* Start pactl with argv (no shell); its stdout goes to outFd, or nowhere
+ * if outFd is -1. Returns the pid or -1. */
+static pid_t pactlSpawn(char *const argv[], int outFd) {
+	posix_spawn_file_actions_t actions;
+	pid_t pid;
+	
+	if (posix_spawn_file_actions_init(&actions) != 0) {
+		return -1;
+	}
+	posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+	if (outFd >= 0) {
+		posix_spawn_file_actions_adddup2(&actions, outFd, STDOUT_FILENO);
+		posix_spawn_file_actions_addclose(&actions, outFd);
+	} else {
+		posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+	}
+	posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+	const int err = posix_spawnp(&pid, "pactl", &actions, NULL, argv, pactlEnv);
+	posix_spawn_file_actions_destroy(&actions);
+	return err == 0 ? pid : -1;
+}
+
+/* Run pactl with argv and collect up to size-1 bytes of its output */
+static bool pactlRun(char *const argv[], char *buf, size_t size) {
+	int fds[2];
+	if (pipe2(fds, O_CLOEXEC) != 0) {
+		return false;
+	}
+	const pid_t pid = pactlSpawn(argv, fds[1]);
+	close(fds[1]);
+	
 	size_t total = 0;
-	size_t n;
-	while (total < buf_size - 1 &&
-	       (n = fread(buf + total, 1, buf_size - 1 - total, fp)) > 0) {
-		total += n;
+	ssize_t n;
+	while (pid > 0 && total < size - 1 &&
+	       ((n = read(fds[0], buf + total, size - 1 - total)) > 0 ||
+	        (n < 0 && errno == EINTR))) {
+		total += n > 0 ? (size_t)n : 0;
 	}
 	buf[total] = '\0';
+	close(fds[0]);
+	
+	int status = -1;
+	if (pid > 0) {
+		while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+		}
+	}
+	return pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
 }
 
-static int pactlGetVolume(void) {
+/* Ask pactl for the default sink's volume; forks, so only used at startup
+ * and when `pactl subscribe` reported a change */
+static int pactlQueryVolume(void) {
+	char buf[4096];
+	
 	/* Attempt JSON output (pactl >= 16.0) */
-	FILE *fp = popen("pactl --format=json get-sink-volume @DEFAULT_SINK@"
-	                 " 2>/dev/null", "r");
-	if (fp) {
-		char buf[4096];
-		pactlReadAll(fp, buf, sizeof(buf));
-		pclose(fp);
+	char *jsonArgv[] = {"pactl", "--format=json", "get-sink-volume", "@DEFAULT_SINK@", NULL};
+	if (pactlRun(jsonArgv, buf, sizeof(buf))) {
 		int vol = BarSystemVolumeParsePactlJsonVolume(buf);
 		if (vol >= 0) {
 			return vol;
 		}
 	}
-
-	/* Fall back to text parsing for older pactl installations */
-	fp = popen("pactl get-sink-volume @DEFAULT_SINK@ 2>/dev/null"
-	           " | grep -oP '\\d+%' | head -1 | tr -d '%'", "r");
-	if (!fp) {
+	
+	/* Fall back to text output for older pactl installations: the first
+	 * "NN%" is the first channel */
+	char *textArgv[] = {"pactl", "get-sink-volume", "@DEFAULT_SINK@", NULL};
+	if (!pactlRun(textArgv, buf, sizeof(buf))) {
 		return -1;
 	}
-	int volume = -1;
-	if (fscanf(fp, "%d", &volume) != 1) {
-		volume = -1;
+	for (const char *p = strchr(buf, '%'); p; p = strchr(p + 1, '%')) {
+		const char *digits = p;
+		while (digits > buf && digits[-1] >= '0' && digits[-1] <= '9') {
+			digits--;
+		}
+		if (digits < p) {
+			return atoi(digits);
+		}
 	}
-	pclose(fp);
-	return volume;
+	return -1;
 }
 
-/* pactl CLI fallback: Set volume */
-static bool pactlSetVolume(int percent) {
-	char cmd[128];
-	snprintf(cmd, sizeof(cmd), "pactl set-sink-volume @DEFAULT_SINK@ %d%% 2>/dev/null", percent);
-	return system(cmd) == 0;
+/* pactl: cached volume, kept current by a watcher thread reading a
+ * long-running `pactl subscribe` */
+static atomic_int pactlVolume = -1;
+static pthread_t pactlThread;
+static bool pactlWatching = false;
+static int pactlWakeFds[2] = {-1, -1};
+
+/* Re-read the volume after an event; report it if it changed */
+static void pactlRefresh(void) {
+	const int volume = pactlQueryVolume();
+	if (volume >= 0 && atomic_exchange(&pactlVolume, volume) != volume) {
+		systemVolumeNotify(volume);
+	}
 }
 
-/* ALSA: open default mixer and find element by alsaMixerName.
- * On success, sets *handle and *elem; caller must snd_mixer_close(*handle).
- * On failure, returns false (handle is closed internally if it was opened).
- */
-static bool alsa_open_mixer_and_find_elem(snd_mixer_t **handle, snd_mixer_elem_t **elem) {
-	snd_mixer_selem_id_t *sid;
+/* Wait for fd to become readable or the wake pipe
+ * @return false if woken (shutting down) */
+static bool pactlWait(int fd, int timeoutMs) {
+	struct pollfd fds[2] = {
+		{.fd = pactlWakeFds[0], .events = POLLIN},
+		{.fd = fd, .events = POLLIN},
+	};
+	while (poll(fds, fd >= 0 ? 2 : 1, timeoutMs) < 0 && errno == EINTR) {
+	}
+	return fds[0].revents == 0;
+}
 
-	if (!alsaMixerName)
-		return false;
+/* pactl watcher thread: run `pactl subscribe`, and if it exits (server
+ * restart), start it again after BAR_PACTL_RESPAWN_MS */
+static void *pactlWatchThread(void *arg) {
+	(void)arg;
+	char *argv[] = {"pactl", "subscribe", NULL};
+	char line[256];
+	
+	while (true) {
+		int fds[2];
+		pid_t pid = -1;
+		if (pipe2(fds, O_CLOEXEC) == 0) {
+			pid = pactlSpawn(argv, fds[1]);
+			close(fds[1]);
+		} else {
+			fds[0] = -1;
+		}
+		if (pid > 0) {
+			/* changes while it was not running went unnoticed */
+			pactlRefresh();
+		}
+		
+		size_t len = 0;
+		bool running = pid > 0;
+		while (running) {
+			if (!pactlWait(fds[0], -1)) {
+				break;
+			}
+			ssize_t n = read(fds[0], line + len, sizeof(line) - 1 - len);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				running = false;
+				break;
+			}
+			len += (size_t)n;
+			line[len] = '\0';
+			
+			/* one query for however many events arrived together */
+			bool changed = false;
+			char *start = line, *nl;
+			while ((nl = strchr(start, '\n')) != NULL) {
+				*nl = '\0';
+				changed |= BarSystemVolumeParsePactlEvent(start);
+				start = nl + 1;
+			}
+			len -= (size_t)(start - line);
+			memmove(line, start, len);
+			if (len == sizeof(line) - 1) {
+				len = 0; /* not a line we know, skip it */
+			}
+			if (changed) {
+				pactlRefresh();
+			}
+		}
+		
+		if (pid > 0) {
+			kill(pid, SIGTERM);
+			while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {
+			}
+		}
+		if (fds[0] >= 0) {
+			close(fds[0]);
+		}
+		if (running || !pactlWait(-1, BAR_PACTL_RESPAWN_MS)) {
+			break;
+		}
+		log_write(DEBUG_AUDIO, "pactl subscribe exited, restarting\n");
+	}
+	return NULL;
+}
 
-	if (snd_mixer_open(handle, 0) < 0)
+/* pactl CLI fallback: read the volume once and start watching it */
+static bool pactlInit(void) {
+	if (!pactlEnv && !pactlEnvInit()) {
 		return false;
-	if (snd_mixer_attach(*handle, "default") < 0)
-		goto cleanup;
-	if (snd_mixer_selem_register(*handle, NULL, NULL) < 0)
-		goto cleanup;
-	if (snd_mixer_load(*handle) < 0)
-		goto cleanup;
-
-	snd_mixer_selem_id_alloca(&sid);
-	snd_mixer_selem_id_set_index(sid, 0);
-	snd_mixer_selem_id_set_name(sid, alsaMixerName);
+	}
+	const int volume = pactlQueryVolume();
+	if (volume < 0) {
+		return false;
+	}
+	atomic_store(&pactlVolume, volume);
+	
+	if (pipe2(pactlWakeFds, O_CLOEXEC) == 0 &&
+	    pthread_create(&pactlThread, NULL, pactlWatchThread, NULL) == 0) {
+		pactlWatching = true;
+	} else {
+		log_write(LOG_ERROR, "Cannot start pactl watcher\n");
+	}
+	return true;
+}
 
-	*elem = snd_mixer_find_selem(*handle, sid);
-	if (!*elem)
-		goto cleanup;
+static int pactlGetVolume(void) {
+	/* Without the watcher the cache would go stale */
+	if (!pactlWatching) {
+		atomic_store(&pactlVolume, pactlQueryVolume());
+	}
+	return atomic_load(&pactlVolume);
+}
 
+/* pactl CLI fallback: Set volume */
+static bool pactlSetVolume(int percent) {
+	char value[16];
+	char buf[256];
+	snprintf(value, sizeof(value), "%d%%", percent);
+	char *argv[] = {"pactl", "set-sink-volume", "@DEFAULT_SINK@", value, NULL};
+	if (!pactlRun(argv, buf, sizeof(buf))) {
+		return false;
+	}
+	/* Our own change is not reported to the listener */
+	atomic_store(&pactlVolume, percent);
 	return true;
+}
 
-cleanup:
-	snd_mixer_close(*handle);
-	*handle = NULL;
-	return false;
+static void pactlDestroy(void) {
+	if (pactlWatching) {
+		const char c = 0;
+		if (write(pactlWakeFds[1], &c, 1) < 0) {
+			log_write(LOG_ERROR, "Cannot wake pactl watcher\n");
+		}
+		pthread_join(pactlThread, NULL);
+		pactlWatching = false;
+	}
+	for (int i = 0; i < 2; i++) {
+		if (pactlWakeFds[i] >= 0) {
+			close(pactlWakeFds[i]);
+			pactlWakeFds[i] = -1;
+		}
+	}
+	atomic_store(&pactlVolume, -1);
 }
 
-/* ALSA native: Get volume using libasound */
-static int alsaGetVolume(void) {
-	snd_mixer_t *handle = NULL;
-	snd_mixer_elem_t *elem;
-	long min, max, volume;
-	int percent;
+/* ALSA: the mixer stays open; a watcher thread sleeps in poll() on its
+ * descriptors and the element callback keeps a cached volume. The handle
+ * is used by the watcher and by setters, so it is under alsaMutex. */
+static snd_mixer_t *alsaHandle = NULL;
+static snd_mixer_elem_t *alsaElem = NULL;
+static long alsaMin, alsaMax;
+static atomic_int alsaVolume = -1;
+static bool alsaChanged = false;
+static pthread_mutex_t alsaMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t alsaThread;
+static bool alsaWatching = false;    /* alsaThread needs joining */
+static atomic_bool alsaWatched = false; /* alsaThread is watching, the cache is current */
+static int alsaWakeFds[2] = {-1, -1};
+
+static int alsaPercent(long volume) {
+	const long range = alsaMax - alsaMin;
+	if (range <= 0) {
+		return 0;
+	}
+	/* Rounded both ways so a percentage set is read back unchanged */
+	return (int)(((volume - alsaMin) * 100 + range / 2) / range);
+}
 
-	if (!alsa_open_mixer_and_find_elem(&handle, &elem)) {
-		return -1;
+/* ALSA: read the element into the cache; alsaMutex held */
+static void alsaReadVolume(void) {
+	long volume;
+	if (!alsaElem ||
+	    snd_mixer_selem_get_playback_volume(alsaElem, SND_MIXER_SCHN_MONO, &volume) < 0) {
+		return;
 	}
+	const int percent = alsaPercent(volume);
+	if (atomic_exchange(&alsaVolume, percent) != percent) {
+		alsaChanged = true;
+	}
+}
 
-	snd_mixer_selem_get_playback_volume_range(elem, &min, &max);
-	snd_mixer_selem_get_playback_volume(elem, SND_MIXER_SCHN_MONO, &volume);
-	percent = (int)(((volume - min) * 100) / (max - min));
+/* ALSA element callback, from snd_mixer_handle_events (alsaMutex held) */
+static int alsaElemCb(snd_mixer_elem_t *elem, unsigned int mask) {
+	(void)elem;
+	if (mask == SND_CTL_EVENT_MASK_REMOVE) {
+		alsaElem = NULL;
+		atomic_store(&alsaVolume, -1);
+		return 0;
+	}
+	if (mask & SND_CTL_EVENT_MASK_VALUE) {
+		alsaReadVolume();
+	}
+	return 0;
+}
+
+/* ALSA watcher thread: wait for mixer events, stop when woken via
+ * alsaWakeFds or the device goes away */
+static void *alsaWatchThread(void *arg) {
+	(void)arg;
+	struct pollfd fds[BAR_ALSA_POLL_FDS_MAX + 1];
+	
+	pthread_mutex_lock(&alsaMutex);
+	int count = snd_mixer_poll_descriptors_count(alsaHandle);
+	if (count > BAR_ALSA_POLL_FDS_MAX) {
+		count = BAR_ALSA_POLL_FDS_MAX;
+	}
+	count = count > 0 ? snd_mixer_poll_descriptors(alsaHandle, fds, (unsigned int)count) : 0;
+	pthread_mutex_unlock(&alsaMutex);
+	if (count <= 0) {
+		log_write(LOG_ERROR, "ALSA mixer has no poll descriptors, volume changes are not watched\n");
+		atomic_store(&alsaWatched, false);
+		return NULL;
+	}
+	fds[count].fd = alsaWakeFds[0];
+	fds[count].events = POLLIN;
+	
+	while (true) {
+		if (poll(fds, (nfds_t)count + 1, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (fds[count].revents) {
+			break;
+		}
+		
+		unsigned short revents = 0;
+		pthread_mutex_lock(&alsaMutex);
+		snd_mixer_poll_descriptors_revents(alsaHandle, fds, (unsigned int)count, &revents);
+		if (revents & POLLIN) {
+			snd_mixer_handle_events(alsaHandle);
+		}
+		const bool changed = alsaChanged;
+		alsaChanged = false;
+		pthread_mutex_unlock(&alsaMutex);
+		
+		if (changed && atomic_load(&alsaVolume) >= 0) {
+			systemVolumeNotify(atomic_load(&alsaVolume));
+		}
+		if (revents & (POLLERR | POLLNVAL)) {
+			log_write(LOG_ERROR, "ALSA mixer went away, volume changes are not watched\n");
+			break;
+		}
+	}
+	atomic_store(&alsaWatched, false);
+	return NULL;
+}
 
-	snd_mixer_close(handle);
-	return percent;
+/* ALSA native: Get volume, from the cache while the watcher keeps it
+ * current, otherwise by catching up on the mixer's events first */
+static int alsaGetVolume(void) {
+	if (!atomic_load(&alsaWatched)) {
+		pthread_mutex_lock(&alsaMutex);
+		if (alsaHandle) {
+			snd_mixer_handle_events(alsaHandle);
+		}
+		alsaReadVolume();
+		alsaChanged = false;
+		pthread_mutex_unlock(&alsaMutex);
+	}
+	return atomic_load(&alsaVolume);
 }
 
 /* ALSA native: Set volume using libasound */
 static bool alsaSetVolume(int percent) {
-	snd_mixer_t *handle = NULL;
-	snd_mixer_elem_t *elem;
-	long min, max, volume;
-
-	if (!alsa_open_mixer_and_find_elem(&handle, &elem)) {
+	pthread_mutex_lock(&alsaMutex);
+	if (!alsaElem) {
+		pthread_mutex_unlock(&alsaMutex);
 		return false;
 	}
+	const long volume = alsaMin + ((alsaMax - alsaMin) * percent + 50) / 100;
+	const bool ok = snd_mixer_selem_set_playback_volume_all(alsaElem, volume) >= 0;
+	if (ok) {
+		/* Our own change is not reported to the listener */
+		atomic_store(&alsaVolume, alsaPercent(volume));
+	}
+	pthread_mutex_unlock(&alsaMutex);
+	return ok;
+}
 
-	snd_mixer_selem_get_playback_volume_range(elem, &min, &max);
-	volume = min + ((max - min) * percent) / 100;
-	snd_mixer_selem_set_playback_volume_all(elem, volume);
-
-	snd_mixer_close(handle);
-	return true;
+/* ALSA: Close the mixer and stop watching it */
+static void alsaDestroy(void) {
+	if (alsaWatching) {
+		const char c = 0;
+		if (write(alsaWakeFds[1], &c, 1) < 0) {
+			log_write(LOG_ERROR, "Cannot wake ALSA watcher\n");
+		}
+		pthread_join(alsaThread, NULL);
+		alsaWatching = false;
+	}
+	for (int i = 0; i < 2; i++) {
+		if (alsaWakeFds[i] >= 0) {
+			close(alsaWakeFds[i]);
+			alsaWakeFds[i] = -1;
+		}
+	}
+	if (alsaHandle) {
+		snd_mixer_close(alsaHandle);
+		alsaHandle = NULL;
+	}
+	alsaElem = NULL;
+	atomic_store(&alsaVolume, -1);
 }
 
-/* ALSA: Try to find a working mixer element
+/* ALSA: Find a working mixer element and keep the mixer open
  * @param mixerName specific mixer name to use, or NULL for auto-detect
  * Returns true if a working mixer was found */
 static bool alsaInit(const char *mixerName) {
 	snd_mixer_t *handle;
-	snd_mixer_elem_t *elem;
+	snd_mixer_elem_t *elem = NULL;
 	snd_mixer_selem_id_t *sid;
 	
 	/* Mixer names to try in order of preference */
@@ -689,24 +1095,41 @@ static bool alsaInit(const char *mixerName) {
 		elem = snd_mixer_find_selem(handle, sid);
 		if (elem) {
 			alsaMixerName = strdup(mixerName);
-			snd_mixer_close(handle);
-			return true;
 		}
 	} else {
 		/* Auto-detect: try each mixer name in order */
-		for (const char **name = mixerNames; *name; name++) {
+		for (const char **name = mixerNames; *name && !elem; name++) {
 			snd_mixer_selem_id_set_name(sid, *name);
 			elem = snd_mixer_find_selem(handle, sid);
 			if (elem) {
 				alsaMixerName = strdup(*name);
-				snd_mixer_close(handle);
-				return true;
 			}
 		}
 	}
+	if (!elem) {
+		snd_mixer_close(handle);
+		return false;
+	}
 	
-	snd_mixer_close(handle);
-	return false;
+	pthread_mutex_lock(&alsaMutex);
+	alsaHandle = handle;
+	alsaElem = elem;
+	snd_mixer_selem_get_playback_volume_range(elem, &alsaMin, &alsaMax);
+	snd_mixer_elem_set_callback(elem, alsaElemCb);
+	alsaReadVolume();
+	alsaChanged = false;
+	pthread_mutex_unlock(&alsaMutex);
+	
+	/* Without the watcher, changes are polled again (alsaGetVolume) */
+	atomic_store(&alsaWatched, true);
+	if (pipe2(alsaWakeFds, O_CLOEXEC) == 0 &&
+	    pthread_create(&alsaThread, NULL, alsaWatchThread, NULL) == 0) {
+		alsaWatching = true;
+	} else {
+		atomic_store(&alsaWatched, false);
+		log_write(LOG_ERROR, "Cannot start ALSA watcher\n");
+	}
+	return true;
 }
 
 /* Linux initialization - try backends in order of preference */
@@ -714,18 +1137,13 @@ static bool linuxInit(const char *mixerName) {
 #ifdef HAVE_PULSEAUDIO
 	/* Try libpulse first */
 	if (pulseaudioInit()) {
-		int testVol = pulseaudioGetVolume();
-		if (testVol >= 0) {
-			activeBackend = BACKEND_PULSEAUDIO;
-			return true;
-		}
-		pulseaudioDestroy();
+		activeBackend = BACKEND_PULSEAUDIO;
+		return true;
 	}
 #endif
 	
 	/* Try pactl CLI */
-	int testVol = pactlGetVolume();
-	if (testVol >= 0) {
+	if (pactlInit()) {
 		activeBackend = BACKEND_PACTL;
 		return true;
 	}
@@ -775,6 +1193,12 @@ static void linuxDestroy(void) {
 		pulseaudioDestroy();
 	}
 #endif
+	if (activeBackend == BACKEND_PACTL) {
+		pactlDestroy();
+	}
+	if (activeBackend == BACKEND_ALSA) {
+		alsaDestroy();
+	}
 	/* Free ALSA mixer name */
 	free(alsaMixerName);
 	alsaMixerName = NULL;
@@ -791,14 +1215,18 @@ static void linuxDestroy(void) {
 bool BarSystemVolumeInit(const char *alsaMixer) {
 #ifdef __APPLE__
 	(void)alsaMixer;  /* unused on macOS */
-	return macosInit();
+	const bool ok = macosInit();
 #elif defined(__linux__)
-	return linuxInit(alsaMixer);
+	const bool ok = linuxInit(alsaMixer);
 #else
 	/* Unsupported platform */
 	(void)alsaMixer;
-	return false;
+	const bool ok = false;
 #endif
+	if (ok) {
+		BarSystemVolumeRefresh();
+	}
+	return ok;
 }
 
 void BarSystemVolumeDestroy(void) {
@@ -806,16 +1234,69 @@ void BarSystemVolumeDestroy(void) {
 	linuxDestroy();
 #endif
 	activeBackend = BACKEND_NONE;
+	
+	pthread_mutex_lock(&cacheMutex);
+	if (cacheReads > 0) {
+		log_write(DEBUG_AUDIO, "System volume cache: %lu reads, %lu misses\n",
+		          cacheReads, cacheMisses);
+	}
+	cache.volume = -1;
+	cache.muted = -1;
+	cache.device[0] = '\0';
+	cache.updatedMs = 0;
+	cacheReads = cacheMisses = 0;
+	pthread_mutex_unlock(&cacheMutex);
 }
 
 int BarSystemVolumeGet(void) {
+	pthread_mutex_lock(&cacheMutex);
+	cacheReads++;
+	const int volume = cache.volume;
+	const bool fresh = volume >= 0 &&
+	        (BarSystemVolumeEventDriven() ||
+	         systemVolumeNowMs() - cache.updatedMs <= SYSTEM_VOLUME_STALE_MS);
+	if (!fresh) {
+		cacheMisses++;
+	}
+	pthread_mutex_unlock(&cacheMutex);
+	
+	return fresh ? volume : BarSystemVolumeRefresh();
+}
+
+int BarSystemVolumeRefresh(void) {
+	const char *device = NULL;
 #ifdef __APPLE__
-	return macosGetVolume();
+	const int volume = macosGetVolume();
+	char deviceId[32];
+	if (activeBackend == BACKEND_COREAUDIO) {
+		snprintf(deviceId, sizeof(deviceId), "0x%x", (unsigned int)defaultOutputDevice);
+		device = deviceId;
+	}
 #elif defined(__linux__)
-	return linuxGetVolume();
+	const int volume = linuxGetVolume();
+	if (activeBackend == BACKEND_ALSA) {
+		device = alsaMixerName;
+	}
 #else
-	return -1;
+	const int volume = -1;
 #endif
+	if (volume >= 0) {
+		systemVolumeStore(volume, -1, device);
+	}
+	return volume;
+}
+
+void BarSystemVolumeGetState(BarSystemVolumeState_t *state) {
+	pthread_mutex_lock(&cacheMutex);
+	*state = cache;
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+void BarSystemVolumeCacheStats(unsigned long *reads, unsigned long *misses) {
+	pthread_mutex_lock(&cacheMutex);
+	*reads = cacheReads;
+	*misses = cacheMisses;
+	pthread_mutex_unlock(&cacheMutex);
 }
 
 bool BarSystemVolumeSet(int percent) {
@@ -824,18 +1305,43 @@ bool BarSystemVolumeSet(int percent) {
 	if (percent > VOLUME_MAX_PERCENT) percent = VOLUME_MAX_PERCENT;
 	
 #ifdef __APPLE__
-	return macosSetVolume(percent);
+	const bool ok = macosSetVolume(percent);
 #elif defined(__linux__)
-	return linuxSetVolume(percent);
+	const bool ok = linuxSetVolume(percent);
 #else
-	return false;
+	const bool ok = false;
 #endif
+	if (ok) {
+		systemVolumeStore(percent, -1, NULL);
+	}
+	return ok;
 }
 
 bool BarSystemVolumeAvailable(void) {
 	return activeBackend != BACKEND_NONE;
 }
 
+bool BarSystemVolumeEventDriven(void) {
+#ifdef __linux__
+#ifdef HAVE_PULSEAUDIO
+	if (activeBackend == BACKEND_PULSEAUDIO) {
+		return !atomic_load(&paLost);
+	}
+#endif
+	return (activeBackend == BACKEND_PACTL && pactlWatching) ||
+	       (activeBackend == BACKEND_ALSA && atomic_load(&alsaWatched));
+#else
+	return false;
+#endif
+}
+
+void BarSystemVolumeSetListener(BarSystemVolumeListener_t fn, void *userdata) {
+	pthread_mutex_lock(&listenerMutex);
+	listener = fn;
+	listenerData = userdata;
+	pthread_mutex_unlock(&listenerMutex);
+}
+
 bool BarSystemVolumeRefreshDevice(void) {
 #ifdef __APPLE__
 	/* Only CoreAudio backend needs device refresh */
@@ -844,7 +1350,8 @@ bool BarSystemVolumeRefreshDevice(void) {
 	}
 	return false;
 #else
-	/* Linux backends use dynamic device resolution - no refresh needed */
+	/* Linux backends use dynamic device resolution - no refresh needed;
+	 * PulseAudio follows default sink changes through its subscription */
 	return false;
 #endif
 }
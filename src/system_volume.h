@@ -24,6 +24,7 @@ THE SOFTWARE.
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /* Volume control mode */
 typedef enum {
@@ -39,10 +40,31 @@ bool BarSystemVolumeInit(const char *alsaMixer);
 /* Cleanup system volume resources */
 void BarSystemVolumeDestroy(void);
 
-/* Get current system volume as 0-100 percentage
+/* Last known system volume. Backends that report changes keep it current;
+ * for the others it is as old as the last read */
+typedef struct {
+	int volume;            /* 0-100, -1 if unknown */
+	int muted;             /* 1 or 0, -1 if the backend does not tell */
+	char device[128];      /* Output device or sink, "" if unknown */
+	uint64_t updatedMs;    /* Monotonic time of the last update (ms) */
+} BarSystemVolumeState_t;
+
+/* Get current system volume as 0-100 percentage, from the cache. Only
+ * reads the backend (a cache miss) if the cache is empty, or older than
+ * SYSTEM_VOLUME_STALE_MS and the backend does not report changes.
  * Returns -1 on error */
 int BarSystemVolumeGet(void);
 
+/* Read the volume from the backend into the cache, e.g. to poll for
+ * external changes. Returns -1 on error */
+int BarSystemVolumeRefresh(void);
+
+/* Copy of the cache; never reads the backend */
+void BarSystemVolumeGetState(BarSystemVolumeState_t *state);
+
+/* BarSystemVolumeGet calls so far, and how many of them missed the cache */
+void BarSystemVolumeCacheStats(unsigned long *reads, unsigned long *misses);
+
 /* Set system volume as 0-100 percentage
  * Returns true on success */
 bool BarSystemVolumeSet(int percent);
@@ -51,6 +73,21 @@ bool BarSystemVolumeSet(int percent);
  * (backend initialized successfully) */
 bool BarSystemVolumeAvailable(void);
 
+/* Called with the new 0-100 volume when it changed outside of pianobar's
+ * own reads (another app, hardware keys), or with -1 when the backend lost
+ * its connection and stops reporting changes (BarSystemVolumeEventDriven
+ * turns false); runs on the backend's thread */
+typedef void (*BarSystemVolumeListener_t)(int percent, void *userdata);
+
+/* Install (or, with NULL, remove) the change listener. Once this returns
+ * the previous listener is no longer running. Safe to call from any thread */
+void BarSystemVolumeSetListener(BarSystemVolumeListener_t listener, void *userdata);
+
+/* Check if the active backend reports changes to the listener by itself
+ * (PulseAudio, pactl, watched ALSA mixer), so its cache never goes stale
+ * and BarSystemVolumeRefresh does not need to be polled */
+bool BarSystemVolumeEventDriven(void);
+
 /* Check if default output device changed and refresh if needed
  * Returns true if device was refreshed, false otherwise
  * Safe to call from any thread */
@@ -60,5 +97,8 @@ bool BarSystemVolumeRefreshDevice(void);
  * Exposed for regression tests; production callers should use BarSystemVolumeGet. */
 #ifndef __APPLE__
 int BarSystemVolumeParsePactlJsonVolume(const char *buf);
+
+/* True if a `pactl subscribe` line may mean a new default sink volume */
+bool BarSystemVolumeParsePactlEvent(const char *line);
 #endif
 
@@ -46,6 +46,7 @@ THE SOFTWARE.
 #include "ui_readline.h"
 #include "bar_state.h"
 #include "websocket_bridge.h"
+#include "station_display.h"
 
 /*	is string a number?
  */
@@ -439,6 +440,48 @@ bool BarUiPianoCallLogged (BarApp_t * const app, const PianoRequestType_t type,
 	return BarUiPianoCall (app, type, data, pRet, wRet);
 }
 
+/*	fetch station list; a refresh is merged into the existing list, so only
+ *	added/renamed stations need new display names and web clients get a delta
+ *	@param app handle
+ *	@param piano error code
+ *	@param curl error code
+ *	@return true on success
+ */
+bool BarUiGetStations (BarApp_t * const app, PianoReturn_t * const pRet,
+		CURLcode * const wRet) {
+	PianoRequestDataGetStations_t diff;
+	memset (&diff, 0, sizeof (diff));
+
+	if (!BarUiPianoCall (app, PIANO_REQUEST_GET_STATIONS, &diff, pRet, wRet)) {
+		PianoDestroyGetStations (&diff);
+		return false;
+	}
+
+	for (size_t i = 0; i < diff.addedCount; i++) {
+		BarUpdateStationDisplayName (&app->settings, diff.added[i]);
+	}
+	for (size_t i = 0; i < diff.changedCount; i++) {
+		BarUpdateStationDisplayName (&app->settings, diff.changed[i]);
+	}
+	BarWsBroadcastStationsDelta (app, &diff);
+
+	/* removed stations are already unlinked, drop our references before
+	 * freeing them (same as DELETE_STATION) */
+	PianoStation_t *station = diff.removed;
+	PianoListForeachP (station) {
+		if (station == BarStateGetCurrentStation (app)) {
+			BarStateDrainPlaylist (app);
+			BarStateSetCurrentStation (app, NULL);
+		}
+		if (station == BarStateGetNextStation (app)) {
+			BarStateSetNextStation (app, NULL);
+		}
+	}
+	PianoDestroyGetStations (&diff);
+
+	return true;
+}
+
 /*	let user pick one station
  *	@param app handle
  *	@param stations that should be listed
@@ -991,7 +1034,7 @@ void BarUiStartEventCmd (const BarSettings_t *settings, const char *type,
 	}
 }
 
-/*	prepend song to history
+/*	prepend song to history; only a compact copy is kept, song is freed
  */
 void BarUiHistoryPrepend (BarApp_t *app, PianoSong_t *song) {
 	assert (app != NULL);
@@ -999,21 +1042,8 @@ void BarUiHistoryPrepend (BarApp_t *app, PianoSong_t *song) {
 	/* make sure it's a single song */
 	assert (PianoListNextP (song) == NULL);
 
-	if (app->settings.history != 0) {
-		app->songHistory = PianoListPrependP (app->songHistory, song);
-		PianoSong_t *del;
-		do {
-			del = PianoListGetP (app->songHistory, app->settings.history);
-			if (del != NULL) {
-				app->songHistory = PianoListDeleteP (app->songHistory, del);
-				PianoDestroyPlaylist (del);
-			} else {
-				break;
-			}
-		} while (true);
-	} else {
-		PianoDestroyPlaylist (song);
-	}
+	BarStateHistoryPush (app, song);
+	PianoDestroyPlaylist (song);
 }
 
 
@@ -62,6 +62,7 @@ bool BarUiPianoCall (BarApp_t * const, const PianoRequestType_t,
 		void *, PianoReturn_t *, CURLcode *);
 bool BarUiPianoCallLogged (BarApp_t * const, const PianoRequestType_t,
 		void *, const char *, PianoReturn_t *, CURLcode *);
+bool BarUiGetStations (BarApp_t * const, PianoReturn_t * const, CURLcode * const);
 void BarUiHistoryPrepend (BarApp_t *app, PianoSong_t *song);
 void BarUiCustomFormat (char *dest, size_t destSize, const char *format,
 		const char *formatChars, const char **formatVals);
@@ -787,10 +787,7 @@ void BarUiDoPandoraDisconnect(BarApp_t *app, const char *reason,
 	BarStateSetNextStation(app, NULL);
 	
 	/* Free song history */
-	if (app->songHistory != NULL) {
-		PianoDestroyPlaylist(app->songHistory);
-		app->songHistory = NULL;
-	}
+	BarStateHistoryClear(app);
 	
 	/* Disconnect from Pandora (destroys stations, user info, partner).
 	 * Serialize with BarUiPianoCall — same app->ph. */
@@ -827,14 +824,30 @@ BarUiActCallback(BarUiActPandoraDisconnect) {
 	BarUiDoPandoraDisconnect(app, "user", NULL);
 }
 
+/*	copy history entry to the temporary playlist built by BarUiActHistory
+ */
+static bool BarUiActHistoryCollect (const BarSongHistoryEntry_t *entry,
+		void *ctx) {
+	PianoSong_t **list = ctx;
+	PianoSong_t *song = BarSongHistoryEntryToSong (entry);
+	if (song == NULL) {
+		return false;
+	}
+	*list = PianoListAppendP (*list, song);
+	return true;
+}
+
 /*	song history
  */
 BarUiActCallback(BarUiActHistory) {
 	char buf[2];
-	PianoSong_t *histSong;
+	PianoSong_t *history = NULL, *histSong;
+
+	/* select from a private copy, the ring may change while we wait for input */
+	BarStateHistoryForeach (app, BarUiActHistoryCollect, &history);
 
-	if (app->songHistory != NULL) {
-		histSong = BarUiSelectSong (app, app->songHistory,
+	if (history != NULL) {
+		histSong = BarUiSelectSong (app, history,
 				&app->input);
 		if (histSong != NULL) {
 			BarKeyShortcutId_t action;
@@ -843,6 +856,7 @@ BarUiActCallback(BarUiActHistory) {
 
 			if (songStation == NULL) {
 				BarUiMsg (&app->settings, MSG_ERR, "Station does not exist any more.\n");
+				PianoDestroyPlaylist (history);
 				return;
 			}
 
@@ -859,7 +873,12 @@ BarUiActCallback(BarUiActHistory) {
 							false, BAR_DC_UNDEFINED);
 				}
 			} while (action == BAR_KS_HELP);
+
+			/* love/ban update the copy, keep the record in sync */
+			BarStateHistorySetRating (app, histSong->trackToken,
+					histSong->rating);
 		} /* end if histSong != NULL */
+		PianoDestroyPlaylist (history);
 	} else {
 		BarUiMsg (&app->settings, MSG_INFO, (app->settings.history == 0) ? "History disabled.\n" :
 				"No history yet.\n");
@@ -1260,8 +1279,8 @@ BarUiActCallback(BarUiActPandoraReconnect) {
 	reqData.password = (char *)pass;
 	reqData.step = 0;
 
-	/* Clean up existing Pandora session so GET_STATIONS doesn't append
-	 * to the old station list (libpiano appends, never replaces). */
+	/* Clean up existing Pandora session; the account may have changed, so
+	 * the station list is fetched from scratch rather than merged. */
 	PianoStation_t *curStation = BarStateGetCurrentStation(app);
 	free(app->lastStationId);
 	app->lastStationId = curStation ? strdup(curStation->id) : NULL;
@@ -1312,17 +1331,11 @@ BarUiActCallback(BarUiActPandoraReconnect) {
 	
 	/* Fetch stations */
 	BarUiMsg(&app->settings, MSG_INFO, "Get stations... ");
-	if (!BarUiPianoCall(app, PIANO_REQUEST_GET_STATIONS, NULL, &pRet, &wRet)) {
+	if (!BarUiGetStations(app, &pRet, &wRet)) {
 		BarUiMsg(&app->settings, MSG_ERR, "Failed to get stations.\n");
 		return;
 	}
 	
-	/* Update display names after stations are fetched */
-	BarUpdateStationDisplayNames(app);
-	
-	/* Broadcast updated stations to WebSocket clients */
-	BarWsBroadcastStations(app);
-	
 	/* Auto-resume: prefer per-account autostart, then last station */
 	const char *autostation = (acct && acct->autostartStation) ?
 			acct->autostartStation : NULL;
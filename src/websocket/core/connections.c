@@ -0,0 +1,155 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "connections.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Set up an empty list
+ * max: connection cap (> 0) */
+void BarWsConnectionListInit(BarWsConnectionList_t *l, size_t max) {
+	memset(l, 0, sizeof(*l));
+	l->max = max > 0 ? max : 1;
+}
+
+/* Start tracking a client in its (zeroed) per-session block
+ * conn: per-session connection block
+ * queueCapacity: outbound queue depth
+ * Returns false if the cap is reached or the queue cannot be allocated, conn is
+ * left untouched then */
+bool BarWsConnectionAttach(BarWsConnectionList_t *l, BarWsConnection_t *conn,
+		void *wsi, const char *protocol, size_t queueCapacity) {
+	if (BarWsConnectionListFull(l)) {
+		return false;
+	}
+
+	BarWsOutQueue_t queue;
+	if (!BarWsOutQueueInit(&queue, queueCapacity)) {
+		return false;
+	}
+
+	memset(conn, 0, sizeof(*conn));
+	conn->wsi = wsi;
+	conn->queue = queue;
+	if (protocol != NULL) {
+		strncpy(conn->protocol, protocol, sizeof(conn->protocol) - 1);
+	}
+
+	/* push front, order does not matter for broadcast */
+	conn->next = l->head;
+	if (l->head != NULL) {
+		l->head->prev = conn;
+	}
+	l->head = conn;
+	conn->linked = true;
+	l->count++;
+	return true;
+}
+
+/* Stop tracking a client and release its queued frames, O(1)
+ * conn: connection, ignored if it was never attached */
+void BarWsConnectionDetach(BarWsConnectionList_t *l, BarWsConnection_t *conn) {
+	if (!conn->linked) {
+		return;
+	}
+
+	if (conn->prev != NULL) {
+		conn->prev->next = conn->next;
+	} else {
+		l->head = conn->next;
+	}
+	if (conn->next != NULL) {
+		conn->next->prev = conn->prev;
+	}
+	conn->prev = conn->next = NULL;
+	conn->linked = false;
+	BarWsOutQueueDestroy(&conn->queue);
+	BarWsRxRelease(&conn->rx, 0);
+	l->count--;
+}
+
+/* Look up a live connection by wsi (for targets that may have gone away)
+ * Returns connection or NULL */
+BarWsConnection_t *BarWsConnectionFind(const BarWsConnectionList_t *l,
+		const void *wsi) {
+	BarWsConnectionForeach(l, c) {
+		if (c->wsi == wsi) {
+			return c;
+		}
+	}
+	return NULL;
+}
+
+/* Add received bytes to the message being assembled; the buffer is kept
+ * between messages, so steady traffic does not allocate
+ * first: first piece of a new message (drops any leftover)
+ * max: maximum message size in bytes
+ * Returns false if the message would exceed the maximum or memory ran out, the
+ * partial message is discarded then */
+bool BarWsRxAppend(BarWsRxBuffer_t *rx, const void *data, size_t len,
+		bool first, size_t max) {
+	if (first) {
+		rx->len = 0;
+	}
+
+	if (len > max || rx->len > max - len) {
+		rx->len = 0;
+		return false;
+	}
+
+	const size_t need = rx->len + len + 1;
+	if (need > rx->alloc) {
+		size_t alloc = rx->alloc > 0 ? rx->alloc : 1024;
+		while (alloc < need) {
+			alloc *= 2;
+		}
+		if (alloc > max + 1) {
+			alloc = max + 1;
+		}
+		char *grown = realloc(rx->data, alloc);
+		if (grown == NULL) {
+			rx->len = 0;
+			return false;
+		}
+		rx->data = grown;
+		rx->alloc = alloc;
+	}
+
+	if (len > 0) {
+		memcpy(rx->data + rx->len, data, len);
+	}
+	rx->len += len;
+	rx->data[rx->len] = '\0';
+	return true;
+}
+
+/* Forget the assembled message, freeing the buffer if it outgrew keep
+ * keep: bytes worth keeping for the next message (0 frees always) */
+void BarWsRxRelease(BarWsRxBuffer_t *rx, size_t keep) {
+	rx->len = 0;
+	if (rx->alloc > keep) {
+		free(rx->data);
+		rx->data = NULL;
+		rx->alloc = 0;
+	}
+}
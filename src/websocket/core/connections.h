@@ -0,0 +1,90 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef _WEBSOCKET_CONNECTIONS_H
+#define _WEBSOCKET_CONNECTIONS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "outqueue.h"
+#include "../http/http_server.h"
+
+/* Connection state lives in the per-session block libwebsockets allocates
+ * for each client (per_session_data_size), so there is no table to size or
+ * scan. Live clients are additionally threaded on an intrusive list that
+ * broadcasts walk. The list does not lock; websocket.c holds connMutex. */
+
+/* Inbound message being assembled from RECEIVE callbacks (fragments, or
+ * pieces of a frame larger than the lws rx buffer). Service thread only. */
+typedef struct {
+	char *data;                   /* NUL-terminated once complete */
+	size_t len, alloc;
+} BarWsRxBuffer_t;
+
+typedef struct BarWsConnection {
+	struct BarWsConnection *prev, *next; /* Live client list */
+	void *wsi;                    /* libwebsockets instance */
+	bool linked;                  /* On the live list (false if rejected) */
+	bool authenticated;           /* Authentication status */
+	bool pendingClose;            /* Connection marked for close (app.stop) */
+	bool slow;                    /* Outbound queue overflowed, kill on next service pass */
+	bool msgpack;                 /* Sent binary MessagePack frames instead of text */
+	int tsi;                      /* lws service thread that owns wsi */
+	unsigned int unsubscribed;    /* Broadcast buckets opted out of, one bit each */
+	char protocol[64];            /* Protocol: "socketio" or "homeassistant" */
+	BarWsOutQueue_t queue;        /* Frames waiting for SERVER_WRITEABLE */
+	BarWsRxBuffer_t rx;           /* Message being received */
+	BarHttpTransfer_t http;       /* Web UI file being sent, before any upgrade */
+} BarWsConnection_t;
+
+typedef struct {
+	BarWsConnection_t *head;
+	size_t count;
+	size_t max;                   /* Connection cap */
+} BarWsConnectionList_t;
+
+void BarWsConnectionListInit(BarWsConnectionList_t *, size_t);
+bool BarWsConnectionAttach(BarWsConnectionList_t *, BarWsConnection_t *,
+		void *, const char *, size_t);
+void BarWsConnectionDetach(BarWsConnectionList_t *, BarWsConnection_t *);
+BarWsConnection_t *BarWsConnectionFind(const BarWsConnectionList_t *,
+		const void *);
+
+bool BarWsRxAppend(BarWsRxBuffer_t *, const void *, size_t, bool, size_t);
+void BarWsRxRelease(BarWsRxBuffer_t *, size_t);
+
+static inline bool BarWsConnectionListFull(const BarWsConnectionList_t *l) {
+	return l->count >= l->max;
+}
+
+/* does c take broadcasts from bucket? Frames outside the buckets (replies,
+ * errors) always go through */
+static inline bool BarWsConnectionWants(const BarWsConnection_t *c, int bucket) {
+	return bucket < 0 || (c->unsubscribed & (1u << bucket)) == 0;
+}
+
+/* iterate over live connections; c must not be detached inside the body */
+#define BarWsConnectionForeach(l, c) \
+	for (BarWsConnection_t *c = (l)->head; c != NULL; c = c->next)
+
+#endif /* _WEBSOCKET_CONNECTIONS_H */
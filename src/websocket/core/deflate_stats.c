@@ -0,0 +1,169 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "deflate_stats.h"
+#include "../../log.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+/* emits come from any thread; the side deflate runs under the lock too, it
+ * is only done for the few large frames (station lists, search results) */
+static pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool statsEnabled = false; /* written under the lock */
+static size_t statsReportMin;
+static z_stream statsStream;
+static BarWsDeflateStat_t stats[BAR_WS_DEFLATE_STATS_EVENT_MAX];
+static size_t statsCount;
+
+/* Start counting (again), clears previous numbers
+ * reportMin: minimum payload size to deflate-measure, in bytes */
+void BarWsDeflateStatsEnable(size_t reportMin) {
+	pthread_mutex_lock(&statsMutex);
+	if (!statsEnabled) {
+		memset(&statsStream, 0, sizeof(statsStream));
+		/* negative window bits: raw deflate, as on the wire */
+		if (deflateInit2(&statsStream, Z_BEST_SPEED, Z_DEFLATED, -15, 8,
+				Z_DEFAULT_STRATEGY) != Z_OK) {
+			pthread_mutex_unlock(&statsMutex);
+			log_write(LOG_ERROR, "Compression stats unavailable\n");
+			return;
+		}
+	}
+	statsEnabled = true;
+	statsReportMin = reportMin;
+	memset(stats, 0, sizeof(stats));
+	statsCount = 0;
+	pthread_mutex_unlock(&statsMutex);
+}
+
+/* Stop counting and release the deflate state */
+void BarWsDeflateStatsDisable(void) {
+	pthread_mutex_lock(&statsMutex);
+	if (statsEnabled) {
+		deflateEnd(&statsStream);
+		statsEnabled = false;
+	}
+	pthread_mutex_unlock(&statsMutex);
+}
+
+/* Size of data after raw deflate; caller holds statsMutex */
+static unsigned long long BarWsDeflatedSize(const unsigned char *data,
+		size_t len) {
+	unsigned char out[4096];
+	unsigned long long total = 0;
+	int ret;
+
+	deflateReset(&statsStream);
+	statsStream.next_in = (unsigned char *) data;
+	statsStream.avail_in = (uInt) len;
+	do {
+		statsStream.next_out = out;
+		statsStream.avail_out = sizeof(out);
+		ret = deflate(&statsStream, Z_SYNC_FLUSH);
+		total += sizeof(out) - statsStream.avail_out;
+	} while (ret == Z_OK && statsStream.avail_out == 0);
+
+	/* permessage-deflate strips the trailing 00 00 ff ff of the flush */
+	return total >= 4 ? total - 4 : total;
+}
+
+/* Entry for event, the last slot collects events beyond the table */
+static BarWsDeflateStat_t *BarWsDeflateStatsFind(const char *event) {
+	for (size_t i = 0; i < statsCount; i++) {
+		if (strcmp(stats[i].event, event) == 0) {
+			return &stats[i];
+		}
+	}
+	if (statsCount == BAR_WS_DEFLATE_STATS_EVENT_MAX - 1) {
+		BarWsDeflateStat_t * const other = &stats[statsCount];
+		strcpy(other->event, "*");
+		return other;
+	}
+	BarWsDeflateStat_t * const s = &stats[statsCount++];
+	strncpy(s->event, event, sizeof(s->event) - 1);
+	return s;
+}
+
+/* Count a formatted frame
+ * event: Socket.IO event name */
+void BarWsDeflateStatsRecord(const char *event, const BarWsFrame_t *frame) {
+	/* the common case, not reporting: no lock per frame */
+	if (event == NULL || frame == NULL || !atomic_load(&statsEnabled)) {
+		return;
+	}
+
+	pthread_mutex_lock(&statsMutex);
+	if (statsEnabled) {
+		BarWsDeflateStat_t * const s = BarWsDeflateStatsFind(event);
+		s->messages++;
+		s->bytes += frame->len;
+		if (frame->len >= statsReportMin && frame->len <= UINT32_MAX) {
+			s->measured++;
+			s->measuredBytes += frame->len;
+			s->deflatedBytes += BarWsDeflatedSize(
+					BarWsFramePayload((BarWsFrame_t *) frame), frame->len);
+		}
+	}
+	pthread_mutex_unlock(&statsMutex);
+}
+
+/* Copy the current numbers
+ * Returns number of events copied */
+size_t BarWsDeflateStatsGet(BarWsDeflateStat_t *out, size_t max) {
+	pthread_mutex_lock(&statsMutex);
+	size_t n = statsCount;
+	if (n < BAR_WS_DEFLATE_STATS_EVENT_MAX && stats[n].messages > 0) {
+		++n; /* overflow slot in use */
+	}
+	if (n > max) {
+		n = max;
+	}
+	memcpy(out, stats, n * sizeof(*out));
+	pthread_mutex_unlock(&statsMutex);
+	return n;
+}
+
+/* Write one line per event to the log */
+void BarWsDeflateStatsLog(void) {
+	BarWsDeflateStat_t snapshot[BAR_WS_DEFLATE_STATS_EVENT_MAX];
+	const size_t n = BarWsDeflateStatsGet(snapshot,
+			BAR_WS_DEFLATE_STATS_EVENT_MAX);
+
+	for (size_t i = 0; i < n; i++) {
+		const BarWsDeflateStat_t * const s = &snapshot[i];
+		if (s->measured > 0) {
+			log_write(DEBUG_WEBSOCKET, "Compression %s: %llu messages, "
+					"%llu bytes; %llu deflated %llu -> %llu bytes (%llu%%)\n",
+					s->event, s->messages, s->bytes, s->measured,
+					s->measuredBytes, s->deflatedBytes,
+					s->deflatedBytes * 100 / s->measuredBytes);
+		} else {
+			log_write(DEBUG_WEBSOCKET, "Compression %s: %llu messages, "
+					"%llu bytes, all below the report minimum\n", s->event,
+					s->messages, s->bytes);
+		}
+	}
+}
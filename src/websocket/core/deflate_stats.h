@@ -0,0 +1,60 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef _DEFLATE_STATS_H
+#define _DEFLATE_STATS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "queue.h"
+
+/* Per-event size report for permessage-deflate.
+ *
+ * libwebsockets compresses every message once a client negotiated the
+ * extension and does not say what it saved, so outgoing frames are counted
+ * here per Socket.IO event. Frames of at least the report minimum are also
+ * deflated once on the side (raw deflate, fastest level, no shared window:
+ * an upper bound for what lws sends) to report bytes before and after.
+ * Smaller ones are only counted. Frames are measured when formatted, i.e.
+ * once per event regardless of how many clients receive it. The report
+ * goes to the DEBUG_WEBSOCKET log, so the server only enables this while
+ * that is on. */
+
+#define BAR_WS_DEFLATE_STATS_EVENT_MAX 32
+
+typedef struct {
+	char event[32];                   /* Socket.IO event name, "*" for overflow */
+	unsigned long long messages;      /* Frames formatted */
+	unsigned long long bytes;         /* Their payload bytes */
+	unsigned long long measured;      /* Frames at or above the report minimum */
+	unsigned long long measuredBytes; /* Their payload bytes */
+	unsigned long long deflatedBytes; /* ... after deflate */
+} BarWsDeflateStat_t;
+
+void BarWsDeflateStatsEnable(size_t);
+void BarWsDeflateStatsDisable(void);
+void BarWsDeflateStatsRecord(const char *, const BarWsFrame_t *);
+size_t BarWsDeflateStatsGet(BarWsDeflateStat_t *, size_t);
+void BarWsDeflateStatsLog(void);
+
+#endif /* _DEFLATE_STATS_H */
@@ -0,0 +1,187 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "outqueue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Set up an empty queue
+ * capacity: maximum depth (> 0)
+ * Returns false if the ring could not be allocated */
+bool BarWsOutQueueInit(BarWsOutQueue_t *q, size_t capacity) {
+	memset(q, 0, sizeof(*q));
+	if (capacity == 0) {
+		capacity = 1;
+	}
+	q->ring = calloc(capacity, sizeof(*q->ring));
+	if (q->ring == NULL) {
+		return false;
+	}
+	q->capacity = capacity;
+	return true;
+}
+
+/* Drop all references and free the ring, statistics are kept */
+void BarWsOutQueueDestroy(BarWsOutQueue_t *q) {
+	BarWsOutQueueClear(q);
+	free(q->ring);
+	q->ring = NULL;
+	q->capacity = 0;
+}
+
+static BarWsOutEntry_t *BarWsOutQueueAt(BarWsOutQueue_t *q, size_t i) {
+	return &q->ring[(q->head + i) % q->capacity];
+}
+
+/* Unlink the oldest frame without touching the counters */
+static BarWsFrame_t *BarWsOutQueueShift(BarWsOutQueue_t *q) {
+	BarWsOutEntry_t * const e = BarWsOutQueueAt(q, 0);
+	BarWsFrame_t * const frame = e->frame;
+	e->frame = NULL;
+	q->head = (q->head + 1) % q->capacity;
+	q->stats.depth--;
+	return frame;
+}
+
+/* Drop the queued frames of one bucket from position `from` on, keeping the
+ * others in order
+ * Returns number of frames removed */
+static size_t BarWsOutQueueDrop(BarWsOutQueue_t *q, int bucket, size_t from) {
+	size_t kept = from;
+
+	if (bucket == BAR_WS_FRAME_NO_BUCKET) {
+		return 0;
+	}
+
+	for (size_t i = from; i < q->stats.depth; i++) {
+		BarWsOutEntry_t * const e = BarWsOutQueueAt(q, i);
+		if (e->bucket == bucket) {
+			BarWsFrameUnref(e->frame);
+			e->frame = NULL;
+		} else {
+			if (kept != i) {
+				*BarWsOutQueueAt(q, kept) = *e;
+				e->frame = NULL;
+			}
+			++kept;
+		}
+	}
+
+	const size_t removed = q->stats.depth - kept;
+	q->stats.depth = kept;
+	q->stats.coalesced += removed;
+	return removed;
+}
+
+/* Drop every queued frame of one bucket, keeping the others in order
+ * Returns number of frames removed */
+size_t BarWsOutQueueRemoveBucket(BarWsOutQueue_t *q, int bucket) {
+	return BarWsOutQueueDrop(q, bucket, 0);
+}
+
+/* Position after the last incremental frame of a bucket, 0 if there is
+ * none; frames before it are what that frame applies on top of */
+static size_t BarWsOutQueueChainEnd(BarWsOutQueue_t *q, int bucket) {
+	for (size_t i = q->stats.depth; i > 0; i--) {
+		const BarWsOutEntry_t * const e = BarWsOutQueueAt(q, i - 1);
+		if (e->bucket == bucket && e->incremental) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+/* Queue a reference to a frame
+ *
+ * Slow consumers are handled in three steps: a frame belonging to a bucket
+ * replaces the unsent frames of that bucket (clients only need the latest
+ * state), a full queue discards its oldest frame, and once a whole queue's
+ * worth of frames has been discarded without the client draining a single
+ * one, `disconnectSlow` gives up on it.
+ *
+ * Incremental frames (process.patch, stations.delta) only make sense on top
+ * of everything queued before them, so they never replace anything and are
+ * never replaced; a later frame of their bucket only replaces what was
+ * queued after the last of them.
+ *
+ * frame: a new reference is taken unless BAR_WS_OUTQ_SLOW
+ * bucket: BarWsBucketType_t or BAR_WS_FRAME_NO_BUCKET
+ * incremental: frame applies on top of the previous ones of its bucket
+ * disconnectSlow: disconnect instead of dropping forever
+ * Returns what happened to the frame */
+BarWsOutQueueResult_t BarWsOutQueuePush(BarWsOutQueue_t *q,
+		BarWsFrame_t *frame, int bucket, bool incremental, bool disconnectSlow) {
+	BarWsOutQueueResult_t ret = BAR_WS_OUTQ_QUEUED;
+
+	if (!incremental &&
+			BarWsOutQueueDrop(q, bucket, BarWsOutQueueChainEnd(q, bucket)) > 0) {
+		ret = BAR_WS_OUTQ_COALESCED;
+	}
+
+	if (q->stats.depth >= q->capacity) {
+		if (disconnectSlow && q->dropsSinceWrite >= q->capacity) {
+			q->stats.dropped++;
+			return BAR_WS_OUTQ_SLOW;
+		}
+		BarWsFrameUnref(BarWsOutQueueShift(q));
+		q->stats.dropped++;
+		q->dropsSinceWrite++;
+		ret = BAR_WS_OUTQ_DROPPED;
+	}
+
+	BarWsOutEntry_t * const e = BarWsOutQueueAt(q, q->stats.depth);
+	e->frame = BarWsFrameRef(frame);
+	e->bucket = bucket;
+	e->incremental = incremental;
+	q->stats.depth++;
+	if (q->stats.depth > q->stats.highWater) {
+		q->stats.highWater = q->stats.depth;
+	}
+
+	return ret;
+}
+
+/* Take the oldest frame, the caller writes it and drops the reference
+ * Returns frame or NULL if empty */
+BarWsFrame_t *BarWsOutQueuePop(BarWsOutQueue_t *q) {
+	if (q->stats.depth == 0) {
+		return NULL;
+	}
+
+	BarWsFrame_t * const frame = BarWsOutQueueShift(q);
+	q->stats.sent++;
+	q->dropsSinceWrite = 0;
+	return frame;
+}
+
+/* Discard all frames, statistics are kept */
+void BarWsOutQueueClear(BarWsOutQueue_t *q) {
+	for (size_t i = 0; i < q->stats.depth; i++) {
+		BarWsOutEntry_t * const e = BarWsOutQueueAt(q, i);
+		BarWsFrameUnref(e->frame);
+		e->frame = NULL;
+	}
+	q->head = 0;
+	q->stats.depth = 0;
+	q->dropsSinceWrite = 0;
+}
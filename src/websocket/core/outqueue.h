@@ -0,0 +1,83 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef _OUTQUEUE_H
+#define _OUTQUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "queue.h"
+
+/* Per-connection outbound frame queue.
+ *
+ * Frames are queued by whichever thread emits an event and written one at a
+ * time from LWS_CALLBACK_SERVER_WRITEABLE, so a client that stops reading
+ * only ever costs its own queue. The queue is a fixed ring of frame
+ * references allocated when the client connects; queueing a frame only takes
+ * a reference. It does not lock, callers serialize access. */
+
+/* Frame that may not be coalesced with anything (unicast replies, events) */
+#define BAR_WS_FRAME_NO_BUCKET (-1)
+
+typedef struct {
+	BarWsFrame_t *frame;
+	int bucket;                   /* Broadcast bucket or BAR_WS_FRAME_NO_BUCKET */
+	bool incremental;             /* Applies on top of the earlier frames of its bucket */
+} BarWsOutEntry_t;
+
+typedef struct {
+	size_t depth;                 /* Frames currently queued */
+	size_t highWater;             /* Largest depth seen */
+	unsigned long long sent;      /* Frames handed to the writer */
+	unsigned long long coalesced; /* Frames replaced by a newer one of the same bucket */
+	unsigned long long dropped;   /* Frames discarded because the queue was full */
+} BarWsOutQueueStats_t;
+
+typedef struct {
+	BarWsOutEntry_t *ring;
+	size_t capacity;              /* Maximum depth */
+	size_t head;                  /* Index of the oldest frame */
+	size_t dropsSinceWrite;       /* Drops since the client last drained a frame */
+	BarWsOutQueueStats_t stats;
+} BarWsOutQueue_t;
+
+typedef enum {
+	BAR_WS_OUTQ_QUEUED = 0,       /* Appended */
+	BAR_WS_OUTQ_COALESCED,        /* Appended, an older frame of its bucket was discarded */
+	BAR_WS_OUTQ_DROPPED,          /* Appended, the oldest frame was discarded to make room */
+	BAR_WS_OUTQ_SLOW,             /* Nothing queued, client is too far behind: disconnect */
+} BarWsOutQueueResult_t;
+
+bool BarWsOutQueueInit(BarWsOutQueue_t *, size_t);
+void BarWsOutQueueDestroy(BarWsOutQueue_t *);
+BarWsOutQueueResult_t BarWsOutQueuePush(BarWsOutQueue_t *, BarWsFrame_t *,
+		int, bool, bool);
+size_t BarWsOutQueueRemoveBucket(BarWsOutQueue_t *, int);
+BarWsFrame_t *BarWsOutQueuePop(BarWsOutQueue_t *);
+void BarWsOutQueueClear(BarWsOutQueue_t *);
+
+static inline bool BarWsOutQueueEmpty(const BarWsOutQueue_t *q) {
+	return q->stats.depth == 0;
+}
+
+#endif /* _OUTQUEUE_H */
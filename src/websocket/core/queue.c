@@ -23,6 +23,82 @@ THE SOFTWARE.
 #include "queue.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Message pool: buckets hold at most one message each, so a handful of
+ * structs covers steady state and enqueueing never hits malloc */
+static pthread_mutex_t g_poolMutex = PTHREAD_MUTEX_INITIALIZER;
+static BarWsMessage_t *g_poolHead = NULL;
+static size_t g_poolSize = 0;
+
+/* Allocate frame */
+BarWsFrame_t *BarWsFrameNew(size_t len) {
+	BarWsFrame_t *frame = malloc(sizeof(*frame) + BAR_WS_FRAME_HEADROOM + len + 1);
+	if (!frame) {
+		return NULL;
+	}
+	atomic_init(&frame->refs, 1);
+	frame->len = len;
+	frame->packed = NULL;
+	frame->incremental = false;
+	frame->buf[BAR_WS_FRAME_HEADROOM + len] = '\0';
+	return frame;
+}
+
+/* Copy string into frame */
+BarWsFrame_t *BarWsFrameFromString(const char *str) {
+	if (!str) {
+		return NULL;
+	}
+	
+	size_t len = strlen(str);
+	BarWsFrame_t *frame = BarWsFrameNew(len);
+	if (frame) {
+		memcpy(BarWsFramePayload(frame), str, len);
+	}
+	return frame;
+}
+
+/* Take another reference */
+BarWsFrame_t *BarWsFrameRef(BarWsFrame_t *frame) {
+	if (frame) {
+		atomic_fetch_add_explicit(&frame->refs, 1, memory_order_relaxed);
+	}
+	return frame;
+}
+
+/* Drop a reference, freeing the frame with the last one */
+void BarWsFrameUnref(BarWsFrame_t *frame) {
+	if (frame && atomic_fetch_sub_explicit(&frame->refs, 1, memory_order_acq_rel) == 1) {
+		BarWsFrameUnref(frame->packed);
+		free(frame);
+	}
+}
+
+/* Get message from pool */
+BarWsMessage_t *BarWsMessageNew(BarWsMsgType_t type, BarWsFrame_t *frame) {
+	pthread_mutex_lock(&g_poolMutex);
+	BarWsMessage_t *msg = g_poolHead;
+	if (msg) {
+		g_poolHead = msg->next;
+		g_poolSize--;
+	}
+	pthread_mutex_unlock(&g_poolMutex);
+	
+	if (!msg) {
+		msg = malloc(sizeof(*msg));
+		if (!msg) {
+			BarWsFrameUnref(frame);
+			return NULL;
+		}
+	}
+	
+	msg->type = type;
+	msg->frame = frame;
+	msg->next = NULL;
+	return msg;
+}
 
 /* Free message */
 void BarWsMessageFree(BarWsMessage_t *msg) {
@@ -30,9 +106,32 @@ void BarWsMessageFree(BarWsMessage_t *msg) {
 		return;
 	}
 	
-	if (msg->data) {
-		free(msg->data);
+	BarWsFrameUnref(msg->frame);
+	msg->frame = NULL;
+	
+	pthread_mutex_lock(&g_poolMutex);
+	if (g_poolSize < BAR_WS_MESSAGE_POOL_MAX) {
+		msg->next = g_poolHead;
+		g_poolHead = msg;
+		g_poolSize++;
+		msg = NULL;
 	}
+	pthread_mutex_unlock(&g_poolMutex);
 	
 	free(msg);
 }
+
+/* Drain pool */
+void BarWsMessagePoolDrain(void) {
+	pthread_mutex_lock(&g_poolMutex);
+	BarWsMessage_t *msg = g_poolHead;
+	g_poolHead = NULL;
+	g_poolSize = 0;
+	pthread_mutex_unlock(&g_poolMutex);
+	
+	while (msg) {
+		BarWsMessage_t *next = msg->next;
+		free(msg);
+		msg = next;
+	}
+}
@@ -24,11 +24,40 @@ THE SOFTWARE.
 #define _WEBSOCKET_QUEUE_H
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Bytes reserved in front of every frame payload. lws_write() writes the
+ * WebSocket header there (LWS_PRE, checked in websocket.c). */
+#define BAR_WS_FRAME_HEADROOM 16
+
+/* Free message structs kept for reuse */
+#define BAR_WS_MESSAGE_POOL_MAX 16
+
+/* Serialized Socket.IO text frame, shared by reference.
+ *
+ * An event is formatted exactly once; the bucket and every client queue
+ * hold a reference to the same buffer, so fanning out to N clients costs no
+ * further allocation or copy. The payload is NUL-terminated (not counted in
+ * len) so it can be logged and inspected as a string. The headroom is
+ * scribbled on by lws_write(); that is safe for a shared frame only while
+ * one service thread does all writes. With several, each writes from a
+ * private copy (BarWebsocketWriteNext).
+ *
+ * While MessagePack clients are connected, the binary encoding of the same
+ * event is made alongside and hangs off the text frame. */
+typedef struct BarWsFrame {
+	atomic_uint refs;
+	size_t len;                    /* Payload length */
+	struct BarWsFrame *packed;     /* MessagePack twin (owned) or NULL */
+	bool incremental;              /* Applies on top of the previous frame of its bucket */
+	unsigned char buf[];           /* Headroom + payload + NUL */
+} BarWsFrame_t;
 
 /* Message types for bucket communication */
 typedef enum {
 	/* Broadcast messages (Main → WebSocket thread) */
-	MSG_TYPE_BROADCAST_SOCKETIO,   /* data is a heap-owned Socket.IO text frame */
+	MSG_TYPE_BROADCAST_SOCKETIO,   /* frame is a Socket.IO text frame */
 
 	/* Command messages (WebSocket → Main thread) */
 	MSG_TYPE_COMMAND_ACTION,       /* User action */
@@ -42,12 +71,34 @@ typedef enum {
 /* Message structure for buckets */
 typedef struct BarWsMessage {
 	BarWsMsgType_t type;           /* Message type */
-	void *data;                    /* Message payload (owned by message) */
-	size_t dataLen;                /* Payload length */
-	struct BarWsMessage *next;     /* Next message in linked list */
+	BarWsFrame_t *frame;           /* Payload (one reference, owned by message) */
+	struct BarWsMessage *next;     /* Next message in linked list / pool */
 } BarWsMessage_t;
 
-/* Free message (frees data and message itself) */
+/* Allocate a frame with `len` payload bytes (refcount 1, payload uninitialized) */
+BarWsFrame_t *BarWsFrameNew(size_t len);
+
+/* Copy a string into a new frame */
+BarWsFrame_t *BarWsFrameFromString(const char *str);
+
+BarWsFrame_t *BarWsFrameRef(BarWsFrame_t *frame);
+void BarWsFrameUnref(BarWsFrame_t *frame);
+
+static inline unsigned char *BarWsFramePayload(BarWsFrame_t *frame) {
+	return frame->buf + BAR_WS_FRAME_HEADROOM;
+}
+
+static inline const char *BarWsFrameData(const BarWsFrame_t *frame) {
+	return (const char *)frame->buf + BAR_WS_FRAME_HEADROOM;
+}
+
+/* Get a message from the pool (or heap); takes ownership of `frame` */
+BarWsMessage_t *BarWsMessageNew(BarWsMsgType_t type, BarWsFrame_t *frame);
+
+/* Free message: drops its frame reference and returns it to the pool */
 void BarWsMessageFree(BarWsMessage_t *msg);
 
+/* Release pooled message structs (shutdown) */
+void BarWsMessagePoolDrain(void);
+
 #endif /* _WEBSOCKET_QUEUE_H */
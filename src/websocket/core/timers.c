@@ -0,0 +1,130 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "timers.h"
+
+#include <time.h>
+
+/* Monotonic clock
+ * Returns milliseconds */
+uint64_t BarWsTimeMs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000u + (uint64_t) ts.tv_nsec / 1000000u;
+}
+
+/* No timer armed */
+void BarWsTimersInit(BarWsTimers_t *t) {
+	t->count = 0;
+	for (int i = 0; i < BAR_WS_TIMER_COUNT; i++) {
+		t->due[i] = 0;
+		t->pos[i] = -1;
+	}
+}
+
+static bool BarWsTimerBefore(const BarWsTimers_t *t, unsigned int a,
+		unsigned int b) {
+	return t->due[t->heap[a]] < t->due[t->heap[b]];
+}
+
+static void BarWsTimerSwap(BarWsTimers_t *t, unsigned int a, unsigned int b) {
+	const int id = t->heap[a];
+	t->heap[a] = t->heap[b];
+	t->heap[b] = id;
+	t->pos[t->heap[a]] = (int) a;
+	t->pos[t->heap[b]] = (int) b;
+}
+
+/* Restore heap order around index i after its deadline changed */
+static void BarWsTimerFix(BarWsTimers_t *t, unsigned int i) {
+	while (i > 0 && BarWsTimerBefore(t, i, (i - 1) / 2)) {
+		BarWsTimerSwap(t, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+	while (true) {
+		unsigned int min = i;
+		const unsigned int l = 2 * i + 1, r = 2 * i + 2;
+		if (l < t->count && BarWsTimerBefore(t, l, min)) {
+			min = l;
+		}
+		if (r < t->count && BarWsTimerBefore(t, r, min)) {
+			min = r;
+		}
+		if (min == i) {
+			break;
+		}
+		BarWsTimerSwap(t, i, min);
+		i = min;
+	}
+}
+
+/* Arm a timer or move its deadline */
+void BarWsTimerArm(BarWsTimers_t *t, BarWsTimerId_t id, uint64_t due) {
+	t->due[id] = due;
+	if (t->pos[id] < 0) {
+		t->heap[t->count] = (int) id;
+		t->pos[id] = (int) t->count;
+		t->count++;
+	}
+	BarWsTimerFix(t, (unsigned int) t->pos[id]);
+}
+
+/* Cancel a timer, no-op if it is not armed */
+void BarWsTimerDisarm(BarWsTimers_t *t, BarWsTimerId_t id) {
+	const int i = t->pos[id];
+	if (i < 0) {
+		return;
+	}
+	t->count--;
+	if ((unsigned int) i != t->count) {
+		BarWsTimerSwap(t, (unsigned int) i, t->count);
+		t->pos[id] = -1;
+		BarWsTimerFix(t, (unsigned int) i);
+	} else {
+		t->pos[id] = -1;
+	}
+}
+
+/* Disarm and return the earliest timer that is due
+ * Returns timer id, -1 if none is due */
+int BarWsTimersExpired(BarWsTimers_t *t, uint64_t now) {
+	if (t->count == 0 || t->due[t->heap[0]] > now) {
+		return -1;
+	}
+	const int id = t->heap[0];
+	BarWsTimerDisarm(t, (BarWsTimerId_t) id);
+	return id;
+}
+
+/* How long the service thread may sleep
+ * max: longest wait (ms)
+ * Returns milliseconds until the earliest deadline, at most max */
+int BarWsTimersTimeout(const BarWsTimers_t *t, uint64_t now, int max) {
+	if (t->count == 0) {
+		return max;
+	}
+	const uint64_t due = t->due[t->heap[0]];
+	if (due <= now) {
+		return 0;
+	}
+	return due - now < (uint64_t) max ? (int) (due - now) : max;
+}
@@ -0,0 +1,60 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef _WS_TIMERS_H
+#define _WS_TIMERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Deadlines of the WebSocket service thread.
+ *
+ * A binary min-heap over a fixed set of timers, so the thread can sleep
+ * until the earliest one instead of waking up on a fixed interval. Times
+ * are CLOCK_MONOTONIC milliseconds. It does not lock: only the service
+ * thread touches it, other threads hand requests over and wake it. */
+
+typedef enum {
+	BAR_WS_TIMER_VOLUME_BROADCAST, /* Debounced volume broadcast */
+	BAR_WS_TIMER_VOLUME_POLL,      /* System volume poll */
+	BAR_WS_TIMER_COUNT
+} BarWsTimerId_t;
+
+typedef struct {
+	uint64_t due[BAR_WS_TIMER_COUNT];
+	int heap[BAR_WS_TIMER_COUNT];  /* Armed timers, earliest first */
+	int pos[BAR_WS_TIMER_COUNT];   /* Index in heap, -1 if not armed */
+	unsigned int count;
+} BarWsTimers_t;
+
+uint64_t BarWsTimeMs(void);
+void BarWsTimersInit(BarWsTimers_t *);
+void BarWsTimerArm(BarWsTimers_t *, BarWsTimerId_t, uint64_t);
+void BarWsTimerDisarm(BarWsTimers_t *, BarWsTimerId_t);
+int BarWsTimersExpired(BarWsTimers_t *, uint64_t);
+int BarWsTimersTimeout(const BarWsTimers_t *, uint64_t, int);
+
+static inline bool BarWsTimerArmed(const BarWsTimers_t *t, BarWsTimerId_t id) {
+	return t->pos[id] >= 0;
+}
+
+#endif /* _WS_TIMERS_H */
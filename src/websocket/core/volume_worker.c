@@ -0,0 +1,108 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "volume_worker.h"
+
+#include <errno.h>
+#include <time.h>
+
+static void *BarWsVolumeWorkerThread(void *arg) {
+	BarWsVolumeWorker_t *w = arg;
+
+	pthread_mutex_lock(&w->mutex);
+	while (true) {
+		while (w->running && w->pending < 0) {
+			pthread_cond_wait(&w->cond, &w->mutex);
+		}
+		if (w->pending < 0) {
+			break;
+		}
+		const int percent = w->pending;
+		w->pending = -1;
+		pthread_mutex_unlock(&w->mutex);
+
+		w->apply(percent, w->userdata);
+
+		/* requests arriving meanwhile overwrite each other in the slot */
+		struct timespec pause = {
+			.tv_sec = w->intervalMs / 1000,
+			.tv_nsec = (long) (w->intervalMs % 1000) * 1000000L,
+		};
+		while (nanosleep(&pause, &pause) != 0 && errno == EINTR) {
+		}
+
+		pthread_mutex_lock(&w->mutex);
+	}
+	pthread_mutex_unlock(&w->mutex);
+	return NULL;
+}
+
+/* Start the worker thread; apply runs on it. BarWsVolumeWorkerDestroy
+ * must follow, also if this fails.
+ * Returns false if the thread could not be created */
+bool BarWsVolumeWorkerStart(BarWsVolumeWorker_t *w, unsigned int intervalMs,
+		BarWsVolumeApply_t apply, void *userdata) {
+	pthread_mutex_init(&w->mutex, NULL);
+	pthread_cond_init(&w->cond, NULL);
+	w->pending = -1;
+	w->intervalMs = intervalMs;
+	w->apply = apply;
+	w->userdata = userdata;
+	w->running = true;
+	if (pthread_create(&w->thread, NULL, BarWsVolumeWorkerThread, w) != 0) {
+		w->running = false;
+		return false;
+	}
+	return true;
+}
+
+/* Replace the pending volume
+ * Returns false if the worker is not running, the caller applies it */
+bool BarWsVolumeWorkerSet(BarWsVolumeWorker_t *w, int percent) {
+	pthread_mutex_lock(&w->mutex);
+	const bool running = w->running;
+	if (running) {
+		w->pending = percent;
+		pthread_cond_signal(&w->cond);
+	}
+	pthread_mutex_unlock(&w->mutex);
+	return running;
+}
+
+/* Apply what is still pending and stop the thread */
+void BarWsVolumeWorkerStop(BarWsVolumeWorker_t *w) {
+	pthread_mutex_lock(&w->mutex);
+	if (!w->running) {
+		pthread_mutex_unlock(&w->mutex);
+		return;
+	}
+	w->running = false;
+	pthread_cond_signal(&w->cond);
+	pthread_mutex_unlock(&w->mutex);
+	pthread_join(w->thread, NULL);
+}
+
+/* Release the lock after BarWsVolumeWorkerStop */
+void BarWsVolumeWorkerDestroy(BarWsVolumeWorker_t *w) {
+	pthread_cond_destroy(&w->cond);
+	pthread_mutex_destroy(&w->mutex);
+}
@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef _WS_VOLUME_WORKER_H
+#define _WS_VOLUME_WORKER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+/* Applies volume.set requests off the service and command threads.
+ *
+ * A slider drag sends dozens of requests; each one only overwrites a
+ * single slot, and the worker applies whatever is in it at most once per
+ * interval. Values in between are skipped, the last one is always
+ * applied, also when the worker is stopped. */
+
+typedef void (*BarWsVolumeApply_t) (int percent, void *userdata);
+
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_t thread;
+	int pending;                /* Latest requested volume, -1 if none */
+	bool running;
+	unsigned int intervalMs;    /* Minimum time between two applies */
+	BarWsVolumeApply_t apply;
+	void *userdata;
+} BarWsVolumeWorker_t;
+
+bool BarWsVolumeWorkerStart(BarWsVolumeWorker_t *, unsigned int,
+		BarWsVolumeApply_t, void *);
+bool BarWsVolumeWorkerSet(BarWsVolumeWorker_t *, int);
+void BarWsVolumeWorkerStop(BarWsVolumeWorker_t *);
+void BarWsVolumeWorkerDestroy(BarWsVolumeWorker_t *);
+
+#endif /* _WS_VOLUME_WORKER_H */
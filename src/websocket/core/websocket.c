@@ -29,7 +29,9 @@ THE SOFTWARE.
 #include "../../log.h"
 #include "../../system_volume.h"
 #include "websocket.h"
+#include "deflate_stats.h"
 #include "../protocol/socketio.h"
+#include "../protocol/msgpack.h"
 #include "../http/http_server.h"
 
 #include <stdlib.h>
@@ -49,14 +51,34 @@ static const lws_retry_bo_t keepalive_policy = {
 	.jitter_percent = 0,
 };
 
+/* permessage-deflate (RFC 7692), offered when websocket_compression is on */
+static const struct lws_extension extensions[] = {
+	{
+		"permessage-deflate",
+		lws_extension_callback_pm_deflate,
+		"permessage-deflate; client_max_window_bits"
+	},
+	{ NULL, NULL, NULL } /* terminator */
+};
+
+/* Frames are formatted with room for the WebSocket header in front */
+_Static_assert(BAR_WS_FRAME_HEADROOM >= LWS_PRE,
+               "BAR_WS_FRAME_HEADROOM must cover LWS_PRE");
+
 /* Global context for broadcast callback */
 static BarWsContext_t *g_wsContext = NULL;
 
+/* lws (4.x) sleeps until its own next timer, whatever timeout lws_service()
+ * is given; this one is kept at the earliest of ctx->timers */
+static lws_sorted_usec_list_t g_timerSul;
+
 /* Forward declarations */
-static void BarWebsocketBroadcast(const char *message, size_t len);
-static void BarWebsocketProcessBroadcast(BarWsContext_t *ctx, BarWsMessage_t *msg);
+static void BarWebsocketBroadcast(BarWsFrame_t *frame);
+static void BarWebsocketQueueFrame(BarWsContext_t *ctx, BarWsFrame_t *frame,
+                                   int bucket);
+static void BarWebsocketProcessBroadcast(BarWsContext_t *ctx, BarWsBucketType_t bucket,
+                                         BarWsMessage_t *msg);
 static void* BarWebsocketThread(void *arg);
-static void BarWsProcessVolumeBroadcast(BarWsContext_t *ctx, BarApp_t *app);
 
 /*	Bucket Pattern for WebSocket Broadcasts
  *
@@ -86,10 +108,10 @@ static void BarWsProcessVolumeBroadcast(BarWsContext_t *ctx, BarApp_t *app);
  *    - Minimizes contention between different message types
  *    - PROGRESS updates don't block VOLUME changes, etc.
  *
- * 5. NATURAL RATE LIMITING FROM POLLING
- *    - WebSocket thread polls buckets every ~50ms
- *    - This polling frequency provides natural rate limiting
- *    - No explicit throttling code needed
+ * 5. NATURAL RATE LIMITING FROM WAKEUPS
+ *    - Filling a bucket wakes the WebSocket thread, which drains all of them
+ *    - Whatever is produced while it services clients coalesces meanwhile
+ *    - No explicit throttling code needed; an idle server does not wake
  *
  * BUCKETS:
  *    - BUCKET_STATE: Song start/stop events
@@ -97,6 +119,18 @@ static void BarWsProcessVolumeBroadcast(BarWsContext_t *ctx, BarApp_t *app);
  *    - BUCKET_VOLUME: Volume changes
  *    - BUCKET_STATIONS: Station list updates
  *
+ * PER-CONNECTION QUEUES:
+ *    Buckets rate-limit what is produced; each client then gets its own
+ *    bounded outbound queue (see outqueue.h) which is only drained from
+ *    LWS_CALLBACK_SERVER_WRITEABLE, one frame per callback. Queues hold
+ *    references to the frame the bucket message carried, so an event is
+ *    serialized once regardless of the number of clients. A client that
+ *    stops reading never blocks the service loop or other clients:
+ *      1. a newer frame of the same bucket replaces its unsent predecessor
+ *      2. a full queue (websocket_queue_limit) drops its oldest frame
+ *      3. after a full queue's worth of drops without progress the client is
+ *         disconnected (websocket_slow_client = disconnect, the default)
+ *
  * ALTERNATIVE (NOT USED):
  *    Direct BarSocketIoEmit*() calls would require manual rate limiting,
  *    explicit throttling logic, and risk flooding clients with intermediate
@@ -140,61 +174,189 @@ static BarWsMessage_t* BarWsBucketTake(BarWsContext_t *ctx, BarWsBucketType_t bu
 	return msg;
 }
 
+/* "subscribe" topic names, indexed by bucket */
+static const char *const bucketNames[BUCKET_COUNT] = {
+	[BUCKET_STATE] = "state",
+	[BUCKET_VOLUME] = "volume",
+	[BUCKET_PROGRESS] = "progress",
+	[BUCKET_STATIONS] = "stations",
+};
+
+bool BarWsBucketByName(const char *name, BarWsBucketType_t *bucket) {
+	for (int i = 0; i < BUCKET_COUNT; i++) {
+		if (strcmp(name, bucketNames[i]) == 0) {
+			*bucket = (BarWsBucketType_t) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* SERVER_WRITEABLE: send the oldest queued frame of conn and ask for another
+ * callback if more are waiting. Returns -1 to close the connection. */
+static int BarWebsocketWriteNext(BarWsContext_t *ctx, BarWsConnection_t *conn,
+                                 struct lws *wsi) {
+	pthread_mutex_lock(&ctx->connMutex);
+	if (!conn->linked) {
+		pthread_mutex_unlock(&ctx->connMutex);
+		return 0;
+	}
+	/* Connection marked for close (app.stop or slow consumer) */
+	if (conn->pendingClose || conn->slow) {
+		pthread_mutex_unlock(&ctx->connMutex);
+		return -1;
+	}
+	BarWsFrame_t *frame = BarWsOutQueuePop(&conn->queue);
+	const bool more = !BarWsOutQueueEmpty(&conn->queue);
+	const enum lws_write_protocol type = conn->msgpack ? LWS_WRITE_BINARY :
+	                                                     LWS_WRITE_TEXT;
+	pthread_mutex_unlock(&ctx->connMutex);
+	
+	if (!frame) {
+		return 0;
+	}
+	
+	/* lws_write puts the header into the headroom in front of the payload.
+	 * Other clients' queues may share this frame; with one service thread
+	 * they are written one after the other, with several they may be
+	 * written right now, so each thread writes from its own copy */
+	const size_t len = frame->len;
+	unsigned char *payload = BarWsFramePayload(frame);
+	if (ctx->serviceThreads > 1) {
+		BarWsServiceThread_t *st = &ctx->service[conn->tsi];
+		if (st->scratchSize < LWS_PRE + len) {
+			unsigned char *scratch = realloc(st->scratch, LWS_PRE + len);
+			if (!scratch) {
+				BarWsFrameUnref(frame);
+				return -1;
+			}
+			st->scratch = scratch;
+			st->scratchSize = LWS_PRE + len;
+		}
+		memcpy(st->scratch + LWS_PRE, payload, len);
+		payload = st->scratch + LWS_PRE;
+	}
+	int written = lws_write(wsi, payload, len, type);
+	BarWsFrameUnref(frame);
+	if (written < (int)len) {
+		log_write(DEBUG_WEBSOCKET, "lws_write failed (wsi=%p, error=%d)\n",
+		           (void *)wsi, written);
+		return -1;
+	}
+	
+	if (more) {
+		lws_callback_on_writable(wsi);
+	}
+	return 0;
+}
+
+/* Request SERVER_WRITEABLE for every connection of st with queued frames,
+ * close connections marked by app.stop and kill slow consumers. Only on
+ * st's own thread, after the buckets were drained. */
+static void BarWsRequestWrites(BarWsContext_t *ctx, BarWsServiceThread_t *st) {
+	pthread_mutex_lock(&ctx->connMutex);
+	if (st->writePending) {
+		st->writePending = false;
+		BarWsConnectionForeach(&ctx->clients, conn) {
+			struct lws *wsi = (struct lws *)conn->wsi;
+			if (conn->tsi != st->tsi) {
+				continue;
+			}
+			if (conn->pendingClose) {
+				/* app.stop: close with "Going Away" (1001) from WRITEABLE */
+				lws_close_reason(wsi, LWS_CLOSE_STATUS_GOINGAWAY,
+				                 (unsigned char *)"Server stopping", 15);
+				lws_callback_on_writable(wsi);
+			} else if (conn->slow) {
+				/* Writable may never come for a client that stopped reading */
+				lws_close_reason(wsi, LWS_CLOSE_STATUS_POLICY_VIOLATION,
+				                 (unsigned char *)"Slow consumer", 13);
+				lws_set_timeout(wsi, PENDING_TIMEOUT_CLOSE_SEND, LWS_TO_KILL_ASYNC);
+			} else if (!BarWsOutQueueEmpty(&conn->queue)) {
+				lws_callback_on_writable(wsi);
+			}
+		}
+	}
+	pthread_mutex_unlock(&ctx->connMutex);
+}
+
 /* WebSocket protocol callback */
 static int callback_websocket(struct lws *wsi, enum lws_callback_reasons reason,
                               void *user, void *in, size_t len) {
 	BarApp_t *app = (BarApp_t *)lws_context_user(lws_get_context(wsi));
-	char filepath[WEBSOCKET_FILEPATH_MAX];
-	const char *webui_path;
 	char *url;
 	
 	switch (reason) {
-		case LWS_CALLBACK_HTTP:
+		case LWS_CALLBACK_HTTP: {
 			/* HTTP request received */
 			url = (char *)in;
 			
-			/* Get webui path from settings, default to ./dist/webui */
-			webui_path = app->settings.webuiPath;
-			if (!webui_path || strlen(webui_path) == 0) {
-				webui_path = "./dist/webui";
-			}
-			
 			log_write(DEBUG_WEBSOCKET, "HTTP: Request for %s\n", url);
 			
-			/* Handle root path */
-			if (strcmp(url, "/") == 0 || strlen(url) == 0) {
-				return BarHttpServeIndex(wsi, webui_path);
+			/* The page carries the current state, so the UI has it
+			 * before its WebSocket is up (webui_inline_state) */
+			BarWsFrame_t *snapshot = NULL;
+			if (app->settings.webuiInlineState && BarHttpAssetIsIndex(url)) {
+				snapshot = BarSocketIoSnapshotFrame(app);
 			}
 			
-			/* Serve requested file */
-			snprintf(filepath, sizeof(filepath), "%s%s", webui_path, url);
-			return BarHttpServeFile(wsi, filepath);
+			/* Served from memory; only files below webui_path exist */
+			const int ret = BarHttpServeAsset(wsi, &((BarWsContext_t *)app->wsContext)->assets,
+			                                  url, snapshot, &((BarWsConnection_t *)user)->http);
+			BarWsFrameUnref(snapshot);
+			return ret;
+		}
+		
+		case LWS_CALLBACK_HTTP_WRITEABLE:
+			/* One chunk of the body per callback, so a slow client only
+			 * holds up itself */
+			return user ? BarHttpWriteBody(wsi, &((BarWsConnection_t *)user)->http) : 0;
+		
+		case LWS_CALLBACK_CLOSED_HTTP:
+			if (user) {
+				BarHttpTransferRelease(&((BarWsConnection_t *)user)->http);
+			}
+			break;
 			
 	case LWS_CALLBACK_ESTABLISHED: {
-		/* New client connected - track it */
+		/* New client connected - track it in its per-session block */
 		log_write(DEBUG_WEBSOCKET, "Client connected\n");
 		
-		if (app && app->wsContext) {
+		if (app && app->wsContext && user) {
 			BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+			BarWsConnection_t *conn = (BarWsConnection_t *)user;
 			
-			/* Find empty slot in connections array */
-			for (size_t i = 0; i < ctx->maxConnections; i++) {
-				if (ctx->connections[i].wsi == NULL) {
-					ctx->connections[i].wsi = wsi;
-					ctx->connections[i].pendingClose = false;
-					strncpy(ctx->connections[i].protocol, 
-					        lws_get_protocol(wsi)->name, 
-					        sizeof(ctx->connections[i].protocol) - 1);
-					ctx->numConnections++;
-					
-					log_write(DEBUG_WEBSOCKET, "Client tracked (slot %zu, total %zu)\n", 
-					           i, ctx->numConnections);
-					
-					/* Send current state to new client only (unicast) */
-					BarSocketIoEmitProcessUnicast(app, wsi);
-					break;
-				}
+			pthread_mutex_lock(&ctx->connMutex);
+			const bool full = BarWsConnectionListFull(&ctx->clients);
+			const bool tracked = !full &&
+			        BarWsConnectionAttach(&ctx->clients, conn, wsi,
+			                              lws_get_protocol(wsi)->name,
+			                              ctx->queueLimit);
+			if (tracked) {
+				conn->tsi = lws_get_tsi(wsi);
+			}
+			if (tracked && strcmp(lws_get_protocol(wsi)->name,
+			                      BAR_MSGPACK_PROTOCOL) == 0) {
+				conn->msgpack = true;
+				BarMsgpackClientsAdd(1);
+			}
+			const size_t total = ctx->clients.count;
+			pthread_mutex_unlock(&ctx->connMutex);
+			
+			if (!tracked) {
+				/* Tell the client why instead of leaving it untracked;
+				 * 1013 lets it retry later */
+				log_write(LOG_ERROR, "Rejecting client: %s (%zu connected)\n",
+				          full ? "connection limit reached" : "out of memory", total);
+				lws_close_reason(wsi, LWS_CLOSE_STATUS_TRY_AGAIN_LATER,
+				                 (unsigned char *)"Too many clients", 16);
+				return -1;
 			}
+			
+			log_write(DEBUG_WEBSOCKET, "Client tracked (total %zu)\n", total);
+			
+			/* Send current state to new client only (unicast) */
+			BarSocketIoEmitProcessUnicast(app, wsi);
 		}
 		break;
 	}
@@ -203,49 +365,64 @@ static int callback_websocket(struct lws *wsi, enum lws_callback_reasons reason,
 		/* Client disconnected - remove from tracking */
 		log_write(DEBUG_WEBSOCKET, "Client disconnected\n");
 		
-		if (app && app->wsContext) {
+		if (app && app->wsContext && user) {
 			BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+			BarWsConnection_t *conn = (BarWsConnection_t *)user;
 			
-			for (size_t i = 0; i < ctx->maxConnections; i++) {
-				if (ctx->connections[i].wsi == wsi) {
-					ctx->connections[i].wsi = NULL;
-					ctx->connections[i].pendingClose = false;
-					ctx->connections[i].protocol[0] = '\0';
-					ctx->numConnections--;
-					
-					log_write(DEBUG_WEBSOCKET, "Client removed (slot %zu, total %zu)\n", 
-					           i, ctx->numConnections);
-					break;
+			pthread_mutex_lock(&ctx->connMutex);
+			if (conn->linked) {
+				const BarWsOutQueueStats_t *st = &conn->queue.stats;
+				log_write(DEBUG_WEBSOCKET, "Client queue stats: "
+				           "pending %zu, high-water %zu, sent %llu, "
+				           "coalesced %llu, dropped %llu\n", st->depth,
+				           st->highWater, st->sent, st->coalesced, st->dropped);
+				
+				BarWsConnectionDetach(&ctx->clients, conn);
+				if (conn->msgpack) {
+					BarMsgpackClientsAdd(-1);
 				}
+				log_write(DEBUG_WEBSOCKET, "Client removed (total %zu)\n",
+				           ctx->clients.count);
 			}
+			pthread_mutex_unlock(&ctx->connMutex);
 		}
 		break;
 	}
 			
 		case LWS_CALLBACK_RECEIVE:
-			/* Received message from client */
-			if (app && in && len > 0) {
-				char *message = malloc(len + 1);
-				if (message) {
-					memcpy(message, in, len);
-					message[len] = '\0';
-					BarWebsocketHandleMessage(app, message, len, "socketio", wsi);
-					free(message);
+			/* Received (part of) a message from client; assemble fragments
+			 * in the connection's buffer and parse it in place once final */
+			if (app && app->wsContext && user) {
+				BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+				BarWsConnection_t *conn = (BarWsConnection_t *)user;
+				if (!conn->linked) {
+					break;
+				}
+				if (!BarWsRxAppend(&conn->rx, in, len,
+				                   lws_is_first_fragment(wsi), ctx->maxMessage)) {
+					log_write(LOG_ERROR, "Client message exceeds %zu bytes, "
+					           "closing (wsi=%p)\n", ctx->maxMessage, (void *)wsi);
+					lws_close_reason(wsi, LWS_CLOSE_STATUS_MESSAGE_TOO_LARGE,
+					                 (unsigned char *)"Message too large", 17);
+					return -1;
+				}
+				/* A final fragment may be empty */
+				if (lws_is_final_fragment(wsi) && conn->rx.len > 0) {
+					BarWebsocketHandleMessage(app, conn->rx.data, conn->rx.len,
+					                          lws_frame_is_binary(wsi) ?
+					                          BAR_MSGPACK_PROTOCOL : "socketio",
+					                          wsi);
+					/* Keep a buffer that fits typical messages */
+					BarWsRxRelease(&conn->rx, LWS_RX_BUFFER_SIZE);
 				}
 			}
 			break;
 			
 		case LWS_CALLBACK_SERVER_WRITEABLE:
-			/* Ready to send data to client */
-			
-			/* Check if this connection is marked for close */
-			if (app && app->wsContext) {
-				BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
-				for (size_t i = 0; i < ctx->maxConnections; i++) {
-					if (ctx->connections[i].wsi == wsi && ctx->connections[i].pendingClose) {
-						return -1;  /* Return -1 to close the connection */
-					}
-				}
+			/* Ready to send data to client: write one queued frame */
+			if (app && app->wsContext && user) {
+				return BarWebsocketWriteNext((BarWsContext_t *)app->wsContext,
+				                             (BarWsConnection_t *)user, wsi);
 			}
 			break;
 			
@@ -261,22 +438,53 @@ static struct lws_protocols protocols[] = {
 	{
 		"socketio",
 		callback_websocket,
-		0,
+		sizeof(BarWsConnection_t),
+		LWS_RX_BUFFER_SIZE,
+		0, NULL, 0
+	},
+	{
+		BAR_MSGPACK_PROTOCOL,         /* same events, MessagePack binary frames */
+		callback_websocket,
+		sizeof(BarWsConnection_t),
 		LWS_RX_BUFFER_SIZE,
 		0, NULL, 0
 	},
 	{
 		"homeassistant",
 		callback_websocket,
-		0,
+		sizeof(BarWsConnection_t),
 		LWS_RX_BUFFER_SIZE,
 		0, NULL, 0
 	},
 	{ NULL, NULL, 0, 0, 0, NULL, 0 } /* terminator */
 };
 
+/* Volume reports from the service thread take the volume bucket like
+ * BarWsBroadcastVolume, so they coalesce and honour subscriptions */
+static void BarWsBroadcastVolumePercent(BarApp_t *app, int percent) {
+	json_object *vol = json_object_new_int(percent);
+	BarWebsocketBroadcastSocketIoMessage(app, BUCKET_VOLUME,
+	                                     BarSocketIoFormatEventFrame("volume", vol));
+	json_object_put(vol);
+}
+
+/* System volume backend noticed a change (its own thread). -1: it stopped
+ * reporting changes, wake the service thread so it starts polling */
+static void BarWsSystemVolumeChanged(int percent, void *userdata) {
+	BarApp_t *app = (BarApp_t *)userdata;
+	if (percent < 0) {
+		BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+		if (ctx && ctx->context) {
+			lws_cancel_service((struct lws_context *)ctx->context);
+		}
+		return;
+	}
+	BarWsBroadcastVolumePercent(app, percent);
+}
+
 /* Process broadcast message from main thread (runs in WS thread) */
-static void BarWebsocketProcessBroadcast(BarWsContext_t *ctx, BarWsMessage_t *msg) {
+static void BarWebsocketProcessBroadcast(BarWsContext_t *ctx, BarWsBucketType_t bucket,
+                                         BarWsMessage_t *msg) {
 	if (!ctx || !msg) {
 		return;
 	}
@@ -286,8 +494,16 @@ static void BarWebsocketProcessBroadcast(BarWsContext_t *ctx, BarWsMessage_t *ms
 	
 	switch (msg->type) {
 		case MSG_TYPE_BROADCAST_SOCKETIO:
-			if (msg->data != NULL && msg->dataLen > 0) {
-				BarWebsocketBroadcast ((const char *) msg->data, msg->dataLen);
+			if (msg->frame != NULL && msg->frame->len > 0) {
+				/* A new song makes queued progress for the old one stale */
+				if (bucket == BUCKET_STATE) {
+					pthread_mutex_lock(&ctx->connMutex);
+					BarWsConnectionForeach(&ctx->clients, conn) {
+						BarWsOutQueueRemoveBucket(&conn->queue, BUCKET_PROGRESS);
+					}
+					pthread_mutex_unlock(&ctx->connMutex);
+				}
+				BarWebsocketQueueFrame(ctx, msg->frame, (int) bucket);
 			}
 			break;
 
@@ -304,12 +520,7 @@ void BarWsScheduleVolumeBroadcast(BarWsContext_t *ctx, int delayMs) {
 	
 	pthread_mutex_lock(&ctx->volumeBroadcastMutex);
 	
-	/* Get current time in milliseconds */
-	struct timespec ts;
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	time_t nowMs = (ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
-	
-	ctx->delayedVolumeBroadcast.scheduleTime = nowMs + delayMs;
+	ctx->delayedVolumeBroadcast.scheduleTime = BarWsTimeMs() + (uint64_t)delayMs;
 	ctx->delayedVolumeBroadcast.pending = true;
 	
 	log_write(DEBUG_WEBSOCKET, "Scheduled volume broadcast in %dms (will use current volume at broadcast time)\n", 
@@ -317,57 +528,45 @@ void BarWsScheduleVolumeBroadcast(BarWsContext_t *ctx, int delayMs) {
 	
 	pthread_mutex_unlock(&ctx->volumeBroadcastMutex);
 	
-	/* Wake websocket thread to update sleep timeout */
+	/* Wake websocket thread to arm its timer */
 	if (ctx->context) {
 		lws_cancel_service((struct lws_context *)ctx->context);
 	}
 }
 
-/* Check and execute pending volume broadcast if timer expired */
-static void BarWsProcessVolumeBroadcast(BarWsContext_t *ctx, BarApp_t *app) {
-	if (!ctx || !app) {
-		return;
-	}
-	
+/* Move a volume broadcast scheduled by another thread onto the timers;
+ * rescheduling before it fired pushes it back (debounce) */
+static void BarWsTakeVolumeBroadcast(BarWsContext_t *ctx) {
 	pthread_mutex_lock(&ctx->volumeBroadcastMutex);
-	
-	if (!ctx->delayedVolumeBroadcast.pending) {
-		pthread_mutex_unlock(&ctx->volumeBroadcastMutex);
-		return;
-	}
-	
-	/* Check if timer has expired */
-	struct timespec ts;
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	time_t nowMs = (ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
-	
-	if (nowMs >= ctx->delayedVolumeBroadcast.scheduleTime) {
+	if (ctx->delayedVolumeBroadcast.pending) {
 		ctx->delayedVolumeBroadcast.pending = false;
-		pthread_mutex_unlock(&ctx->volumeBroadcastMutex);
-		
-		/* Read CURRENT volume as percentage - frontend always expects 0-100 */
-		int volumePercent;
-		if (app->settings.volumeMode == BAR_VOLUME_MODE_SYSTEM) {
-			volumePercent = BarSystemVolumeGet();
-			if (volumePercent < 0) volumePercent = VOLUME_FALLBACK_PERCENT;
-			log_write(DEBUG_WEBSOCKET, "Executing delayed volume broadcast - %d%% (system volume)\n", 
-			           volumePercent);
-		} else {
-			/* Player mode: volume is already 0-100 linear */
-			volumePercent = app->settings.volume;
-			log_write(DEBUG_WEBSOCKET, "Executing delayed volume broadcast - %d%% (player volume)\n", 
-			           volumePercent);
-		}
-		
-		/* Broadcast to all clients */
-		BarSocketIoEmitVolume(app, volumePercent);
+		BarWsTimerArm(&ctx->timers, BAR_WS_TIMER_VOLUME_BROADCAST,
+		              ctx->delayedVolumeBroadcast.scheduleTime);
+	}
+	pthread_mutex_unlock(&ctx->volumeBroadcastMutex);
+}
+
+/* Debounce timer expired: broadcast the volume as it is now */
+static void BarWsProcessVolumeBroadcast(BarApp_t *app) {
+	/* Read CURRENT volume as percentage - frontend always expects 0-100 */
+	int volumePercent;
+	if (app->settings.volumeMode == BAR_VOLUME_MODE_SYSTEM) {
+		volumePercent = BarSystemVolumeGet();
+		if (volumePercent < 0) volumePercent = VOLUME_FALLBACK_PERCENT;
+		log_write(DEBUG_WEBSOCKET, "Executing delayed volume broadcast - %d%% (system volume)\n", 
+		           volumePercent);
 	} else {
-		pthread_mutex_unlock(&ctx->volumeBroadcastMutex);
+		/* Player mode: volume is already 0-100 linear */
+		volumePercent = app->settings.volume;
+		log_write(DEBUG_WEBSOCKET, "Executing delayed volume broadcast - %d%% (player volume)\n", 
+		           volumePercent);
 	}
+	
+	BarWsBroadcastVolumePercent(app, volumePercent);
 }
 
 /* Poll system volume for external changes (keyboard keys, other apps)
- * Called from WebSocket thread, checks every 1 second */
+ * Called from WebSocket thread when BAR_WS_TIMER_VOLUME_POLL expires */
 static void BarWsPollSystemVolume(BarWsContext_t *ctx, BarApp_t *app) {
 	if (!ctx || !app) {
 		return;
@@ -378,20 +577,13 @@ static void BarWsPollSystemVolume(BarWsContext_t *ctx, BarApp_t *app) {
 		return;
 	}
 	
-	/* Check if 1 second has elapsed since last poll */
-	time_t now = time(NULL);
-	if (now - ctx->lastVolumePollTime < 1) {
-		return;  /* Too soon, skip this poll */
-	}
-	ctx->lastVolumePollTime = now;
-	
 	/* Check if default audio device changed and refresh if needed */
 	if (BarSystemVolumeRefreshDevice()) {
 		log_write(DEBUG_WEBSOCKET, "Default audio output device changed\n");
 	}
 	
-	/* Read current system volume */
-	int currentVolume = BarSystemVolumeGet();
+	/* Read current system volume from the backend, not the cache */
+	int currentVolume = BarSystemVolumeRefresh();
 	if (currentVolume < 0) {
 		return;  /* Error reading volume */
 	}
@@ -402,14 +594,134 @@ static void BarWsPollSystemVolume(BarWsContext_t *ctx, BarApp_t *app) {
 		           ctx->lastPolledVolume, currentVolume);
 		ctx->lastPolledVolume = currentVolume;
 		
-		/* Broadcast to all clients */
-		BarSocketIoEmitVolume(app, currentVolume);
+		BarWsBroadcastVolumePercent(app, currentVolume);
 	}
 }
 
-/* WebSocket service thread - runs lws_service() loop */
-static void* BarWebsocketThread(void *arg) {
+/* Append a parsed command for the worker. Takes ownership of the packet;
+ * drops it if the queue is full. */
+static void BarWsCommandPush(BarWsContext_t *ctx, BarSocketIoPacket_t *packet,
+                             void *wsi) {
+	BarWsCommand_t *cmd = NULL;
+	
+	pthread_mutex_lock(&ctx->cmdMutex);
+	if (ctx->cmdDepth < WEBSOCKET_COMMAND_QUEUE_MAX) {
+		cmd = malloc(sizeof(*cmd));
+	}
+	if (!cmd) {
+		pthread_mutex_unlock(&ctx->cmdMutex);
+		log_write(LOG_ERROR, "Command queue full, dropping %s\n",
+		           packet->eventName ? packet->eventName : "connect");
+		BarSocketIoPacketFree(packet);
+		return;
+	}
+	cmd->next = NULL;
+	cmd->packet = *packet;
+	cmd->wsi = wsi;
+	if (ctx->cmdTail) {
+		ctx->cmdTail->next = cmd;
+	} else {
+		ctx->cmdHead = cmd;
+	}
+	ctx->cmdTail = cmd;
+	ctx->cmdDepth++;
+	pthread_cond_signal(&ctx->cmdCond);
+	pthread_mutex_unlock(&ctx->cmdMutex);
+}
+
+/* Command worker - runs Socket.IO handlers (which may block on Pandora
+ * requests) in arrival order, off the service thread. Replies go out
+ * through the usual bucket/unicast path. */
+static void* BarWsCommandThread(void *arg) {
 	BarApp_t *app = (BarApp_t *)arg;
+	BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+	
+	log_write(DEBUG_WEBSOCKET, "Command worker started\n");
+	
+	pthread_mutex_lock(&ctx->cmdMutex);
+	while (true) {
+		while (ctx->cmdThreadRunning && !ctx->cmdHead) {
+			pthread_cond_wait(&ctx->cmdCond, &ctx->cmdMutex);
+		}
+		if (!ctx->cmdThreadRunning) {
+			break;
+		}
+		BarWsCommand_t *cmd = ctx->cmdHead;
+		ctx->cmdHead = cmd->next;
+		if (!ctx->cmdHead) {
+			ctx->cmdTail = NULL;
+		}
+		ctx->cmdDepth--;
+		pthread_mutex_unlock(&ctx->cmdMutex);
+		
+		BarSocketIoDispatchPacket(app, &cmd->packet, cmd->wsi);
+		BarSocketIoPacketFree(&cmd->packet);
+		free(cmd);
+		
+		pthread_mutex_lock(&ctx->cmdMutex);
+	}
+	pthread_mutex_unlock(&ctx->cmdMutex);
+	
+	log_write(DEBUG_WEBSOCKET, "Command worker stopped\n");
+	return NULL;
+}
+
+/* Volume worker: apply the latest volume.set */
+static void BarWsApplyVolume(int percent, void *userdata) {
+	BarSocketIoApplyVolume((BarApp_t *)userdata, percent);
+}
+
+/* Stop the command worker and discard whatever it had not run yet */
+static void BarWsCommandWorkerStop(BarWsContext_t *ctx) {
+	pthread_mutex_lock(&ctx->cmdMutex);
+	const bool wasRunning = ctx->cmdThreadRunning;
+	ctx->cmdThreadRunning = false;
+	pthread_cond_broadcast(&ctx->cmdCond);
+	pthread_mutex_unlock(&ctx->cmdMutex);
+	
+	if (wasRunning) {
+		pthread_join(ctx->cmdThread, NULL);
+	}
+	
+	BarWsCommand_t *cmd = ctx->cmdHead;
+	while (cmd) {
+		BarWsCommand_t *next = cmd->next;
+		BarSocketIoPacketFree(&cmd->packet);
+		free(cmd);
+		cmd = next;
+	}
+	ctx->cmdHead = ctx->cmdTail = NULL;
+	ctx->cmdDepth = 0;
+}
+
+/* Additional service threads (websocket_threads > 1): only service their
+ * own share of the clients */
+static void* BarWebsocketServiceThread(void *arg) {
+	BarWsServiceThread_t *st = (BarWsServiceThread_t *)arg;
+	BarApp_t *app = st->app;
+	BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+	
+	log_write(DEBUG_WEBSOCKET, "Service thread %d started\n", st->tsi);
+	
+	while (ctx->threadRunning && !app->doQuit) {
+		lws_service_tsi(ctx->context, WEBSOCKET_IDLE_WAIT_MS, st->tsi);
+		BarWsRequestWrites(ctx, st);
+	}
+	
+	log_write(DEBUG_WEBSOCKET, "Service thread %d stopped\n", st->tsi);
+	return NULL;
+}
+
+/* g_timerSul expired; lws_service() returns and the loop runs the timers */
+static void BarWsTimerWake(lws_sorted_usec_list_t *sul) {
+	(void)sul;
+}
+
+/* WebSocket service thread - runs lws_service() loop for service thread 0
+ * and feeds every client's queue from the buckets */
+static void* BarWebsocketThread(void *arg) {
+	BarWsServiceThread_t *st = (BarWsServiceThread_t *)arg;
+	BarApp_t *app = st->app;
 	if (!app || !app->wsContext) {
 		return NULL;
 	}
@@ -418,54 +730,77 @@ static void* BarWebsocketThread(void *arg) {
 	
 	log_write(DEBUG_WEBSOCKET, "Thread started\n");
 	
+	/* Poll system volume for external changes, starting right away, unless
+	 * the backend reports them (BarWsSystemVolumeChanged) */
+	if (app->settings.volumeMode == BAR_VOLUME_MODE_SYSTEM &&
+	    !BarSystemVolumeEventDriven()) {
+		BarWsTimerArm(&ctx->timers, BAR_WS_TIMER_VOLUME_POLL, BarWsTimeMs());
+	}
+	
 	while (ctx->threadRunning && !app->doQuit) {
-		bool didWork = false;
+		/* Sleep until the next deadline or until another thread wakes us
+		 * with lws_cancel_service() (bucket filled, frame queued, ...) */
+		const int timeout = BarWsTimersTimeout(&ctx->timers, BarWsTimeMs(),
+		                                       WEBSOCKET_IDLE_WAIT_MS);
+		lws_sul_schedule((struct lws_context *)ctx->context, 0, &g_timerSul,
+		                 BarWsTimerWake, ctx->timers.count > 0 ?
+		                 (lws_usec_t)timeout * LWS_US_PER_MS :
+		                 LWS_SET_TIMER_USEC_CANCEL);
+		lws_service_tsi(ctx->context, timeout, 0);
 		
-		/* Service WebSocket - WEBSOCKET_POLL_MS timeout
-		 * This ensures the loop runs at least every WEBSOCKET_POLL_MS
-		 */
-		if (ctx->context) {
-			int n = lws_service(ctx->context, WEBSOCKET_POLL_MS);
-			if (n > 0) {
-				didWork = true;
-			}
-		}
-		
-		/* BUCKET POLLING - Natural Rate Limiting
+		/* BUCKET DRAINING
 		 * 
-		 * Process all buckets in priority order (STATE > PROGRESS > VOLUME > STATIONS).
-		 * This loop runs ~20 times/second (every 50ms from lws_service above).
+		 * Process all buckets in priority order (STATE > VOLUME > PROGRESS > STATIONS).
+		 * Every bucket put wakes us, so this runs once per burst of updates.
 		 * 
 		 * Key behavior:
 		 *   - BarWsBucketTake() retrieves and REMOVES the message from the bucket
 		 *   - Only the LATEST message is retrieved (older ones were discarded)
 		 *   - Empty buckets return NULL (no processing)
 		 * 
-		 * This polling frequency provides natural rate limiting:
-		 *   - Even if progress is updated 100 times/second, we only send ~20/second max
-		 *   - Combined with message consolidation in BarWebsocketBroadcastSocketIoMessage(),
-		 *     actual sends are further reduced (only when values change)
-		 * 
-		 * Example: High-frequency progress updates
-		 *   - BarWsBroadcastProgress() called every 100ms (10/second)
-		 *   - Bucket stores only latest value
-		 *   - We poll every 50ms but only find new value every ~2nd poll
-		 *   - Result: ~5-10 actual network sends/second instead of 10
+		 * Updates that arrive while we are servicing clients coalesce in
+		 * their bucket, so a slow pass sends the latest value only once.
 		 */
 		for (int i = 0; i < BUCKET_COUNT; i++) {
 			BarWsMessage_t *msg = BarWsBucketTake(ctx, i);
 			if (msg) {
-				BarWebsocketProcessBroadcast(ctx, msg);
+				BarWebsocketProcessBroadcast(ctx, i, msg);
 				BarWsMessageFree(msg);
-				didWork = true;
 			}
 		}
 		
-		/* Process delayed volume broadcast (debouncing) */
-		BarWsProcessVolumeBroadcast(ctx, app);
+		/* Deferred work: debounced volume broadcast, system volume poll */
+		BarWsTakeVolumeBroadcast(ctx);
+		const uint64_t now = BarWsTimeMs();
+		int timer;
+		while ((timer = BarWsTimersExpired(&ctx->timers, now)) >= 0) {
+			switch (timer) {
+				case BAR_WS_TIMER_VOLUME_BROADCAST:
+					BarWsProcessVolumeBroadcast(app);
+					break;
+				
+				case BAR_WS_TIMER_VOLUME_POLL:
+					BarWsPollSystemVolume(ctx, app);
+					break;
+				
+				default:
+					break;
+			}
+		}
+		
+		/* Poll while the backend does not report changes; that may start
+		 * or stop at runtime (PulseAudio server lost and reconnected) */
+		if (app->settings.volumeMode == BAR_VOLUME_MODE_SYSTEM &&
+		    !BarWsTimerArmed(&ctx->timers, BAR_WS_TIMER_VOLUME_POLL) &&
+		    !BarSystemVolumeEventDriven()) {
+			BarWsTimerArm(&ctx->timers, BAR_WS_TIMER_VOLUME_POLL,
+			              now + WEBSOCKET_VOLUME_POLL_MS);
+		}
 		
-		/* Poll system volume for external changes (every 1s) */
-		BarWsPollSystemVolume(ctx, app);
+		/* Everything above only queued frames; have lws tell us when each
+		 * client can take them. Other service threads do the same for
+		 * their clients once woken by BarWebsocketQueueFrame. */
+		BarWsRequestWrites(ctx, st);
 		
 		/* NOTE: Progress broadcasting now handled by playback_manager thread
 		 * This ensures timing is independent of WebSocket servicing delays
@@ -510,21 +845,72 @@ bool BarWebsocketInit(BarApp_t *app) {
 	info.user = app;
 	info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
 	info.retry_and_idle_policy = &keepalive_policy;
+	if (app->settings.websocketCompression == BAR_WS_COMPRESSION_DEFLATE) {
+		info.extensions = extensions;
+	}
+	const unsigned int threads = app->settings.websocketThreads > 0 ?
+	                             app->settings.websocketThreads : 1;
+	info.count_threads = threads;
 	/* Removed LWS_SERVER_OPTION_HTTP_HEADERS_SECURITY_BEST_PRACTICES_ENFORCE
 	 * so we can use custom CSP for Google Fonts */
 	
+	/* Web UI files: webui_path if set, else the copy compiled in
+	 * (EMBED_WEBUI=1), else ./dist/webui */
+	const char *webuiPath = app->settings.webuiPath;
+	bool assetsLoaded;
+	if (webuiPath && strlen(webuiPath) > 0) {
+		assetsLoaded = BarHttpAssetCacheInit(&ctx->assets, webuiPath);
+	} else {
+#ifdef WEBUI_EMBEDDED
+		webuiPath = "the built-in web UI";
+		assetsLoaded = BarHttpAssetCacheInitEmbedded(&ctx->assets, barWebuiFiles,
+		                                             barWebuiFileCount);
+#else
+		webuiPath = "./dist/webui";
+		assetsLoaded = BarHttpAssetCacheInit(&ctx->assets, webuiPath);
+#endif
+	}
+	if (!assetsLoaded) {
+		log_write(LOG_ERROR, "No web UI files in %s\n", webuiPath);
+	}
+	
 	ctx->context = lws_create_context(&info);
 	if (!ctx->context) {
 		log_write(LOG_ERROR, "Failed to create context on port %d\n",
 		        app->settings.websocketPort);
+		BarHttpAssetCacheDestroy(&ctx->assets);
 		free(ctx);
 		app->wsContext = NULL;
 		return false;
 	}
 	
 	ctx->initialized = true;
-	ctx->maxConnections = 32;
-	ctx->connections = calloc(ctx->maxConnections, sizeof(BarWsConnection_t));
+	
+	/* lws caps the thread count at its LWS_MAX_SMP build option */
+	const int lwsThreads = lws_get_count_threads(ctx->context);
+	ctx->serviceThreads = lwsThreads < 1 ? 1 :
+	                      lwsThreads > WEBSOCKET_SERVICE_THREADS_MAX ?
+	                      WEBSOCKET_SERVICE_THREADS_MAX : (unsigned int)lwsThreads;
+	if (ctx->serviceThreads < threads) {
+		log_write(LOG_ERROR, "libwebsockets supports %u service threads, "
+		          "not %u\n", ctx->serviceThreads, threads);
+	}
+	for (unsigned int i = 0; i < ctx->serviceThreads; i++) {
+		ctx->service[i].tsi = (int)i;
+		ctx->service[i].app = app;
+	}
+	
+	BarWsConnectionListInit(&ctx->clients, app->settings.websocketMaxClients > 0 ?
+	                        app->settings.websocketMaxClients : WEBSOCKET_MAX_CLIENTS_DEFAULT);
+	pthread_mutex_init(&ctx->connMutex, NULL);
+	pthread_mutex_init(&ctx->cmdMutex, NULL);
+	pthread_cond_init(&ctx->cmdCond, NULL);
+	ctx->queueLimit = app->settings.websocketQueueLimit > 0 ?
+	                  app->settings.websocketQueueLimit : WEBSOCKET_QUEUE_LIMIT_DEFAULT;
+	ctx->maxMessage = app->settings.websocketMaxMessage > 0 ?
+	                  app->settings.websocketMaxMessage : WEBSOCKET_MAX_MESSAGE_DEFAULT;
+	ctx->disconnectSlow =
+	        app->settings.websocketSlowClient == BAR_WS_SLOW_CLIENT_DISCONNECT;
 	
 	/* Initialize buckets */
 	BarWsBucketsInit(ctx);
@@ -533,31 +919,94 @@ bool BarWebsocketInit(BarApp_t *app) {
 	ctx->delayedVolumeBroadcast.pending = false;
 	pthread_mutex_init(&ctx->volumeBroadcastMutex, NULL);
 	
-	/* Initialize system volume polling state */
+	/* Initialize system volume polling state and the service thread's
+	 * deadlines */
 	ctx->lastPolledVolume = -1;  /* Unknown until first poll */
-	ctx->lastVolumePollTime = 0; /* Force immediate first poll */
+	BarWsTimersInit(&ctx->timers);
+	memset(&g_timerSul, 0, sizeof(g_timerSul));
 	
 	/* Set up Socket.IO broadcast callback */
 	BarSocketIoSetBroadcastCallback(BarWebsocketBroadcast);
 	
+	/* The report is only written to the debug log, and measuring deflates
+	 * large frames a second time: leave it off unless it is read */
+	if (info.extensions && log_is_debug_enabled(DEBUG_WEBSOCKET)) {
+		BarWsDeflateStatsEnable(app->settings.websocketCompressionReportMin > 0 ?
+		                        app->settings.websocketCompressionReportMin :
+		                        WEBSOCKET_COMPRESSION_REPORT_MIN_DEFAULT);
+	}
+	
 	log_write(LOG_ERROR, "Server started on port %d\n",
 	        app->settings.websocketPort);
 	
-	/* Start WebSocket thread */
+	/* Start the workers first so the service thread can hand off to them;
+	 * without the volume worker, volume.set is applied on the command
+	 * worker */
+	if (!BarWsVolumeWorkerStart(&ctx->volumeWorker, WEBSOCKET_VOLUME_APPLY_MS,
+	                            BarWsApplyVolume, app)) {
+		log_write(LOG_ERROR, "Failed to create volume worker\n");
+	}
+	ctx->cmdThreadRunning = true;
+	if (pthread_create(&ctx->cmdThread, NULL, BarWsCommandThread, app) != 0) {
+		log_write(LOG_ERROR, "Failed to create command worker\n");
+		ctx->cmdThreadRunning = false;
+		
+		BarWsVolumeWorkerStop(&ctx->volumeWorker);
+		BarWsVolumeWorkerDestroy(&ctx->volumeWorker);
+		BarWsBucketsDestroy(ctx);
+		lws_context_destroy(ctx->context);
+		pthread_cond_destroy(&ctx->cmdCond);
+		pthread_mutex_destroy(&ctx->cmdMutex);
+		pthread_mutex_destroy(&ctx->connMutex);
+		BarHttpAssetCacheDestroy(&ctx->assets);
+		free(ctx);
+		app->wsContext = NULL;
+		return false;
+	}
+	
+	/* Start the service threads. lws spreads clients over all of them, so
+	 * it is all or nothing. */
 	ctx->threadRunning = true;
-	if (pthread_create(&ctx->thread, NULL, BarWebsocketThread, app) != 0) {
+	unsigned int started = 0;
+	pthread_mutex_lock(&ctx->connMutex);
+	while (started < ctx->serviceThreads) {
+		BarWsServiceThread_t *st = &ctx->service[started];
+		if (pthread_create(&st->thread, NULL, started == 0 ? BarWebsocketThread :
+		                   BarWebsocketServiceThread, st) != 0) {
+			break;
+		}
+		started++;
+	}
+	pthread_mutex_unlock(&ctx->connMutex);
+	if (started < ctx->serviceThreads) {
 		log_write(LOG_ERROR, "Failed to create thread\n");
 		
 		/* Cleanup on failure */
+		ctx->threadRunning = false;
+		lws_cancel_service(ctx->context);
+		for (unsigned int i = 0; i < started; i++) {
+			pthread_join(ctx->service[i].thread, NULL);
+		}
+		BarWsCommandWorkerStop(ctx);
+		BarWsVolumeWorkerStop(&ctx->volumeWorker);
+		BarWsVolumeWorkerDestroy(&ctx->volumeWorker);
 		BarWsBucketsDestroy(ctx);
 		lws_context_destroy(ctx->context);
-		free(ctx->connections);
+		pthread_cond_destroy(&ctx->cmdCond);
+		pthread_mutex_destroy(&ctx->cmdMutex);
+		pthread_mutex_destroy(&ctx->connMutex);
+		BarHttpAssetCacheDestroy(&ctx->assets);
 		free(ctx);
 		app->wsContext = NULL;
 		return false;
 	}
 	
-	log_write(LOG_ERROR, "Thread created successfully\n");
+	if (app->settings.volumeMode == BAR_VOLUME_MODE_SYSTEM) {
+		BarSystemVolumeSetListener(BarWsSystemVolumeChanged, app);
+	}
+	
+	log_write(LOG_ERROR, "Thread created successfully (%u service thread%s)\n",
+	          ctx->serviceThreads, ctx->serviceThreads == 1 ? "" : "s");
 	
 	return true;
 }
@@ -572,6 +1021,9 @@ void BarWebsocketDestroy(BarApp_t *app) {
 	
 	BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
 	
+	/* No more volume changes from the backend's thread */
+	BarSystemVolumeSetListener(NULL, NULL);
+	
 	/* Signal thread to stop */
 	ctx->threadRunning = false;
 	
@@ -582,9 +1034,19 @@ void BarWebsocketDestroy(BarApp_t *app) {
 	
 	/* Wait for thread to finish */
 	log_write(LOG_ERROR, "Waiting for thread to stop...\n");
-	pthread_join(ctx->thread, NULL);
+	for (unsigned int i = 0; i < ctx->serviceThreads; i++) {
+		pthread_join(ctx->service[i].thread, NULL);
+	}
 	log_write(LOG_ERROR, "Thread stopped\n");
 	
+	/* No new commands can arrive; let the one in progress (if any) finish
+	 * while connections and buckets are still there for its reply */
+	BarWsCommandWorkerStop(ctx);
+	
+	/* The last volume.set of a drag still reaches the mixer */
+	BarWsVolumeWorkerStop(&ctx->volumeWorker);
+	BarWsVolumeWorkerDestroy(&ctx->volumeWorker);
+	
 	/* Now safe to cleanup (thread is dead) */
 	if (ctx->context) {
 		lws_context_destroy(ctx->context);
@@ -594,12 +1056,22 @@ void BarWebsocketDestroy(BarApp_t *app) {
 	/* Cleanup buckets */
 	BarWsBucketsDestroy(ctx);
 	
+	/* No HTTP response can be using the assets any more */
+	BarHttpAssetCacheDestroy(&ctx->assets);
+	
+	BarWsDeflateStatsLog();
+	BarWsDeflateStatsDisable();
+	
 	pthread_mutex_destroy(&ctx->volumeBroadcastMutex);
 	
-	if (ctx->connections) {
-		free(ctx->connections);
-		ctx->connections = NULL;
+	/* lws_context_destroy() closed every client, detaching it (CLOSED) */
+	for (unsigned int i = 0; i < ctx->serviceThreads; i++) {
+		free(ctx->service[i].scratch);
 	}
+	pthread_mutex_destroy(&ctx->connMutex);
+	pthread_cond_destroy(&ctx->cmdCond);
+	pthread_mutex_destroy(&ctx->cmdMutex);
+	BarWsMessagePoolDrain();
 	
 	/* Clear global context */
 	g_wsContext = NULL;
@@ -624,13 +1096,15 @@ unsigned int BarWebsocketGetElapsed(BarApp_t *app) {
 	return elapsed;
 }
 
-/* Enqueue a pre-formatted Socket.IO message; takes ownership of message */
-void BarWebsocketBroadcastSocketIoMessage (BarApp_t *app,
-                                            BarWsBucketType_t bucket,
-                                            char *message) {
-	if (!app || !app->wsContext || !message) {
-		free (message);
-		return;
+/* Enqueue a pre-formatted Socket.IO frame; takes over the caller's reference */
+/* Shared by Broadcast/Offer: when `replace` is false an occupied bucket is
+ * left alone and the new frame is dropped instead */
+static bool BarWebsocketEnqueueSocketIoMessage(BarApp_t *app,
+                                                BarWsBucketType_t bucket,
+                                                BarWsFrame_t *frame, bool replace) {
+	if (!app || !app->wsContext || !frame || bucket >= BUCKET_COUNT) {
+		BarWsFrameUnref(frame);
+		return false;
 	}
 
 	BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
@@ -646,18 +1120,19 @@ void BarWebsocketBroadcastSocketIoMessage (BarApp_t *app,
 		pthread_mutex_unlock (&ctx->buckets[BUCKET_PROGRESS].mutex);
 	}
 
-	BarWsMessage_t *msg = calloc (1, sizeof (BarWsMessage_t));
+	/* Pooled; takes over frame */
+	BarWsMessage_t *msg = BarWsMessageNew(MSG_TYPE_BROADCAST_SOCKETIO, frame);
 	if (!msg) {
-		free (message);
-		return;
+		return false;
 	}
-	msg->type = MSG_TYPE_BROADCAST_SOCKETIO;
-	msg->data = message; /* transfer ownership */
-	msg->dataLen = strlen (message);
-	msg->next = NULL;
 
 	pthread_mutex_lock (&ctx->buckets[bucket].mutex);
 	if (ctx->buckets[bucket].message) {
+		if (!replace) {
+			pthread_mutex_unlock(&ctx->buckets[bucket].mutex);
+			BarWsMessageFree(msg);
+			return false;
+		}
 		BarWsMessageFree (ctx->buckets[bucket].message); /* free older message */
 	}
 	ctx->buckets[bucket].message = msg;
@@ -666,65 +1141,139 @@ void BarWebsocketBroadcastSocketIoMessage (BarApp_t *app,
 	if (ctx->context) {
 		lws_cancel_service ((struct lws_context *)ctx->context);
 	}
+	return true;
+}
+
+void BarWebsocketBroadcastSocketIoMessage(BarApp_t *app,
+                                            BarWsBucketType_t bucket,
+                                            BarWsFrame_t *frame) {
+	BarWebsocketEnqueueSocketIoMessage(app, bucket, frame, true);
 }
 
-/* Broadcast message to all connected WebSocket clients */
-static void BarWebsocketBroadcast(const char *message, size_t len) {
-	if (!g_wsContext || !message || len == 0) {
+bool BarWebsocketOfferSocketIoMessage(BarApp_t *app,
+                                       BarWsBucketType_t bucket,
+                                       BarWsFrame_t *frame) {
+	return BarWebsocketEnqueueSocketIoMessage(app, bucket, frame, false);
+}
+
+/* Socket.IO broadcast callback: events emitted outside the buckets (unicast
+ * replies, query results) may come from any thread and are never coalesced */
+static void BarWebsocketBroadcast(BarWsFrame_t *frame) {
+	if (!g_wsContext || !frame || frame->len == 0) {
 		log_write(DEBUG_WEBSOCKET, "Broadcast called with null/empty message\n");
 		return;
 	}
 	
-	BarWsContext_t *ctx = g_wsContext;
+	BarWebsocketQueueFrame(g_wsContext, frame, BAR_WS_FRAME_NO_BUCKET);
+}
+
+/* Queue a frame reference for one client, applying the slow consumer
+ * policy; caller holds connMutex. MessagePack clients get frame->packed;
+ * frames formatted without one are converted once into `packed`, which the
+ * caller releases. Returns true if a write is needed. */
+static bool BarWsQueueToConnection(BarWsContext_t *ctx, BarWsConnection_t *conn,
+                                   BarWsFrame_t *frame, BarWsFrame_t **packed,
+                                   int bucket) {
+	/* Unsubscribed: skip before anything is encoded or queued */
+	if (conn->slow || !BarWsConnectionWants(conn, bucket)) {
+		return false;
+	}
+	const bool incremental = frame->incremental; /* not set on the twin */
+	if (conn->msgpack && frame->packed) {
+		frame = frame->packed;
+	} else if (conn->msgpack) {
+		if (*packed == NULL && (*packed = BarMsgpackFrameFromText(frame)) == NULL) {
+			log_write(LOG_ERROR, "Cannot encode frame as MessagePack "
+			           "(%zu bytes)\n", frame->len);
+			return false;
+		}
+		frame = *packed;
+	}
 	
+	switch (BarWsOutQueuePush(&conn->queue, frame, bucket, incremental,
+	                          ctx->disconnectSlow)) {
+		case BAR_WS_OUTQ_QUEUED:
+		case BAR_WS_OUTQ_COALESCED:
+			break;
+		
+		case BAR_WS_OUTQ_DROPPED:
+			log_write(DEBUG_WEBSOCKET, "Client %p queue full, dropped oldest "
+			           "frame (%llu total)\n", conn->wsi, conn->queue.stats.dropped);
+			break;
+		
+		case BAR_WS_OUTQ_SLOW:
+			log_write(LOG_ERROR, "Client %p is not reading, disconnecting "
+			           "(%llu frames dropped)\n", conn->wsi, conn->queue.stats.dropped);
+			conn->slow = true;
+			BarWsOutQueueClear(&conn->queue);
+			break;
+	}
+	return true;
+}
+
+/* Bit of the calling thread in a mask of service threads, 0 if it is not
+ * one of them. Under connMutex, which BarWebsocketInit holds while it
+ * fills in the thread ids. */
+static unsigned int BarWsServiceThreadSelf(const BarWsContext_t *ctx) {
+	for (unsigned int i = 0; i < ctx->serviceThreads; i++) {
+		if (pthread_equal(pthread_self(), ctx->service[i].thread)) {
+			return 1u << i;
+		}
+	}
+	return 0;
+}
+
+/* Mark conn's service thread as having writes to request; returns its bit */
+static unsigned int BarWsWritePending(BarWsContext_t *ctx,
+                                      const BarWsConnection_t *conn) {
+	ctx->service[conn->tsi].writePending = true;
+	return 1u << conn->tsi;
+}
+
+/* Queue frame for all connected WebSocket clients (or the unicast target).
+ * Each queue takes a reference, nothing is copied or written here; see
+ * BarWebsocketWriteNext. */
+static void BarWebsocketQueueFrame(BarWsContext_t *ctx, BarWsFrame_t *frame,
+                                   int bucket) {
+	const char *message = BarWsFrameData(frame);
+	const size_t len = frame->len;
+
 	/* Detect progress messages for separate debug flag */
 	bool isProgress = (len > 13 && strncmp(message, "2[ \"progress\"", 13) == 0);
 	logKind dbgFlag = isProgress ? DEBUG_WEBSOCKET_PROGRESS : DEBUG_WEBSOCKET;
 
 	log_write(dbgFlag, "Broadcasting to %zu clients (%zu bytes): %.*s%s\n",
-	           ctx->numConnections, len, (int)LOG_MESSAGE_TRUNCATE_LEN, message, len > LOG_MESSAGE_TRUNCATE_LEN ? "..." : "");
+	           ctx->clients.count, len, (int)LOG_MESSAGE_TRUNCATE_LEN, message, len > LOG_MESSAGE_TRUNCATE_LEN ? "..." : "");
 	
-	/* Check for unicast mode - if set, only send to target client */
+	/* Check for unicast mode - if set, only send to target client. The
+	 * target is looked up on the live list rather than through its wsi,
+	 * which may already be gone */
 	void *unicastTarget = BarSocketIoGetUnicastTarget();
-	
-	/* Iterate through all connected clients */
-	for (size_t i = 0; i < ctx->maxConnections; i++) {
-		if (ctx->connections[i].wsi != NULL) {
-			struct lws *wsi = (struct lws *)ctx->connections[i].wsi;
-			
-			/* Skip if in unicast mode and this isn't the target */
-			if (unicastTarget != NULL && wsi != unicastTarget) {
-				continue;
-			}
-			
-			log_write(dbgFlag, "Sending to client %zu (wsi=%p)\n", i, wsi);
-			
-			/* Allocate buffer with LWS_PRE padding */
-			unsigned char *buf = malloc(LWS_PRE + len);
-			if (!buf) {
-				log_write(dbgFlag, "Failed to allocate buffer for client %zu\n", i);
-				continue;
-			}
-			
-			/* Copy message after LWS_PRE padding */
-			memcpy(&buf[LWS_PRE], message, len);
-			
-			log_write(dbgFlag, "About to call lws_write (len=%zu)\n", len);
-			
-			/* Send to this client */
-			int written = lws_write(wsi, &buf[LWS_PRE], len, LWS_WRITE_TEXT);
-			
-			if (written < 0) {
-				log_write(dbgFlag, "lws_write failed for client %zu (error=%d)\n", i, written);
-			} else {
-				log_write(dbgFlag, "lws_write succeeded for client %zu (%d bytes)\n", i, written);
+	unsigned int wake = 0;
+	BarWsFrame_t *packed = NULL;
+	
+	pthread_mutex_lock(&ctx->connMutex);
+	if (unicastTarget != NULL) {
+		BarWsConnection_t *conn = BarWsConnectionFind(&ctx->clients, unicastTarget);
+		if (conn && BarWsQueueToConnection(ctx, conn, frame, &packed, bucket)) {
+			wake |= BarWsWritePending(ctx, conn);
+		}
+	} else {
+		BarWsConnectionForeach(&ctx->clients, conn) {
+			if (BarWsQueueToConnection(ctx, conn, frame, &packed, bucket)) {
+				wake |= BarWsWritePending(ctx, conn);
 			}
-			
-			free(buf);
 		}
 	}
+	wake &= ~BarWsServiceThreadSelf(ctx);
+	pthread_mutex_unlock(&ctx->connMutex);
+	BarWsFrameUnref(packed);
 	
-	log_write(dbgFlag, "Broadcast complete\n");
+	/* Wake the service threads that got writes, unless that is only the
+	 * one we are on (it checks after servicing). lws wakes all of them. */
+	if (wake && ctx->context) {
+		lws_cancel_service((struct lws_context *)ctx->context);
+	}
 }
 
 /* Handle incoming WebSocket message */
@@ -740,8 +1289,53 @@ void BarWebsocketHandleMessage(BarApp_t *app, const char *message,
 		log_write(DEBUG_WEBSOCKET, "HA message received (not yet implemented)\n");
 	} else {
 		/* Default to Socket.IO */
-		BarSocketIoHandleMessage(app, message, wsi);
+		BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+		bool worker = false;
+		if (ctx) {
+			pthread_mutex_lock(&ctx->cmdMutex);
+			worker = ctx->cmdThreadRunning;
+			pthread_mutex_unlock(&ctx->cmdMutex);
+		}
+		
+		/* Parse here (no I/O), run the handler on the worker */
+		BarSocketIoPacket_t packet;
+		const bool parsed = strcmp(protocol, BAR_MSGPACK_PROTOCOL) == 0 ?
+		        BarSocketIoParseMsgpackPacket(message, len, &packet) :
+		        BarSocketIoParsePacket(message, &packet);
+		if (!parsed) {
+			return;
+		}
+		if (BarSocketIoTakeVolumePacket(app, &packet)) {
+			BarSocketIoPacketFree(&packet);
+		} else if (worker) {
+			BarWsCommandPush(ctx, &packet, wsi);
+		} else {
+			BarSocketIoDispatchPacket(app, &packet, wsi);
+			BarSocketIoPacketFree(&packet);
+		}
+	}
+}
+
+/* "subscribe" from a client (command worker) */
+void BarWebsocketSubscribe(BarApp_t *app, void *wsi, unsigned int mask) {
+	if (!app || !app->wsContext || !wsi) {
+		return;
+	}
+	BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+	
+	pthread_mutex_lock(&ctx->connMutex);
+	BarWsConnection_t *conn = BarWsConnectionFind(&ctx->clients, wsi);
+	if (conn) {
+		conn->unsubscribed = BAR_WS_SUBSCRIBE_ALL & ~mask;
+		for (int i = 0; i < BUCKET_COUNT; i++) {
+			if (!BarWsConnectionWants(conn, i)) {
+				BarWsOutQueueRemoveBucket(&conn->queue, i);
+			}
+		}
+		log_write(DEBUG_WEBSOCKET, "Client %p subscribed to 0x%x\n", wsi,
+		           mask & BAR_WS_SUBSCRIBE_ALL);
 	}
+	pthread_mutex_unlock(&ctx->connMutex);
 }
 
 /* Disconnect all WebSocket clients (used by app.stop) */
@@ -752,26 +1346,23 @@ void BarWebsocketDisconnectAllClients(BarApp_t *app) {
 	
 	BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
 	
+	pthread_mutex_lock(&ctx->connMutex);
 	log_write(DEBUG_WEBSOCKET, "Disconnecting all clients (%zu connected)\n", 
-	           ctx->numConnections);
+	           ctx->clients.count);
+	
+	/* Only mark them here: app.stop runs on the command worker, and lws
+	 * calls belong on each client's service thread (BarWsRequestWrites) */
+	unsigned int wake = 0;
+	BarWsConnectionForeach(&ctx->clients, conn) {
+		log_write(DEBUG_WEBSOCKET, "Closing client (wsi=%p)\n", conn->wsi);
+		conn->pendingClose = true;
+		wake |= BarWsWritePending(ctx, conn);
+	}
+	wake &= ~BarWsServiceThreadSelf(ctx);
+	pthread_mutex_unlock(&ctx->connMutex);
 	
-	/* Close each connected client */
-	for (size_t i = 0; i < ctx->maxConnections; i++) {
-		if (ctx->connections[i].wsi != NULL) {
-			struct lws *wsi = (struct lws *)ctx->connections[i].wsi;
-			
-			log_write(DEBUG_WEBSOCKET, "Closing client %zu (wsi=%p)\n", i, wsi);
-			
-			/* Mark connection for close - will be handled in SERVER_WRITEABLE */
-			ctx->connections[i].pendingClose = true;
-			
-			/* Request close with "Going Away" status (1001) */
-			lws_close_reason(wsi, LWS_CLOSE_STATUS_GOINGAWAY, 
-			                 (unsigned char *)"Server stopping", 15);
-			
-			/* Trigger the close callback */
-			lws_callback_on_writable(wsi);
-		}
+	if (wake && ctx->context) {
+		lws_cancel_service((struct lws_context *)ctx->context);
 	}
 	
 	log_write(DEBUG_WEBSOCKET, "All clients marked for disconnect\n");
@@ -29,6 +29,11 @@ THE SOFTWARE.
 #include <pthread.h>
 
 #include "queue.h"
+#include "connections.h"
+#include "timers.h"
+#include "volume_worker.h"
+#include "../http/asset_cache.h"
+#include "../protocol/socketio.h"
 
 /* Note: main.h must be included before this header to get BarApp_t definition */
 
@@ -42,32 +47,47 @@ typedef enum {
 	BUCKET_COUNT       /* Total number of buckets */
 } BarWsBucketType_t;
 
+/* Subscription mask with every bucket, the default for new clients */
+#define BAR_WS_SUBSCRIBE_ALL ((1u << BUCKET_COUNT) - 1)
+
 /* Message bucket - holds one message of a specific category */
 typedef struct {
 	BarWsMessage_t *message;       /* Current message (NULL if empty) */
 	pthread_mutex_t mutex;         /* Protects this bucket */
 } BarWsBucket_t;
 
-/* WebSocket connection state */
-typedef struct {
-	void *wsi;                    /* libwebsockets instance */
-	bool authenticated;           /* Authentication status */
-	bool pendingClose;            /* Connection marked for close (app.stop) */
-	char protocol[64];            /* Protocol: "socketio" or "homeassistant" */
-} BarWsConnection_t;
-
 /* Progress tracking - simplified, uses player->lock as source of truth */
 typedef struct {
 	unsigned int lastBroadcast;   /* Last progress time broadcast (optimization) */
 } BarWsProgress_t;
 
+/* Inbound command, parsed on the service thread and run on the worker */
+typedef struct BarWsCommand {
+	struct BarWsCommand *next;
+	BarSocketIoPacket_t packet;
+	void *wsi;                     /* Sender; may be gone by the time it runs */
+} BarWsCommand_t;
+
+/* One lws service thread (websocket_threads). lws hands every new client
+ * to one of them and services it only there, so requesting writes or
+ * closing it has to happen on that thread too. */
+typedef struct {
+	pthread_t thread;
+	int tsi;                      /* lws service thread index */
+	bool writePending;            /* One of its queues was filled since its last pass (connMutex) */
+	unsigned char *scratch;       /* Private copy of shared frames, see BarWebsocketWriteNext */
+	size_t scratchSize;
+	BarApp_t *app;
+} BarWsServiceThread_t;
+
 /* WebSocket server context */
 typedef struct {
 	void *context;                /* libwebsockets context */
 	bool initialized;             /* Initialization status */
 	
-	/* Threading */
-	pthread_t thread;             /* WebSocket service thread */
+	/* Threading; service[0] also drains the buckets and polls volume */
+	BarWsServiceThread_t service[WEBSOCKET_SERVICE_THREADS_MAX];
+	unsigned int serviceThreads;  /* Running service threads, as lws agreed to */
 	bool threadRunning;           /* Thread lifecycle flag */
 	/* stateRwlock is in BarApp_t (web/both via BarStateUsesRwlock); player->lock for transport here */
 	
@@ -77,21 +97,43 @@ typedef struct {
 	/* Progress tracking - single-threaded access from playback manager */
 	BarWsProgress_t progress;
 	
-	/* Delayed volume broadcast (for debouncing) */
+	/* Delayed volume broadcast (for debouncing), handed to the timers */
 	struct {
-		time_t scheduleTime;    /* When to broadcast (epoch ms) */
-		bool pending;           /* Whether broadcast is pending */
+		uint64_t scheduleTime;  /* When to broadcast (BarWsTimeMs) */
+		bool pending;           /* Not yet taken by the service thread */
 	} delayedVolumeBroadcast;
 	pthread_mutex_t volumeBroadcastMutex;
 	
+	/* Deadlines of service thread 0, which it sleeps until */
+	BarWsTimers_t timers;
+	
 	/* System volume polling (for detecting external changes) */
 	int lastPolledVolume;         /* Last known system volume (-1 = unknown) */
-	time_t lastVolumePollTime;    /* Last poll timestamp (seconds) */
 	
-	/* Connections (WS thread only) */
-	BarWsConnection_t *connections;
-	size_t numConnections;
-	size_t maxConnections;
+	/* Live connections (state in lws per-session data); attached/detached
+	 * on the WS thread, queues are filled from any thread that emits, so
+	 * both are under connMutex */
+	BarWsConnectionList_t clients;
+	pthread_mutex_t connMutex;
+	size_t queueLimit;            /* Per-connection outbound queue depth */
+	size_t maxMessage;            /* Largest inbound message accepted (bytes) */
+	bool disconnectSlow;          /* Slow client policy: disconnect (true) or drop */
+	
+	/* Inbound commands (WS thread → command worker). Handlers may block on
+	 * Pandora requests, so they never run on the service thread. One
+	 * worker keeps commands in arrival order. */
+	BarWsCommand_t *cmdHead, *cmdTail;
+	size_t cmdDepth;
+	pthread_mutex_t cmdMutex;
+	pthread_cond_t cmdCond;
+	pthread_t cmdThread;
+	bool cmdThreadRunning;
+	
+	/* volume.set requests (command worker → volume worker), coalesced */
+	BarWsVolumeWorker_t volumeWorker;
+	
+	/* Web UI files served over HTTP */
+	BarHttpAssetCache_t assets;
 } BarWsContext_t;
 
 /* Initialize WebSocket server */
@@ -101,22 +143,44 @@ bool BarWebsocketInit(BarApp_t *app);
 void BarWebsocketDestroy(BarApp_t *app);
 
 /*
- * Enqueue a pre-formatted Socket.IO event for all connected clients.
- * Takes ownership of `message` — do not free() it after this call.
- * Frees `message` immediately if app or wsContext is NULL.
+ * Enqueue a pre-formatted Socket.IO frame for all connected clients.
+ * Takes over the caller's reference to `frame` — do not unref it after
+ * this call. Drops it immediately if app or wsContext is NULL.
  * On bucket replacement, the older message is freed. Thread-safe.
  */
 void BarWebsocketBroadcastSocketIoMessage (BarApp_t *app,
                                             BarWsBucketType_t bucket,
-                                            char *message);
+                                            BarWsFrame_t *frame);
+
+/*
+ * Like BarWebsocketBroadcastSocketIoMessage, but only enqueues if `bucket`
+ * is empty. Used for incremental events (e.g. stations.delta) that are only
+ * valid relative to what clients have already received: if a message is
+ * still pending it is never replaced, and `frame` is dropped instead.
+ * Always takes ownership. Returns true if the message was enqueued.
+ */
+bool BarWebsocketOfferSocketIoMessage(BarApp_t *app,
+                                       BarWsBucketType_t bucket,
+                                       BarWsFrame_t *frame);
 
 /* Get current elapsed time */
 unsigned int BarWebsocketGetElapsed(BarApp_t *app);
 
-/* Handle incoming WebSocket message */
+/* Handle incoming WebSocket message. While the server runs, Socket.IO
+ * events are parsed here and handed to the command worker; otherwise
+ * (tests, before init) they are handled on the calling thread.
+ * `protocol` is the message encoding: "socketio" for text packets,
+ * BAR_MSGPACK_PROTOCOL for binary MessagePack ones. */
 void BarWebsocketHandleMessage(BarApp_t *app, const char *message, 
                                size_t len, const char *protocol, void *wsi);
 
+/* Topic name used by the "subscribe" event ("state", "volume", ...) */
+bool BarWsBucketByName(const char *name, BarWsBucketType_t *bucket);
+
+/* Limit the broadcasts a client receives to the buckets in mask (a bit per
+ * BarWsBucketType_t); frames of other buckets already queued are dropped */
+void BarWebsocketSubscribe(BarApp_t *app, void *wsi, unsigned int mask);
+
 /* Schedule delayed volume broadcast (for debouncing) */
 void BarWsScheduleVolumeBroadcast(BarWsContext_t *ctx, int delayMs);
 
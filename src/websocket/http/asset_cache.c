@@ -0,0 +1,476 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "asset_cache.h"
+#include "http_server.h"
+#include "../../bar_constants.h"
+#include "../../log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+/* Files found by a scan, before they are sorted into a table */
+typedef struct {
+	BarHttpAsset_t *assets;
+	size_t count, size;
+	size_t bytes;
+} BarHttpAssetScan_t;
+
+/* Suffixes of precompressed siblings, by encoding */
+static const char *const encodingSuffix[BAR_HTTP_ENCODING_COUNT] = {
+	[BAR_HTTP_ENCODING_IDENTITY] = "",
+	[BAR_HTTP_ENCODING_GZIP] = ".gz",
+	[BAR_HTTP_ENCODING_BR] = ".br",
+};
+
+/* Strong validator: FNV-1a of the contents */
+static void assetEtag(const unsigned char *data, size_t len, char *etag, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+	snprintf(etag, size, "\"%016llx\"", (unsigned long long)hash);
+}
+
+/* Same validator per representation, told apart by suffix */
+static void assetVariantEtag(BarHttpAsset_t *asset, int e) {
+	snprintf(asset->body[e].etag, sizeof(asset->body[e].etag), "%.17s-%s\"",
+	         asset->body[BAR_HTTP_ENCODING_IDENTITY].etag, encodingSuffix[e] + 1);
+}
+
+/* HTTP-date for Last-Modified */
+static void assetLastModified(BarHttpAsset_t *asset, time_t mtime) {
+	struct tm tm;
+	strftime(asset->lastModified, sizeof(asset->lastModified),
+	         "%a, %d %b %Y %H:%M:%S GMT", gmtime_r(&mtime, &tm));
+}
+
+static bool assetIsHashChar(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+	       (c >= '0' && c <= '9') || c == '_' || c == '-';
+}
+
+bool BarHttpAssetIsHashedName(const char *path) {
+	static const char assetsDir[] = "/assets/";
+	if (!path || strncmp(path, assetsDir, sizeof(assetsDir) - 1) != 0) {
+		return false;
+	}
+	const char *name = strrchr(path, '/') + 1;
+	const char *ext = strchr(name, '.');
+	if (!ext || ext - name < HTTP_ASSET_HASH_LEN + 2) {
+		return false;
+	}
+	const char *hash = ext - HTTP_ASSET_HASH_LEN;
+	if (hash[-1] != '-') {
+		return false;
+	}
+	for (const char *c = hash; c < ext; c++) {
+		if (!assetIsHashChar(*c)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Read one file into the scan; path is relative to root, with a leading / */
+static bool assetScanFile(BarHttpAssetScan_t *scan, const char *filepath,
+                          const char *path, const struct stat *st) {
+	if (scan->count == scan->size) {
+		const size_t size = scan->size ? scan->size * 2 : 32;
+		BarHttpAsset_t *assets = realloc(scan->assets, size * sizeof(*assets));
+		if (!assets) {
+			return false;
+		}
+		scan->assets = assets;
+		scan->size = size;
+	}
+	
+	const int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+	const size_t len = (size_t)st->st_size;
+	unsigned char *data = malloc(len > 0 ? len : 1);
+	size_t total = 0;
+	while (data && total < len) {
+		const ssize_t n = read(fd, data + total, len - total);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		total += (size_t)n;
+	}
+	close(fd);
+	if (!data || total != len) {
+		/* Changed while we read it; the next reload picks it up */
+		free(data);
+		return false;
+	}
+	
+	BarHttpAsset_t *asset = &scan->assets[scan->count];
+	memset(asset, 0, sizeof(*asset));
+	asset->path = strdup(path);
+	if (!asset->path) {
+		free(data);
+		return false;
+	}
+	asset->mime = BarHttpGetMimeType(path);
+	asset->body[BAR_HTTP_ENCODING_IDENTITY].data = data;
+	asset->body[BAR_HTTP_ENCODING_IDENTITY].len = len;
+	assetEtag(data, len, asset->body[BAR_HTTP_ENCODING_IDENTITY].etag,
+	          sizeof(asset->body[BAR_HTTP_ENCODING_IDENTITY].etag));
+	assetLastModified(asset, st->st_mtime);
+	asset->immutable = BarHttpAssetIsHashedName(path);
+	scan->count++;
+	scan->bytes += len;
+	return true;
+}
+
+/* Read every file below dir; watch each directory with inotifyFd (>= 0) */
+static void assetScanDir(BarHttpAssetScan_t *scan, const char *dir,
+                         const char *prefix, int inotifyFd, int depth) {
+	DIR *d = opendir(dir);
+	if (!d) {
+		return;
+	}
+#ifdef __linux__
+	if (inotifyFd >= 0 &&
+	    inotify_add_watch(inotifyFd, dir, IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+	                      IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF) < 0) {
+		log_write(DEBUG_WEBSOCKET, "HTTP: Cannot watch %s\n", dir);
+	}
+#else
+	(void)inotifyFd;
+#endif
+	
+	struct dirent *de;
+	while ((de = readdir(d)) != NULL) {
+		/* Hidden files (editor swap files, .DS_Store) are not served */
+		if (de->d_name[0] == '.') {
+			continue;
+		}
+		char filepath[WEBSOCKET_FILEPATH_MAX];
+		char path[WEBSOCKET_FILEPATH_MAX];
+		struct stat st;
+		if ((size_t)snprintf(filepath, sizeof(filepath), "%s/%s", dir,
+		                     de->d_name) >= sizeof(filepath) ||
+		    (size_t)snprintf(path, sizeof(path), "%s/%s", prefix,
+		                     de->d_name) >= sizeof(path) ||
+		    stat(filepath, &st) != 0) {
+			continue;
+		}
+		if (S_ISDIR(st.st_mode)) {
+			if (depth < HTTP_ASSET_MAX_DEPTH) {
+				assetScanDir(scan, filepath, path, inotifyFd, depth + 1);
+			}
+		} else if (S_ISREG(st.st_mode)) {
+			assetScanFile(scan, filepath, path, &st);
+		}
+	}
+	closedir(d);
+}
+
+static int assetCompare(const void *a, const void *b) {
+	return strcmp(((const BarHttpAsset_t *)a)->path,
+	              ((const BarHttpAsset_t *)b)->path);
+}
+
+static void assetFree(BarHttpAsset_t *asset) {
+	for (int e = 0; e < BAR_HTTP_ENCODING_COUNT; e++) {
+		free((void *)asset->body[e].data);
+	}
+	free((void *)asset->path);
+}
+
+/* Make "x.br" and "x.gz" variants of "x" if that exists; files without
+ * an uncompressed original are served as they are */
+static void assetAttachVariants(BarHttpAssetScan_t *scan) {
+	bool *merged = calloc(scan->count > 0 ? scan->count : 1, sizeof(*merged));
+	if (!merged) {
+		return;
+	}
+	for (size_t i = 0; i < scan->count; i++) {
+		BarHttpAsset_t *asset = &scan->assets[i];
+		for (int e = 1; e < BAR_HTTP_ENCODING_COUNT; e++) {
+			char path[WEBSOCKET_FILEPATH_MAX];
+			snprintf(path, sizeof(path), "%s%s", asset->path, encodingSuffix[e]);
+			const BarHttpAsset_t key = {.path = path};
+			BarHttpAsset_t *variant = bsearch(&key, scan->assets, scan->count,
+			                                  sizeof(key), assetCompare);
+			if (!variant) {
+				continue;
+			}
+			asset->body[e] = variant->body[BAR_HTTP_ENCODING_IDENTITY];
+			assetVariantEtag(asset, e);
+			memset(&variant->body[BAR_HTTP_ENCODING_IDENTITY], 0,
+			       sizeof(variant->body[BAR_HTTP_ENCODING_IDENTITY]));
+			merged[variant - scan->assets] = true;
+		}
+	}
+	size_t kept = 0;
+	for (size_t i = 0; i < scan->count; i++) {
+		if (merged[i]) {
+			assetFree(&scan->assets[i]);
+		} else {
+			scan->assets[kept++] = scan->assets[i];
+		}
+	}
+	scan->count = kept;
+	free(merged);
+}
+
+static void assetTableFree(BarHttpAssetTable_t *table) {
+	for (size_t i = 0; i < table->count && !table->embedded; i++) {
+		assetFree(&table->assets[i]);
+	}
+	free(table->assets);
+	free(table);
+}
+
+/* Build a table from root */
+static BarHttpAssetTable_t *assetTableLoad(const char *root, int inotifyFd) {
+	BarHttpAssetTable_t *table = calloc(1, sizeof(*table));
+	if (!table) {
+		return NULL;
+	}
+	BarHttpAssetScan_t scan = {NULL, 0, 0, 0};
+	assetScanDir(&scan, root, "", inotifyFd, 0);
+	qsort(scan.assets, scan.count, sizeof(*scan.assets), assetCompare);
+	assetAttachVariants(&scan);
+	
+	atomic_init(&table->refs, 1);
+	table->assets = scan.assets;
+	table->count = scan.count;
+	table->bytes = scan.bytes;
+	return table;
+}
+
+bool BarHttpAssetCacheReload(BarHttpAssetCache_t *cache) {
+	if (!cache->root) {
+		/* Embedded, never changes */
+		return false;
+	}
+	BarHttpAssetTable_t *table = assetTableLoad(cache->root, cache->inotifyFd);
+	if (!table) {
+		return false;
+	}
+	log_write(DEBUG_WEBSOCKET, "HTTP: Cached %zu files (%zu bytes) from %s\n",
+	           table->count, table->bytes, cache->root);
+	
+	pthread_mutex_lock(&cache->mutex);
+	BarHttpAssetTable_t *old = cache->table;
+	cache->table = table;
+	pthread_mutex_unlock(&cache->mutex);
+	
+	if (old) {
+		BarHttpAssetTableRelease(old);
+	}
+	return table->count > 0;
+}
+
+BarHttpAssetTable_t *BarHttpAssetCacheAcquire(BarHttpAssetCache_t *cache) {
+	pthread_mutex_lock(&cache->mutex);
+	BarHttpAssetTable_t *table = cache->table;
+	if (table) {
+		atomic_fetch_add(&table->refs, 1);
+	}
+	pthread_mutex_unlock(&cache->mutex);
+	return table;
+}
+
+void BarHttpAssetTableRelease(BarHttpAssetTable_t *table) {
+	if (table && atomic_fetch_sub(&table->refs, 1) == 1) {
+		assetTableFree(table);
+	}
+}
+
+bool BarHttpAssetIsIndex(const char *path) {
+	return path && (path[0] == '\0' || strcmp(path, "/") == 0 ||
+	                strcmp(path, "/index.html") == 0);
+}
+
+const BarHttpAsset_t *BarHttpAssetFind(const BarHttpAssetTable_t *table,
+                                       const char *path) {
+	if (!table || !path) {
+		return NULL;
+	}
+	if (BarHttpAssetIsIndex(path)) {
+		path = "/index.html";
+	}
+	const BarHttpAsset_t key = {.path = (char *)path};
+	return bsearch(&key, table->assets, table->count, sizeof(key), assetCompare);
+}
+
+#ifdef __linux__
+/* Wait for inotify or the wake pipe
+ * @return 1 for changes, 0 on timeout, -1 when woken to stop */
+static int assetWatchWait(BarHttpAssetCache_t *cache, int timeoutMs) {
+	struct pollfd fds[2] = {
+		{.fd = cache->wakeFds[0], .events = POLLIN},
+		{.fd = cache->inotifyFd, .events = POLLIN},
+	};
+	int n;
+	while ((n = poll(fds, 2, timeoutMs)) < 0 && errno == EINTR) {
+	}
+	if (n < 0 || fds[0].revents) {
+		return -1;
+	}
+	if (n == 0) {
+		return 0;
+	}
+	/* Which file changed does not matter, everything is read again */
+	char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	while (read(cache->inotifyFd, events, sizeof(events)) > 0) {
+	}
+	return 1;
+}
+
+/* Watcher thread: reload once changes have settled, so a rebuild that
+ * replaces the whole directory is read once, complete */
+static void *assetWatchThread(void *arg) {
+	BarHttpAssetCache_t *cache = arg;
+	int r;
+	while ((r = assetWatchWait(cache, -1)) >= 0) {
+		while ((r = assetWatchWait(cache, HTTP_ASSET_RELOAD_MS)) > 0) {
+		}
+		if (r < 0) {
+			break;
+		}
+		log_write(DEBUG_WEBSOCKET, "HTTP: %s changed, reloading\n", cache->root);
+		BarHttpAssetCacheReload(cache);
+	}
+	return NULL;
+}
+#endif
+
+bool BarHttpAssetCacheInit(BarHttpAssetCache_t *cache, const char *root) {
+	memset(cache, 0, sizeof(*cache));
+	cache->inotifyFd = -1;
+	cache->wakeFds[0] = cache->wakeFds[1] = -1;
+	pthread_mutex_init(&cache->mutex, NULL);
+	cache->root = strdup(root);
+	if (!cache->root) {
+		return false;
+	}
+	
+#ifdef __linux__
+	cache->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+	const bool loaded = BarHttpAssetCacheReload(cache);
+	if (!loaded) {
+		log_write(DEBUG_WEBSOCKET, "HTTP: No web UI files in %s\n", root);
+	}
+	
+#ifdef __linux__
+	if (cache->inotifyFd >= 0 && pipe2(cache->wakeFds, O_CLOEXEC) == 0 &&
+	    pthread_create(&cache->thread, NULL, assetWatchThread, cache) == 0) {
+		cache->watching = true;
+	} else {
+		log_write(DEBUG_WEBSOCKET, "HTTP: Not watching %s for changes\n", root);
+	}
+#endif
+	return loaded;
+}
+
+bool BarHttpAssetCacheInitEmbedded(BarHttpAssetCache_t *cache,
+                                   const BarHttpEmbeddedFile_t *files,
+                                   size_t count) {
+	memset(cache, 0, sizeof(*cache));
+	cache->inotifyFd = -1;
+	cache->wakeFds[0] = cache->wakeFds[1] = -1;
+	pthread_mutex_init(&cache->mutex, NULL);
+	
+	BarHttpAssetTable_t *table = calloc(1, sizeof(*table));
+	BarHttpAsset_t *assets = calloc(count > 0 ? count : 1, sizeof(*assets));
+	if (!table || !assets) {
+		free(table);
+		free(assets);
+		return false;
+	}
+	/* Only the index is built; bodies point at the read-only arrays */
+	for (size_t i = 0; i < count; i++) {
+		const BarHttpEmbeddedFile_t *file = &files[i];
+		BarHttpAsset_t *asset = &assets[i];
+		asset->path = file->path;
+		asset->mime = BarHttpGetMimeType(file->path);
+		for (int e = 0; e < BAR_HTTP_ENCODING_COUNT; e++) {
+			asset->body[e].data = file->data[e];
+			asset->body[e].len = file->len[e];
+		}
+		BarHttpAssetBody_t *identity = &asset->body[BAR_HTTP_ENCODING_IDENTITY];
+		assetEtag(identity->data, identity->len, identity->etag, sizeof(identity->etag));
+		for (int e = 1; e < BAR_HTTP_ENCODING_COUNT; e++) {
+			if (asset->body[e].data) {
+				assetVariantEtag(asset, e);
+			}
+		}
+		assetLastModified(asset, (time_t)file->mtime);
+		asset->immutable = BarHttpAssetIsHashedName(file->path);
+		table->bytes += identity->len;
+	}
+	atomic_init(&table->refs, 1);
+	table->assets = assets;
+	table->count = count;
+	table->embedded = true;
+	cache->table = table;
+	log_write(DEBUG_WEBSOCKET, "HTTP: Serving %zu built-in files (%zu bytes)\n",
+	           count, table->bytes);
+	return count > 0;
+}
+
+void BarHttpAssetCacheDestroy(BarHttpAssetCache_t *cache) {
+	if (cache->watching) {
+		const char c = 0;
+		if (write(cache->wakeFds[1], &c, 1) < 0) {
+			log_write(LOG_ERROR, "HTTP: Cannot wake asset watcher\n");
+		}
+		pthread_join(cache->thread, NULL);
+		cache->watching = false;
+	}
+	for (int i = 0; i < 2; i++) {
+		if (cache->wakeFds[i] >= 0) {
+			close(cache->wakeFds[i]);
+		}
+	}
+	if (cache->inotifyFd >= 0) {
+		close(cache->inotifyFd);
+	}
+	BarHttpAssetTableRelease(cache->table);
+	cache->table = NULL;
+	free(cache->root);
+	cache->root = NULL;
+	pthread_mutex_destroy(&cache->mutex);
+}
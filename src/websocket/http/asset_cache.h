@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef _ASSET_CACHE_H
+#define _ASSET_CACHE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <time.h>
+
+/* The web UI directory, held in memory.
+ *
+ * Every regular file below the root is read once; a `.br` or `.gz` file
+ * next to one of them becomes its precompressed variant. Requests are
+ * answered from a table that is never modified: a reload (inotify on
+ * Linux) builds a new one and swaps it in, and a table lives on while a
+ * response still uses it. */
+
+/* A precompressed representation of an asset */
+typedef struct {
+	const unsigned char *data;  /* NULL if there is none */
+	size_t len;
+	char etag[24];
+} BarHttpAssetBody_t;
+
+typedef enum {
+	BAR_HTTP_ENCODING_IDENTITY = 0,
+	BAR_HTTP_ENCODING_GZIP,
+	BAR_HTTP_ENCODING_BR,
+	BAR_HTTP_ENCODING_COUNT
+} BarHttpEncoding_t;
+
+typedef struct {
+	const char *path;           /* URL path, e.g. "/assets/app-Bx3f9a1c.js" */
+	const char *mime;
+	BarHttpAssetBody_t body[BAR_HTTP_ENCODING_COUNT];
+	char lastModified[32];      /* HTTP-date of the file's mtime */
+	bool immutable;             /* Content-hashed name, cached for a year */
+} BarHttpAsset_t;
+
+/* One generation of the cache, sorted by path */
+typedef struct {
+	atomic_uint refs;
+	BarHttpAsset_t *assets;
+	size_t count;
+	size_t bytes;               /* Memory held by file contents */
+	bool embedded;              /* Contents are in the binary, not owned */
+} BarHttpAssetTable_t;
+
+/* A file compiled in by scripts/webui_embed.py (make EMBED_WEBUI=1) */
+typedef struct {
+	const char *path;
+	const unsigned char *data[BAR_HTTP_ENCODING_COUNT];
+	size_t len[BAR_HTTP_ENCODING_COUNT];
+	long long mtime;
+} BarHttpEmbeddedFile_t;
+
+#ifdef WEBUI_EMBEDDED
+/* webui_embed_gen.c, sorted by path */
+extern const BarHttpEmbeddedFile_t barWebuiFiles[];
+extern const size_t barWebuiFileCount;
+#endif
+
+typedef struct {
+	char *root;                 /* NULL for an embedded web UI */
+	BarHttpAssetTable_t *table; /* Current generation (mutex) */
+	pthread_mutex_t mutex;
+	
+	/* Reloads on changes below root (Linux) */
+	pthread_t thread;
+	bool watching;
+	int inotifyFd;
+	int wakeFds[2];
+} BarHttpAssetCache_t;
+
+/* Load root and start watching it. Returns false if nothing could be
+ * loaded; the cache is usable (and empty) either way */
+bool BarHttpAssetCacheInit(BarHttpAssetCache_t *cache, const char *root);
+void BarHttpAssetCacheDestroy(BarHttpAssetCache_t *cache);
+
+/* Serve files compiled into the binary, sorted by path. Nothing is
+ * copied and there is nothing to watch or reload */
+bool BarHttpAssetCacheInitEmbedded(BarHttpAssetCache_t *cache,
+                                   const BarHttpEmbeddedFile_t *files,
+                                   size_t count);
+
+/* Read root again and swap the result in */
+bool BarHttpAssetCacheReload(BarHttpAssetCache_t *cache);
+
+/* Current table, referenced until BarHttpAssetTableRelease; never NULL
+ * after a successful init */
+BarHttpAssetTable_t *BarHttpAssetCacheAcquire(BarHttpAssetCache_t *cache);
+void BarHttpAssetTableRelease(BarHttpAssetTable_t *table);
+
+/* Whether a URL path names index.html ("", "/" or "/index.html") */
+bool BarHttpAssetIsIndex(const char *path);
+
+/* Asset for a URL path ("/" is "/index.html"), NULL if there is none */
+const BarHttpAsset_t *BarHttpAssetFind(const BarHttpAssetTable_t *table,
+                                       const char *path);
+
+/* Whether a file name carries a content hash (Vite's "name-<hash>.ext") */
+bool BarHttpAssetIsHashedName(const char *path);
+
+#endif /* _ASSET_CACHE_H */
@@ -25,8 +25,8 @@ THE SOFTWARE.
 
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
-#include <sys/stat.h>
 #include <libwebsockets.h>
 
 /* MIME type mappings */
@@ -78,135 +78,313 @@ const char *BarHttpGetMimeType(const char *path) {
 	return "application/octet-stream";
 }
 
-/* Serve static file with manual HTTP response construction */
-int BarHttpServeFile(struct lws *wsi, const char *filepath) {
+/* Headers sent with every response */
+static const struct {
+	const char *name;
+	const char *value;
+} securityHeaders[] = {
+	/* Allow Google Fonts */
+	{"content-security-policy:",
+	 "default-src 'self'; "
+	 "style-src 'self' 'unsafe-inline' https://fonts.googleapis.com; "
+	 "font-src 'self' https://fonts.gstatic.com data:; "
+	 "connect-src 'self' ws: wss:; "
+	 "img-src 'self' http: https: data:; "
+	 "frame-ancestors 'none'; "
+	 "base-uri 'none'; "
+	 "form-action 'self';"},
+	{"referrer-policy:", "no-referrer"},
+	{"x-content-type-options:", "nosniff"},
+	{"x-frame-options:", "deny"},
+	{"x-xss-protection:", "1; mode=block"},
+};
+
+/* Whether an Accept-Encoding header allows coding; q=0 refuses it, "*"
+ * stands for codings not named */
+bool BarHttpAcceptsEncoding(const char *header, const char *coding) {
+	const size_t codingLen = strlen(coding);
+	const char *p = header;
+	bool any = false;
+	
+	while (p && *p) {
+		while (*p == ' ' || *p == '\t' || *p == ',') {
+			p++;
+		}
+		const char *end = p;
+		while (*end && *end != ',' && *end != ';' && *end != ' ' && *end != '\t') {
+			end++;
+		}
+		const char *next = strchr(end, ',');
+		const char *q = strstr(end, "q=");
+		const bool refused = q && (!next || q < next) && strtod(q + 2, NULL) <= 0.0;
+		if ((size_t)(end - p) == codingLen && strncasecmp(p, coding, codingLen) == 0) {
+			return !refused;
+		}
+		if (end - p == 1 && *p == '*') {
+			any = !refused;
+		}
+		p = next;
+	}
+	return any;
+}
+
+/* Whether an If-None-Match header lists etag; weak tags compare equal */
+bool BarHttpEtagMatches(const char *header, const char *etag) {
+	const size_t etagLen = strlen(etag);
+	const char *p = header;
+	
+	while (p && *p) {
+		while (*p == ' ' || *p == '\t' || *p == ',') {
+			p++;
+		}
+		if (*p == '*') {
+			return true;
+		}
+		if (strncmp(p, "W/", 2) == 0) {
+			p += 2;
+		}
+		if (strncmp(p, etag, etagLen) == 0 &&
+		    (p[etagLen] == '\0' || p[etagLen] == ',' || p[etagLen] == ' ')) {
+			return true;
+		}
+		p = strchr(p, ',');
+	}
+	return false;
+}
+
+/* Copy a request header into buf; "" if absent or too long */
+static void httpHeader(struct lws *wsi, enum lws_token_indexes token,
+                       char *buf, int size) {
+	buf[0] = '\0';
+	const int len = lws_hdr_total_length(wsi, token);
+	if (len > 0 && len < size && lws_hdr_copy(wsi, buf, size, token) < 0) {
+		buf[0] = '\0';
+	}
+}
+
+static int httpAddHeader(struct lws *wsi, enum lws_token_indexes token,
+                         const char *value, unsigned char **p, unsigned char *end) {
+	return lws_add_http_header_by_token(wsi, token, (const unsigned char *)value,
+	                                    (int)strlen(value), p, end);
+}
+
+/* Serve a web UI file from the asset cache */
+int BarHttpServeAsset(struct lws *wsi, BarHttpAssetCache_t *cache, const char *url,
+                      BarWsFrame_t *snapshot, BarHttpTransfer_t *transfer) {
 	unsigned char buffer[LWS_PRE + LWS_RX_BUFFER_SIZE];
 	unsigned char *start = &buffer[LWS_PRE];
 	unsigned char *p = start;
 	unsigned char *end = &buffer[sizeof(buffer) - 1];
-	FILE *fp;
-	long filesize;
-	char lenstr[32];
-	int n;
+	char header[256];
+	char value[64];
+	int ret = -1;
 	
-	if (!wsi || !filepath) {
+	if (!wsi || !cache || !url || !transfer) {
 		return -1;
 	}
 	
-	/* Open and validate file */
-	fp = fopen(filepath, "rb");
-	if (!fp) {
+	BarHttpAssetTable_t *table = BarHttpAssetCacheAcquire(cache);
+	const BarHttpAsset_t *asset = BarHttpAssetFind(table, url);
+	if (!asset) {
+		BarHttpAssetTableRelease(table);
 		lws_return_http_status(wsi, HTTP_STATUS_NOT_FOUND, NULL);
 		return -1;
 	}
 	
-	/* Get file size */
-	fseek(fp, 0, SEEK_END);
-	filesize = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
-	
-	/* Build HTTP response headers */
-	if (lws_add_http_header_status(wsi, HTTP_STATUS_OK, &p, end)) {
-		fclose(fp);
-		return -1;
+	/* Smallest representation the client takes */
+	BarHttpEncoding_t encoding = BAR_HTTP_ENCODING_IDENTITY;
+	bool hasVariants = false;
+	httpHeader(wsi, WSI_TOKEN_HTTP_ACCEPT_ENCODING, header, sizeof(header));
+	if (asset->body[BAR_HTTP_ENCODING_BR].data) {
+		hasVariants = true;
+		if (BarHttpAcceptsEncoding(header, "br")) {
+			encoding = BAR_HTTP_ENCODING_BR;
+		}
 	}
-	
-	/* Content-Type */
-	const char *mime = BarHttpGetMimeType(filepath);
-	if (lws_add_http_header_by_token(wsi, WSI_TOKEN_HTTP_CONTENT_TYPE,
-	                                  (unsigned char *)mime, strlen(mime), &p, end)) {
-		fclose(fp);
-		return -1;
+	if (asset->body[BAR_HTTP_ENCODING_GZIP].data) {
+		hasVariants = true;
+		if (encoding == BAR_HTTP_ENCODING_IDENTITY &&
+		    BarHttpAcceptsEncoding(header, "gzip")) {
+			encoding = BAR_HTTP_ENCODING_GZIP;
+		}
 	}
+	const BarHttpAssetBody_t *body = &asset->body[encoding];
 	
-	/* Content-Length */
-	snprintf(lenstr, sizeof(lenstr), "%ld", filesize);
-	if (lws_add_http_header_by_token(wsi, WSI_TOKEN_HTTP_CONTENT_LENGTH,
-	                                  (unsigned char *)lenstr, strlen(lenstr), &p, end)) {
-		fclose(fp);
-		return -1;
+	/* index.html with a state snapshot is made per request: uncompressed,
+	 * and without a validator since the state changes under it */
+	memset(transfer, 0, sizeof(*transfer));
+	const bool spliced = snapshot && strcmp(asset->path, "/index.html") == 0 &&
+	                     BarHttpTransferSplice(transfer,
+	                                           &asset->body[BAR_HTTP_ENCODING_IDENTITY],
+	                                           snapshot);
+	if (spliced) {
+		encoding = BAR_HTTP_ENCODING_IDENTITY;
+		hasVariants = false;
+	} else {
+		transfer->parts[0].data = body->data;
+		transfer->parts[0].len = body->len;
+		transfer->count = 1;
 	}
 	
-	/* Content-Security-Policy - Allow Google Fonts */
-	const char *csp = "default-src 'self'; "
-	                  "style-src 'self' 'unsafe-inline' https://fonts.googleapis.com; "
-	                  "font-src 'self' https://fonts.gstatic.com data:; "
-	                  "connect-src 'self' ws: wss:; "
-	                  "img-src 'self' http: https: data:; "
-	                  "frame-ancestors 'none'; "
-	                  "base-uri 'none'; "
-	                  "form-action 'self';";
-	if (lws_add_http_header_by_name(wsi, (unsigned char *)"content-security-policy:",
-	                                 (unsigned char *)csp, strlen(csp), &p, end)) {
-		fclose(fp);
-		return -1;
-	}
+	httpHeader(wsi, WSI_TOKEN_HTTP_IF_NONE_MATCH, header, sizeof(header));
+	const bool notModified = !spliced && header[0] &&
+	                         BarHttpEtagMatches(header, body->etag);
 	
-	/* Additional Security Headers */
-	if (lws_add_http_header_by_name(wsi, (unsigned char *)"referrer-policy:",
-	                                 (unsigned char *)"no-referrer", 11, &p, end)) {
-		fclose(fp);
-		return -1;
+	if (lws_add_http_header_status(wsi, notModified ? HTTP_STATUS_NOT_MODIFIED :
+	                               HTTP_STATUS_OK, &p, end) ||
+	    (!spliced &&
+	     (httpAddHeader(wsi, WSI_TOKEN_HTTP_ETAG, body->etag, &p, end) ||
+	      httpAddHeader(wsi, WSI_TOKEN_HTTP_LAST_MODIFIED, asset->lastModified, &p, end)))) {
+		goto out;
 	}
-	if (lws_add_http_header_by_name(wsi, (unsigned char *)"x-content-type-options:",
-	                                 (unsigned char *)"nosniff", 7, &p, end)) {
-		fclose(fp);
-		return -1;
+	
+	/* Hashed names never change content; everything else is revalidated */
+	if (asset->immutable) {
+		snprintf(value, sizeof(value), "public, max-age=%d, immutable",
+		         HTTP_ASSET_IMMUTABLE_MAX_AGE);
+	} else {
+		snprintf(value, sizeof(value), "no-cache");
 	}
-	if (lws_add_http_header_by_name(wsi, (unsigned char *)"x-frame-options:",
-	                                 (unsigned char *)"deny", 4, &p, end)) {
-		fclose(fp);
-		return -1;
+	if (httpAddHeader(wsi, WSI_TOKEN_HTTP_CACHE_CONTROL, value, &p, end)) {
+		goto out;
 	}
-	if (lws_add_http_header_by_name(wsi, (unsigned char *)"x-xss-protection:",
-	                                 (unsigned char *)"1; mode=block", 13, &p, end)) {
-		fclose(fp);
-		return -1;
+	if (hasVariants &&
+	    lws_add_http_header_by_name(wsi, (const unsigned char *)"vary:",
+	                                (const unsigned char *)"Accept-Encoding", 15, &p, end)) {
+		goto out;
 	}
 	
-	/* Finalize headers */
-	if (lws_finalize_http_header(wsi, &p, end)) {
-		fclose(fp);
-		return -1;
+	if (!notModified) {
+		if (httpAddHeader(wsi, WSI_TOKEN_HTTP_CONTENT_TYPE, asset->mime, &p, end) ||
+		    lws_add_http_header_content_length(wsi, BarHttpTransferRemaining(transfer),
+		                                       &p, end)) {
+			goto out;
+		}
+		if (encoding != BAR_HTTP_ENCODING_IDENTITY &&
+		    httpAddHeader(wsi, WSI_TOKEN_HTTP_CONTENT_ENCODING,
+		                  encoding == BAR_HTTP_ENCODING_BR ? "br" : "gzip", &p, end)) {
+			goto out;
+		}
+		for (size_t i = 0; i < sizeof(securityHeaders) / sizeof(*securityHeaders); i++) {
+			if (lws_add_http_header_by_name(wsi,
+			        (const unsigned char *)securityHeaders[i].name,
+			        (const unsigned char *)securityHeaders[i].value,
+			        (int)strlen(securityHeaders[i].value), &p, end)) {
+				goto out;
+			}
+		}
 	}
 	
-	/* Send headers */
-	n = lws_write(wsi, start, p - start, LWS_WRITE_HTTP_HEADERS);
-	if (n < 0) {
-		fclose(fp);
-		return -1;
+	if (lws_finalize_http_header(wsi, &p, end) ||
+	    lws_write(wsi, start, p - start, LWS_WRITE_HTTP_HEADERS) < 0) {
+		goto out;
 	}
 	
-	/* Stream file content */
-	while (!feof(fp)) {
-		n = fread(start, 1, sizeof(buffer) - LWS_PRE, fp);
-		if (n > 0) {
-			if (lws_write(wsi, start, n, LWS_WRITE_HTTP) < 0) {
-				fclose(fp);
-				return -1;
-			}
-		}
+	/* The body follows from HTTP_WRITEABLE, a chunk whenever the client
+	 * takes one; the table stays referenced until it is sent */
+	if (!notModified && BarHttpTransferRemaining(transfer) > 0) {
+		transfer->table = table;
+		lws_callback_on_writable(wsi);
+		return 0;
 	}
 	
-	fclose(fp);
-	
 	/* Complete HTTP transaction */
-	if (lws_http_transaction_completed(wsi)) {
-		return -1;
-	}
+	ret = lws_http_transaction_completed(wsi) ? -1 : 0;
 	
-	return 0;
+out:
+	BarWsFrameUnref(transfer->snapshot);
+	memset(transfer, 0, sizeof(*transfer));
+	BarHttpAssetTableRelease(table);
+	return ret;
 }
 
-/* Serve directory index (index.html) */
-int BarHttpServeIndex(struct lws *wsi, const char *webui_path) {
-	char filepath[WEBSOCKET_FILEPATH_MAX];
+bool BarHttpTransferSplice(BarHttpTransfer_t *transfer, const BarHttpAssetBody_t *html,
+                           BarWsFrame_t *snapshot) {
+	static const char scriptOpen[] = "<script id=\"pianobar-state\" type=\"application/json\">";
+	static const char scriptClose[] = "</script>";
+	static const char head[] = "</head>";
 	
-	if (!wsi || !webui_path) {
+	const unsigned char *at = html->data ?
+	                          memmem(html->data, html->len, head, sizeof(head) - 1) : NULL;
+	if (!at || !snapshot) {
+		return false;
+	}
+	const size_t before = (size_t)(at - html->data);
+	const struct {
+		const void *data;
+		size_t len;
+	} parts[HTTP_TRANSFER_PARTS] = {
+		{html->data, before},
+		{scriptOpen, sizeof(scriptOpen) - 1},
+		{BarWsFrameData(snapshot), snapshot->len},
+		{scriptClose, sizeof(scriptClose) - 1},
+		{at, html->len - before},
+	};
+	for (size_t i = 0; i < HTTP_TRANSFER_PARTS; i++) {
+		transfer->parts[i].data = parts[i].data;
+		transfer->parts[i].len = parts[i].len;
+	}
+	transfer->count = HTTP_TRANSFER_PARTS;
+	transfer->part = 0;
+	transfer->sent = 0;
+	transfer->snapshot = BarWsFrameRef(snapshot);
+	return true;
+}
+
+size_t BarHttpTransferFill(BarHttpTransfer_t *transfer, unsigned char *buf, size_t size) {
+	size_t n = 0;
+	while (n < size && transfer->part < transfer->count) {
+		const size_t left = transfer->parts[transfer->part].len - transfer->sent;
+		const size_t take = left < size - n ? left : size - n;
+		memcpy(buf + n, transfer->parts[transfer->part].data + transfer->sent, take);
+		n += take;
+		transfer->sent += take;
+		if (transfer->sent == transfer->parts[transfer->part].len) {
+			transfer->part++;
+			transfer->sent = 0;
+		}
+	}
+	return n;
+}
+
+size_t BarHttpTransferRemaining(const BarHttpTransfer_t *transfer) {
+	size_t n = 0;
+	for (size_t i = transfer->part; i < transfer->count; i++) {
+		n += transfer->parts[i].len;
+	}
+	return n - transfer->sent;
+}
+
+/* Send the next chunk of the body started by BarHttpServeAsset */
+int BarHttpWriteBody(struct lws *wsi, BarHttpTransfer_t *transfer) {
+	unsigned char buffer[LWS_PRE + HTTP_BODY_CHUNK_SIZE];
+	unsigned char *start = &buffer[LWS_PRE];
+	
+	if (!wsi || !transfer || !transfer->table) {
+		return 0;
+	}
+	
+	/* Copied out so lws can use the LWS_PRE headroom */
+	const size_t n = BarHttpTransferFill(transfer, start, HTTP_BODY_CHUNK_SIZE);
+	const bool last = BarHttpTransferRemaining(transfer) == 0;
+	if (lws_write(wsi, start, n, last ? LWS_WRITE_HTTP_FINAL : LWS_WRITE_HTTP) < 0) {
+		BarHttpTransferRelease(transfer);
 		return -1;
 	}
 	
-	snprintf(filepath, sizeof(filepath), "%s/index.html", webui_path);
-	return BarHttpServeFile(wsi, filepath);
+	if (!last) {
+		lws_callback_on_writable(wsi);
+		return 0;
+	}
+	BarHttpTransferRelease(transfer);
+	return lws_http_transaction_completed(wsi) ? -1 : 0;
 }
 
+/* Drop a transfer that did not finish (client went away) */
+void BarHttpTransferRelease(BarHttpTransfer_t *transfer) {
+	if (transfer) {
+		BarHttpAssetTableRelease(transfer->table);
+		BarWsFrameUnref(transfer->snapshot);
+		memset(transfer, 0, sizeof(*transfer));
+	}
+}
@@ -26,6 +26,10 @@ THE SOFTWARE.
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "asset_cache.h"
+#include "../core/queue.h"
+#include "../../bar_constants.h"
+
 /* Forward declarations */
 struct lws;
 typedef struct lws lws_t;
@@ -33,11 +37,50 @@ typedef struct lws lws_t;
 /* MIME type detection */
 const char *BarHttpGetMimeType(const char *path);
 
-/* Serve static file */
-int BarHttpServeFile(struct lws *wsi, const char *filepath);
+/* Response body in progress; lives in the connection's per-session data.
+ * The body is sent from up to HTTP_TRANSFER_PARTS pieces back to back, so
+ * a state snapshot can be spliced into index.html without copying either */
+typedef struct {
+	BarHttpAssetTable_t *table;     /* Referenced until the body is sent */
+	BarWsFrame_t *snapshot;         /* Spliced in, referenced until sent */
+	struct {
+		const unsigned char *data;
+		size_t len;
+	} parts[HTTP_TRANSFER_PARTS];
+	size_t count;
+	size_t part;                    /* Piece being sent */
+	size_t sent;                    /* Bytes of it already sent */
+} BarHttpTransfer_t;
+
+/* Serve a web UI file ("/" is index.html) from the cache, with ETag/304
+ * and a precompressed variant when the client accepts it. Only the headers
+ * are written here; a body is left in transfer for BarHttpWriteBody.
+ * A snapshot (JSON, may be NULL) is put into index.html as a
+ * <script id="pianobar-state" type="application/json"> element. */
+int BarHttpServeAsset(struct lws *wsi, BarHttpAssetCache_t *cache, const char *url,
+                      BarWsFrame_t *snapshot, BarHttpTransfer_t *transfer);
+
+/* Set transfer up to send html with snapshot inserted before </head>.
+ * Takes a reference to snapshot; false if html has no </head> */
+bool BarHttpTransferSplice(BarHttpTransfer_t *transfer, const BarHttpAssetBody_t *html,
+                           BarWsFrame_t *snapshot);
+
+/* Copy the next bytes of the body into buf; returns how many */
+size_t BarHttpTransferFill(BarHttpTransfer_t *transfer, unsigned char *buf, size_t size);
+
+/* Bytes of the body not sent yet */
+size_t BarHttpTransferRemaining(const BarHttpTransfer_t *transfer);
+
+/* LWS_CALLBACK_HTTP_WRITEABLE: send the next HTTP_BODY_CHUNK_SIZE bytes
+ * and ask for another callback until the body is complete */
+int BarHttpWriteBody(struct lws *wsi, BarHttpTransfer_t *transfer);
+
+/* Give up an unfinished body (LWS_CALLBACK_CLOSED_HTTP) */
+void BarHttpTransferRelease(BarHttpTransfer_t *transfer);
 
-/* Serve directory index */
-int BarHttpServeIndex(struct lws *wsi, const char *webui_path);
+/* Header parsing, exposed for tests */
+bool BarHttpAcceptsEncoding(const char *header, const char *coding);
+bool BarHttpEtagMatches(const char *header, const char *etag);
 
 #endif /* _HTTP_SERVER_H */
 
@@ -0,0 +1,452 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "msgpack.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <json-c/json.h>
+
+/* connected MessagePack clients; events are only encoded for them if any */
+static atomic_int msgpackClients;
+
+/* bytes taken by the header of a str, array or map with n entries */
+static size_t BarMsgpackHeaderSize(size_t n, size_t fixMax, bool hasByte) {
+	if (n <= fixMax) {
+		return 1;
+	} else if (hasByte && n <= UINT8_MAX) {
+		return 2;
+	} else if (n <= UINT16_MAX) {
+		return 3;
+	}
+	return 5;
+}
+
+static size_t BarMsgpackIntSize(int64_t v) {
+	if (v >= 0) {
+		return v < 128 ? 1 : v <= UINT8_MAX ? 2 : v <= UINT16_MAX ? 3 :
+				v <= UINT32_MAX ? 5 : 9;
+	}
+	return v >= -32 ? 1 : v >= INT8_MIN ? 2 : v >= INT16_MIN ? 3 :
+			v >= INT32_MIN ? 5 : 9;
+}
+
+/* Number of bytes BarMsgpackWrite will produce
+ * obj: json value, NULL is null */
+size_t BarMsgpackSize(json_object *obj) {
+	size_t size = 0;
+
+	switch (json_object_get_type(obj)) {
+		case json_type_null:
+		case json_type_boolean:
+			return 1;
+
+		case json_type_int:
+			return BarMsgpackIntSize(json_object_get_int64(obj));
+
+		case json_type_double:
+			return 9;
+
+		case json_type_string: {
+			const size_t len = (size_t) json_object_get_string_len(obj);
+			return BarMsgpackHeaderSize(len, 31, true) + len;
+		}
+
+		case json_type_array: {
+			const size_t n = json_object_array_length(obj);
+			size = BarMsgpackHeaderSize(n, 15, false);
+			for (size_t i = 0; i < n; i++) {
+				size += BarMsgpackSize(json_object_array_get_idx(obj, i));
+			}
+			return size;
+		}
+
+		case json_type_object:
+			size = BarMsgpackHeaderSize(
+					(size_t) json_object_object_length(obj), 15, false);
+			json_object_object_foreach(obj, key, val) {
+				const size_t len = strlen(key);
+				size += BarMsgpackHeaderSize(len, 31, true) + len +
+						BarMsgpackSize(val);
+			}
+			return size;
+	}
+	return 1;
+}
+
+static unsigned char *BarMsgpackPutBE(unsigned char *p, uint64_t v,
+		size_t bytes) {
+	for (size_t i = bytes; i > 0; i--) {
+		p[i - 1] = (unsigned char) (v & 0xff);
+		v >>= 8;
+	}
+	return p + bytes;
+}
+
+/* Write the header of a str, array or map
+ * p: first byte of the fix format, fix formats hold up to fixMax
+ * n: first byte of the 8 (str only), 16 and 32 bit formats */
+static unsigned char *BarMsgpackPutHeader(unsigned char *p, size_t n,
+		unsigned char fix, size_t fixMax, unsigned char sized) {
+	const size_t size = BarMsgpackHeaderSize(n, fixMax, fix == 0xa0);
+
+	if (size == 1) {
+		*p++ = (unsigned char) (fix | n);
+		return p;
+	}
+	/* str has str8 in front of str16/str32 */
+	const unsigned char type = (unsigned char) (sized +
+			(size == 2 ? 0 : size == 3 ? 1 : 2) - (fix == 0xa0 ? 0 : 1));
+	*p++ = type;
+	return BarMsgpackPutBE(p, n, size - 1);
+}
+
+static unsigned char *BarMsgpackPutString(unsigned char *p, const char *s,
+		size_t len) {
+	p = BarMsgpackPutHeader(p, len, 0xa0, 31, 0xd9);
+	memcpy(p, s, len);
+	return p + len;
+}
+
+static unsigned char *BarMsgpackPutInt(unsigned char *p, int64_t v) {
+	const size_t size = BarMsgpackIntSize(v);
+
+	if (size == 1) {
+		*p++ = (unsigned char) v;
+		return p;
+	}
+	static const unsigned char uintType[] = {[2] = 0xcc, [3] = 0xcd,
+			[5] = 0xce, [9] = 0xcf};
+	static const unsigned char intType[] = {[2] = 0xd0, [3] = 0xd1,
+			[5] = 0xd2, [9] = 0xd3};
+	*p++ = v >= 0 ? uintType[size] : intType[size];
+	return BarMsgpackPutBE(p, (uint64_t) v, size - 1);
+}
+
+/* Serialize a json value
+ * obj: json value, NULL is null
+ * p: output, at least BarMsgpackSize bytes
+ * Returns end of the written data */
+unsigned char *BarMsgpackWrite(json_object *obj, unsigned char *p) {
+	switch (json_object_get_type(obj)) {
+		case json_type_null:
+			*p++ = 0xc0;
+			break;
+
+		case json_type_boolean:
+			*p++ = json_object_get_boolean(obj) ? 0xc3 : 0xc2;
+			break;
+
+		case json_type_int:
+			p = BarMsgpackPutInt(p, json_object_get_int64(obj));
+			break;
+
+		case json_type_double: {
+			const double d = json_object_get_double(obj);
+			uint64_t bits;
+			memcpy(&bits, &d, sizeof(bits));
+			*p++ = 0xcb;
+			p = BarMsgpackPutBE(p, bits, 8);
+			break;
+		}
+
+		case json_type_string:
+			p = BarMsgpackPutString(p, json_object_get_string(obj),
+					(size_t) json_object_get_string_len(obj));
+			break;
+
+		case json_type_array: {
+			const size_t n = json_object_array_length(obj);
+			p = BarMsgpackPutHeader(p, n, 0x90, 15, 0xdc);
+			for (size_t i = 0; i < n; i++) {
+				p = BarMsgpackWrite(json_object_array_get_idx(obj, i), p);
+			}
+			break;
+		}
+
+		case json_type_object:
+			p = BarMsgpackPutHeader(p,
+					(size_t) json_object_object_length(obj), 0x80, 15, 0xde);
+			json_object_object_foreach(obj, key, val) {
+				p = BarMsgpackPutString(p, key, strlen(key));
+				p = BarMsgpackWrite(val, p);
+			}
+			break;
+	}
+	return p;
+}
+
+typedef struct {
+	const unsigned char *p, *end;
+} BarMsgpackReader_t;
+
+static bool BarMsgpackGetBE(BarMsgpackReader_t *r, size_t bytes,
+		uint64_t *v) {
+	if ((size_t) (r->end - r->p) < bytes) {
+		return false;
+	}
+	*v = 0;
+	for (size_t i = 0; i < bytes; i++) {
+		*v = (*v << 8) | *r->p++;
+	}
+	return true;
+}
+
+static bool BarMsgpackGetString(BarMsgpackReader_t *r, size_t len,
+		const char **s) {
+	if ((size_t) (r->end - r->p) < len) {
+		return false;
+	}
+	*s = (const char *) r->p;
+	r->p += len;
+	return true;
+}
+
+static bool BarMsgpackDecodeValue(BarMsgpackReader_t *, unsigned int,
+		json_object **);
+
+static bool BarMsgpackDecodeArray(BarMsgpackReader_t *r, uint64_t n,
+		unsigned int depth, json_object **out) {
+	/* every element takes at least a byte; refuse absurd counts early */
+	if (n > (uint64_t) (r->end - r->p)) {
+		return false;
+	}
+	json_object *arr = json_object_new_array();
+	for (uint64_t i = 0; i < n; i++) {
+		json_object *val;
+		if (!BarMsgpackDecodeValue(r, depth + 1, &val)) {
+			json_object_put(arr);
+			return false;
+		}
+		json_object_array_add(arr, val);
+	}
+	*out = arr;
+	return true;
+}
+
+static bool BarMsgpackDecodeMap(BarMsgpackReader_t *r, uint64_t n,
+		unsigned int depth, json_object **out) {
+	if (n > (uint64_t) (r->end - r->p) / 2) {
+		return false;
+	}
+	json_object *obj = json_object_new_object();
+	for (uint64_t i = 0; i < n; i++) {
+		json_object *key, *val;
+		if (!BarMsgpackDecodeValue(r, depth + 1, &key)) {
+			json_object_put(obj);
+			return false;
+		}
+		/* JSON object keys are strings without NUL */
+		if (!json_object_is_type(key, json_type_string) ||
+				memchr(json_object_get_string(key), '\0',
+				(size_t) json_object_get_string_len(key)) != NULL ||
+				!BarMsgpackDecodeValue(r, depth + 1, &val)) {
+			json_object_put(key);
+			json_object_put(obj);
+			return false;
+		}
+		json_object_object_add(obj, json_object_get_string(key), val);
+		json_object_put(key);
+	}
+	*out = obj;
+	return true;
+}
+
+static bool BarMsgpackDecodeValue(BarMsgpackReader_t *r, unsigned int depth,
+		json_object **out) {
+	uint64_t v;
+	const char *s;
+
+	if (r->p >= r->end || depth > BAR_MSGPACK_DEPTH_MAX) {
+		return false;
+	}
+	const unsigned char type = *r->p++;
+
+	if (type <= 0x7f) {
+		*out = json_object_new_int64(type);
+		return true;
+	} else if (type >= 0xe0) {
+		*out = json_object_new_int64((int8_t) type);
+		return true;
+	} else if (type <= 0x8f) {
+		return BarMsgpackDecodeMap(r, type & 0x0f, depth, out);
+	} else if (type <= 0x9f) {
+		return BarMsgpackDecodeArray(r, type & 0x0f, depth, out);
+	} else if (type <= 0xbf) {
+		if (!BarMsgpackGetString(r, type & 0x1f, &s)) {
+			return false;
+		}
+		*out = json_object_new_string_len(s, type & 0x1f);
+		return true;
+	}
+
+	switch (type) {
+		case 0xc0:
+			*out = NULL;
+			return true;
+
+		case 0xc2:
+		case 0xc3:
+			*out = json_object_new_boolean(type == 0xc3);
+			return true;
+
+		case 0xca: {
+			float f;
+			uint32_t bits;
+			if (!BarMsgpackGetBE(r, 4, &v)) {
+				return false;
+			}
+			bits = (uint32_t) v;
+			memcpy(&f, &bits, sizeof(f));
+			*out = json_object_new_double(f);
+			return true;
+		}
+
+		case 0xcb: {
+			double d;
+			if (!BarMsgpackGetBE(r, 8, &v)) {
+				return false;
+			}
+			memcpy(&d, &v, sizeof(d));
+			*out = json_object_new_double(d);
+			return true;
+		}
+
+		case 0xcc:
+		case 0xcd:
+		case 0xce:
+		case 0xcf:
+			/* json-c integers are signed 64 bit */
+			if (!BarMsgpackGetBE(r, 1u << (type - 0xcc), &v) ||
+					v > INT64_MAX) {
+				return false;
+			}
+			*out = json_object_new_int64((int64_t) v);
+			return true;
+
+		case 0xd0:
+		case 0xd1:
+		case 0xd2:
+		case 0xd3: {
+			const unsigned int bytes = 1u << (type - 0xd0);
+			if (!BarMsgpackGetBE(r, bytes, &v)) {
+				return false;
+			}
+			/* sign-extend */
+			const unsigned int shift = 64 - 8 * bytes;
+			*out = json_object_new_int64(
+					(int64_t) (v << shift) >> shift);
+			return true;
+		}
+
+		case 0xd9:
+		case 0xda:
+		case 0xdb:
+			if (!BarMsgpackGetBE(r, 1u << (type - 0xd9), &v) ||
+					!BarMsgpackGetString(r, v, &s)) {
+				return false;
+			}
+			*out = json_object_new_string_len(s, (int) v);
+			return true;
+
+		case 0xdc:
+		case 0xdd:
+			if (!BarMsgpackGetBE(r, type == 0xdc ? 2 : 4, &v)) {
+				return false;
+			}
+			return BarMsgpackDecodeArray(r, v, depth, out);
+
+		case 0xde:
+		case 0xdf:
+			if (!BarMsgpackGetBE(r, type == 0xde ? 2 : 4, &v)) {
+				return false;
+			}
+			return BarMsgpackDecodeMap(r, v, depth, out);
+
+		default:
+			/* bin, ext and the unused 0xc1 have no JSON equivalent */
+			return false;
+	}
+}
+
+/* Decode exactly one MessagePack value
+ * out: result (NULL for nil), caller json_object_put()s it
+ * Returns false if the input is malformed, has trailing bytes or a type JSON
+ * cannot represent */
+bool BarMsgpackDecode(const unsigned char *buf, size_t len,
+		json_object **out) {
+	BarMsgpackReader_t r = {buf, buf + len};
+	json_object *val;
+
+	if (buf == NULL || !BarMsgpackDecodeValue(&r, 0, &val)) {
+		return false;
+	}
+	if (r.p != r.end) {
+		json_object_put(val);
+		return false;
+	}
+	*out = val;
+	return true;
+}
+
+/* Encode a value into a new frame
+ * arr: ["event", data] array */
+BarWsFrame_t *BarMsgpackFrame(json_object *arr) {
+	BarWsFrame_t *frame = BarWsFrameNew(BarMsgpackSize(arr));
+	if (frame != NULL) {
+		BarMsgpackWrite(arr, BarWsFramePayload(frame));
+	}
+	return frame;
+}
+
+/* Binary twin of a Socket.IO event text frame (2["event",data]) that was
+ * formatted without one; parses the text again, so it is the slow path
+ * Returns new frame, NULL if the text is not an event packet */
+BarWsFrame_t *BarMsgpackFrameFromText(const BarWsFrame_t *text) {
+	const char *data = BarWsFrameData(text);
+
+	if (text->len < 2 || data[0] != '0' + 2) {
+		return NULL;
+	}
+	json_object *arr = json_tokener_parse(data + 1);
+	if (!json_object_is_type(arr, json_type_array)) {
+		json_object_put(arr);
+		return NULL;
+	}
+
+	BarWsFrame_t *frame = BarMsgpackFrame(arr);
+	json_object_put(arr);
+	return frame;
+}
+
+/* Count MessagePack clients in (+1) and out (-1) */
+void BarMsgpackClientsAdd(int delta) {
+	atomic_fetch_add_explicit(&msgpackClients, delta, memory_order_relaxed);
+}
+
+/* Should formatted events carry a MessagePack twin? A client that
+ * connects in between gets the twin made from text (see FrameFromText) */
+bool BarMsgpackClientsConnected(void) {
+	return atomic_load_explicit(&msgpackClients, memory_order_relaxed) > 0;
+}
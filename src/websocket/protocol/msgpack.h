@@ -0,0 +1,58 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef _MSGPACK_H
+#define _MSGPACK_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "../core/queue.h"
+
+/* MessagePack encoding of Socket.IO events for clients that negotiate the
+ * "socketio.msgpack" subprotocol.
+ *
+ * An event is sent as one binary frame holding the array ["event", data],
+ * the same value the text frame carries after its packet type digit. JSON
+ * types map to their MessagePack counterparts: integers use the smallest
+ * int/uint format, reals are float64, strings are str, objects are maps.
+ * Only what JSON can represent is accepted when decoding (no bin or ext,
+ * string map keys only). */
+
+/* Subprotocol name; plain "socketio" clients keep getting text frames */
+#define BAR_MSGPACK_PROTOCOL "socketio.msgpack"
+
+#define BAR_MSGPACK_DEPTH_MAX 32
+
+struct json_object;
+
+size_t BarMsgpackSize(struct json_object *);
+unsigned char *BarMsgpackWrite(struct json_object *, unsigned char *);
+bool BarMsgpackDecode(const unsigned char *, size_t, struct json_object **);
+
+BarWsFrame_t *BarMsgpackFrame(struct json_object *);
+BarWsFrame_t *BarMsgpackFrameFromText(const BarWsFrame_t *);
+
+void BarMsgpackClientsAdd(int);
+bool BarMsgpackClientsConnected(void);
+
+#endif /* _MSGPACK_H */
@@ -36,13 +36,17 @@ THE SOFTWARE.
 #include "socketio.h"
 #include "error_messages.h"
 #include "../core/websocket.h"
+#include "../core/deflate_stats.h"
+#include "msgpack.h"
 
 #include "../../ui_act.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <math.h>
 #include <json-c/json.h>
 
@@ -140,7 +144,7 @@ static const BarActionMapping_t actionMappings[] = {
 	/* station.mode, station.seeds, music.search, query.stations handled by dedicated events */
 
 	/* Query */
-	{"query.history",  BAR_KS_HISTORY,  BAR_SOCKETIO_ACTION_NOT_IMPLEMENTED, "web.socket.not_implemented_history"},
+	/* query.history handled by dedicated event (also accepted as an action) */
 	{"query.upcoming", BAR_KS_UPCOMING, BAR_SOCKETIO_ACTION_DISPATCH,        NULL},
 
 	/* App */
@@ -243,6 +247,9 @@ typedef struct {
 static void evtHandleQuery(BarApp_t *a, json_object *d, void *w) {
 	(void)d; BarSocketIoHandleQuery(a, w);
 }
+static void evtQueryProcess(BarApp_t *a, json_object *d, void *w) {
+	(void)d; BarSocketIoEmitProcessUnicast(a, w);
+}
 static void evtHandleStationChange(BarApp_t *a, json_object *d, void *w) {
 	(void)w;
 	if (!d) { return; }
@@ -262,9 +269,42 @@ static void evtEmitStations(BarApp_t *a, json_object *d, void *w) {
 	log_write(DEBUG_WEBSOCKET, "Socket.IO: Query stations received\n");
 	BarSocketIoEmitStations(a);
 }
+static void evtQueryHistory(BarApp_t *a, json_object *d, void *w) {
+	(void)d; BarSocketIoHandleQueryHistory(a, w);
+}
+static void evtRefreshStations(BarApp_t *a, json_object *d, void *w) {
+	(void)d; (void)w; BarSocketIoHandleRefreshStations(a);
+}
 static void evtGetGenres(BarApp_t *a, json_object *d, void *w) {
 	(void)d; (void)w; BarSocketIoHandleGetGenres(a);
 }
+/* "subscribe": a topic or list of topics ("state", "volume", "progress",
+ * "stations", "all"); null subscribes to everything again */
+static void evtSubscribe(BarApp_t *a, json_object *d, void *w) {
+	unsigned int mask = d ? 0 : BAR_WS_SUBSCRIBE_ALL;
+	const size_t n = json_object_is_type(d, json_type_array) ?
+	        json_object_array_length(d) : (d ? 1 : 0);
+
+	for (size_t i = 0; i < n; i++) {
+		json_object *topic = json_object_is_type(d, json_type_array) ?
+		        json_object_array_get_idx(d, i) : d;
+		const char *name = json_object_is_type(topic, json_type_string) ?
+		        json_object_get_string(topic) : NULL;
+		BarWsBucketType_t bucket;
+		if (name && strcmp(name, "all") == 0) {
+			mask = BAR_WS_SUBSCRIBE_ALL;
+		} else if (name && BarWsBucketByName(name, &bucket)) {
+			mask |= 1u << bucket;
+		} else {
+			BarSocketIoSetUnicastTarget(w);
+			BarSocketIoEmitError(a, "subscribe", name ?
+			        "Unknown topic" : "Topics must be strings");
+			BarSocketIoSetUnicastTarget(NULL);
+			return;
+		}
+	}
+	BarWebsocketSubscribe(a, w, mask);
+}
 static void evtPingNoop(BarApp_t *a, json_object *d, void *w) {
 	(void)a; (void)d; (void)w; /* client keepalive; no response needed */
 }
@@ -320,6 +360,7 @@ static const BarSocketIoEvent_t eventHandlers[] = {
 	{"station.addMusic",       evtAddMusic},
 	{"station.addShared",      evtAddShared},
 	{"station.rename",         evtRenameStation},
+	{"station.refresh",        evtRefreshStations},
 	{"station.getModes",       evtGetStationModes},
 	{"station.setMode",        evtSetStationMode},
 	{"station.getInfo",        evtGetStationInfo},
@@ -331,38 +372,85 @@ static const BarSocketIoEvent_t eventHandlers[] = {
 	{"query",                  evtHandleQuery},
 	{"query.state",            evtHandleQuery},           /* alias */
 	{"query.stations",         evtEmitStations},
+	{"query.process",          evtQueryProcess},          /* resync after a process.patch gap */
+	{"query.history",          evtQueryHistory},
 	/* protocol events */
+	{"subscribe",              evtSubscribe},
 	{"ping",                   evtPingNoop},
 	{NULL, NULL}  /* sentinel */
 };
 
-/* Handle incoming Socket.IO message */
-void BarSocketIoHandleMessage(BarApp_t *app, const char *message, void *wsi) {
-	BarSocketIoType_t type;
-	char *eventName = NULL;
-	json_object *data = NULL;
+/* Parse inbound packet; cheap, runs on the WebSocket service thread */
+bool BarSocketIoParsePacket(const char *message, BarSocketIoPacket_t *pkt) {
+	if (!message || !pkt) {
+		return false;
+	}
 
-	if (!app || !message) {
-		log_write(DEBUG_WEBSOCKET_PROGRESS, "Socket.IO: HandleMessage called with null app or message\n");
-		return;
+	pkt->type = BarSocketIoParse(message, &pkt->eventName, &pkt->data);
+
+	log_write(DEBUG_WEBSOCKET_PROGRESS, "Socket.IO: Parsed message - type=%d, eventName=%s\n",
+	           pkt->type, pkt->eventName ? pkt->eventName : "(null)");
+
+	if (pkt->type == SOCKETIO_CONNECT ||
+	    (pkt->type == SOCKETIO_EVENT && pkt->eventName)) {
+		return true;
 	}
+	BarSocketIoPacketFree(pkt);
+	return false;
+}
 
-	log_write(DEBUG_WEBSOCKET_PROGRESS, "Socket.IO: HandleMessage called with: %.*s%s\n",
-	           (int)LOG_MESSAGE_TRUNCATE_LEN, message, strlen(message) > LOG_MESSAGE_TRUNCATE_LEN ? "..." : "");
+bool BarSocketIoParseMsgpackPacket(const void *message, size_t len,
+                                   BarSocketIoPacket_t *pkt) {
+	json_object *arr = NULL, *event;
 
-	type = BarSocketIoParse(message, &eventName, &data);
+	if (!message || !pkt || !BarMsgpackDecode(message, len, &arr)) {
+		log_write(DEBUG_WEBSOCKET, "Socket.IO: Malformed MessagePack message (%zu bytes)\n", len);
+		return false;
+	}
+	pkt->type = SOCKETIO_EVENT;
+	pkt->eventName = NULL;
+	pkt->data = NULL;
+	if (json_object_is_type(arr, json_type_array) &&
+	    json_object_array_length(arr) >= 1 &&
+	    json_object_is_type((event = json_object_array_get_idx(arr, 0)), json_type_string)) {
+		pkt->eventName = strdup(json_object_get_string(event));
+		pkt->data = json_object_get(json_object_array_get_idx(arr, 1));
+	}
+	json_object_put(arr);
 
-	log_write(DEBUG_WEBSOCKET_PROGRESS, "Socket.IO: Parsed message - type=%d, eventName=%s\n",
-	           type, eventName ? eventName : "(null)");
+	if (pkt->eventName) {
+		return true;
+	}
+	BarSocketIoPacketFree(pkt);
+	return false;
+}
+
+/* Release what BarSocketIoParsePacket allocated */
+void BarSocketIoPacketFree(BarSocketIoPacket_t *pkt) {
+	if (!pkt) {
+		return;
+	}
+	free(pkt->eventName);
+	pkt->eventName = NULL;
+	if (pkt->data) {
+		json_object_put(pkt->data);
+		pkt->data = NULL;
+	}
+}
+
+/* Handle parsed packet; handlers may block on Pandora requests */
+void BarSocketIoDispatchPacket(BarApp_t *app, const BarSocketIoPacket_t *pkt, void *wsi) {
+	const char *eventName = pkt->eventName;
+	json_object *data = pkt->data;
 
-	if (type == SOCKETIO_CONNECT) {
+	if (pkt->type == SOCKETIO_CONNECT) {
 		log_write(DEBUG_WEBSOCKET, "Socket.IO: Client connected\n");
 		BarSocketIoHandleQuery(app, wsi);
-		goto cleanup;
+		return;
 	}
 
-	if (type != SOCKETIO_EVENT || !eventName) {
-		goto cleanup;
+	if (pkt->type != SOCKETIO_EVENT || !eventName) {
+		return;
 	}
 
 	/* "action" has complex sub-routing (string/object data formats); handle before table */
@@ -380,27 +468,39 @@ void BarSocketIoHandleMessage(BarApp_t *app, const char *message, void *wsi) {
 				if (action) { BarSocketIoHandleAction(app, action, data, wsi); }
 			}
 		}
-		goto cleanup;
+		return;
 	}
 
 	/* Table-driven dispatch for all other events */
 	for (const BarSocketIoEvent_t *e = eventHandlers; e->name != NULL; e++) {
 		if (strcmp(eventName, e->name) == 0) {
 			e->fn(app, data, wsi);
-			goto cleanup;
+			return;
 		}
 	}
 	log_write(DEBUG_WEBSOCKET, "Socket.IO: Unknown event: %s\n", eventName);
+}
 
-cleanup:
-	free(eventName);
-	if (data) {
-		json_object_put(data);
+/* Handle incoming Socket.IO message (parse and dispatch inline) */
+void BarSocketIoHandleMessage(BarApp_t *app, const char *message, void *wsi) {
+	BarSocketIoPacket_t pkt;
+
+	if (!app || !message) {
+		log_write(DEBUG_WEBSOCKET_PROGRESS, "Socket.IO: HandleMessage called with null app or message\n");
+		return;
+	}
+
+	log_write(DEBUG_WEBSOCKET_PROGRESS, "Socket.IO: HandleMessage called with: %.*s%s\n",
+	           (int)LOG_MESSAGE_TRUNCATE_LEN, message, strlen(message) > LOG_MESSAGE_TRUNCATE_LEN ? "..." : "");
+
+	if (BarSocketIoParsePacket(message, &pkt)) {
+		BarSocketIoDispatchPacket(app, &pkt, wsi);
+		BarSocketIoPacketFree(&pkt);
 	}
 }
 
 /* Global broadcast callback (set by WebSocket core) */
-static void (*g_broadcastCallback)(const char *message, size_t len) = NULL;
+static void (*g_broadcastCallback)(BarWsFrame_t *frame) = NULL;
 
 /* Thread-local unicast target - each thread has its own value
  * WebSocket thread: Sets this when handling query actions
@@ -415,7 +515,7 @@ static void init_unicast_target_key(void) {
 }
 
 /* Set broadcast callback */
-void BarSocketIoSetBroadcastCallback(void (*callback)(const char *, size_t)) {
+void BarSocketIoSetBroadcastCallback(void (*callback)(BarWsFrame_t *)) {
 	g_broadcastCallback = callback;
 }
 
@@ -431,12 +531,12 @@ void *BarSocketIoGetUnicastTarget(void) {
 	return pthread_getspecific(g_unicastTargetKey);
 }
 
-/* Format Socket.IO event message */
-char *BarSocketIoFormatEventMessage(const char *event, json_object *data) {
+/* Format Socket.IO event frame */
+BarWsFrame_t *BarSocketIoFormatEventFrame(const char *event, json_object *data) {
 	json_object *arr;
 	const char *jsonStr;
-	char *formatted;
-	size_t len;
+	BarWsFrame_t *frame;
+	size_t jsonLen = 0;
 	
 	if (!event) {
 		return NULL;
@@ -450,22 +550,28 @@ char *BarSocketIoFormatEventMessage(const char *event, json_object *data) {
 		json_object_array_add(arr, json_object_get(data)); /* Increment ref */
 	}
 	
-	jsonStr = json_object_to_json_string(arr);
+	/* Same flags as json_object_to_json_string() */
+	jsonStr = json_object_to_json_string_length(arr, JSON_C_TO_STRING_SPACED, &jsonLen);
 	
 	/* Format as Socket.IO message: 2["event",data] */
-	len = strlen(jsonStr) + 2; /* "2" + JSON + null */
-	formatted = malloc(len);
-	if (formatted) {
-		snprintf(formatted, len, "2%s", jsonStr);
+	frame = jsonStr ? BarWsFrameNew(jsonLen + 1) : NULL;
+	if (frame) {
+		unsigned char *payload = BarWsFramePayload(frame);
+		payload[0] = '2';
+		memcpy(payload + 1, jsonStr, jsonLen);
+		BarWsDeflateStatsRecord(event, frame);
+		if (BarMsgpackClientsConnected()) {
+			frame->packed = BarMsgpackFrame(arr);
+		}
 	}
 	
 	json_object_put(arr);
-	return formatted;
+	return frame;
 }
 
 /* Emit event to all connected clients */
 void BarSocketIoEmit(const char *event, json_object *data) {
-	char *message;
+	BarWsFrame_t *frame;
 	
 	if (!event) {
 		log_write(DEBUG_WEBSOCKET, "Socket.IO: Emit called with null event\n");
@@ -478,25 +584,25 @@ void BarSocketIoEmit(const char *event, json_object *data) {
 
 	log_write(dbgFlag, "Socket.IO: Emit event='%s' (data=%p)\n", event, data);
 
-	message = BarSocketIoFormatEventMessage(event, data);
-	if (!message) {
+	frame = BarSocketIoFormatEventFrame(event, data);
+	if (!frame) {
 		log_write(dbgFlag, "Socket.IO: Failed to format message for event '%s'\n", event);
 		return;
 	}
 
 	log_write(dbgFlag, "Socket.IO: Formatted message (len=%zu): %.*s%s\n",
-	           strlen(message), (int)LOG_MESSAGE_TRUNCATE_LEN, message, strlen(message) > LOG_MESSAGE_TRUNCATE_LEN ? "..." : "");
+	           frame->len, (int)LOG_MESSAGE_TRUNCATE_LEN, BarWsFrameData(frame), frame->len > LOG_MESSAGE_TRUNCATE_LEN ? "..." : "");
 
 	/* Broadcast to all clients if callback is set */
 	if (g_broadcastCallback) {
 		log_write(dbgFlag, "Socket.IO: Calling broadcast callback\n");
-		g_broadcastCallback(message, strlen(message));
+		g_broadcastCallback(frame);
 		log_write(DEBUG_WEBSOCKET_PROGRESS, "Socket.IO: Broadcast callback returned\n");
 	} else {
 		log_write(dbgFlag, "Socket.IO: Emit '%s' (no broadcast callback set)\n", event);
 	}
 
-	free(message);
+	BarWsFrameUnref(frame);
 	log_write(DEBUG_WEBSOCKET_PROGRESS, "Socket.IO: Emit complete for event '%s'\n", event);
 }
 
@@ -561,6 +667,7 @@ void BarSocketIoEmitStations(BarApp_t *app) {
 	if (!stationList) {
 		log_write(DEBUG_WEBSOCKET, "Socket.IO: No stations available yet\n");
 		/* Send empty stations array */
+		BarSocketIoStationsChanged();
 		stations = json_object_new_array();
 		BarSocketIoEmit("stations", stations);
 		json_object_put(stations);
@@ -592,26 +699,268 @@ void BarSocketIoEmitStations(BarApp_t *app) {
 	
 	free(sortedStations);
 	
+	BarSocketIoStationsChanged();
 	BarSocketIoEmit("stations", stations);
 	json_object_put(stations);
 }
 
+/* Last process state sent and its revision. Clients apply process.patch
+ * only on top of the revision before it and re-query on a gap. The document
+ * is built and its frames are handed to the STATE bucket while the lock is
+ * held, so the newest revision is always the newest state and revisions
+ * reach clients in the order they were assigned. */
+static pthread_mutex_t g_processMutex = PTHREAD_MUTEX_INITIALIZER;
+static json_object *g_processLast = NULL;
+static uint64_t g_processRevision = 0;
+
+struct json_object *BarSocketIoMergePatchDiff(json_object *from, json_object *to) {
+	json_object *patch = json_object_new_object();
+
+	json_object_object_foreach(to, key, toVal) {
+		json_object *fromVal;
+		if (!json_object_object_get_ex(from, key, &fromVal)) {
+			json_object_object_add(patch, key, json_object_get(toVal));
+		} else if (json_object_is_type(fromVal, json_type_object) &&
+				json_object_is_type(toVal, json_type_object)) {
+			json_object *sub = BarSocketIoMergePatchDiff(fromVal, toVal);
+			if (json_object_object_length(sub) > 0) {
+				json_object_object_add(patch, key, sub);
+			} else {
+				json_object_put(sub);
+			}
+		} else if (!json_object_equal(fromVal, toVal)) {
+			/* null, scalars and arrays are replaced as a whole */
+			json_object_object_add(patch, key, json_object_get(toVal));
+		}
+	}
+	json_object_object_foreach(from, oldKey, oldVal) {
+		(void) oldVal;
+		if (!json_object_object_get_ex(to, oldKey, NULL)) {
+			json_object_object_add(patch, oldKey, NULL); /* removal */
+		}
+	}
+	return patch;
+}
+
+/* Wrap a payload for the wire together with its revision */
+static BarWsFrame_t *BarSocketIoFormatRevision(const char *event,
+		json_object *body, const char *key, uint64_t revision) {
+	json_object *data = json_object_new_object();
+	json_object_object_add(data, "revision", json_object_new_int64((int64_t) revision));
+	json_object_object_add(data, key, json_object_get(body));
+	BarWsFrame_t *frame = BarSocketIoFormatEventFrame(event, data);
+	json_object_put(data);
+	return frame;
+}
+
+/* Diff doc against the last state sent and format both frames; caller holds
+ * g_processMutex. Returns true if the state changed (new revision) */
+static bool BarSocketIoFormatProcessFrames(json_object *doc,
+		BarWsFrame_t **patch, BarWsFrame_t **full) {
+	bool changed = true;
+	if (g_processLast != NULL) {
+		json_object *diff = BarSocketIoMergePatchDiff(g_processLast, doc);
+		changed = json_object_object_length(diff) > 0;
+		if (changed) {
+			*patch = BarSocketIoFormatRevision("process.patch", diff, "patch",
+					g_processRevision + 1);
+			if (*patch) {
+				(*patch)->incremental = true;
+			}
+		}
+		json_object_put(diff);
+	}
+	if (changed) {
+		json_object_put(g_processLast);
+		g_processLast = json_object_get(doc);
+		g_processRevision++;
+	}
+
+	/* full document keeps its fields at the top level, as before */
+	json_object *data = json_object_new_object();
+	json_object_object_foreach(doc, key, val) {
+		json_object_object_add(data, key, json_object_get(val));
+	}
+	json_object_object_add(data, "revision",
+			json_object_new_int64((int64_t) g_processRevision));
+	*full = BarSocketIoFormatEventFrame("process", data);
+	json_object_put(data);
+	return changed;
+}
+
+/* Hand a new revision to the STATE bucket: the patch if nothing is waiting
+ * there (it applies on top of what clients already have), the full state
+ * otherwise. Caller holds g_processMutex; takes over both references. */
+static void BarSocketIoQueueProcess(BarApp_t *app, BarWsFrame_t *patch,
+		BarWsFrame_t *full) {
+	if (patch && BarWebsocketOfferSocketIoMessage(app, BUCKET_STATE, patch)) {
+		BarWsFrameUnref(full);
+		return;
+	}
+	BarWebsocketBroadcastSocketIoMessage(app, BUCKET_STATE, full);
+}
+
+bool BarSocketIoBuildProcessFrames(BarApp_t *app, BarWsFrame_t **patch,
+		BarWsFrame_t **full) {
+	bool changed = false;
+	*patch = NULL;
+	*full = NULL;
+
+	pthread_mutex_lock(&g_processMutex);
+	json_object *doc = BarSocketIoBuildProcessPayload(app);
+	if (doc != NULL) {
+		changed = BarSocketIoFormatProcessFrames(doc, patch, full);
+	}
+	pthread_mutex_unlock(&g_processMutex);
+
+	json_object_put(doc);
+	return changed;
+}
+
+void BarSocketIoBroadcastProcess(BarApp_t *app) {
+	BarWsFrame_t *patch = NULL, *full = NULL;
+
+	pthread_mutex_lock(&g_processMutex);
+	json_object *doc = BarSocketIoBuildProcessPayload(app);
+	if (doc == NULL) {
+		pthread_mutex_unlock(&g_processMutex);
+		return;
+	}
+	if (BarSocketIoFormatProcessFrames(doc, &patch, &full)) {
+		BarSocketIoQueueProcess(app, patch, full);
+	} else {
+		BarWsFrameUnref(full);
+	}
+	pthread_mutex_unlock(&g_processMutex);
+
+	json_object_put(doc);
+}
+
 /* Emit 'process' event (full state) */
 void BarSocketIoEmitProcess(BarApp_t *app) {
+	BarWsFrame_t *patch = NULL, *full = NULL;
+
 	if (!app) {
 		log_write(DEBUG_WEBSOCKET, "Socket.IO: EmitProcess called with null app\n");
 		return;
 	}
 
-	json_object *data = BarSocketIoBuildProcessPayload (app);
-	if (data == NULL) {
+	void *target = BarSocketIoGetUnicastTarget();
+	pthread_mutex_lock(&g_processMutex);
+	json_object *doc = BarSocketIoBuildProcessPayload(app);
+	if (doc == NULL) {
+		pthread_mutex_unlock(&g_processMutex);
 		return;
 	}
-	log_write(DEBUG_WEBSOCKET, "Socket.IO: EmitProcess calling emit\n");
-	BarSocketIoEmit("process", data);
-	log_write(DEBUG_WEBSOCKET, "Socket.IO: EmitProcess freeing data object\n");
+	const bool changed = BarSocketIoFormatProcessFrames(doc, &patch, &full);
+	if (target == NULL && app->wsContext != NULL) {
+		/* everyone: same path as BarSocketIoBroadcastProcess, so it cannot
+		 * overtake an older state still waiting in the bucket */
+		BarSocketIoQueueProcess(app, patch, full);
+		full = NULL;
+	} else if (changed && target != NULL) {
+		/* A unicast reply moves the revision for everyone else too; the
+		 * target ignores the patch (it gets the full state right away) */
+		BarSocketIoQueueProcess(app, patch, BarWsFrameRef(full));
+	} else {
+		BarWsFrameUnref(patch);
+	}
+	if (full && g_broadcastCallback) {
+		log_write(DEBUG_WEBSOCKET, "Socket.IO: EmitProcess (len=%zu)\n", full->len);
+		g_broadcastCallback(full);
+	}
+	pthread_mutex_unlock(&g_processMutex);
+
+	BarWsFrameUnref(full);
+	json_object_put(doc);
+}
+
+/* First-paint snapshot for index.html and what it was built from. The
+ * stations revision moves whenever a station list or delta goes out. */
+static pthread_mutex_t g_snapshotMutex = PTHREAD_MUTEX_INITIALIZER;
+static BarWsFrame_t *g_snapshot = NULL;
+static uint64_t g_snapshotProcessRevision = 0;
+static uint64_t g_snapshotStationsRevision = 0;
+static atomic_uint_fast64_t g_stationsRevision = 1;
+
+void BarSocketIoStationsChanged(void) {
+	atomic_fetch_add(&g_stationsRevision, 1);
+}
+
+/* JSON text of obj with every '<' written as \u003c, so nothing in it can
+ * end or confuse the <script> element it goes into */
+static BarWsFrame_t *BarSocketIoFormatScriptJson(json_object *obj) {
+	size_t len, lt = 0;
+	const char *json = json_object_to_json_string_length(obj,
+			JSON_C_TO_STRING_PLAIN, &len);
+	for (size_t i = 0; i < len; i++) {
+		lt += json[i] == '<';
+	}
+	BarWsFrame_t *frame = BarWsFrameNew(len + lt * 5);
+	if (frame == NULL) {
+		return NULL;
+	}
+	unsigned char *out = BarWsFramePayload(frame);
+	for (size_t i = 0; i < len; i++) {
+		if (json[i] == '<') {
+			memcpy(out, "\\u003c", 6);
+			out += 6;
+		} else {
+			*out++ = (unsigned char) json[i];
+		}
+	}
+	return frame;
+}
+
+BarWsFrame_t *BarSocketIoSnapshotFrame(BarApp_t *app) {
+	if (!app) return NULL;
+
+	/* The process document last sent to clients, which is what its
+	 * revision numbers; before there is one, build it (uncached) */
+	pthread_mutex_lock(&g_processMutex);
+	json_object *process = json_object_get(g_processLast);
+	const uint64_t revision = g_processRevision;
+	pthread_mutex_unlock(&g_processMutex);
+	const bool cacheable = process != NULL;
+	const uint64_t stationsRevision = atomic_load(&g_stationsRevision);
+
+	pthread_mutex_lock(&g_snapshotMutex);
+	if (cacheable && g_snapshot != NULL &&
+			g_snapshotProcessRevision == revision &&
+			g_snapshotStationsRevision == stationsRevision) {
+		BarWsFrame_t *frame = BarWsFrameRef(g_snapshot);
+		pthread_mutex_unlock(&g_snapshotMutex);
+		json_object_put(process);
+		return frame;
+	}
+
+	if (process == NULL && (process = BarSocketIoBuildProcessPayload(app)) == NULL) {
+		pthread_mutex_unlock(&g_snapshotMutex);
+		return NULL;
+	}
+	json_object *processData = json_object_new_object();
+	json_object_object_foreach(process, key, val) {
+		json_object_object_add(processData, key, json_object_get(val));
+	}
+	json_object_object_add(processData, "revision",
+			json_object_new_int64((int64_t) revision));
+	json_object *data = json_object_new_object();
+	json_object_object_add(data, "process", processData);
+	json_object_object_add(data, "stations", BarSocketIoBuildStationsPayload(app));
+	BarWsFrame_t *frame = BarSocketIoFormatScriptJson(data);
 	json_object_put(data);
-	log_write(DEBUG_WEBSOCKET, "Socket.IO: EmitProcess complete\n");
+	json_object_put(process);
+
+	if (cacheable && frame != NULL) {
+		BarWsFrameUnref(g_snapshot);
+		g_snapshot = BarWsFrameRef(frame);
+		g_snapshotProcessRevision = revision;
+		g_snapshotStationsRevision = stationsRevision;
+		log_write(DEBUG_WEBSOCKET, "Socket.IO: Snapshot for revision %llu "
+				"(len=%zu)\n", (unsigned long long) revision, frame->len);
+	}
+	pthread_mutex_unlock(&g_snapshotMutex);
+	return frame;
 }
 
 /* --- Payload builders (snapshot app state; caller json_object_put()s the result) --- */
@@ -673,6 +1022,59 @@ struct json_object *BarSocketIoBuildStationsPayload (BarApp_t *app) {
 	return stations;
 }
 
+/* Append the snapshot entry for station `id` (with its sorted index) to arr */
+static void BarSocketIoAddStationDeltaEntry(struct json_object *arr,
+		const BarStationSnapshotList_t *snap, const char *id) {
+	if (id == NULL) return;
+	for (size_t i = 0; i < snap->count; i++) {
+		const BarStationSnapshot_t *st = &snap->items[i];
+		if (st->id == NULL || strcmp(st->id, id) != 0) continue;
+		const char *displayName = st->displayName ? st->displayName : (st->name ? st->name : "");
+		struct json_object *station = json_object_new_object();
+		json_object_object_add(station, "id",           BarJsonStringOrEmpty(st->id));
+		json_object_object_add(station, "name",         BarJsonStringOrEmpty(displayName));
+		json_object_object_add(station, "isQuickMix",   json_object_new_boolean(st->isQuickMix));
+		json_object_object_add(station, "isQuickMixed", json_object_new_boolean(st->isQuickMixed));
+		json_object_object_add(station, "index",        json_object_new_int64((int64_t) i));
+		json_object_array_add(arr, station);
+		return;
+	}
+}
+
+struct json_object *BarSocketIoBuildStationsDeltaPayload(BarApp_t *app,
+		const PianoRequestDataGetStations_t *diff) {
+	if (!app || !diff) return NULL;
+
+	BarStationSnapshotList_t snap;
+	if (!BarStateSnapshotStations(app, &snap)) return NULL;
+
+	if (snap.count > 0) {
+		BarSortStationSnapshots(snap.items, snap.count, app->settings.sortOrder);
+	}
+
+	struct json_object *added = json_object_new_array();
+	for (size_t i = 0; i < diff->addedCount; i++) {
+		BarSocketIoAddStationDeltaEntry(added, &snap, diff->added[i]->id);
+	}
+	struct json_object *changed = json_object_new_array();
+	for (size_t i = 0; i < diff->changedCount; i++) {
+		BarSocketIoAddStationDeltaEntry(changed, &snap, diff->changed[i]->id);
+	}
+	struct json_object *removed = json_object_new_array();
+	const PianoStation_t *st = diff->removed;
+	PianoListForeachP(st) {
+		json_object_array_add(removed, BarJsonStringOrEmpty(st->id));
+	}
+
+	struct json_object *data = json_object_new_object();
+	json_object_object_add(data, "added",   added);
+	json_object_object_add(data, "changed", changed);
+	json_object_object_add(data, "removed", removed);
+	json_object_object_add(data, "count",   json_object_new_int64((int64_t) snap.count));
+	BarStateFreeStationSnapshot(&snap);
+	return data;
+}
+
 struct json_object *BarSocketIoBuildProcessPayload (BarApp_t *app) {
 	if (!app) return NULL;
 
@@ -887,6 +1289,65 @@ void BarSocketIoEmitUpcoming(BarApp_t *app, PianoSong_t *firstSong, int maxSongs
 	json_object_put(songs);
 }
 
+/* Visitor for BarSocketIoEmitHistory; runs under the state read lock */
+static bool BarSocketIoHistoryEntryJson(const BarSongHistoryEntry_t *e, void *ctx) {
+	json_object *songs = ctx;
+	json_object *songObj = json_object_new_object();
+	json_object_object_add(songObj, "title",      BarJsonStringOrEmpty(e->title));
+	json_object_object_add(songObj, "artist",     BarJsonStringOrEmpty(e->artist));
+	json_object_object_add(songObj, "album",      BarJsonStringOrEmpty(e->album));
+	json_object_object_add(songObj, "coverArt",   BarJsonStringOrEmpty(e->coverArt));
+	json_object_object_add(songObj, "rating",     json_object_new_int(e->rating));
+	json_object_object_add(songObj, "duration",   json_object_new_int(e->length));
+	json_object_object_add(songObj, "trackToken", BarJsonStringOrEmpty(e->trackToken));
+	json_object_object_add(songObj, "stationId",  BarJsonStringOrEmpty(e->stationId));
+	json_object_object_add(songObj, "playedAt",   json_object_new_int64((int64_t)e->playedAt));
+	json_object_array_add(songs, songObj);
+	return true;
+}
+
+/* Emit 'query.history.result' event (recently played songs, newest first) */
+void BarSocketIoEmitHistory(BarApp_t *app) {
+	if (!app) {
+		return;
+	}
+
+	json_object *songs = json_object_new_array();
+	BarStateHistoryForeach(app, BarSocketIoHistoryEntryJson, songs);
+
+	/* station names are looked up outside the history lock */
+	size_t count = json_object_array_length(songs);
+	for (size_t i = 0; i < count; i++) {
+		json_object *songObj = json_object_array_get_idx(songs, i);
+		json_object *idObj;
+		if (!json_object_object_get_ex(songObj, "stationId", &idObj)) {
+			continue;
+		}
+		PianoStation_t *station = BarStateFindStationById(app,
+				json_object_get_string(idObj));
+		if (station) {
+			const char *displayName = station->displayName ? station->displayName : station->name;
+			json_object_object_add(songObj, "stationName", BarJsonStringOrEmpty(displayName));
+		}
+	}
+
+	BarSocketIoEmit("query.history.result", songs);
+	json_object_put(songs);
+}
+
+/* Handle 'query.history' from client (unicast response to requesting client) */
+void BarSocketIoHandleQueryHistory(BarApp_t *app, void *wsi) {
+	if (!app) {
+		return;
+	}
+
+	log_write(DEBUG_WEBSOCKET, "Socket.IO: Query history received\n");
+
+	BarSocketIoSetUnicastTarget(wsi);
+	BarSocketIoEmitHistory(app);
+	BarSocketIoSetUnicastTarget(NULL);
+}
+
 /* Emit 'genres' event (genre categories and stations) */
 void BarSocketIoEmitGenres(BarApp_t *app) {
 	json_object *data, *categories, *categoryObj, *genresArray, *genreObj;
@@ -934,6 +1395,25 @@ void BarSocketIoEmitGenres(BarApp_t *app) {
 	json_object_put(data);
 }
 
+/* Handle 'station.refresh' event from client: fetch the station list again
+ * and merge it into the one we have, so clients get a stations.delta with
+ * only what changed (a full list if that is no smaller) */
+void BarSocketIoHandleRefreshStations(BarApp_t *app) {
+	PianoReturn_t pRet;
+	CURLcode wRet;
+
+	if (!app) {
+		return;
+	}
+
+	BarUiMsg(&app->settings, MSG_INFO, "Refreshing stations... ");
+	if (!BarUiGetStations(app, &pRet, &wRet)) {
+		log_write(DEBUG_WEBSOCKET, "Socket.IO: Failed: Refreshing stations\n");
+		BarSocketIoOnPandoraRequestFailed(pRet);
+		BarSocketIoEmitError(app, "station.refresh", "Failed: Refreshing stations");
+	}
+}
+
 /* Handle 'station.getGenres' event from client */
 void BarSocketIoHandleGetGenres(BarApp_t *app) {
 	PianoReturn_t pRet;
@@ -1639,6 +2119,58 @@ void BarSocketIoHandleSearchMusic(BarApp_t *app, json_object *data) {
 	}
 }
 
+/* Set the volume requested by volume.set; runs on the volume worker, or
+ * on the caller when the server is not running */
+void BarSocketIoApplyVolume(BarApp_t *app, int volumePercent) {
+	if (app->settings.volumeMode == BAR_VOLUME_MODE_SYSTEM) {
+		/* System volume mode - set OS volume directly */
+		log_write(DEBUG_WEBSOCKET, "Socket.IO: volume.set → system volume=%d%%\n",
+		           volumePercent);
+		BarSystemVolumeSet(volumePercent);
+	} else {
+		/* Player volume mode - use percentage directly (linear 0-100) */
+		log_write(DEBUG_WEBSOCKET, "Socket.IO: volume.set → volume=%d%%\n",
+		           volumePercent);
+		app->settings.volume = volumePercent;
+		BarPlayerSetVolume(&app->player);
+	}
+	
+	/* Schedule debounced broadcast (will read current volume at broadcast time) */
+	BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+	BarWsScheduleVolumeBroadcast(ctx, 500);  /* 500ms debounce */
+}
+
+/* Volume from a volume.set payload ({"volume": n}), clamped to 0-100
+ * Returns false if there is none */
+static bool BarSocketIoVolumeFromData(json_object *data, int *percent) {
+	json_object *volumeObj;
+	if (!data || !json_object_object_get_ex(data, "volume", &volumeObj)) {
+		return false;
+	}
+	*percent = json_object_get_int(volumeObj);
+	if (*percent < 0) *percent = 0;
+	if (*percent > VOLUME_MAX_PERCENT) *percent = VOLUME_MAX_PERCENT;
+	return true;
+}
+
+bool BarSocketIoTakeVolumePacket(BarApp_t *app, const BarSocketIoPacket_t *pkt) {
+	json_object *actionObj;
+	int volumePercent;
+
+	if (!app || !app->wsContext || pkt->type != SOCKETIO_EVENT ||
+			!pkt->eventName || strcmp(pkt->eventName, "action") != 0 ||
+			!json_object_is_type(pkt->data, json_type_object) ||
+			!json_object_object_get_ex(pkt->data, "action", &actionObj) ||
+			!json_object_is_type(actionObj, json_type_string) ||
+			strcmp(json_object_get_string(actionObj), "volume.set") != 0 ||
+			!BarSocketIoVolumeFromData(pkt->data, &volumePercent)) {
+		return false;
+	}
+
+	BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+	return BarWsVolumeWorkerSet(&ctx->volumeWorker, volumePercent);
+}
+
 /* Handle 'action' event from client */
 void BarSocketIoHandleAction(BarApp_t *app, const char *action, json_object *data, void *wsi) {
 	BarKeyShortcutId_t actionId;
@@ -1648,35 +2180,23 @@ void BarSocketIoHandleAction(BarApp_t *app, const char *action, json_object *dat
 	}
 	
 	/* Special handling for volume.set with percentage value */
-	if (strcmp(action, "volume.set") == 0 && data) {
-		json_object *volumeObj;
-		if (json_object_object_get_ex(data, "volume", &volumeObj)) {
-			int volumePercent = json_object_get_int(volumeObj);
-			/* Clamp to 0-100 range */
-			if (volumePercent < 0) volumePercent = 0;
-			if (volumePercent > VOLUME_MAX_PERCENT) volumePercent = VOLUME_MAX_PERCENT;
-			
-			if (app->settings.volumeMode == BAR_VOLUME_MODE_SYSTEM) {
-				/* System volume mode - set OS volume directly */
-				log_write(DEBUG_WEBSOCKET, "Socket.IO: Action '%s' → system volume=%d%%\n", 
-				           action, volumePercent);
-				BarSystemVolumeSet(volumePercent);
-			} else {
-				/* Player volume mode - use percentage directly (linear 0-100) */
-				log_write(DEBUG_WEBSOCKET, "Socket.IO: Action '%s' → volume=%d%%\n", 
-				           action, volumePercent);
-				app->settings.volume = volumePercent;
-				BarPlayerSetVolume(&app->player);
-			}
-			
-			/* Schedule debounced broadcast (will read current volume at broadcast time) */
-			BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
-			BarWsScheduleVolumeBroadcast(ctx, 500);  /* 500ms debounce */
-			
-			return;
+	int volumePercent;
+	if (strcmp(action, "volume.set") == 0 &&
+			BarSocketIoVolumeFromData(data, &volumePercent)) {
+		/* Applied by the volume worker at a bounded rate; only the
+		 * latest value of a slider drag reaches the mixer */
+		BarWsContext_t *ctx = (BarWsContext_t *)app->wsContext;
+		if (!BarWsVolumeWorkerSet(&ctx->volumeWorker, volumePercent)) {
+			BarSocketIoApplyVolume(app, volumePercent);
 		}
+		return;
 	}
 	
+	if (strcmp(action, "query.history") == 0) {
+		BarSocketIoHandleQueryHistory(app, wsi);
+		return;
+	}
+
 	/* Special handling for app.pandora-reconnect with account_id:
 	 * Account switching must work regardless of Pandora connection state,
 	 * so call the reconnect callback directly, bypassing the dispatch
@@ -26,6 +26,8 @@ THE SOFTWARE.
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "../core/queue.h"
+
 /* Note: main.h must be included before this header to get BarApp_t definition */
 
 /* Forward declarations */
@@ -42,8 +44,9 @@ typedef enum {
 	SOCKETIO_BINARY_ACK = 6,
 } BarSocketIoType_t;
 
-/* Set broadcast callback (called by WebSocket core) */
-void BarSocketIoSetBroadcastCallback(void (*callback)(const char *, size_t));
+/* Set broadcast callback (called by WebSocket core). The callback borrows
+ * the frame; it takes its own reference to keep it. */
+void BarSocketIoSetBroadcastCallback(void (*callback)(BarWsFrame_t *));
 
 /* Unicast support - for sending to specific client only */
 void BarSocketIoSetUnicastTarget(void *wsi);
@@ -52,14 +55,43 @@ void *BarSocketIoGetUnicastTarget(void);
 /* Emit 'process' event to specific client only (unicast) */
 void BarSocketIoEmitProcessUnicast(BarApp_t *app, void *wsi);
 
-/* Handle incoming Socket.IO message */
+/* Inbound Socket.IO packet, parsed but not yet handled */
+typedef struct {
+	BarSocketIoType_t type;
+	char *eventName;
+	struct json_object *data;
+} BarSocketIoPacket_t;
+
+/* Parse `message` into `pkt`. Does no I/O, safe on the WebSocket service
+ * thread. Returns false (nothing to free) if the packet needs no handling. */
+bool BarSocketIoParsePacket(const char *message, BarSocketIoPacket_t *pkt);
+
+/* Run the handler for a parsed packet. Handlers may block on Pandora
+ * requests, so this runs on the command worker, not the service thread. */
+void BarSocketIoDispatchPacket(BarApp_t *app, const BarSocketIoPacket_t *pkt, void *wsi);
+
+/* Hand a volume.set action straight to the volume worker. Only replaces its
+ * pending value, so it runs on the service thread: queued behind a slow
+ * Pandora request, a slider drag would fill the command queue and could
+ * lose its last value. Returns false (dispatch as usual) for any other
+ * packet or when the volume worker is not running. */
+bool BarSocketIoTakeVolumePacket(BarApp_t *app, const BarSocketIoPacket_t *pkt);
+
+/* Same for a binary MessagePack message (["event", data], see msgpack.h) */
+bool BarSocketIoParseMsgpackPacket(const void *message, size_t len,
+                                   BarSocketIoPacket_t *pkt);
+
+void BarSocketIoPacketFree(BarSocketIoPacket_t *pkt);
+
+/* Handle incoming Socket.IO message: parse and dispatch on the calling thread */
 void BarSocketIoHandleMessage(BarApp_t *app, const char *message, void *wsi);
 
-/* Returns a heap-allocated Socket.IO text frame for event + data.
-   Caller owns the result and must free() it.
+/* Returns a Socket.IO text frame for event + data, serialized once with
+   headroom for the WebSocket header so it can be sent as is.
+   Caller owns the reference and must BarWsFrameUnref() it.
    Returns NULL on allocation failure.
    Passing data=NULL produces a no-payload frame: 2["eventName"] */
-char *BarSocketIoFormatEventMessage (const char *event, struct json_object *data);
+BarWsFrame_t *BarSocketIoFormatEventFrame(const char *event, struct json_object *data);
 
 /* Emit event to all connected clients */
 void BarSocketIoEmit(const char *event, struct json_object *data);
@@ -68,6 +100,37 @@ void BarSocketIoEmit(const char *event, struct json_object *data);
 struct json_object *BarSocketIoBuildStartPayload    (BarApp_t *app);
 struct json_object *BarSocketIoBuildStationsPayload (BarApp_t *app);
 struct json_object *BarSocketIoBuildProcessPayload  (BarApp_t *app);
+/* Incremental counterpart of the stations payload for a GET_STATIONS diff;
+   entries carry their index in the sorted list. */
+struct json_object *BarSocketIoBuildStationsDeltaPayload(BarApp_t *app,
+		const PianoRequestDataGetStations_t *diff);
+
+/* RFC 7386 merge patch that turns `from` into `to` (both objects); an empty
+   object if they are equal. Caller must json_object_put(). */
+struct json_object *BarSocketIoMergePatchDiff(struct json_object *from,
+		struct json_object *to);
+
+/* Snapshot the process state and advance its revision if it changed.
+   *full gets a `process` frame carrying the (current) revision; *patch a
+   `process.patch` frame against the previous revision, or NULL if nothing
+   changed or there was no previous state. Returns true if it changed. */
+bool BarSocketIoBuildProcessFrames(BarApp_t *app, BarWsFrame_t **patch,
+		BarWsFrame_t **full);
+
+/* Publish a changed process state to every client through the STATE bucket:
+   a `process.patch` when the bucket is free, the full `process` otherwise.
+   Done under the revision lock, so revisions reach the bucket in order. */
+void BarSocketIoBroadcastProcess(BarApp_t *app);
+
+/* State for the web UI's first paint (webui_inline_state):
+   {"process": {..., "revision": n}, "stations": [...]} as JSON that is safe
+   inside a <script> element. Serialized again only when the process
+   revision or the station list changed. Caller must BarWsFrameUnref().
+   Returns NULL on allocation failure. */
+BarWsFrame_t *BarSocketIoSnapshotFrame(BarApp_t *app);
+
+/* The station list clients hold changed; the next snapshot rebuilds it */
+void BarSocketIoStationsChanged(void);
 
 /* Emit 'start' event (song started) */
 void BarSocketIoEmitStart(BarApp_t *app);
@@ -85,7 +148,9 @@ void BarSocketIoEmitProgress(BarApp_t *app, unsigned int elapsed,
 /* Emit 'stations' event (station list) */
 void BarSocketIoEmitStations(BarApp_t *app);
 
-/* Emit 'process' event (full state) */
+/* Emit 'process' event (full state) to the unicast target, or to everyone
+   through the STATE bucket; if a reply to one client changed the state, the
+   others get it as in BarSocketIoBroadcastProcess */
 void BarSocketIoEmitProcess(BarApp_t *app);
 
 /* Emit 'song.explanation' event (explanation text) */
@@ -104,9 +169,18 @@ void BarSocketIoEmitPlayState(BarApp_t *app);
 /* Emit 'query.upcoming.result' event (upcoming songs list) */
 void BarSocketIoEmitUpcoming(BarApp_t *app, struct PianoSong *firstSong, int maxSongs);
 
+/* Emit 'query.history.result' event (song history, newest first) */
+void BarSocketIoEmitHistory(BarApp_t *app);
+
+/* Handle 'query.history' from client (unicast response) */
+void BarSocketIoHandleQueryHistory(BarApp_t *app, void *wsi);
+
 /* Handle 'action' event from client */
 void BarSocketIoHandleAction(BarApp_t *app, const char *action, struct json_object *data, void *wsi);
 
+/* Apply a volume.set percentage (0-100) and schedule its broadcast */
+void BarSocketIoApplyVolume(BarApp_t *app, int volumePercent);
+
 /* Handle 'changeStation' event from client */
 void BarSocketIoHandleChangeStation(BarApp_t *app, const char *stationId);
 
@@ -122,6 +196,9 @@ void BarSocketIoHandleCreateStationFrom(BarApp_t *app, struct json_object *data)
 /* Handle 'query' event from client (unicast response to requesting client) */
 void BarSocketIoHandleQuery(BarApp_t *app, void *wsi);
 
+/* Handle 'station.refresh': merge a fresh station list, broadcast the delta */
+void BarSocketIoHandleRefreshStations(BarApp_t *app);
+
 /* Fetch genres and emit to client */
 void BarSocketIoHandleGetGenres(BarApp_t *app);
 void BarSocketIoEmitGenres(BarApp_t *app);
@@ -58,7 +58,7 @@ void BarWsBroadcastVolume(BarApp_t *app) {
 			volumePercent = app->settings.volume;
 		}
 		struct json_object *vol = json_object_new_int (volumePercent);
-		char *msg = BarSocketIoFormatEventMessage ("volume", vol);
+		BarWsFrame_t *msg = BarSocketIoFormatEventFrame ("volume", vol);
 		json_object_put (vol);
 		BarWebsocketBroadcastSocketIoMessage (app, BUCKET_VOLUME, msg);
 	}
@@ -87,24 +87,23 @@ void BarWsBroadcastUpcoming(BarApp_t *app, PianoSong_t *songs, int count) {
 void BarWsBroadcastSongStart(BarApp_t *app) {
 	if (app && app->settings.uiMode != BAR_UI_MODE_CLI && app->wsContext) {
 		struct json_object *data = BarSocketIoBuildStartPayload (app);
-		char *msg = BarSocketIoFormatEventMessage ("start", data);
+		BarWsFrame_t *msg = BarSocketIoFormatEventFrame ("start", data);
 		json_object_put (data);
 		BarWebsocketBroadcastSocketIoMessage (app, BUCKET_STATE, msg);
 	}
 }
 
+/* Send only what changed (process.patch) when clients can apply it; see
+ * BarSocketIoBroadcastProcess */
 void BarWsBroadcastProcess(BarApp_t *app) {
 	if (app && app->settings.uiMode != BAR_UI_MODE_CLI && app->wsContext) {
-		struct json_object *data = BarSocketIoBuildProcessPayload (app);
-		char *msg = BarSocketIoFormatEventMessage ("process", data);
-		json_object_put (data);
-		BarWebsocketBroadcastSocketIoMessage (app, BUCKET_STATE, msg);
+		BarSocketIoBroadcastProcess (app);
 	}
 }
 
 void BarWsBroadcastSongStop(BarApp_t *app) {
 	if (app && app->settings.uiMode != BAR_UI_MODE_CLI && app->wsContext) {
-		char *msg = BarSocketIoFormatEventMessage ("stop", NULL);
+		BarWsFrame_t *msg = BarSocketIoFormatEventFrame ("stop", NULL);
 		BarWebsocketBroadcastSocketIoMessage (app, BUCKET_STATE, msg);
 	}
 }
@@ -131,7 +130,7 @@ void BarWsBroadcastProgress(BarApp_t *app) {
 	json_object_object_add (data, "elapsed",    json_object_new_int ((int)elapsed));
 	json_object_object_add (data, "duration",   json_object_new_int ((int)duration));
 	json_object_object_add (data, "percentage", json_object_new_double ((double)pct));
-	char *msg = BarSocketIoFormatEventMessage ("progress", data);
+	BarWsFrame_t *msg = BarSocketIoFormatEventFrame ("progress", data);
 	json_object_put (data);
 	BarWebsocketBroadcastSocketIoMessage (app, BUCKET_PROGRESS, msg);
 }
@@ -144,13 +143,47 @@ void BarWsBroadcastPlayState(BarApp_t *app) {
 
 void BarWsBroadcastStations(BarApp_t *app) {
 	if (app && app->settings.uiMode != BAR_UI_MODE_CLI && app->wsContext) {
+		BarSocketIoStationsChanged ();
 		struct json_object *data = BarSocketIoBuildStationsPayload (app);
-		char *msg = BarSocketIoFormatEventMessage ("stations", data);
+		BarWsFrame_t *msg = BarSocketIoFormatEventFrame ("stations", data);
 		json_object_put (data);
 		BarWebsocketBroadcastSocketIoMessage (app, BUCKET_STATIONS, msg);
 	}
 }
 
+/* Deltas are only meaningful against the list clients already hold: if a
+ * stations message is still waiting in the bucket (or the list was empty
+ * before), send the full list instead. */
+void BarWsBroadcastStationsDelta(BarApp_t *app,
+		const PianoRequestDataGetStations_t *diff) {
+	if (!app || app->settings.uiMode == BAR_UI_MODE_CLI || !app->wsContext) {
+		return;
+	}
+	if (!diff) {
+		BarWsBroadcastStations (app);
+		return;
+	}
+	if (diff->addedCount == 0 && diff->changedCount == 0 &&
+			diff->removed == NULL) {
+		return;
+	}
+	if (diff->addedCount > 0 && diff->addedCount == BarStateGetStationCount (app)) {
+		BarWsBroadcastStations (app);
+		return;
+	}
+
+	BarSocketIoStationsChanged ();
+	struct json_object *data = BarSocketIoBuildStationsDeltaPayload (app, diff);
+	BarWsFrame_t *msg = data ? BarSocketIoFormatEventFrame ("stations.delta", data) : NULL;
+	json_object_put (data);
+	if (msg) {
+		msg->incremental = true; /* client queues must not coalesce it away */
+	}
+	if (!msg || !BarWebsocketOfferSocketIoMessage (app, BUCKET_STATIONS, msg)) {
+		BarWsBroadcastStations (app);
+	}
+}
+
 void BarWsDisconnectAllClients(BarApp_t *app) {
 	if (app && app->wsContext) {
 		BarWebsocketDisconnectAllClients(app);
@@ -271,7 +304,11 @@ void BarWsPrintWebInfo(const BarApp_t *app, FILE *stream) {
 	if (app->settings.webuiPath) {
 		fprintf(stream, "Web UI files: %s\n", app->settings.webuiPath);
 	} else {
+#ifdef WEBUI_EMBEDDED
 		fprintf(stream, "Web UI files: (using built-in)\n");
+#else
+		fprintf(stream, "Web UI files: ./dist/webui\n");
+#endif
 	}
 	fprintf(stream, "Web interface: http://%s:%d/\n",
 	        app->settings.websocketHost ? app->settings.websocketHost : "127.0.0.1",
@@ -324,6 +361,10 @@ void BarWsBroadcastSongStop(BarApp_t *app) { (void)app; }
 void BarWsBroadcastProgress(BarApp_t *app) { (void)app; }
 void BarWsBroadcastPlayState(BarApp_t *app) { (void)app; }
 void BarWsBroadcastStations(BarApp_t *app) { (void)app; }
+void BarWsBroadcastStationsDelta(BarApp_t *app,
+		const PianoRequestDataGetStations_t *diff) {
+	(void)app; (void)diff;
+}
 void BarWsDisconnectAllClients(BarApp_t *app) { (void)app; }
 
 bool BarWsInit(BarApp_t *app) { (void)app; return true; }
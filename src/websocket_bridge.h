@@ -47,6 +47,9 @@ void BarWsBroadcastSongStop(BarApp_t *app);
 void BarWsBroadcastProgress(BarApp_t *app);
 void BarWsBroadcastPlayState(BarApp_t *app);
 void BarWsBroadcastStations(BarApp_t *app);
+/** Emit `stations.delta` for a GET_STATIONS diff, or the full list if clients may be out of sync. */
+void BarWsBroadcastStationsDelta(BarApp_t *app,
+		const PianoRequestDataGetStations_t *diff);
 void BarWsDisconnectAllClients(BarApp_t *app);
 
 /* Lifecycle management */
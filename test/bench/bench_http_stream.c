@@ -0,0 +1,415 @@
+/*
+ * WebSocket broadcast latency while the same server sends a large web UI
+ * file to a slow HTTP client.
+ *
+ * Writes a 5 MB asset into a temporary webui_path, starts the server on
+ * 127.0.0.1 with one service thread and connects a few "socketio" clients.
+ * An emitter broadcasts a timestamped event every few milliseconds; each
+ * client records how long it took to arrive. Halfway through, a client
+ * with a small receive buffer downloads the asset at a throttled rate:
+ *
+ *   idle       broadcast latency before the download
+ *   download   broadcast latency while it runs
+ *
+ * File bodies go out one chunk per writeable callback, so the download
+ * only occupies the service thread while its socket takes data. The run
+ * fails if the download is incomplete or the latency during it exceeds
+ * the limit (-l).
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <libwebsockets.h>
+#include <json-c/json.h>
+
+#include "../../src/main.h"
+#include "../../src/settings.h"
+#include "../../src/bar_state.h"
+#include "../../src/websocket/core/websocket.h"
+#include "../../src/websocket/protocol/socketio.h"
+
+/* provided by main.c / test_main.c in the other binaries */
+sig_atomic_t *interrupted = NULL;
+
+void BarMainGetPlaylist (BarApp_t *app) {
+	(void) app;
+}
+
+void BarMainStartPlayback (BarApp_t *app, pthread_t *playerThread) {
+	(void) app;
+	(void) playerThread;
+}
+
+#define BENCH_ASSET "/assets/bundle-Ab12Cd34.js"
+#define BENCH_EMIT_INTERVAL_US 5000
+#define BENCH_IDLE_US 1000000
+#define BENCH_TIMEOUT_NS (60ull * 1000000000ull)
+
+typedef struct {
+	unsigned int clients, port, rateKb, limitMs;
+	size_t size;
+} BenchOpts_t;
+
+/* broadcast latency of one phase */
+typedef struct {
+	atomic_ulong count, sumUs, maxUs;
+} BenchLatency_t;
+
+static atomic_uint benchConnected, benchFailed;
+static atomic_bool benchStop, benchDownloading;
+static BenchLatency_t benchIdle, benchDownload;
+
+static uint64_t benchNow (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static void benchRecord (BenchLatency_t *l, unsigned long us) {
+	atomic_fetch_add (&l->count, 1);
+	atomic_fetch_add (&l->sumUs, us);
+	unsigned long max = atomic_load (&l->maxUs);
+	while (us > max && !atomic_compare_exchange_weak (&l->maxUs, &max, us)) {
+	}
+}
+
+static int benchClientCallback (struct lws *wsi,
+		enum lws_callback_reasons reason, void *user, void *in, size_t len) {
+	(void) wsi;
+	(void) user;
+	char buf[256];
+
+	switch ((int) reason) {
+		case LWS_CALLBACK_CLIENT_ESTABLISHED:
+			atomic_fetch_add (&benchConnected, 1);
+			break;
+
+		case LWS_CALLBACK_CLIENT_RECEIVE: {
+			/* 2[ "bench", { "t": <ns> } ]; other events are larger */
+			if (len >= sizeof (buf)) {
+				break;
+			}
+			memcpy (buf, in, len);
+			buf[len] = '\0';
+			const char *t = strstr (buf, "\"t\":");
+			if (strncmp (buf, "2[ \"bench\"", 10) != 0 || t == NULL) {
+				break;
+			}
+			const uint64_t sent = strtoull (t + 4, NULL, 10);
+			const unsigned long us = (unsigned long) ((benchNow () - sent) / 1000);
+			benchRecord (atomic_load (&benchDownloading) ? &benchDownload :
+					&benchIdle, us);
+			break;
+		}
+
+		case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+		case LWS_CALLBACK_CLIENT_CLOSED:
+			atomic_fetch_add (&benchFailed, 1);
+			break;
+
+		default:
+			break;
+	}
+	return 0;
+}
+
+static const struct lws_protocols benchProtocols[] = {
+	{"socketio", benchClientCallback, 0, 0, 0, NULL, 0},
+	{NULL, NULL, 0, 0, 0, NULL, 0},
+};
+
+static void *benchClientThread (void *arg) {
+	struct lws_context *context = arg;
+	while (!atomic_load (&benchStop)) {
+		lws_service (context, 10);
+	}
+	return NULL;
+}
+
+static void *benchEmitThread (void *arg) {
+	(void) arg;
+	while (!atomic_load (&benchStop)) {
+		json_object *data = json_object_new_object ();
+		json_object_object_add (data, "t",
+				json_object_new_int64 ((int64_t) benchNow ()));
+		BarSocketIoEmit ("bench", data);
+		json_object_put (data);
+		usleep (BENCH_EMIT_INTERVAL_US);
+	}
+	return NULL;
+}
+
+/*	download the asset through a small receive buffer at rateKb KiB/s
+ *	@return body bytes received
+ */
+static size_t benchDownloadAsset (const BenchOpts_t *o, uint64_t *elapsedNs) {
+	const int fd = socket (AF_INET, SOCK_STREAM, 0);
+	const int rcvbuf = 16384;
+	struct sockaddr_in addr;
+	char buf[4097];
+	size_t total = 0, body = 0;
+	bool headers = false;
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons ((uint16_t) o->port);
+	addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+	if (fd >= 0) {
+		setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf));
+	}
+	if (fd < 0 || connect (fd, (struct sockaddr *) &addr, sizeof (addr)) != 0) {
+		if (fd >= 0) {
+			close (fd);
+		}
+		return 0;
+	}
+
+	const char request[] = "GET " BENCH_ASSET " HTTP/1.1\r\n"
+			"Host: 127.0.0.1\r\nAccept-Encoding: identity\r\n"
+			"Connection: close\r\n\r\n";
+	if (write (fd, request, sizeof (request) - 1) != sizeof (request) - 1) {
+		close (fd);
+		return 0;
+	}
+
+	const uint64_t start = benchNow ();
+	const uint64_t deadline = start + BENCH_TIMEOUT_NS;
+	/* read at most rateKb KiB per second, 4 KiB at a time */
+	const uint64_t nsPerRead = 4ull * 1000000000ull / o->rateKb;
+	ssize_t n;
+	while (body < o->size && benchNow () < deadline &&
+			(n = read (fd, buf, 4096)) > 0) {
+		total += (size_t) n;
+		if (!headers) {
+			/* the headers fit in the first reads */
+			buf[n] = '\0';
+			const char *end = strstr (buf, "\r\n\r\n");
+			if (end != NULL) {
+				headers = true;
+				body = (size_t) n - (size_t) (end + 4 - buf);
+			}
+		} else {
+			body += (size_t) n;
+		}
+		const uint64_t due = start + (total / 4096) * nsPerRead;
+		const uint64_t now = benchNow ();
+		if (due > now) {
+			usleep ((useconds_t) ((due - now) / 1000));
+		}
+	}
+	*elapsedNs = benchNow () - start;
+	close (fd);
+	return body;
+}
+
+static bool benchWriteAsset (const char *dir, size_t size) {
+	char path[512];
+	snprintf (path, sizeof (path), "%s/assets", dir);
+	if (mkdir (path, 0700) != 0) {
+		return false;
+	}
+	snprintf (path, sizeof (path), "%s%s", dir, BENCH_ASSET);
+	FILE *fp = fopen (path, "wb");
+	if (fp == NULL) {
+		return false;
+	}
+	for (size_t i = 0; i < size; i++) {
+		fputc ('a' + (int) (i % 26), fp);
+	}
+	fclose (fp);
+	snprintf (path, sizeof (path), "%s/index.html", dir);
+	fp = fopen (path, "wb");
+	if (fp == NULL) {
+		return false;
+	}
+	fputs ("<!doctype html><title>bench</title>", fp);
+	fclose (fp);
+	return true;
+}
+
+static void benchPrint (const char *phase, BenchLatency_t *l) {
+	const unsigned long count = atomic_load (&l->count);
+	printf ("%-9s %8lu %10.2f %10.2f\n", phase, count,
+			count ? (double) atomic_load (&l->sumUs) / (double) count / 1000.0 : 0.0,
+			(double) atomic_load (&l->maxUs) / 1000.0);
+}
+
+static void usage (const char *argv0) {
+	fprintf (stderr, "usage: %s [-c clients] [-s bytes] [-r KiB/s] "
+			"[-l max ms] [-p port]\n", argv0);
+}
+
+int main (int argc, char **argv) {
+	BenchOpts_t o = {
+		.clients = 8,
+		.port = 18098,
+		.rateKb = 1024,
+		.limitMs = 200,
+		.size = 5u * 1024u * 1024u,
+	};
+	int opt;
+
+	while ((opt = getopt (argc, argv, "c:s:r:l:p:h")) != -1) {
+		switch (opt) {
+			case 'c':
+				o.clients = (unsigned int) strtoul (optarg, NULL, 10);
+				break;
+
+			case 's':
+				o.size = strtoul (optarg, NULL, 10);
+				break;
+
+			case 'r':
+				o.rateKb = (unsigned int) strtoul (optarg, NULL, 10);
+				break;
+
+			case 'l':
+				o.limitMs = (unsigned int) strtoul (optarg, NULL, 10);
+				break;
+
+			case 'p':
+				o.port = (unsigned int) strtoul (optarg, NULL, 10);
+				break;
+
+			default:
+				usage (argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (o.clients == 0 || o.rateKb == 0 || o.size == 0) {
+		usage (argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	char dir[] = "/tmp/pianobar-bench-XXXXXX";
+	if (mkdtemp (dir) == NULL || !benchWriteAsset (dir, o.size)) {
+		fprintf (stderr, "cannot create web UI in %s\n", dir);
+		return EXIT_FAILURE;
+	}
+
+	lws_set_log_level (LLL_ERR, NULL);
+	BarApp_t app;
+	memset (&app, 0, sizeof (app));
+	BarSettingsInit (&app.settings);
+	app.settings.uiMode = BAR_UI_MODE_WEB;
+	app.settings.volumeMode = BAR_VOLUME_MODE_PLAYER;
+	app.settings.websocketPort = (int) o.port;
+	free (app.settings.websocketHost);
+	app.settings.websocketHost = strdup ("127.0.0.1");
+	app.settings.websocketThreads = 1;
+	app.settings.websocketCompression = BAR_WS_COMPRESSION_OFF;
+	free (app.settings.webuiPath);
+	app.settings.webuiPath = strdup (dir);
+	BarStateInit (&app);
+	pthread_mutex_init (&app.player.lock, NULL);
+	pthread_cond_init (&app.player.cond, NULL);
+
+	bool ok = false;
+	pthread_t clientThread, emitThread;
+	bool clientRunning = false, emitRunning = false;
+	struct lws_context *context = NULL;
+
+	if (!BarWebsocketInit (&app)) {
+		fprintf (stderr, "cannot start server on port %u\n", o.port);
+		goto out;
+	}
+
+	struct lws_context_creation_info info;
+	memset (&info, 0, sizeof (info));
+	info.port = CONTEXT_PORT_NO_LISTEN;
+	info.protocols = benchProtocols;
+	context = lws_create_context (&info);
+	if (context == NULL) {
+		fprintf (stderr, "cannot create client context\n");
+		goto out;
+	}
+	for (unsigned int i = 0; i < o.clients; i++) {
+		struct lws_client_connect_info ci;
+		memset (&ci, 0, sizeof (ci));
+		ci.context = context;
+		ci.address = "127.0.0.1";
+		ci.port = (int) o.port;
+		ci.path = "/";
+		ci.host = ci.address;
+		ci.origin = ci.address;
+		ci.protocol = "socketio";
+		if (lws_client_connect_via_info (&ci) == NULL) {
+			atomic_fetch_add (&benchFailed, 1);
+		}
+	}
+	clientRunning = pthread_create (&clientThread, NULL, benchClientThread,
+			context) == 0;
+
+	const uint64_t connectDeadline = benchNow () + BENCH_TIMEOUT_NS;
+	while (atomic_load (&benchConnected) < o.clients) {
+		if (!clientRunning || atomic_load (&benchFailed) > 0 ||
+				benchNow () > connectDeadline) {
+			fprintf (stderr, "%u of %u clients connected\n",
+					atomic_load (&benchConnected), o.clients);
+			goto out;
+		}
+		usleep (1000);
+	}
+	/* let the process state sent on connect go out first */
+	usleep (100000);
+
+	emitRunning = pthread_create (&emitThread, NULL, benchEmitThread, NULL) == 0;
+	usleep (BENCH_IDLE_US);
+
+	atomic_store (&benchDownloading, true);
+	uint64_t elapsed = 0;
+	const size_t received = benchDownloadAsset (&o, &elapsed);
+	atomic_store (&benchDownloading, false);
+
+	printf ("%u clients, %zu byte asset at %u KiB/s\n", o.clients, o.size,
+			o.rateKb);
+	printf ("%-9s %8s %10s %10s\n", "phase", "events", "avg ms", "max ms");
+	benchPrint ("idle", &benchIdle);
+	benchPrint ("download", &benchDownload);
+	printf ("download: %zu of %zu bytes in %.2f s\n", received, o.size,
+			(double) elapsed / 1e9);
+
+	ok = received == o.size && atomic_load (&benchDownload.count) > 0 &&
+			atomic_load (&benchDownload.maxUs) <= o.limitMs * 1000ul;
+	if (!ok) {
+		fprintf (stderr, "FAIL: incomplete download or latency above %u ms\n",
+				o.limitMs);
+	}
+
+out:
+	atomic_store (&benchStop, true);
+	if (emitRunning) {
+		pthread_join (emitThread, NULL);
+	}
+	if (clientRunning) {
+		lws_cancel_service (context);
+		pthread_join (clientThread, NULL);
+	}
+	if (context != NULL) {
+		lws_context_destroy (context);
+	}
+	BarWebsocketDestroy (&app);
+	pthread_cond_destroy (&app.player.cond);
+	pthread_mutex_destroy (&app.player.lock);
+	BarStateDestroy (&app);
+	BarSettingsDestroy (&app.settings);
+
+	char cmd[600];
+	snprintf (cmd, sizeof (cmd), "rm -rf '%s'", dir);
+	if (system (cmd) != 0) {
+		fprintf (stderr, "cannot remove %s\n", dir);
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,559 @@
+/*
+ * Micro-benchmarks for libpiano: request serialization + encryption,
+ * PianoDecryptString and PianoResponse parsing, driven by recorded API
+ * responses in test/fixtures/libpiano.
+ *
+ * Reports ns/op, allocations/op, bytes allocated/op and peak live heap per op.
+ * With -c the results are compared against a baseline previously written
+ * with -s (see `make bench` / `make bench-baseline`).
+ *
+ * Allocation counters interpose malloc and friends; they are only available
+ * with glibc and are reported as "-" elsewhere.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <piano.h>
+#include <piano_private.h>
+#include <crypt.h>
+
+/* Pandora android partner, matches the defaults in settings.c */
+#define BENCH_PARTNER_USER "android"
+#define BENCH_PARTNER_PASSWORD "AC7IBG09A3DTSYM4R41UJWL07VLN8JI7"
+#define BENCH_PARTNER_DEVICE "android-generic"
+#define BENCH_PARTNER_INKEY "R=U!LH$O2B#"
+#define BENCH_PARTNER_OUTKEY "6#26FRL$ZWD"
+
+#define BENCH_MAX_RESULTS 64
+
+/* allocation accounting */
+static struct {
+	uint64_t count, bytes;
+	int64_t live, peak;
+} allocStats;
+
+#ifdef __GLIBC__
+#define BENCH_HAVE_ALLOC_STATS 1
+
+extern void *__libc_malloc (size_t);
+extern void *__libc_calloc (size_t, size_t);
+extern void *__libc_realloc (void *, size_t);
+extern void __libc_free (void *);
+
+static void benchAccountAlloc (void *p) {
+	if (p != NULL) {
+		const size_t size = malloc_usable_size (p);
+		++allocStats.count;
+		allocStats.bytes += size;
+		allocStats.live += size;
+		if (allocStats.live > allocStats.peak) {
+			allocStats.peak = allocStats.live;
+		}
+	}
+}
+
+static void benchAccountFree (void *p) {
+	if (p != NULL) {
+		allocStats.live -= malloc_usable_size (p);
+	}
+}
+
+void *malloc (size_t size) {
+	void *p = __libc_malloc (size);
+	benchAccountAlloc (p);
+	return p;
+}
+
+void *calloc (size_t n, size_t size) {
+	void *p = __libc_calloc (n, size);
+	benchAccountAlloc (p);
+	return p;
+}
+
+void *realloc (void *old, size_t size) {
+	benchAccountFree (old);
+	void *p = __libc_realloc (old, size);
+	if (p == NULL && old != NULL && size != 0) {
+		/* old block is still valid */
+		allocStats.live += malloc_usable_size (old);
+	}
+	benchAccountAlloc (p);
+	return p;
+}
+
+void free (void *p) {
+	benchAccountFree (p);
+	__libc_free (p);
+}
+#else
+#define BENCH_HAVE_ALLOC_STATS 0
+#endif
+
+typedef struct {
+	const char *fixtureDir;
+	PianoHandle_t ph;
+	PianoRequest_t req;
+	char *fixture;
+	char *blob;
+	union {
+		PianoRequestDataLogin_t login;
+		PianoRequestDataGetPlaylist_t playlist;
+		PianoRequestDataSearch_t search;
+	} data;
+	PianoStation_t station;
+} BenchCtx_t;
+
+typedef struct {
+	const char *name;
+	/* fixture file or NULL */
+	const char *fixture;
+	bool (*setup) (BenchCtx_t *);
+	void (*op) (BenchCtx_t *);
+} BenchCase_t;
+
+typedef struct {
+	char name[64];
+	double nsPerOp, allocsPerOp, bytesPerOp, peakPerOp;
+} BenchResult_t;
+
+static char *benchReadFile (const char *dir, const char *name) {
+	char path[1024];
+	snprintf (path, sizeof (path), "%s/%s", dir, name);
+
+	FILE *fp = fopen (path, "r");
+	if (fp == NULL) {
+		fprintf (stderr, "bench: cannot open %s: %s\n", path, strerror (errno));
+		return NULL;
+	}
+	fseek (fp, 0, SEEK_END);
+	const long size = ftell (fp);
+	rewind (fp);
+	char *buf = malloc ((size_t) size + 1);
+	if (buf != NULL) {
+		buf[fread (buf, 1, (size_t) size, fp)] = '\0';
+	}
+	fclose (fp);
+	return buf;
+}
+
+static uint64_t benchNow (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static void benchDestroyStations (PianoHandle_t *ph) {
+	while (ph->stations != NULL) {
+		PianoStation_t *s = ph->stations;
+		ph->stations = (PianoStation_t *) s->head.next;
+		PianoDestroyStation (s);
+		free (s);
+	}
+}
+
+static bool benchInitHandle (BenchCtx_t *ctx) {
+	return PianoInit (&ctx->ph, BENCH_PARTNER_USER, BENCH_PARTNER_PASSWORD,
+			BENCH_PARTNER_DEVICE, BENCH_PARTNER_INKEY,
+			BENCH_PARTNER_OUTKEY) == PIANO_RET_OK;
+}
+
+/* logged-in handle as after a successful auth.userLogin */
+static bool benchSetupLoggedIn (BenchCtx_t *ctx) {
+	if (!benchInitHandle (ctx)) {
+		return false;
+	}
+	ctx->ph.partner.authToken = strdup ("VAzrFQTtsy3BQ3K+3BqEbaSo8KTZ8a0mi1");
+	ctx->ph.partner.id = 42;
+	ctx->ph.user.listenerId = strdup ("272241281");
+	ctx->ph.user.authToken = strdup (
+			"XXLuWXlMTFPh0b+jxJaDTmaxOcvWdQSpy5ZBybJtrvNiKKzXm3f5uKww==");
+	return true;
+}
+
+/* --- request construction + encryption --- */
+
+static void benchRequestRun (BenchCtx_t *ctx, PianoRequestType_t type,
+		void *data) {
+	memset (&ctx->req, 0, sizeof (ctx->req));
+	ctx->req.data = data;
+	if (PianoRequest (&ctx->ph, &ctx->req, type) != PIANO_RET_OK) {
+		abort ();
+	}
+	PianoDestroyRequest (&ctx->req);
+}
+
+static bool benchSetupRequestLogin (BenchCtx_t *ctx) {
+	if (!benchSetupLoggedIn (ctx)) {
+		return false;
+	}
+	ctx->data.login.user = (char *) "user@example.com";
+	ctx->data.login.password = (char *) "correct horse battery staple";
+	ctx->data.login.step = 1;
+	return true;
+}
+
+static void benchRequestLogin (BenchCtx_t *ctx) {
+	benchRequestRun (ctx, PIANO_REQUEST_LOGIN, &ctx->data.login);
+}
+
+static bool benchSetupRequestPlaylist (BenchCtx_t *ctx) {
+	if (!benchSetupLoggedIn (ctx)) {
+		return false;
+	}
+	ctx->station.id = (char *) "4000000000000000001";
+	ctx->data.playlist.station = &ctx->station;
+	ctx->data.playlist.quality = PIANO_AQ_HIGH;
+	return true;
+}
+
+static void benchRequestPlaylist (BenchCtx_t *ctx) {
+	benchRequestRun (ctx, PIANO_REQUEST_GET_PLAYLIST, &ctx->data.playlist);
+}
+
+static bool benchSetupRequestQuickmix (BenchCtx_t *ctx) {
+	if (!benchSetupLoggedIn (ctx)) {
+		return false;
+	}
+	memset (&ctx->req, 0, sizeof (ctx->req));
+	ctx->req.type = PIANO_REQUEST_GET_STATIONS;
+	ctx->req.responseData = ctx->fixture;
+	return PianoResponse (&ctx->ph, &ctx->req) == PIANO_RET_OK;
+}
+
+static void benchRequestQuickmix (BenchCtx_t *ctx) {
+	benchRequestRun (ctx, PIANO_REQUEST_SET_QUICKMIX, NULL);
+}
+
+/* --- decryption --- */
+
+static bool benchSetupDecryptSyncTime (BenchCtx_t *ctx) {
+	if (!benchInitHandle (ctx)) {
+		return false;
+	}
+	ctx->blob = strdup ("dc6dcf3b686a7fd539ea25e9fa05bff1");
+	return ctx->blob != NULL;
+}
+
+static bool benchSetupDecrypt4k (BenchCtx_t *ctx) {
+	if (!benchInitHandle (ctx)) {
+		return false;
+	}
+	char plain[4096];
+	for (size_t i = 0; i < sizeof (plain) - 1; i++) {
+		plain[i] = 'a' + (char) (i % 26);
+	}
+	plain[sizeof (plain) - 1] = '\0';
+	ctx->blob = PianoEncryptString (ctx->ph.partner.in, plain);
+	return ctx->blob != NULL;
+}
+
+static void benchDecrypt (BenchCtx_t *ctx) {
+	size_t len;
+	char *s = PianoDecryptString (ctx->ph.partner.in, ctx->blob, &len);
+	if (s == NULL) {
+		abort ();
+	}
+	free (s);
+}
+
+/* --- response parsing --- */
+
+static void benchResponseRun (BenchCtx_t *ctx, PianoRequestType_t type,
+		void *data, PianoReturn_t expect) {
+	memset (&ctx->req, 0, sizeof (ctx->req));
+	ctx->req.type = type;
+	ctx->req.data = data;
+	ctx->req.responseData = ctx->fixture;
+	if (PianoResponse (&ctx->ph, &ctx->req) != expect) {
+		abort ();
+	}
+}
+
+static bool benchSetupResponse (BenchCtx_t *ctx) {
+	memset (&ctx->ph, 0, sizeof (ctx->ph));
+	return true;
+}
+
+static void benchResponseLoginPartner (BenchCtx_t *ctx) {
+	ctx->data.login.step = 0;
+	benchResponseRun (ctx, PIANO_REQUEST_LOGIN, &ctx->data.login,
+			PIANO_RET_CONTINUE_REQUEST);
+	free (ctx->ph.partner.authToken);
+	ctx->ph.partner.authToken = NULL;
+}
+
+static void benchResponseLoginUser (BenchCtx_t *ctx) {
+	ctx->data.login.step = 1;
+	benchResponseRun (ctx, PIANO_REQUEST_LOGIN, &ctx->data.login,
+			PIANO_RET_OK);
+	PianoDestroyUserInfo (&ctx->ph.user);
+	memset (&ctx->ph.user, 0, sizeof (ctx->ph.user));
+}
+
+static void benchResponseStations (BenchCtx_t *ctx) {
+	benchResponseRun (ctx, PIANO_REQUEST_GET_STATIONS, NULL, PIANO_RET_OK);
+	benchDestroyStations (&ctx->ph);
+}
+
+static void benchResponsePlaylist (BenchCtx_t *ctx) {
+	ctx->data.playlist.quality = PIANO_AQ_HIGH;
+	benchResponseRun (ctx, PIANO_REQUEST_GET_PLAYLIST, &ctx->data.playlist,
+			PIANO_RET_OK);
+	PianoDestroyPlaylist (ctx->data.playlist.retPlaylist);
+}
+
+static void benchResponseSearch (BenchCtx_t *ctx) {
+	benchResponseRun (ctx, PIANO_REQUEST_SEARCH, &ctx->data.search,
+			PIANO_RET_OK);
+	PianoDestroySearchResult (&ctx->data.search.searchResult);
+}
+
+static void benchResponseGenres (BenchCtx_t *ctx) {
+	benchResponseRun (ctx, PIANO_REQUEST_GET_GENRE_STATIONS, NULL,
+			PIANO_RET_OK);
+	PianoDestroy (&ctx->ph);
+}
+
+static const BenchCase_t benchCases[] = {
+	{"request/login", NULL, benchSetupRequestLogin, benchRequestLogin},
+	{"request/get_playlist", NULL, benchSetupRequestPlaylist,
+			benchRequestPlaylist},
+	{"request/set_quickmix_250", "stations_250.json",
+			benchSetupRequestQuickmix, benchRequestQuickmix},
+	{"decrypt/sync_time", NULL, benchSetupDecryptSyncTime, benchDecrypt},
+	{"decrypt/4k", NULL, benchSetupDecrypt4k, benchDecrypt},
+	{"response/login_partner", "login_partner.json", benchInitHandle,
+			benchResponseLoginPartner},
+	{"response/login_user", "login_user.json", benchSetupResponse,
+			benchResponseLoginUser},
+	{"response/get_stations_100", "stations_100.json", benchSetupResponse,
+			benchResponseStations},
+	{"response/get_stations_250", "stations_250.json", benchSetupResponse,
+			benchResponseStations},
+	{"response/get_playlist", "playlist.json", benchSetupResponse,
+			benchResponsePlaylist},
+	{"response/search", "search.json", benchSetupResponse,
+			benchResponseSearch},
+	{"response/genres", "genres.json", benchSetupResponse,
+			benchResponseGenres},
+};
+
+/*	run one case until it has taken at least minNs
+ *	@return false if setup failed
+ */
+static bool benchRun (const BenchCase_t *bc, const char *fixtureDir,
+		uint64_t minNs, BenchResult_t *res) {
+	BenchCtx_t ctx;
+	memset (&ctx, 0, sizeof (ctx));
+	ctx.fixtureDir = fixtureDir;
+
+	if (bc->fixture != NULL &&
+			(ctx.fixture = benchReadFile (fixtureDir, bc->fixture)) == NULL) {
+		return false;
+	}
+	if (!bc->setup (&ctx)) {
+		fprintf (stderr, "bench: setup for %s failed\n", bc->name);
+		free (ctx.fixture);
+		return false;
+	}
+
+	/* warm up caches and lazily grown buffers */
+	bc->op (&ctx);
+
+	uint64_t n = 1, elapsed = 0;
+	while (true) {
+		const uint64_t allocsBefore = allocStats.count;
+		const uint64_t bytesBefore = allocStats.bytes;
+		allocStats.peak = allocStats.live;
+		const int64_t liveBefore = allocStats.live;
+
+		const uint64_t start = benchNow ();
+		for (uint64_t i = 0; i < n; i++) {
+			bc->op (&ctx);
+		}
+		elapsed = benchNow () - start;
+
+		if (elapsed >= minNs || n >= (1ull << 32)) {
+			res->nsPerOp = (double) elapsed / (double) n;
+			res->allocsPerOp = (double) (allocStats.count - allocsBefore) /
+					(double) n;
+			res->bytesPerOp = (double) (allocStats.bytes - bytesBefore) /
+					(double) n;
+			res->peakPerOp = (double) (allocStats.peak - liveBefore);
+			break;
+		}
+
+		/* aim for 1.2 * minNs based on the last round */
+		uint64_t next = elapsed == 0 ? n * 100 :
+				(uint64_t) ((double) n * 1.2 * (double) minNs /
+				(double) elapsed);
+		if (next <= n) {
+			next = n + 1;
+		} else if (next > n * 100) {
+			next = n * 100;
+		}
+		n = next;
+	}
+	snprintf (res->name, sizeof (res->name), "%s", bc->name);
+
+	free (ctx.blob);
+	free (ctx.fixture);
+	PianoDestroy (&ctx.ph);
+	return true;
+}
+
+static size_t benchLoadBaseline (const char *path, BenchResult_t *base,
+		size_t max) {
+	FILE *fp = fopen (path, "r");
+	if (fp == NULL) {
+		fprintf (stderr, "bench: no baseline at %s (create one with -s)\n",
+				path);
+		return 0;
+	}
+
+	size_t count = 0;
+	char line[256];
+	while (count < max && fgets (line, sizeof (line), fp) != NULL) {
+		BenchResult_t *r = &base[count];
+		if (line[0] == '#') {
+			continue;
+		}
+		if (sscanf (line, "%63s %lf %lf %lf %lf", r->name, &r->nsPerOp,
+				&r->allocsPerOp, &r->bytesPerOp, &r->peakPerOp) == 5) {
+			++count;
+		}
+	}
+	fclose (fp);
+	return count;
+}
+
+static const BenchResult_t *benchFindBaseline (const BenchResult_t *base,
+		size_t count, const char *name) {
+	for (size_t i = 0; i < count; i++) {
+		if (strcmp (base[i].name, name) == 0) {
+			return &base[i];
+		}
+	}
+	return NULL;
+}
+
+static void benchPrintDelta (double now, double then) {
+	if (then > 0.0) {
+		printf (" %+7.1f%%", (now - then) * 100.0 / then);
+	} else if (now == then) {
+		printf (" %8s", "=");
+	} else {
+		printf (" %8s", "new");
+	}
+}
+
+static void usage (const char *argv0) {
+	fprintf (stderr, "usage: %s [-d fixturedir] [-t ms] [-c baseline] "
+			"[-s baseline] [filter]\n", argv0);
+}
+
+int main (int argc, char **argv) {
+	const char *fixtureDir = "test/fixtures/libpiano";
+	const char *comparePath = NULL, *savePath = NULL;
+	unsigned long minMs = 500;
+	int opt;
+
+	while ((opt = getopt (argc, argv, "d:t:c:s:h")) != -1) {
+		switch (opt) {
+			case 'd':
+				fixtureDir = optarg;
+				break;
+
+			case 't':
+				minMs = strtoul (optarg, NULL, 10);
+				break;
+
+			case 'c':
+				comparePath = optarg;
+				break;
+
+			case 's':
+				savePath = optarg;
+				break;
+
+			default:
+				usage (argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	const char *filter = optind < argc ? argv[optind] : NULL;
+
+	gcry_check_version (NULL);
+
+	BenchResult_t base[BENCH_MAX_RESULTS];
+	size_t baseCount = 0;
+	if (comparePath != NULL) {
+		baseCount = benchLoadBaseline (comparePath, base, BENCH_MAX_RESULTS);
+	}
+
+	FILE *save = NULL;
+	if (savePath != NULL) {
+		if ((save = fopen (savePath, "w")) == NULL) {
+			fprintf (stderr, "bench: cannot write %s: %s\n", savePath,
+					strerror (errno));
+			return EXIT_FAILURE;
+		}
+		fprintf (save, "# name ns/op allocs/op bytes/op peak-bytes/op\n");
+	}
+
+	printf ("%-28s %12s %10s %10s %10s", "benchmark", "ns/op", "allocs/op",
+			"B/op", "peak B/op");
+	if (baseCount > 0) {
+		printf (" %8s %8s", "vs ns", "vs alloc");
+	}
+	printf ("\n");
+
+	int ret = EXIT_SUCCESS;
+	for (size_t i = 0; i < sizeof (benchCases) / sizeof (*benchCases); i++) {
+		const BenchCase_t *bc = &benchCases[i];
+		if (filter != NULL && strstr (bc->name, filter) == NULL) {
+			continue;
+		}
+
+		BenchResult_t res;
+		if (!benchRun (bc, fixtureDir, (uint64_t) minMs * 1000000ull, &res)) {
+			ret = EXIT_FAILURE;
+			continue;
+		}
+
+		printf ("%-28s %12.0f", res.name, res.nsPerOp);
+		if (BENCH_HAVE_ALLOC_STATS) {
+			printf (" %10.1f %10.0f %10.0f", res.allocsPerOp, res.bytesPerOp,
+					res.peakPerOp);
+		} else {
+			printf (" %10s %10s %10s", "-", "-", "-");
+		}
+		const BenchResult_t *b = benchFindBaseline (base, baseCount, res.name);
+		if (b != NULL) {
+			benchPrintDelta (res.nsPerOp, b->nsPerOp);
+			benchPrintDelta (res.allocsPerOp, b->allocsPerOp);
+		}
+		printf ("\n");
+		fflush (stdout);
+
+		if (save != NULL) {
+			fprintf (save, "%s %.1f %.2f %.1f %.1f\n", res.name, res.nsPerOp,
+					res.allocsPerOp, res.bytesPerOp, res.peakPerOp);
+		}
+	}
+
+	if (save != NULL) {
+		fclose (save);
+	}
+	return ret;
+}
@@ -0,0 +1,239 @@
+/*
+ * Micro-benchmarks for the Socket.IO wire encodings: JSON text frames as
+ * sent to "socketio" clients against MessagePack binary frames for
+ * "socketio.msgpack" ones, for the process, stations and progress events.
+ *
+ * For each event and encoding it measures what the server pays to produce
+ * a frame and what a client pays to decode it, and reports the frame size:
+ *
+ *   json/format       json-c serialization, as BarSocketIoFormatEventFrame
+ *   json/parse        json_tokener_parse of the frame (client decode)
+ *   msgpack/encode    BarMsgpackFrame from json-c, what formatting an event
+ *                     costs extra while a MessagePack client is connected
+ *   msgpack/text      BarMsgpackFrameFromText, the fallback for frames
+ *                     formatted before that client connected
+ *   msgpack/decode    BarMsgpackDecode of the frame (client decode)
+ *
+ * Client decode numbers use json-c on both sides, so they compare the wire
+ * formats rather than any particular client library.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <json-c/json.h>
+
+#include "../../src/websocket/protocol/msgpack.h"
+
+typedef struct {
+	json_object *arr;         /* ["event", data] */
+	BarWsFrame_t *text;       /* 2["event",data] */
+	BarWsFrame_t *packed;
+} BenchCtx_t;
+
+typedef struct {
+	const char *name;
+	json_object *(*payload) (void);
+	size_t (*op) (BenchCtx_t *);
+} BenchCase_t;
+
+static uint64_t benchNow (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+/* payloads shaped like what socketio.c builds (see WEBSOCKET_API.md) */
+static json_object *benchPayloadProcess (void) {
+	return json_tokener_parse ("[\"process\",{"
+			"\"playing\":true,\"paused\":false,\"volume\":65,\"maxGain\":10,"
+			"\"station\":\"Today's Hits Radio\","
+			"\"stationId\":\"3914377188324099182\",\"elapsed\":45,"
+			"\"song\":{\"title\":\"Blinding Lights\",\"artist\":\"The Weeknd\","
+			"\"album\":\"After Hours\",\"coverArt\":\"https://content-images."
+			"p-cdn.com/images/2f/4b/ae/5e/5cb84ba6b5e4c1e57d1e5f82/_500W_500H"
+			".jpg\",\"rating\":1,\"duration\":200,\"trackToken\":"
+			"\"S1234567a6b3c9d0e1f2a3b4c5d6e7f8\",\"songStationName\":"
+			"\"Today's Hits Radio\"},"
+			"\"current_account\":{\"id\":\"work\",\"label\":\"Work\"},"
+			"\"accounts\":[{\"id\":\"default\",\"label\":\"Home\"},"
+			"{\"id\":\"work\",\"label\":\"Work\"}],\"revision\":1234}]");
+}
+
+static json_object *benchPayloadStations (size_t count) {
+	json_object *list = json_object_new_array ();
+	char id[32], name[64];
+
+	for (size_t i = 0; i < count; i++) {
+		json_object *st = json_object_new_object ();
+		snprintf (id, sizeof (id), "%019llu",
+				4100000000000000000ull + i * 7919);
+		snprintf (name, sizeof (name), "Station %zu Radio", i);
+		json_object_object_add (st, "id", json_object_new_string (id));
+		json_object_object_add (st, "name", json_object_new_string (name));
+		json_object_object_add (st, "isQuickMix",
+				json_object_new_boolean (i == 0));
+		json_object_object_add (st, "isQuickMixed",
+				json_object_new_boolean (i % 3 == 0));
+		json_object_array_add (list, st);
+	}
+	json_object *arr = json_object_new_array ();
+	json_object_array_add (arr, json_object_new_string ("stations"));
+	json_object_array_add (arr, list);
+	return arr;
+}
+
+static json_object *benchPayloadStations100 (void) {
+	return benchPayloadStations (100);
+}
+
+static json_object *benchPayloadStations250 (void) {
+	return benchPayloadStations (250);
+}
+
+static json_object *benchPayloadProgress (void) {
+	return json_tokener_parse ("[\"progress\",{\"elapsed\":42,"
+			"\"duration\":240,\"percentage\":17}]");
+}
+
+static BarWsFrame_t *benchFormatText (json_object *arr) {
+	size_t len;
+	const char *json = json_object_to_json_string_length (arr,
+			JSON_C_TO_STRING_SPACED, &len);
+	BarWsFrame_t *frame = BarWsFrameNew (len + 1);
+	unsigned char *payload = BarWsFramePayload (frame);
+	payload[0] = '2';
+	memcpy (payload + 1, json, len);
+	return frame;
+}
+
+static size_t benchJsonFormat (BenchCtx_t *ctx) {
+	/* json-c serializes again on every call, reusing its print buffer */
+	BarWsFrame_t *frame = benchFormatText (ctx->arr);
+	const size_t len = frame->len;
+	BarWsFrameUnref (frame);
+	return len;
+}
+
+static size_t benchJsonParse (BenchCtx_t *ctx) {
+	json_object *obj = json_tokener_parse (BarWsFrameData (ctx->text) + 1);
+	json_object_put (obj);
+	return ctx->text->len;
+}
+
+static size_t benchMsgpackEncode (BenchCtx_t *ctx) {
+	BarWsFrame_t *frame = BarMsgpackFrame (ctx->arr);
+	const size_t len = frame->len;
+	BarWsFrameUnref (frame);
+	return len;
+}
+
+static size_t benchMsgpackText (BenchCtx_t *ctx) {
+	BarWsFrame_t *frame = BarMsgpackFrameFromText (ctx->text);
+	const size_t len = frame->len;
+	BarWsFrameUnref (frame);
+	return len;
+}
+
+static size_t benchMsgpackDecode (BenchCtx_t *ctx) {
+	json_object *obj = NULL;
+	BarMsgpackDecode (BarWsFramePayload (ctx->packed), ctx->packed->len, &obj);
+	json_object_put (obj);
+	return ctx->packed->len;
+}
+
+#define BENCH_EVENT(ev, fn) \
+	{"json/format/" ev, fn, benchJsonFormat}, \
+	{"json/parse/" ev, fn, benchJsonParse}, \
+	{"msgpack/encode/" ev, fn, benchMsgpackEncode}, \
+	{"msgpack/text/" ev, fn, benchMsgpackText}, \
+	{"msgpack/decode/" ev, fn, benchMsgpackDecode}
+
+static const BenchCase_t benchCases[] = {
+	BENCH_EVENT ("process", benchPayloadProcess),
+	BENCH_EVENT ("stations_100", benchPayloadStations100),
+	BENCH_EVENT ("stations_250", benchPayloadStations250),
+	BENCH_EVENT ("progress", benchPayloadProgress),
+};
+
+/*	run one case until it has taken at least minNs
+ *	@return ns/op
+ */
+static double benchRun (const BenchCase_t *bc, uint64_t minNs,
+		size_t *bytes) {
+	BenchCtx_t ctx;
+	ctx.arr = bc->payload ();
+	ctx.text = benchFormatText (ctx.arr);
+	ctx.packed = BarMsgpackFrameFromText (ctx.text);
+
+	/* warm up caches */
+	*bytes = bc->op (&ctx);
+
+	uint64_t n = 1, elapsed;
+	while (true) {
+		const uint64_t start = benchNow ();
+		for (uint64_t i = 0; i < n; i++) {
+			bc->op (&ctx);
+		}
+		elapsed = benchNow () - start;
+		if (elapsed >= minNs || n >= (1ull << 32)) {
+			break;
+		}
+
+		/* aim for 1.2 * minNs based on the last round */
+		uint64_t next = elapsed == 0 ? n * 100 :
+				(uint64_t) ((double) n * 1.2 * (double) minNs /
+				(double) elapsed);
+		if (next <= n) {
+			next = n + 1;
+		} else if (next > n * 100) {
+			next = n * 100;
+		}
+		n = next;
+	}
+
+	BarWsFrameUnref (ctx.packed);
+	BarWsFrameUnref (ctx.text);
+	json_object_put (ctx.arr);
+	return (double) elapsed / (double) n;
+}
+
+static void usage (const char *argv0) {
+	fprintf (stderr, "usage: %s [-t ms] [filter]\n", argv0);
+}
+
+int main (int argc, char **argv) {
+	unsigned long minMs = 500;
+	int opt;
+
+	while ((opt = getopt (argc, argv, "t:h")) != -1) {
+		switch (opt) {
+			case 't':
+				minMs = strtoul (optarg, NULL, 10);
+				break;
+
+			default:
+				usage (argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	const char *filter = optind < argc ? argv[optind] : NULL;
+
+	printf ("%-32s %12s %10s\n", "benchmark", "ns/op", "frame B");
+	for (size_t i = 0; i < sizeof (benchCases) / sizeof (*benchCases); i++) {
+		const BenchCase_t *bc = &benchCases[i];
+		if (filter != NULL && strstr (bc->name, filter) == NULL) {
+			continue;
+		}
+
+		size_t bytes;
+		const double ns = benchRun (bc, (uint64_t) minMs * 1000000ull, &bytes);
+		printf ("%-32s %12.0f %10zu\n", bc->name, ns, bytes);
+		fflush (stdout);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,342 @@
+/*
+ * Broadcast fan-out through the real WebSocket server with 1..N lws service
+ * threads (websocket_threads).
+ *
+ * Starts the server on 127.0.0.1, connects many "socketio" clients from a
+ * few client threads, then emits events with BarSocketIoEmit and times how
+ * long it takes until every client received all of them. Events go out in
+ * rounds no larger than the per-client queue, so nothing is dropped and the
+ * number reflects how fast the service threads drain the queues:
+ *
+ *   threads   service threads the server ran (lws may run fewer)
+ *   msgs/s    frames delivered per second, summed over all clients
+ *   MB/s      payload delivered per second
+ *
+ * Client threads share the machine with the server, so absolute numbers
+ * depend on the host; compare rows of one run.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <libwebsockets.h>
+#include <json-c/json.h>
+
+#include "../../src/main.h"
+#include "../../src/settings.h"
+#include "../../src/bar_state.h"
+#include "../../src/websocket/core/websocket.h"
+#include "../../src/websocket/protocol/socketio.h"
+
+/* provided by main.c / test_main.c in the other binaries */
+sig_atomic_t *interrupted = NULL;
+
+void BarMainGetPlaylist (BarApp_t *app) {
+	(void) app;
+}
+
+void BarMainStartPlayback (BarApp_t *app, pthread_t *playerThread) {
+	(void) app;
+	(void) playerThread;
+}
+
+#define BENCH_CLIENT_THREADS 4
+#define BENCH_ROUND 32
+#define BENCH_TIMEOUT_NS (30ull * 1000000000ull)
+
+typedef struct {
+	unsigned int clients, messages, threads, port;
+	size_t size;
+} BenchOpts_t;
+
+typedef struct {
+	pthread_t thread;
+	struct lws_context *context;
+	unsigned int clients;
+	const BenchOpts_t *opts;
+} BenchClientThread_t;
+
+/* per-session data of a client */
+typedef struct {
+	bool bench;             /* message being received is a "bench" event */
+} BenchClient_t;
+
+static atomic_uint benchConnected, benchFailed;
+static atomic_ulong benchReceived;
+static atomic_bool benchStop;
+
+static uint64_t benchNow (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static int benchClientCallback (struct lws *wsi,
+		enum lws_callback_reasons reason, void *user, void *in, size_t len) {
+	BenchClient_t *client = user;
+	static const char prefix[] = "2[ \"bench\"";
+
+	switch ((int) reason) {
+		case LWS_CALLBACK_CLIENT_ESTABLISHED:
+			atomic_fetch_add (&benchConnected, 1);
+			break;
+
+		case LWS_CALLBACK_CLIENT_RECEIVE:
+			/* skip the process state sent on connect */
+			if (lws_is_first_fragment (wsi)) {
+				client->bench = len >= sizeof (prefix) - 1 &&
+						memcmp (in, prefix, sizeof (prefix) - 1) == 0;
+			}
+			if (client->bench && lws_is_final_fragment (wsi)) {
+				atomic_fetch_add (&benchReceived, 1);
+			}
+			break;
+
+		case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+		case LWS_CALLBACK_CLIENT_CLOSED:
+			atomic_fetch_add (&benchFailed, 1);
+			break;
+
+		default:
+			break;
+	}
+	return 0;
+}
+
+static const struct lws_protocols benchProtocols[] = {
+	{"socketio", benchClientCallback, sizeof (BenchClient_t), 0, 0, NULL, 0},
+	{NULL, NULL, 0, 0, 0, NULL, 0},
+};
+
+static void *benchClientThread (void *arg) {
+	BenchClientThread_t *ct = arg;
+
+	for (unsigned int i = 0; i < ct->clients; i++) {
+		struct lws_client_connect_info info;
+		memset (&info, 0, sizeof (info));
+		info.context = ct->context;
+		info.address = "127.0.0.1";
+		info.port = (int) ct->opts->port;
+		info.path = "/";
+		info.host = info.address;
+		info.origin = info.address;
+		info.protocol = "socketio";
+		if (lws_client_connect_via_info (&info) == NULL) {
+			atomic_fetch_add (&benchFailed, 1);
+		}
+	}
+	while (!atomic_load (&benchStop)) {
+		lws_service (ct->context, 10);
+	}
+	return NULL;
+}
+
+/*	wait until benchReceived reaches target
+ *	@return false on timeout or lost clients
+ */
+static bool benchWait (unsigned long target, uint64_t deadline) {
+	while (atomic_load (&benchReceived) < target) {
+		if (atomic_load (&benchFailed) > 0 || benchNow () > deadline) {
+			return false;
+		}
+		sched_yield ();
+	}
+	return true;
+}
+
+static bool benchServerStart (BarApp_t *app, const BenchOpts_t *o,
+		unsigned int threads) {
+	memset (app, 0, sizeof (*app));
+	BarSettingsInit (&app->settings);
+	app->settings.uiMode = BAR_UI_MODE_WEB;
+	app->settings.volumeMode = BAR_VOLUME_MODE_PLAYER;
+	app->settings.websocketPort = (int) o->port;
+	free (app->settings.websocketHost);
+	app->settings.websocketHost = strdup ("127.0.0.1");
+	app->settings.websocketThreads = threads;
+	app->settings.websocketMaxClients = o->clients;
+	app->settings.websocketQueueLimit = BENCH_ROUND * 2;
+	app->settings.websocketCompression = BAR_WS_COMPRESSION_OFF;
+	BarStateInit (app);
+	pthread_mutex_init (&app->player.lock, NULL);
+	pthread_cond_init (&app->player.cond, NULL);
+	return BarWebsocketInit (app);
+}
+
+static void benchServerStop (BarApp_t *app) {
+	BarWebsocketDestroy (app);
+	pthread_cond_destroy (&app->player.cond);
+	pthread_mutex_destroy (&app->player.lock);
+	BarStateDestroy (app);
+	BarSettingsDestroy (&app->settings);
+}
+
+/*	one row: server with `threads` service threads
+ *	@return false if the run did not complete
+ */
+static bool benchRun (const BenchOpts_t *o, unsigned int threads) {
+	BarApp_t app;
+	BenchClientThread_t clientThreads[BENCH_CLIENT_THREADS];
+	unsigned int running = 0;
+	bool ok = false;
+
+	atomic_store (&benchConnected, 0);
+	atomic_store (&benchFailed, 0);
+	atomic_store (&benchReceived, 0);
+	atomic_store (&benchStop, false);
+
+	if (!benchServerStart (&app, o, threads)) {
+		fprintf (stderr, "cannot start server on port %u\n", o->port);
+		benchServerStop (&app);
+		return false;
+	}
+	const BarWsContext_t *ctx = app.wsContext;
+
+	for (unsigned int i = 0; i < BENCH_CLIENT_THREADS; i++) {
+		BenchClientThread_t *ct = &clientThreads[i];
+		struct lws_context_creation_info info;
+		memset (&info, 0, sizeof (info));
+		info.port = CONTEXT_PORT_NO_LISTEN;
+		info.protocols = benchProtocols;
+		ct->opts = o;
+		ct->clients = o->clients / BENCH_CLIENT_THREADS +
+				(i < o->clients % BENCH_CLIENT_THREADS);
+		ct->context = lws_create_context (&info);
+		if (ct->context == NULL ||
+				pthread_create (&ct->thread, NULL, benchClientThread, ct) != 0) {
+			if (ct->context != NULL) {
+				lws_context_destroy (ct->context);
+			}
+			fprintf (stderr, "cannot start client thread\n");
+			goto out;
+		}
+		running++;
+	}
+
+	const uint64_t connectDeadline = benchNow () + BENCH_TIMEOUT_NS;
+	while (atomic_load (&benchConnected) < o->clients) {
+		if (atomic_load (&benchFailed) > 0 || benchNow () > connectDeadline) {
+			fprintf (stderr, "%u of %u clients connected\n",
+					atomic_load (&benchConnected), o->clients);
+			goto out;
+		}
+		usleep (1000);
+	}
+	/* let the process state sent on connect go out first */
+	usleep (100000);
+
+	char *text = malloc (o->size + 1);
+	memset (text, 'x', o->size);
+	text[o->size] = '\0';
+
+	const uint64_t start = benchNow ();
+	const uint64_t deadline = start + BENCH_TIMEOUT_NS;
+	unsigned long target = 0;
+	ok = true;
+	for (unsigned int sent = 0; sent < o->messages && ok;) {
+		const unsigned int round = o->messages - sent < BENCH_ROUND ?
+				o->messages - sent : BENCH_ROUND;
+		for (unsigned int i = 0; i < round; i++) {
+			json_object *data = json_object_new_object ();
+			json_object_object_add (data, "seq", json_object_new_int (
+					(int) (sent + i)));
+			json_object_object_add (data, "text", json_object_new_string (text));
+			BarSocketIoEmit ("bench", data);
+			json_object_put (data);
+		}
+		sent += round;
+		target += (unsigned long) round * o->clients;
+		ok = benchWait (target, deadline);
+	}
+	const uint64_t elapsed = benchNow () - start;
+	free (text);
+
+	if (ok) {
+		const double secs = (double) elapsed / 1e9;
+		const double msgs = (double) target;
+		printf ("%7u %12.0f %10.1f\n", ctx->serviceThreads, msgs / secs,
+				msgs * (double) o->size / secs / 1e6);
+		fflush (stdout);
+	} else {
+		fprintf (stderr, "%lu of %lu frames received\n",
+				atomic_load (&benchReceived), target);
+	}
+
+out:
+	atomic_store (&benchStop, true);
+	for (unsigned int i = 0; i < running; i++) {
+		lws_cancel_service (clientThreads[i].context);
+		pthread_join (clientThreads[i].thread, NULL);
+		lws_context_destroy (clientThreads[i].context);
+	}
+	benchServerStop (&app);
+	return ok;
+}
+
+static void usage (const char *argv0) {
+	fprintf (stderr, "usage: %s [-c clients] [-m messages] [-s bytes] "
+			"[-t max threads] [-p port]\n", argv0);
+}
+
+int main (int argc, char **argv) {
+	BenchOpts_t o = {
+		.clients = 200,
+		.messages = 2000,
+		.threads = 4,
+		.port = 18099,
+		.size = 256,
+	};
+	int opt;
+
+	while ((opt = getopt (argc, argv, "c:m:s:t:p:h")) != -1) {
+		switch (opt) {
+			case 'c':
+				o.clients = (unsigned int) strtoul (optarg, NULL, 10);
+				break;
+
+			case 'm':
+				o.messages = (unsigned int) strtoul (optarg, NULL, 10);
+				break;
+
+			case 's':
+				o.size = strtoul (optarg, NULL, 10);
+				break;
+
+			case 't':
+				o.threads = (unsigned int) strtoul (optarg, NULL, 10);
+				break;
+
+			case 'p':
+				o.port = (unsigned int) strtoul (optarg, NULL, 10);
+				break;
+
+			default:
+				usage (argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (o.clients == 0 || o.threads == 0 ||
+			o.threads > WEBSOCKET_SERVICE_THREADS_MAX) {
+		usage (argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	lws_set_log_level (LLL_ERR, NULL);
+	printf ("%u clients, %u messages of %zu bytes\n", o.clients, o.messages,
+			o.size);
+	printf ("%7s %12s %10s\n", "threads", "msgs/s", "MB/s");
+	for (unsigned int t = 1; t <= o.threads; t++) {
+		if (!benchRun (&o, t)) {
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
@@ -100,10 +100,7 @@ static void setup_integration_app_with_piano (BarApp_t *barApp) {
 static void teardown_integration_app (BarApp_t *barApp) {
 	BarUiPianoCallClearTestHook ();
 	BarStateSetPlaylist (barApp, NULL);
-	if (barApp->songHistory != NULL) {
-		PianoDestroyPlaylist (barApp->songHistory);
-		barApp->songHistory = NULL;
-	}
+	BarStateHistoryClear (barApp);
 	BarPlayerDestroy (&barApp->player);
 	BarStateDestroy (barApp);
 	BarL10nDestroy (&barApp->l10n);
@@ -52,12 +52,19 @@ Suite *system_volume_suite(void);
 Suite *ui_readline_suite(void);
 Suite *ui_suite(void);
 Suite *station_sort_suite(void);
+Suite *song_history_suite(void);
 Suite *interrupt_suite(void);
 Suite *libpiano_response_suite(void);
+Suite *libpiano_request_suite(void);
 
 /* Test suite declarations — WebSocket-only */
 #ifdef WEBSOCKET_ENABLED
 Suite *websocket_suite(void);
+Suite *ws_outqueue_suite(void);
+Suite *ws_timers_suite(void);
+Suite *ws_volume_worker_suite(void);
+Suite *ws_connections_suite(void);
+Suite *ws_msgpack_suite(void);
 Suite *http_server_suite(void);
 Suite *daemon_suite(void);
 Suite *socketio_suite(void);
@@ -74,6 +81,11 @@ int main(void) {
 #ifdef WEBSOCKET_ENABLED
 	/* Start with WebSocket suite; add remaining WebSocket suites */
 	sr = srunner_create(websocket_suite());
+	srunner_add_suite(sr, ws_outqueue_suite());
+	srunner_add_suite(sr, ws_timers_suite());
+	srunner_add_suite(sr, ws_volume_worker_suite());
+	srunner_add_suite(sr, ws_connections_suite());
+	srunner_add_suite(sr, ws_msgpack_suite());
 	srunner_add_suite(sr, http_server_suite());
 	srunner_add_suite(sr, daemon_suite());
 	srunner_add_suite(sr, socketio_suite());
@@ -100,8 +112,10 @@ int main(void) {
 	srunner_add_suite(sr, ui_readline_suite());
 	srunner_add_suite(sr, ui_suite());
 	srunner_add_suite(sr, station_sort_suite());
+	srunner_add_suite(sr, song_history_suite());
 	srunner_add_suite(sr, interrupt_suite());
 	srunner_add_suite(sr, libpiano_response_suite());
+	srunner_add_suite(sr, libpiano_request_suite());
 
 	/* Run tests */
 	srunner_run_all(sr, CK_NORMAL);
@@ -303,6 +303,23 @@ START_TEST(test_bar_state_get_station_list) {
 }
 END_TEST
 
+/* GetStationCount counts ph.stations */
+START_TEST(test_bar_state_get_station_count) {
+	BarApp_t app;
+	PianoStation_t station_b;
+	memset(&station_a, 0, sizeof(station_a));
+	memset(&station_b, 0, sizeof(station_b));
+	station_a.head.next = &station_b.head;
+
+	bar_state_test_setup(&app, BAR_UI_MODE_BOTH);
+	ck_assert_uint_eq(BarStateGetStationCount(&app), 0);
+	app.ph.stations = &station_a;
+	ck_assert_uint_eq(BarStateGetStationCount(&app), 2);
+	app.ph.stations = NULL;
+	bar_state_test_teardown(&app);
+}
+END_TEST
+
 /* Playlist get/set and drain */
 START_TEST(test_bar_state_playlist_get_set) {
 	BarApp_t app;
@@ -749,6 +766,7 @@ Suite *bar_state_suite(void) {
 	tcase_add_test(tc_core, test_bar_state_find_station_by_id_null_list);
 	tcase_add_test(tc_core, test_bar_state_find_station_by_id_one_station);
 	tcase_add_test(tc_core, test_bar_state_get_station_list);
+	tcase_add_test(tc_core, test_bar_state_get_station_count);
 	suite_add_tcase(s, tc_core);
 
 	TCase *tc_playlist = tcase_create("Playlist");
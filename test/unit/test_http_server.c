@@ -21,8 +21,13 @@ THE SOFTWARE.
 */
 
 #include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "../../src/websocket/http/http_server.h"
+#include "../../src/websocket/http/asset_cache.h"
 
 /* Test: HTML files should have text/html MIME type */
 START_TEST(test_mime_type_html) {
@@ -87,6 +92,216 @@ START_TEST(test_mime_type_no_extension) {
 }
 END_TEST
 
+/* Test: Accept-Encoding with q-values and wildcards */
+START_TEST(test_accepts_encoding) {
+	ck_assert(BarHttpAcceptsEncoding("gzip, deflate, br", "br"));
+	ck_assert(BarHttpAcceptsEncoding("gzip;q=0.8, BR;q=1.0", "br"));
+	ck_assert(!BarHttpAcceptsEncoding("gzip, deflate", "br"));
+	ck_assert(!BarHttpAcceptsEncoding("br;q=0, gzip", "br"));
+	ck_assert(BarHttpAcceptsEncoding("br;q=0, gzip", "gzip"));
+	ck_assert(BarHttpAcceptsEncoding("*", "gzip"));
+	ck_assert(!BarHttpAcceptsEncoding("gzip;q=0, *", "gzip"));
+	ck_assert(!BarHttpAcceptsEncoding("brotli", "br"));
+	ck_assert(!BarHttpAcceptsEncoding("", "gzip"));
+}
+END_TEST
+
+/* Test: If-None-Match lists, weak tags and the wildcard */
+START_TEST(test_etag_matches) {
+	ck_assert(BarHttpEtagMatches("\"abc\"", "\"abc\""));
+	ck_assert(BarHttpEtagMatches("\"x\", W/\"abc\"", "\"abc\""));
+	ck_assert(BarHttpEtagMatches("*", "\"abc\""));
+	ck_assert(!BarHttpEtagMatches("\"abcd\"", "\"abc\""));
+	ck_assert(!BarHttpEtagMatches("\"ab\"", "\"abc\""));
+}
+END_TEST
+
+/* Test: only content-hashed names below /assets/ are immutable */
+START_TEST(test_hashed_asset_names) {
+	ck_assert(BarHttpAssetIsHashedName("/assets/app-Bx3f9a1c.js"));
+	ck_assert(BarHttpAssetIsHashedName("/assets/index-a_b-C1d2.css"));
+	ck_assert(!BarHttpAssetIsHashedName("/assets/app.js"));
+	ck_assert(!BarHttpAssetIsHashedName("/assets/app-Bx3f9a.js"));
+	ck_assert(!BarHttpAssetIsHashedName("/app-Bx3f9a1c.js"));
+	ck_assert(!BarHttpAssetIsHashedName("/index.html"));
+	ck_assert(!BarHttpAssetIsHashedName(NULL));
+}
+END_TEST
+
+static void writeFile(const char *dir, const char *name, const char *content) {
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	FILE *fp = fopen(path, "wb");
+	ck_assert_ptr_nonnull(fp);
+	fputs(content, fp);
+	fclose(fp);
+}
+
+static void removeTree(const char *dir) {
+	char cmd[600];
+	snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/* Test: files are cached with their precompressed siblings */
+START_TEST(test_asset_cache_loads_variants) {
+	char dir[] = "/tmp/pianobar-assets-XXXXXX";
+	char sub[600];
+	BarHttpAssetCache_t cache;
+	
+	ck_assert_ptr_nonnull(mkdtemp(dir));
+	snprintf(sub, sizeof(sub), "%s/assets", dir);
+	ck_assert_int_eq(mkdir(sub, 0700), 0);
+	writeFile(dir, "index.html", "<html></html>");
+	writeFile(dir, ".hidden", "x");
+	writeFile(dir, "assets/app-Bx3f9a1c.js", "console.log(1)");
+	writeFile(dir, "assets/app-Bx3f9a1c.js.br", "BR");
+	writeFile(dir, "assets/app-Bx3f9a1c.js.gz", "GZ");
+	writeFile(dir, "assets/data.bin.gz", "only compressed");
+	
+	ck_assert(BarHttpAssetCacheInit(&cache, dir));
+	BarHttpAssetTable_t *table = BarHttpAssetCacheAcquire(&cache);
+	ck_assert_uint_eq(table->count, 3);
+	ck_assert_ptr_null(BarHttpAssetFind(table, "/.hidden"));
+	ck_assert_ptr_null(BarHttpAssetFind(table, "/../etc/passwd"));
+	ck_assert_ptr_null(BarHttpAssetFind(table, "/assets/app-Bx3f9a1c.js.br"));
+	
+	const BarHttpAsset_t *index = BarHttpAssetFind(table, "/");
+	ck_assert_ptr_nonnull(index);
+	ck_assert_str_eq(index->path, "/index.html");
+	ck_assert_str_eq(index->mime, "text/html");
+	ck_assert(!index->immutable);
+	ck_assert_ptr_null(index->body[BAR_HTTP_ENCODING_BR].data);
+	ck_assert_int_eq(index->body[BAR_HTTP_ENCODING_IDENTITY].etag[0], '"');
+	
+	const BarHttpAsset_t *app = BarHttpAssetFind(table, "/assets/app-Bx3f9a1c.js");
+	ck_assert_ptr_nonnull(app);
+	ck_assert(app->immutable);
+	ck_assert_uint_eq(app->body[BAR_HTTP_ENCODING_IDENTITY].len, 14);
+	ck_assert_uint_eq(app->body[BAR_HTTP_ENCODING_BR].len, 2);
+	ck_assert(memcmp(app->body[BAR_HTTP_ENCODING_GZIP].data, "GZ", 2) == 0);
+	ck_assert_str_ne(app->body[BAR_HTTP_ENCODING_BR].etag,
+	                 app->body[BAR_HTTP_ENCODING_IDENTITY].etag);
+	
+	ck_assert_ptr_nonnull(BarHttpAssetFind(table, "/assets/data.bin.gz"));
+	BarHttpAssetTableRelease(table);
+	
+	BarHttpAssetCacheDestroy(&cache);
+	removeTree(dir);
+}
+END_TEST
+
+/* Test: a compiled-in web UI is served from its arrays, uncopied */
+START_TEST(test_asset_cache_serves_embedded_files) {
+	static const unsigned char app[] = "console.log(1)";
+	static const unsigned char appGz[] = "GZ";
+	static const unsigned char index[] = "<html></html>";
+	static const BarHttpEmbeddedFile_t files[] = {
+		{"/assets/app-Bx3f9a1c.js", {app, appGz, NULL}, {14, 2, 0}, 0},
+		{"/index.html", {index, NULL, NULL}, {13, 0, 0}, 1700000000},
+	};
+	BarHttpAssetCache_t cache;
+	
+	ck_assert(BarHttpAssetCacheInitEmbedded(&cache, files, 2));
+	ck_assert(!BarHttpAssetCacheReload(&cache));
+	BarHttpAssetTable_t *table = BarHttpAssetCacheAcquire(&cache);
+	ck_assert_uint_eq(table->count, 2);
+	ck_assert_uint_eq(table->bytes, 27);
+	
+	const BarHttpAsset_t *asset = BarHttpAssetFind(table, "/");
+	ck_assert_ptr_nonnull(asset);
+	ck_assert_ptr_eq(asset->body[BAR_HTTP_ENCODING_IDENTITY].data, index);
+	ck_assert_str_eq(asset->mime, "text/html");
+	ck_assert_str_eq(asset->lastModified, "Tue, 14 Nov 2023 22:13:20 GMT");
+	
+	asset = BarHttpAssetFind(table, "/assets/app-Bx3f9a1c.js");
+	ck_assert_ptr_nonnull(asset);
+	ck_assert(asset->immutable);
+	ck_assert_ptr_eq(asset->body[BAR_HTTP_ENCODING_GZIP].data, appGz);
+	ck_assert_ptr_null(asset->body[BAR_HTTP_ENCODING_BR].data);
+	ck_assert_str_ne(asset->body[BAR_HTTP_ENCODING_GZIP].etag,
+	                 asset->body[BAR_HTTP_ENCODING_IDENTITY].etag);
+	BarHttpAssetTableRelease(table);
+	
+	BarHttpAssetCacheDestroy(&cache);
+}
+END_TEST
+
+/* Test: a snapshot goes into index.html before </head>, in any chunk size */
+START_TEST(test_transfer_splices_snapshot) {
+	static const char html[] = "<html><head><title>x</title></head><body></body></html>";
+	static const char expected[] = "<html><head><title>x</title>"
+	                               "<script id=\"pianobar-state\" type=\"application/json\">"
+	                               "{\"a\":1}</script></head><body></body></html>";
+	const BarHttpAssetBody_t body = {(const unsigned char *)html, sizeof(html) - 1, ""};
+	const BarHttpAssetBody_t noHead = {(const unsigned char *)"<p>", 3, ""};
+	BarWsFrame_t *snapshot = BarWsFrameFromString("{\"a\":1}");
+	BarHttpTransfer_t transfer;
+	unsigned char out[256];
+	
+	for (size_t chunk = 1; chunk <= sizeof(expected); chunk++) {
+		memset(&transfer, 0, sizeof(transfer));
+		ck_assert(BarHttpTransferSplice(&transfer, &body, snapshot));
+		ck_assert_uint_eq(BarHttpTransferRemaining(&transfer), sizeof(expected) - 1);
+		size_t len = 0, n;
+		while ((n = BarHttpTransferFill(&transfer, out + len, chunk)) > 0) {
+			len += n;
+		}
+		ck_assert_uint_eq(len, sizeof(expected) - 1);
+		ck_assert(memcmp(out, expected, len) == 0);
+		ck_assert_uint_eq(BarHttpTransferRemaining(&transfer), 0);
+		BarHttpTransferRelease(&transfer);
+	}
+	
+	memset(&transfer, 0, sizeof(transfer));
+	ck_assert(!BarHttpTransferSplice(&transfer, &noHead, snapshot));
+	ck_assert_ptr_null(transfer.snapshot);
+	ck_assert_uint_eq(atomic_load(&snapshot->refs), 1);
+	BarWsFrameUnref(snapshot);
+	
+	ck_assert(BarHttpAssetIsIndex("/"));
+	ck_assert(BarHttpAssetIsIndex("/index.html"));
+	ck_assert(!BarHttpAssetIsIndex("/assets/index.js"));
+}
+END_TEST
+
+#ifdef __linux__
+/* Test: a changed file is picked up without a restart */
+START_TEST(test_asset_cache_reloads_on_change) {
+	char dir[] = "/tmp/pianobar-assets-XXXXXX";
+	BarHttpAssetCache_t cache;
+	
+	ck_assert_ptr_nonnull(mkdtemp(dir));
+	writeFile(dir, "index.html", "old");
+	ck_assert(BarHttpAssetCacheInit(&cache, dir));
+	BarHttpAssetTable_t *before = BarHttpAssetCacheAcquire(&cache);
+	
+	writeFile(dir, "index.html", "new!");
+	writeFile(dir, "added.txt", "added");
+	
+	BarHttpAssetTable_t *after = NULL;
+	for (int i = 0; i < 100; i++) {
+		after = BarHttpAssetCacheAcquire(&cache);
+		if (after != before && after->count == 2) {
+			break;
+		}
+		BarHttpAssetTableRelease(after);
+		after = NULL;
+		usleep(20000);
+	}
+	ck_assert_ptr_nonnull(after);
+	ck_assert_uint_eq(BarHttpAssetFind(after, "/")->body[0].len, 4);
+	/* a response still using the old table keeps it alive */
+	ck_assert_uint_eq(BarHttpAssetFind(before, "/")->body[0].len, 3);
+	BarHttpAssetTableRelease(before);
+	BarHttpAssetTableRelease(after);
+	
+	BarHttpAssetCacheDestroy(&cache);
+	removeTree(dir);
+}
+END_TEST
+#endif
+
 /* Create test suite */
 Suite *http_server_suite(void) {
 	Suite *s;
@@ -107,6 +322,18 @@ Suite *http_server_suite(void) {
 	
 	suite_add_tcase(s, tc_mime);
 	
+	TCase *tc_cache = tcase_create("Asset Cache");
+	tcase_add_test(tc_cache, test_accepts_encoding);
+	tcase_add_test(tc_cache, test_etag_matches);
+	tcase_add_test(tc_cache, test_hashed_asset_names);
+	tcase_add_test(tc_cache, test_asset_cache_loads_variants);
+	tcase_add_test(tc_cache, test_asset_cache_serves_embedded_files);
+	tcase_add_test(tc_cache, test_transfer_splices_snapshot);
+#ifdef __linux__
+	tcase_add_test(tc_cache, test_asset_cache_reloads_on_change);
+#endif
+	suite_add_tcase(s, tc_cache);
+	
 	return s;
 }
 
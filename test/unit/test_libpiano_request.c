@@ -0,0 +1,116 @@
+/*
+ * Tests for src/libpiano/request.c — request body serialization, escaping
+ * and encryption. No network access; bodies are inspected after PianoRequest
+ * has built them.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <piano.h>
+#include <crypt.h>
+
+/* Helper: handle with the android partner keys, as pianobar configures it */
+static void setupHandle (PianoHandle_t *ph) {
+	ck_assert_int_eq (PianoInit (ph, "android",
+			"AC7IBG09A3DTSYM4R41UJWL07VLN8JI7", "android-generic",
+			"R=U!LH$O2B#", "6#26FRL$ZWD"), PIANO_RET_OK);
+}
+
+/* Partner login (step 0) is sent unencrypted */
+START_TEST (test_request_login_partner_body)
+{
+	PianoHandle_t ph;
+	PianoRequest_t req;
+	PianoRequestDataLogin_t login = { .step = 0 };
+
+	setupHandle (&ph);
+	memset (&req, 0, sizeof (req));
+	req.data = &login;
+
+	ck_assert_int_eq (PianoRequest (&ph, &req, PIANO_REQUEST_LOGIN), PIANO_RET_OK);
+	ck_assert (req.secure);
+	ck_assert_str_eq (req.postData, "{\"username\":\"android\","
+			"\"password\":\"AC7IBG09A3DTSYM4R41UJWL07VLN8JI7\","
+			"\"deviceModel\":\"android-generic\",\"version\":\"5\","
+			"\"includeUrls\":true}");
+
+	PianoDestroyRequest (&req);
+	PianoDestroy (&ph);
+}
+END_TEST
+
+/* User login (step 1): body is encrypted, strings are escaped and the
+ * partner token is percent-encoded in the URL */
+START_TEST (test_request_login_user_escaped_and_encrypted)
+{
+	PianoHandle_t ph;
+	PianoRequest_t req;
+	PianoRequestDataLogin_t login = {
+			.user = "a\"b\\c\n\x01", .password = "p/w", .step = 1 };
+
+	setupHandle (&ph);
+	ph.partner.authToken = strdup ("ab+c/=d e");
+	ph.partner.id = 42;
+	memset (&req, 0, sizeof (req));
+	req.data = &login;
+
+	ck_assert_int_eq (PianoRequest (&ph, &req, PIANO_REQUEST_LOGIN), PIANO_RET_OK);
+	ck_assert_str_eq (req.urlPath, "/services/json/?method=auth.userLogin&"
+			"auth_token=ab%2Bc%2F%3Dd%20e&partner_id=42");
+	/* hex encoded, multiple of blowfish block size */
+	ck_assert_uint_eq (strlen (req.postData) % (2 * PIANO_CRYPT_BLOCKSIZE), 0);
+
+	/* server side key pair is reversed; decrypt with our out key */
+	size_t len;
+	char *body = PianoDecryptString (ph.partner.out, req.postData, &len);
+	ck_assert_ptr_nonnull (body);
+	ck_assert_ptr_nonnull (strstr (body, "{\"loginType\":\"user\","
+			"\"username\":\"a\\\"b\\\\c\\n\\u0001\",\"password\":\"p/w\","
+			"\"partnerAuthToken\":\"ab+c/=d e\",\"syncTime\":"));
+	ck_assert_ptr_nonnull (strstr (body, "}"));
+	free (body);
+
+	PianoDestroyRequest (&req);
+	PianoDestroy (&ph);
+}
+END_TEST
+
+/* Request buffer is reused between calls; a shorter body must not carry
+ * stale bytes from a previous, longer one */
+START_TEST (test_request_buffer_reuse)
+{
+	PianoHandle_t ph;
+	PianoRequest_t req;
+	PianoRequestDataLogin_t login = {
+			.user = "someone@example.com", .password = "secret", .step = 1 };
+
+	setupHandle (&ph);
+	ph.partner.authToken = strdup ("token");
+	memset (&req, 0, sizeof (req));
+	req.data = &login;
+	ck_assert_int_eq (PianoRequest (&ph, &req, PIANO_REQUEST_LOGIN), PIANO_RET_OK);
+	PianoDestroyRequest (&req);
+
+	login.step = 0;
+	memset (&req, 0, sizeof (req));
+	req.data = &login;
+	ck_assert_int_eq (PianoRequest (&ph, &req, PIANO_REQUEST_LOGIN), PIANO_RET_OK);
+	ck_assert_str_eq (req.postData, ph.requestBuf.data);
+	ck_assert_ptr_null (strstr (req.postData, "someone"));
+
+	PianoDestroyRequest (&req);
+	PianoDestroy (&ph);
+}
+END_TEST
+
+Suite *libpiano_request_suite (void) {
+	Suite *s = suite_create ("libpiano_request");
+	TCase *tc = tcase_create ("request serialization");
+	tcase_add_test (tc, test_request_login_partner_body);
+	tcase_add_test (tc, test_request_login_user_escaped_and_encrypted);
+	tcase_add_test (tc, test_request_buffer_reuse);
+	suite_add_tcase (s, tc);
+	return s;
+}
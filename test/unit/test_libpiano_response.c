@@ -88,6 +88,149 @@ START_TEST (test_response_ok_genre_stations_empty_does_not_crash)
 }
 END_TEST
 
+/* getStations: fields are extracted and quickmix membership is applied */
+START_TEST (test_response_get_stations_quickmix)
+{
+	PianoHandle_t ph;
+	PianoRequest_t req;
+
+	PianoReturn_t ret = callResponse (&ph, &req, PIANO_REQUEST_GET_STATIONS,
+	        "{\"stat\":\"ok\",\"result\":{\"checksum\":\"abc\",\"stations\":["
+	        "{\"stationToken\":\"1\",\"stationName\":\"Rock \\u00e9\","
+	        "\"isShared\":false,\"unused\":{\"deep\":[1,2,{\"x\":null}]}},"
+	        "{\"stationToken\":\"2\",\"stationName\":\"Jazz\",\"isShared\":true},"
+	        "{\"stationToken\":\"3\",\"stationName\":\"Shuffle\",\"isQuickMix\":true,"
+	        "\"quickMixStationIds\":[\"2\"]}]}}");
+	ck_assert_int_eq (ret, PIANO_RET_OK);
+
+	PianoStation_t *s = ph.stations;
+	ck_assert_ptr_nonnull (s);
+	ck_assert_str_eq (s->id, "1");
+	ck_assert_str_eq (s->name, "Rock \xc3\xa9");
+	ck_assert (s->isCreator);
+	ck_assert (!s->useQuickMix);
+	s = (PianoStation_t *) s->head.next;
+	ck_assert_str_eq (s->name, "Jazz");
+	ck_assert (!s->isCreator);
+	ck_assert (s->useQuickMix);
+	s = (PianoStation_t *) s->head.next;
+	ck_assert (s->isQuickMix);
+	ck_assert_ptr_null (s->head.next);
+	PianoDestroy (&ph);
+}
+END_TEST
+
+/* getPlaylist: ads are skipped, quality map and numeric fields are honoured */
+START_TEST (test_response_get_playlist)
+{
+	PianoHandle_t ph;
+	PianoRequest_t req;
+	PianoRequestDataGetPlaylist_t data = { .quality = PIANO_AQ_HIGH };
+
+	memset (&ph,  0, sizeof (ph));
+	memset (&req, 0, sizeof (req));
+	req.type = PIANO_REQUEST_GET_PLAYLIST;
+	req.data = &data;
+	req.responseData = (char *)
+	        "{\"stat\":\"ok\",\"result\":{\"items\":["
+	        "{\"adToken\":\"ad\"},"
+	        "{\"artistName\":\"A\\\"B\",\"albumName\":\"\\ud83c\\udfb5\","
+	        "\"songName\":\"S\",\"trackToken\":\"t1\",\"stationId\":\"1\","
+	        "\"trackGain\":\"-7.5\",\"trackLength\":215,\"songRating\":1,"
+	        "\"audioUrlMap\":{\"lowQuality\":{\"encoding\":\"aacplus\","
+	        "\"audioUrl\":\"http://low\"},\"highQuality\":{\"encoding\":\"mp3\","
+	        "\"audioUrl\":\"http:\\/\\/high\"}}}]}}";
+
+	ck_assert_int_eq (PianoResponse (&ph, &req), PIANO_RET_OK);
+	PianoSong_t *song = data.retPlaylist;
+	ck_assert_ptr_nonnull (song);
+	ck_assert_ptr_null (song->head.next);
+	ck_assert_str_eq (song->artist, "A\"B");
+	ck_assert_str_eq (song->album, "\xf0\x9f\x8e\xb5");
+	ck_assert_str_eq (song->audioUrl, "http://high");
+	ck_assert_int_eq (song->audioFormat, PIANO_AF_MP3);
+	ck_assert_int_eq (song->length, 215);
+	ck_assert (song->fileGain < -7.4 && song->fileGain > -7.6);
+	ck_assert_int_eq (song->rating, PIANO_RATE_LOVE);
+	ck_assert_ptr_null (song->coverArt);
+
+	PianoDestroyPlaylist (song);
+	PianoDestroy (&ph);
+}
+END_TEST
+
+/* Malformed documents are rejected instead of partially parsed */
+START_TEST (test_response_malformed_json_rejected)
+{
+	static const char * const bad[] = {
+	        "",
+	        "{\"stat\":\"ok\"",
+	        "{\"stat\":\"ok\"} trailing",
+	        "{\"stat\":\"ok\",}",
+	        "{\"stat\":\"o\nk\"}",
+	        "{\"stat\":\"ok\\x\"}",
+	        "{\"stat\":ok}",
+	        "{\"stat\":\"ok\",\"n\":01}",
+	};
+	for (size_t i = 0; i < sizeof (bad) / sizeof (*bad); i++) {
+		PianoHandle_t ph;
+		PianoRequest_t req;
+		PianoReturn_t ret = callResponse (&ph, &req, PIANO_REQUEST_GET_GENRE_STATIONS,
+		        bad[i]);
+		ck_assert_int_eq (ret, PIANO_RET_INVALID_RESPONSE);
+		PianoDestroy (&ph);
+	}
+}
+END_TEST
+
+/* A second getStations merges by token: kept stations keep their address,
+ * renamed ones are reported as changed, vanished ones are handed back */
+START_TEST (test_response_get_stations_diff)
+{
+	PianoHandle_t ph;
+	PianoRequest_t req;
+	PianoRequestDataGetStations_t diff;
+
+	ck_assert_int_eq (callResponse (&ph, &req, PIANO_REQUEST_GET_STATIONS,
+	        "{\"stat\":\"ok\",\"result\":{\"stations\":["
+	        "{\"stationToken\":\"1\",\"stationName\":\"One\"},"
+	        "{\"stationToken\":\"2\",\"stationName\":\"Two\"},"
+	        "{\"stationToken\":\"3\",\"stationName\":\"Three\"}]}}"), PIANO_RET_OK);
+	PianoStation_t * const one = ph.stations;
+	PianoStation_t * const two = (PianoStation_t *) one->head.next;
+	PianoStation_t * const three = (PianoStation_t *) two->head.next;
+
+	memset (&req, 0, sizeof (req));
+	req.type = PIANO_REQUEST_GET_STATIONS;
+	req.data = &diff;
+	req.responseData = (char *) "{\"stat\":\"ok\",\"result\":{\"stations\":["
+	        "{\"stationToken\":\"3\",\"stationName\":\"Three\"},"
+	        "{\"stationToken\":\"4\",\"stationName\":\"Four\"},"
+	        "{\"stationToken\":\"1\",\"stationName\":\"Uno\"}]}}";
+	ck_assert_int_eq (PianoResponse (&ph, &req), PIANO_RET_OK);
+
+	/* server order, existing structs reused */
+	ck_assert_ptr_eq (ph.stations, three);
+	PianoStation_t * const four = (PianoStation_t *) three->head.next;
+	ck_assert_str_eq (four->id, "4");
+	ck_assert_ptr_eq (four->head.next, &one->head);
+	ck_assert_ptr_null (one->head.next);
+	ck_assert_str_eq (one->name, "Uno");
+
+	ck_assert_uint_eq (diff.addedCount, 1);
+	ck_assert_ptr_eq (diff.added[0], four);
+	ck_assert_uint_eq (diff.changedCount, 1);
+	ck_assert_ptr_eq (diff.changed[0], one);
+	ck_assert_ptr_eq (diff.removed, two);
+	ck_assert_str_eq (diff.removed->id, "2");
+	ck_assert_ptr_null (diff.removed->head.next);
+
+	PianoDestroyGetStations (&diff);
+	ck_assert_ptr_null (diff.removed);
+	PianoDestroy (&ph);
+}
+END_TEST
+
 Suite *libpiano_response_suite (void) {
 	Suite *s = suite_create ("libpiano_response");
 	TCase *tc = tcase_create ("JSON parsing");
@@ -96,6 +239,10 @@ Suite *libpiano_response_suite (void) {
 	tcase_add_test (tc, test_response_invalid_json_does_not_crash);
 	tcase_add_test (tc, test_response_fail_missing_code_field);
 	tcase_add_test (tc, test_response_ok_genre_stations_empty_does_not_crash);
+	tcase_add_test (tc, test_response_get_stations_quickmix);
+	tcase_add_test (tc, test_response_get_stations_diff);
+	tcase_add_test (tc, test_response_get_playlist);
+	tcase_add_test (tc, test_response_malformed_json_rejected);
 	suite_add_tcase (s, tc);
 	return s;
 }
@@ -60,6 +60,7 @@ END_TEST
 
 START_TEST(test_log_stub_no_debuglog) {
 	ck_assert(!log_is_any_debug_enabled());
+	ck_assert(!log_is_debug_enabled(DEBUG_WEBSOCKET));
 	log_write(DEBUG_STATE, "ignored\n");
 }
 END_TEST
@@ -182,6 +183,16 @@ START_TEST(test_log_network_respects_mask) {
 }
 END_TEST
 
+/* log_is_debug_enabled follows the mask bit by bit */
+START_TEST(test_log_debug_enabled_per_kind) {
+	log_set_debug_mask(DEBUG_WEBSOCKET);
+	ck_assert(log_is_debug_enabled(DEBUG_WEBSOCKET));
+	ck_assert(!log_is_debug_enabled(DEBUG_WEBSOCKET_PROGRESS));
+	log_set_debug_mask(0);
+	ck_assert(!log_is_debug_enabled(DEBUG_WEBSOCKET));
+}
+END_TEST
+
 #endif /* HAVE_DEBUGLOG */
 
 Suite *log_suite (void) {
@@ -201,6 +212,7 @@ Suite *log_suite (void) {
 	tcase_add_test (tc_debug, test_log_write_unknown_kind);
 	tcase_add_test (tc_debug, test_log_network_request_and_response);
 	tcase_add_test (tc_debug, test_log_network_respects_mask);
+	tcase_add_test (tc_debug, test_log_debug_enabled_per_kind);
 #endif
 #ifndef HAVE_DEBUGLOG
 	tcase_add_test (tc_debug, test_log_stub_no_debuglog);
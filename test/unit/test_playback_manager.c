@@ -22,6 +22,7 @@ THE SOFTWARE.
 
 #include <check.h>
 #include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -196,10 +197,10 @@ END_TEST
 /* Covers idle PLAYER_DEAD path: BarStateAdvancePlaylist + BarUiHistoryPrepend. */
 START_TEST(test_manager_idle_advances_playlist) {
 	BarApp_t app;
-	PianoSong_t song;
-
-	memset(&song, 0, sizeof(song));
-	song.title = (char *)"idle-advance";
+	/* history keeps a copy and frees the finished song */
+	PianoSong_t *song = calloc(1, sizeof(*song));
+	ck_assert_ptr_nonnull(song);
+	song->title = strdup("idle-advance");
 
 	memset(&app, 0, sizeof(app));
 	app.settings.uiMode = BAR_UI_MODE_WEB;
@@ -208,7 +209,7 @@ START_TEST(test_manager_idle_advances_playlist) {
 	pthread_mutex_init(&app.player.lock, NULL);
 	pthread_cond_init(&app.player.cond, NULL);
 	app.player.mode = PLAYER_DEAD;
-	BarStateSetPlaylist(&app, &song);
+	BarStateSetPlaylist(&app, song);
 
 	ck_assert(BarPlaybackManagerStart(&app));
 	pthread_mutex_lock(&app.player.lock);
@@ -219,7 +220,10 @@ START_TEST(test_manager_idle_advances_playlist) {
 	BarPlaybackManagerStop(&app);
 
 	ck_assert_ptr_null(BarStateGetPlaylist(&app));
-	ck_assert_ptr_eq(app.songHistory, &song);
+	const BarSongHistoryEntry_t *last = BarSongHistoryAt(app.songHistory, 0);
+	ck_assert_ptr_nonnull(last);
+	ck_assert_str_eq(last->title, "idle-advance");
+	BarStateHistoryClear(&app);
 
 	pthread_mutex_destroy(&app.player.lock);
 	pthread_cond_destroy(&app.player.cond);
@@ -36,13 +36,16 @@ THE SOFTWARE.
 #include "../../src/system_volume.h"
 #include "../../src/websocket/core/websocket.h"
 #include "../../src/websocket/core/queue.h"
+#include "../../src/websocket/core/deflate_stats.h"
 #include "../../src/websocket/protocol/socketio.h"
 
 /* Mock broadcast callback for testing emissions */
 static char *lastBroadcastMessage = NULL;
 static size_t lastBroadcastLen = 0;
 
-static void mockBroadcastCallback(const char *message, size_t len) {
+static void mockBroadcastCallback(BarWsFrame_t *frame) {
+	const char *message = BarWsFrameData(frame);
+	size_t len = frame->len;
 	free(lastBroadcastMessage);
 	lastBroadcastMessage = malloc(len + 1);
 	memcpy(lastBroadcastMessage, message, len);
@@ -371,6 +374,81 @@ START_TEST(test_socketio_ping_keepalive_noop) {
 }
 END_TEST
 
+/* Parsing happens on the service thread and must hand the worker only
+ * packets it would act on */
+START_TEST(test_socketio_parse_packet_filters_for_dispatch) {
+	BarSocketIoPacket_t pkt;
+
+	ck_assert(BarSocketIoParsePacket("2[\"music.search\",{\"query\":\"x\"}]", &pkt));
+	ck_assert_int_eq(pkt.type, SOCKETIO_EVENT);
+	ck_assert_str_eq(pkt.eventName, "music.search");
+	ck_assert_ptr_nonnull(pkt.data);
+	BarSocketIoPacketFree(&pkt);
+	ck_assert_ptr_null(pkt.eventName);
+	ck_assert_ptr_null(pkt.data);
+
+	ck_assert(BarSocketIoParsePacket("0", &pkt));
+	ck_assert_int_eq(pkt.type, SOCKETIO_CONNECT);
+	BarSocketIoPacketFree(&pkt);
+
+	ck_assert(!BarSocketIoParsePacket("1", &pkt));
+	ck_assert(!BarSocketIoParsePacket("2not-json", &pkt));
+	ck_assert(!BarSocketIoParsePacket(NULL, &pkt));
+}
+END_TEST
+
+/* Binary packets from MessagePack clients parse to the same event */
+START_TEST(test_socketio_parse_msgpack_packet) {
+	BarSocketIoPacket_t pkt;
+	/* ["station.change", {"id": "s1"}] */
+	static const unsigned char change[] = {0x92, 0xae, 's', 't', 'a', 't', 'i',
+			'o', 'n', '.', 'c', 'h', 'a', 'n', 'g', 'e', 0x81, 0xa2, 'i', 'd',
+			0xa2, 's', '1'};
+	/* ["query"] */
+	static const unsigned char query[] = {0x91, 0xa5, 'q', 'u', 'e', 'r', 'y'};
+	/* [1] and a truncated string */
+	static const unsigned char noName[] = {0x91, 0x01};
+	static const unsigned char cut[] = {0x91, 0xa5, 'q'};
+
+	ck_assert(BarSocketIoParseMsgpackPacket(change, sizeof(change), &pkt));
+	ck_assert_int_eq(pkt.type, SOCKETIO_EVENT);
+	ck_assert_str_eq(pkt.eventName, "station.change");
+	ck_assert_str_eq(json_object_get_string(json_object_object_get(pkt.data, "id")), "s1");
+	BarSocketIoPacketFree(&pkt);
+
+	ck_assert(BarSocketIoParseMsgpackPacket(query, sizeof(query), &pkt));
+	ck_assert_str_eq(pkt.eventName, "query");
+	ck_assert_ptr_null(pkt.data);
+	BarSocketIoPacketFree(&pkt);
+
+	ck_assert(!BarSocketIoParseMsgpackPacket(noName, sizeof(noName), &pkt));
+	ck_assert(!BarSocketIoParseMsgpackPacket(cut, sizeof(cut), &pkt));
+}
+END_TEST
+
+/* subscribe with a topic that is not a bucket is refused */
+START_TEST(test_socketio_subscribe_rejects_unknown_topic) {
+	BarApp_t app;
+	memset(&app, 0, sizeof(app));
+	BarSettingsInit(&app.settings);
+	app.settings.uiMode = BAR_UI_MODE_CLI;
+
+	BarSocketIoSetBroadcastCallback(mockBroadcastCallback);
+	clearBroadcastMock();
+	BarSocketIoHandleMessage(&app, "2[\"subscribe\",[\"volume\",\"lyrics\"]]", NULL);
+	ck_assert_ptr_nonnull(lastBroadcastMessage);
+	ck_assert_ptr_nonnull(strstr(lastBroadcastMessage, "\"error\""));
+	ck_assert_ptr_nonnull(strstr(lastBroadcastMessage, "\"subscribe\""));
+
+	clearBroadcastMock();
+	BarSocketIoHandleMessage(&app, "2[\"subscribe\",\"volume\"]", NULL);
+	BarSocketIoHandleMessage(&app, "2[\"subscribe\",null]", NULL);
+	ck_assert_ptr_null(lastBroadcastMessage);
+
+	BarSettingsDestroy(&app.settings);
+}
+END_TEST
+
 START_TEST(test_socketio_handle_query_stations_event_emits_station_list) {
 	BarApp_t app;
 	PianoStation_t station;
@@ -746,6 +824,44 @@ START_TEST (test_socketio_volume_set_clamps_out_of_range) {
 }
 END_TEST
 
+static int g_volumeApplied = -1;
+static void recordVolume (int percent, void *userdata) {
+	(void) userdata;
+	g_volumeApplied = percent;
+}
+
+/* volume.set goes to the volume worker from the service thread instead of
+ * waiting in the command queue; everything else is left for dispatch */
+START_TEST (test_socketio_volume_set_taken_before_command_queue) {
+	BarApp_t app;
+	BarWsContext_t ctx;
+	BarSocketIoPacket_t pkt;
+	memset (&app, 0, sizeof (app));
+	memset (&ctx, 0, sizeof (ctx));
+	app.wsContext = &ctx;
+	ck_assert (BarWsVolumeWorkerStart (&ctx.volumeWorker, 10, recordVolume, NULL));
+
+	ck_assert (BarSocketIoParsePacket (
+			"2[\"action\",{\"action\":\"volume.set\",\"volume\":150}]", &pkt));
+	ck_assert (BarSocketIoTakeVolumePacket (&app, &pkt));
+	BarSocketIoPacketFree (&pkt);
+
+	ck_assert (BarSocketIoParsePacket ("2[\"action\",\"playback.toggle\"]", &pkt));
+	ck_assert (!BarSocketIoTakeVolumePacket (&app, &pkt));
+	BarSocketIoPacketFree (&pkt);
+
+	BarWsVolumeWorkerStop (&ctx.volumeWorker);
+	ck_assert_int_eq (g_volumeApplied, 100);
+
+	/* no worker: the command worker applies it */
+	ck_assert (BarSocketIoParsePacket (
+			"2[\"action\",{\"action\":\"volume.set\",\"volume\":5}]", &pkt));
+	ck_assert (!BarSocketIoTakeVolumePacket (&app, &pkt));
+	BarSocketIoPacketFree (&pkt);
+	BarWsVolumeWorkerDestroy (&ctx.volumeWorker);
+}
+END_TEST
+
 START_TEST (test_socketio_build_stations_payload_sorts_snapshot) {
 	BarApp_t app;
 	PianoStation_t beta, alpha;
@@ -878,6 +994,148 @@ START_TEST (test_socketio_emit_process_includes_accounts) {
 }
 END_TEST
 
+/* RFC 7386 diff: changed members, nested objects recursively, removals as
+ * null, arrays replaced as a whole */
+START_TEST (test_socketio_merge_patch_diff) {
+	json_object *from = json_tokener_parse (
+			"{\"paused\":false,\"song\":{\"title\":\"T\",\"rating\":0},"
+			"\"accounts\":[1,2],\"elapsed\":3}");
+	json_object *to = json_tokener_parse (
+			"{\"paused\":false,\"song\":{\"title\":\"T\",\"rating\":1},"
+			"\"accounts\":[1,3],\"station\":\"Rock\"}");
+
+	json_object *patch = BarSocketIoMergePatchDiff (from, to);
+	json_object *expect = json_tokener_parse (
+			"{\"song\":{\"rating\":1},\"accounts\":[1,3],"
+			"\"station\":\"Rock\",\"elapsed\":null}");
+	ck_assert (json_object_equal (patch, expect));
+	json_object_put (patch);
+	json_object_put (expect);
+
+	patch = BarSocketIoMergePatchDiff (to, to);
+	ck_assert_int_eq (json_object_object_length (patch), 0);
+	json_object_put (patch);
+
+	json_object_put (from);
+	json_object_put (to);
+}
+END_TEST
+
+/* Unchanged state keeps its revision; a volume change yields a patch of
+ * just that member for the next revision */
+START_TEST (test_socketio_process_frames_patch_revision) {
+	BarApp_t app;
+	BarWsFrame_t *patch, *full;
+
+	memset (&app, 0, sizeof (app));
+	BarSettingsInit (&app.settings);
+	app.settings.volumeMode = BAR_VOLUME_MODE_PLAYER;
+	app.settings.volume = 40;
+	ck_assert_int_eq (pthread_mutex_init (&app.player.lock, NULL), 0);
+
+	BarSocketIoBuildProcessFrames (&app, &patch, &full);
+	BarWsFrameUnref (patch);
+	json_object *first = json_tokener_parse (BarWsFrameData (full) + 1);
+	BarWsFrameUnref (full);
+	json_object *rev;
+	ck_assert (json_object_object_get_ex (json_object_array_get_idx (first, 1),
+			"revision", &rev));
+	const int64_t base = json_object_get_int64 (rev);
+
+	ck_assert (!BarSocketIoBuildProcessFrames (&app, &patch, &full));
+	ck_assert_ptr_null (patch);
+	ck_assert_ptr_nonnull (strstr (BarWsFrameData (full), "\"volume\": 40"));
+	BarWsFrameUnref (full);
+
+	app.settings.volume = 41;
+	ck_assert (BarSocketIoBuildProcessFrames (&app, &patch, &full));
+	ck_assert_ptr_nonnull (patch);
+	json_object *p = json_tokener_parse (BarWsFrameData (patch) + 1);
+	ck_assert_str_eq (json_object_get_string (json_object_array_get_idx (p, 0)),
+			"process.patch");
+	json_object *body = json_object_array_get_idx (p, 1);
+	json_object *diff;
+	ck_assert (json_object_object_get_ex (body, "revision", &rev));
+	ck_assert_int_eq (json_object_get_int64 (rev), base + 1);
+	ck_assert (json_object_object_get_ex (body, "patch", &diff));
+	ck_assert_int_eq (json_object_object_length (diff), 1);
+	ck_assert (json_object_object_get_ex (diff, "volume", &rev));
+	ck_assert_int_eq (json_object_get_int (rev), 41);
+
+	json_object_put (p);
+	json_object_put (first);
+	BarWsFrameUnref (patch);
+	BarWsFrameUnref (full);
+	BarSettingsDestroy (&app.settings);
+	pthread_mutex_destroy (&app.player.lock);
+}
+END_TEST
+
+/* The index.html snapshot is reused until the process revision or the
+ * station list moves, and cannot close its <script> element */
+START_TEST (test_socketio_snapshot_cached_per_revision) {
+	BarApp_t app;
+	PianoStation_t station;
+	BarWsFrame_t *patch, *full;
+
+	memset (&app, 0, sizeof (app));
+	memset (&station, 0, sizeof (station));
+	BarSettingsInit (&app.settings);
+	app.settings.volumeMode = BAR_VOLUME_MODE_PLAYER;
+	app.settings.volume = 30;
+	BarStateInit (&app);
+	ck_assert_int_eq (pthread_mutex_init (&app.player.lock, NULL), 0);
+	station.id = "s1";
+	station.name = "Rock </script><!-- Radio";
+	app.ph.stations = &station;
+
+	BarSocketIoBuildProcessFrames (&app, &patch, &full);
+	BarWsFrameUnref (patch);
+	BarWsFrameUnref (full);
+
+	BarWsFrame_t *first = BarSocketIoSnapshotFrame (&app);
+	ck_assert_ptr_nonnull (first);
+	BarWsFrame_t *again = BarSocketIoSnapshotFrame (&app);
+	ck_assert_ptr_eq (again, first);
+	BarWsFrameUnref (again);
+
+	ck_assert_ptr_null (strchr (BarWsFrameData (first), '<'));
+	json_object *doc = json_tokener_parse (BarWsFrameData (first));
+	ck_assert_ptr_nonnull (doc);
+	json_object *process, *stations, *val;
+	ck_assert (json_object_object_get_ex (doc, "process", &process));
+	ck_assert (json_object_object_get_ex (process, "revision", &val));
+	ck_assert (json_object_object_get_ex (process, "volume", &val));
+	ck_assert_int_eq (json_object_get_int (val), 30);
+	ck_assert (json_object_object_get_ex (doc, "stations", &stations));
+	ck_assert (json_object_object_get_ex (json_object_array_get_idx (stations, 0),
+			"name", &val));
+	ck_assert_str_eq (json_object_get_string (val), "Rock </script><!-- Radio");
+	json_object_put (doc);
+
+	/* a new process revision */
+	app.settings.volume = 31;
+	ck_assert (BarSocketIoBuildProcessFrames (&app, &patch, &full));
+	BarWsFrameUnref (patch);
+	BarWsFrameUnref (full);
+	BarWsFrame_t *second = BarSocketIoSnapshotFrame (&app);
+	ck_assert_ptr_ne (second, first);
+	ck_assert_ptr_nonnull (strstr (BarWsFrameData (second), "\"volume\":31"));
+
+	/* a new station list */
+	BarSocketIoStationsChanged ();
+	BarWsFrame_t *third = BarSocketIoSnapshotFrame (&app);
+	ck_assert_ptr_ne (third, second);
+
+	BarWsFrameUnref (first);
+	BarWsFrameUnref (second);
+	BarWsFrameUnref (third);
+	pthread_mutex_destroy (&app.player.lock);
+	BarStateDestroy (&app);
+	BarSettingsDestroy (&app.settings);
+}
+END_TEST
+
 /* app.pandora-reconnect with unknown account_id emits error and leaves active index */
 START_TEST (test_socketio_pandora_reconnect_unknown_account) {
 	BarApp_t app;
@@ -1026,7 +1284,7 @@ END_TEST
 START_TEST (test_socketio_unimplemented_actions_emit_error)
 {
 	static const char *unimplemented[] = {
-		"query.history", "song.bookmark", "app.settings", NULL
+		"song.bookmark", "app.settings", NULL
 	};
 
 	BarApp_t app;
@@ -1061,18 +1319,67 @@ START_TEST (test_socketio_format_event_message_returns_valid_packet)
 	struct json_object *data = json_object_new_object ();
 	json_object_object_add (data, "elapsed", json_object_new_int (7));
 
-	char *message = BarSocketIoFormatEventMessage ("progress", data);
+	BarWsFrame_t *frame = BarSocketIoFormatEventFrame ("progress", data);
 
-	ck_assert_ptr_nonnull (message);
+	ck_assert_ptr_nonnull (frame);
+	const char *message = BarWsFrameData (frame);
+	ck_assert_uint_eq (frame->len, strlen (message));
 	ck_assert (strncmp (message, "2[", 2) == 0);
 	ck_assert (strstr (message, "\"progress\"") != NULL);
 	ck_assert (strstr (message, "\"elapsed\"")  != NULL);
 
-	free (message);
+	BarWsFrameUnref (frame);
 	json_object_put (data);
 }
 END_TEST
 
+/* Formatted frames are counted per event; only those at or above the
+ * report minimum are deflate-measured, and a repetitive station list shrinks */
+START_TEST (test_socketio_format_records_deflate_stats)
+{
+	BarWsDeflateStat_t st[BAR_WS_DEFLATE_STATS_EVENT_MAX];
+
+	BarWsDeflateStatsEnable (256);
+
+	struct json_object *progress = json_object_new_object ();
+	json_object_object_add (progress, "elapsed", json_object_new_int (7));
+	struct json_object *stations = json_object_new_array ();
+	for (int i = 0; i < 50; i++) {
+		struct json_object *station = json_object_new_object ();
+		json_object_object_add (station, "id", json_object_new_int (1000 + i));
+		json_object_object_add (station, "name", json_object_new_string ("Radio"));
+		json_object_array_add (stations, station);
+	}
+
+	BarWsFrame_t *small = BarSocketIoFormatEventFrame ("progress", progress);
+	BarWsFrame_t *large = BarSocketIoFormatEventFrame ("stations", stations);
+	BarWsFrameUnref (BarSocketIoFormatEventFrame ("stations", stations));
+
+	ck_assert_uint_eq (BarWsDeflateStatsGet (st, BAR_WS_DEFLATE_STATS_EVENT_MAX), 2);
+	ck_assert_str_eq (st[0].event, "progress");
+	ck_assert_uint_eq (st[0].messages, 1);
+	ck_assert_uint_eq (st[0].bytes, small->len);
+	ck_assert_uint_eq (st[0].measured, 0);
+	ck_assert_str_eq (st[1].event, "stations");
+	ck_assert_uint_eq (st[1].messages, 2);
+	ck_assert_uint_eq (st[1].measured, 2);
+	ck_assert_uint_eq (st[1].measuredBytes, 2 * large->len);
+	ck_assert (st[1].deflatedBytes > 0);
+	ck_assert (st[1].deflatedBytes < st[1].measuredBytes / 4);
+
+	/* disabled: nothing is counted */
+	BarWsDeflateStatsDisable ();
+	BarWsFrameUnref (BarSocketIoFormatEventFrame ("progress", progress));
+	ck_assert_uint_eq (BarWsDeflateStatsGet (st, BAR_WS_DEFLATE_STATS_EVENT_MAX), 2);
+	ck_assert_uint_eq (st[0].messages, 1);
+
+	BarWsFrameUnref (small);
+	BarWsFrameUnref (large);
+	json_object_put (progress);
+	json_object_put (stations);
+}
+END_TEST
+
 START_TEST (test_socketio_emit_explanation_includes_text)
 {
 	BarApp_t app;
@@ -1857,6 +2164,9 @@ Suite *socketio_suite(void) {
 	tcase_add_test(tc_emit, test_socketio_emit_progress);
 	tcase_add_test(tc_emit, test_socketio_emit_volume);
 	tcase_add_test(tc_emit, test_socketio_emit_process_includes_accounts);
+	tcase_add_test(tc_emit, test_socketio_merge_patch_diff);
+	tcase_add_test(tc_emit, test_socketio_process_frames_patch_revision);
+	tcase_add_test(tc_emit, test_socketio_snapshot_cached_per_revision);
 	suite_add_tcase(s, tc_emit);
 	
 	/* Action dispatch tests */
@@ -1879,6 +2189,9 @@ Suite *socketio_suite(void) {
 	tc_handle = tcase_create("Event Handlers");
 	tcase_add_test(tc_handle, test_socketio_handle_query);
 	tcase_add_test(tc_handle, test_socketio_ping_keepalive_noop);
+	tcase_add_test(tc_handle, test_socketio_parse_packet_filters_for_dispatch);
+	tcase_add_test(tc_handle, test_socketio_parse_msgpack_packet);
+	tcase_add_test(tc_handle, test_socketio_subscribe_rejects_unknown_topic);
 	tcase_add_test(tc_handle, test_socketio_handle_query_stations_event_emits_station_list);
 	tcase_add_test(tc_handle, test_socketio_handle_action_object_command_emits_not_implemented_error);
 	tcase_add_test(tc_handle, test_socketio_handle_station_change_missing_station_reports_error);
@@ -1893,6 +2206,7 @@ Suite *socketio_suite(void) {
 	tcase_add_test(tc_handle, test_socketio_handle_change_station_switches_when_found);
 	tcase_add_test(tc_handle, test_socketio_volume_set_action_updates_player_volume);
 	tcase_add_test(tc_handle, test_socketio_volume_set_clamps_out_of_range);
+	tcase_add_test(tc_handle, test_socketio_volume_set_taken_before_command_queue);
 	tcase_add_test(tc_handle, test_socketio_volume_set_system_mode);
 	tcase_add_test(tc_handle, test_socketio_handle_rename_station_success);
 	tcase_add_test(tc_handle, test_socketio_handle_add_music_success);
@@ -1914,6 +2228,7 @@ Suite *socketio_suite(void) {
 	/* Formatter tests */
 	TCase *tc_format = tcase_create ("Format");
 	tcase_add_test (tc_format, test_socketio_format_event_message_returns_valid_packet);
+	tcase_add_test (tc_format, test_socketio_format_records_deflate_stats);
 	suite_add_tcase (s, tc_format);
 
 	TCase *tc_extra = tcase_create ("Extended coverage");
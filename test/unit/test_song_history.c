@@ -0,0 +1,119 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/song_history.h"
+
+static void pushTitle (BarSongHistory_t *h, size_t capacity, const char *title) {
+	PianoSong_t song;
+	memset (&song, 0, sizeof (song));
+	song.title = (char *) title;
+	song.trackToken = (char *) title;
+	song.audioUrl = (char *) "http://example.com/not-kept";
+	ck_assert (BarSongHistoryPush (h, capacity, &song));
+}
+
+START_TEST (test_song_history_wraps_newest_first)
+{
+	BarSongHistory_t h;
+	memset (&h, 0, sizeof (h));
+
+	pushTitle (&h, 3, "a");
+	pushTitle (&h, 3, "b");
+	pushTitle (&h, 3, "c");
+	pushTitle (&h, 3, "d");
+
+	ck_assert_uint_eq (h.count, 3);
+	ck_assert_str_eq (BarSongHistoryAt (&h, 0)->title, "d");
+	ck_assert_str_eq (BarSongHistoryAt (&h, 1)->title, "c");
+	ck_assert_str_eq (BarSongHistoryAt (&h, 2)->title, "b");
+	ck_assert_ptr_null (BarSongHistoryAt (&h, 3));
+	ck_assert_ptr_null (BarSongHistoryAt (&h, 0)->album);
+
+	BarSongHistoryDestroy (&h);
+}
+END_TEST
+
+START_TEST (test_song_history_resize_keeps_newest)
+{
+	BarSongHistory_t h;
+	memset (&h, 0, sizeof (h));
+
+	for (char t[2] = "a"; t[0] <= 'e'; t[0]++) {
+		pushTitle (&h, 5, t);
+	}
+	/* settings.history lowered to 2, then raised again */
+	pushTitle (&h, 2, "f");
+	ck_assert_uint_eq (h.count, 2);
+	ck_assert_str_eq (BarSongHistoryAt (&h, 0)->title, "f");
+	ck_assert_str_eq (BarSongHistoryAt (&h, 1)->title, "e");
+
+	pushTitle (&h, 4, "g");
+	ck_assert_uint_eq (h.count, 3);
+	ck_assert_str_eq (BarSongHistoryAt (&h, 0)->title, "g");
+	ck_assert_str_eq (BarSongHistoryAt (&h, 2)->title, "e");
+
+	/* 0 disables and drops everything */
+	PianoSong_t song;
+	memset (&song, 0, sizeof (song));
+	ck_assert (!BarSongHistoryPush (&h, 0, &song));
+	ck_assert_uint_eq (h.count, 0);
+
+	BarSongHistoryDestroy (&h);
+}
+END_TEST
+
+START_TEST (test_song_history_rating_and_copy)
+{
+	BarSongHistory_t h;
+	memset (&h, 0, sizeof (h));
+
+	pushTitle (&h, 2, "x");
+	pushTitle (&h, 2, "y");
+	BarSongHistorySetRating (&h, "x", PIANO_RATE_LOVE);
+	ck_assert_int_eq (BarSongHistoryAt (&h, 1)->rating, PIANO_RATE_LOVE);
+	ck_assert_int_eq (BarSongHistoryAt (&h, 0)->rating, PIANO_RATE_NONE);
+
+	PianoSong_t *song = BarSongHistoryEntryToSong (BarSongHistoryAt (&h, 1));
+	ck_assert_ptr_nonnull (song);
+	ck_assert_str_eq (song->title, "x");
+	ck_assert_str_eq (song->trackToken, "x");
+	ck_assert_ptr_null (song->audioUrl);
+	ck_assert_int_eq (song->rating, PIANO_RATE_LOVE);
+	PianoDestroyPlaylist (song);
+
+	BarSongHistoryDestroy (&h);
+}
+END_TEST
+
+Suite *song_history_suite (void) {
+	Suite *s = suite_create ("song_history");
+	TCase *tc = tcase_create ("ring");
+	tcase_add_test (tc, test_song_history_wraps_newest_first);
+	tcase_add_test (tc, test_song_history_resize_keeps_newest);
+	tcase_add_test (tc, test_song_history_rating_and_copy);
+	suite_add_tcase (s, tc);
+	return s;
+}
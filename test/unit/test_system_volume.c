@@ -56,6 +56,25 @@ START_TEST (test_system_volume_rejects_malformed_pactl_json)
 }
 END_TEST
 
+/* Only sink and server events can move the default sink's volume */
+START_TEST (test_system_volume_filters_pactl_subscribe_events)
+{
+#ifdef __APPLE__
+	ck_assert (1);
+#else
+	ck_assert (BarSystemVolumeParsePactlEvent ("Event 'change' on sink #0"));
+	ck_assert (BarSystemVolumeParsePactlEvent ("Event 'new' on sink #12"));
+	ck_assert (BarSystemVolumeParsePactlEvent ("Event 'change' on server #-1"));
+	ck_assert (!BarSystemVolumeParsePactlEvent ("Event 'change' on sink-input #40"));
+	ck_assert (!BarSystemVolumeParsePactlEvent ("Event 'new' on source-output #3"));
+	ck_assert (!BarSystemVolumeParsePactlEvent ("Event 'change' on client #7"));
+	ck_assert (!BarSystemVolumeParsePactlEvent ("Ereignis »change« auf Sink #0"));
+	ck_assert (!BarSystemVolumeParsePactlEvent (""));
+	ck_assert (!BarSystemVolumeParsePactlEvent (NULL));
+#endif
+}
+END_TEST
+
 /* Public API exercises the platform backend.  These tests verify default-state
  * behavior so the public surface stays covered even where the underlying
  * backend cannot be exercised in a unit test (no audio device available). */
@@ -75,6 +94,33 @@ START_TEST (test_system_volume_public_api_default_state)
 }
 END_TEST
 
+/* An empty cache never answers a read; each one is counted as a miss */
+START_TEST (test_system_volume_cache_counts_misses)
+{
+	BarSystemVolumeState_t state;
+	unsigned long reads, misses;
+
+	BarSystemVolumeDestroy ();
+	BarSystemVolumeGetState (&state);
+	ck_assert_int_eq (state.volume, -1);
+	ck_assert_int_eq (state.muted, -1);
+	ck_assert_str_eq (state.device, "");
+	BarSystemVolumeCacheStats (&reads, &misses);
+	ck_assert_uint_eq (reads, 0);
+	ck_assert_uint_eq (misses, 0);
+
+	ck_assert_int_eq (BarSystemVolumeGet (), -1);
+	ck_assert_int_eq (BarSystemVolumeGet (), -1);
+	BarSystemVolumeCacheStats (&reads, &misses);
+	ck_assert_uint_eq (reads, 2);
+	ck_assert_uint_eq (misses, 2);
+
+	BarSystemVolumeDestroy ();
+	BarSystemVolumeCacheStats (&reads, &misses);
+	ck_assert_uint_eq (reads, 0);
+}
+END_TEST
+
 START_TEST (test_system_volume_set_clamps_out_of_range_inputs)
 {
 	/* Without an initialized backend the set call returns false but must
@@ -117,7 +163,9 @@ Suite *system_volume_suite (void)
 	TCase *tc = tcase_create ("pactl");
 	tcase_add_test (tc, test_system_volume_parses_pactl_json_first_channel);
 	tcase_add_test (tc, test_system_volume_rejects_malformed_pactl_json);
+	tcase_add_test (tc, test_system_volume_filters_pactl_subscribe_events);
 	tcase_add_test (tc, test_system_volume_public_api_default_state);
+	tcase_add_test (tc, test_system_volume_cache_counts_misses);
 	tcase_add_test (tc, test_system_volume_set_clamps_out_of_range_inputs);
 #ifdef __APPLE__
 	tcase_add_test (tc, test_system_volume_macos_init_get_set_roundtrip);
@@ -77,8 +77,10 @@ bool BarWsTransformIfShared (BarApp_t *app, PianoStation_t *station);
 static char *last_broadcast_msg = NULL;
 
 static void
-mock_broadcast (const char *message, size_t len)
+mock_broadcast (BarWsFrame_t *frame)
 {
+	const char *message = BarWsFrameData (frame);
+	size_t len = frame->len;
 	free (last_broadcast_msg);
 	last_broadcast_msg = malloc (len + 1);
 	memcpy (last_broadcast_msg, message, len);
@@ -188,8 +190,8 @@ static const char *
 ws_bucket_payload (BarWsContext_t *ctx, BarWsBucketType_t bucket)
 {
 	ck_assert_ptr_nonnull (ctx->buckets[bucket].message);
-	ck_assert_ptr_nonnull (ctx->buckets[bucket].message->data);
-	return (const char *) ctx->buckets[bucket].message->data;
+	ck_assert_ptr_nonnull (ctx->buckets[bucket].message->frame);
+	return BarWsFrameData (ctx->buckets[bucket].message->frame);
 }
 
 START_TEST (test_ui_act_pandora_reconnect_no_credentials)
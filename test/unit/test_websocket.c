@@ -21,6 +21,7 @@ THE SOFTWARE.
 */
 
 #include <check.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,15 +31,19 @@ THE SOFTWARE.
 #include "../../src/settings.h"
 #include "../../src/bar_state.h"
 #include "../../src/system_volume.h"
+#include "../../src/ui.h"
 #include "../../src/websocket_bridge.h"
 #include "../../src/websocket/core/websocket.h"
 #include "../../src/websocket/protocol/socketio.h"
 #include <json-c/json.h>
 #include <pthread.h>
+#include <stdatomic.h>
 
 /* Wire-compat capture buffer */
 static char g_compatBuf[8192];
-static void compatCapture (const char *msg, size_t len) {
+static void compatCapture (BarWsFrame_t *frame) {
+	const char *msg = BarWsFrameData (frame);
+	size_t len = frame->len;
 	size_t copy = len < sizeof (g_compatBuf) - 1 ? len : sizeof (g_compatBuf) - 1;
 	memcpy (g_compatBuf, msg, copy);
 	g_compatBuf[copy] = '\0';
@@ -69,7 +74,7 @@ END_TEST
 /* Test: Broadcast message with NULL app should not crash */
 START_TEST(test_websocket_broadcast_null) {
 	/* The new API: NULL app frees message and returns */
-	char *msg = strdup ("2[\"test\"]");
+	BarWsFrame_t *msg = BarWsFrameFromString ("2[\"test\"]");
 	BarWebsocketBroadcastSocketIoMessage (NULL, BUCKET_STATE, msg);
 	/* If we get here without crashing, test passes */
 	ck_assert (1);
@@ -99,8 +104,8 @@ static void test_ws_context_destroy_buckets (BarWsContext_t *ctx) {
 
 static const char *test_bucket_payload (BarWsContext_t *ctx, BarWsBucketType_t bucket) {
 	ck_assert_ptr_nonnull (ctx->buckets[bucket].message);
-	ck_assert_ptr_nonnull (ctx->buckets[bucket].message->data);
-	return (const char *)ctx->buckets[bucket].message->data;
+	ck_assert_ptr_nonnull (ctx->buckets[bucket].message->frame);
+	return BarWsFrameData (ctx->buckets[bucket].message->frame);
 }
 
 static void test_setup_web_app (BarApp_t *app, BarWsContext_t *ctx) {
@@ -161,6 +166,121 @@ START_TEST(test_websocket_bridge_broadcast_process_queues_snapshot_payload) {
 }
 END_TEST
 
+/* Takes the STATE bucket's frame the way the service thread does */
+static BarWsFrame_t *test_take_state_frame (BarWsContext_t *ctx) {
+	BarWsMessage_t *msg = ctx->buckets[BUCKET_STATE].message;
+	ck_assert_ptr_nonnull (msg);
+	ctx->buckets[BUCKET_STATE].message = NULL;
+	BarWsFrame_t *frame = BarWsFrameRef (msg->frame);
+	BarWsMessageFree (msg);
+	return frame;
+}
+
+/* Every revision goes through the STATE bucket in order: a patch when the
+ * bucket is free, the full state when one is still waiting there, and a
+ * reply to one client hands the others its patch the same way */
+START_TEST(test_websocket_bridge_process_revisions_in_order) {
+	BarApp_t app;
+	BarWsContext_t ctx;
+	PianoSong_t song;
+	PianoStation_t station;
+	char wsi;
+	test_setup_web_app (&app, &ctx);
+	test_attach_station_and_song (&app, &station, &song);
+
+	BarWsBroadcastProcess (&app);
+	BarWsFrame_t *f = test_take_state_frame (&ctx);
+	ck_assert (strstr (BarWsFrameData (f), "\"process\"") != NULL);
+	ck_assert (!f->incremental);
+	BarWsFrameUnref (f);
+
+	app.settings.volume = 41;
+	BarWsBroadcastProcess (&app);
+	f = test_take_state_frame (&ctx);
+	ck_assert (strstr (BarWsFrameData (f), "\"process.patch\"") != NULL);
+	ck_assert (strstr (BarWsFrameData (f), "\"revision\": 2") != NULL);
+	ck_assert (f->incremental);
+	BarWsFrameUnref (f);
+
+	/* undelivered patch: the next revision replaces it with the full state */
+	app.settings.volume = 42;
+	BarWsBroadcastProcess (&app);
+	app.settings.volume = 43;
+	BarWsBroadcastProcess (&app);
+	f = test_take_state_frame (&ctx);
+	ck_assert (strstr (BarWsFrameData (f), "\"process\"") != NULL);
+	ck_assert (strstr (BarWsFrameData (f), "\"revision\": 4") != NULL);
+	BarWsFrameUnref (f);
+
+	g_compatBuf[0] = '\0';
+	BarSocketIoSetBroadcastCallback (compatCapture);
+	app.settings.volume = 44;
+	BarSocketIoEmitProcessUnicast (&app, &wsi);
+	ck_assert (strstr (g_compatBuf, "\"process\"") != NULL);
+	ck_assert (strstr (g_compatBuf, "\"revision\": 5") != NULL);
+	f = test_take_state_frame (&ctx);
+	ck_assert (strstr (BarWsFrameData (f), "\"process.patch\"") != NULL);
+	ck_assert (strstr (BarWsFrameData (f), "\"revision\": 5") != NULL);
+	BarWsFrameUnref (f);
+
+	/* to everyone: through the bucket, not around it */
+	g_compatBuf[0] = '\0';
+	BarSocketIoEmitProcess (&app);
+	ck_assert_str_eq (g_compatBuf, "");
+	f = test_take_state_frame (&ctx);
+	ck_assert (strstr (BarWsFrameData (f), "\"revision\": 5") != NULL);
+	BarWsFrameUnref (f);
+
+	BarSocketIoSetBroadcastCallback (NULL);
+	test_teardown_web_app (&app, &ctx);
+}
+END_TEST
+
+static atomic_bool g_processBroadcasterStop;
+
+/* Broadcasts the process state until told to stop */
+static void *test_process_broadcaster (void *arg) {
+	BarApp_t *app = arg;
+	while (!atomic_load (&g_processBroadcasterStop)) {
+		BarWsBroadcastProcess (app);
+	}
+	return NULL;
+}
+
+/* One thread changes the state while another keeps broadcasting it: every
+ * revision is built from the state current when it is assigned, so each
+ * change makes exactly one and an older state is never sent after a newer
+ * one (that would take two more revisions to undo) */
+START_TEST(test_websocket_bridge_process_last_revision_is_latest_state) {
+	BarApp_t app;
+	BarWsContext_t ctx;
+	pthread_t broadcaster;
+	test_setup_web_app (&app, &ctx);
+	BarWsBroadcastProcess (&app);
+
+	atomic_store (&g_processBroadcasterStop, false);
+	ck_assert_int_eq (pthread_create (&broadcaster, NULL,
+			test_process_broadcaster, &app), 0);
+	for (int i = 1; i <= 500; i++) {
+		app.settings.volume = 40 + i;
+		BarWsBroadcastProcess (&app);
+		/* let the broadcaster finish what it was building */
+		sched_yield ();
+	}
+	atomic_store (&g_processBroadcasterStop, true);
+	ck_assert_int_eq (pthread_join (broadcaster, NULL), 0);
+
+	BarWsFrame_t *patch, *full;
+	ck_assert (!BarSocketIoBuildProcessFrames (&app, &patch, &full));
+	ck_assert_ptr_null (patch);
+	ck_assert (strstr (BarWsFrameData (full), "\"volume\": 540") != NULL);
+	ck_assert (strstr (BarWsFrameData (full), "\"revision\": 501") != NULL);
+	BarWsFrameUnref (full);
+
+	test_teardown_web_app (&app, &ctx);
+}
+END_TEST
+
 START_TEST(test_websocket_bridge_broadcasts_real_player_state_buckets) {
 	BarApp_t app;
 	BarWsContext_t ctx;
@@ -442,6 +562,88 @@ START_TEST(test_websocket_disconnect_all_clients_null_app) {
 }
 END_TEST
 
+/* "subscribe" narrows a client to some buckets and drops what it queued
+ * for the others; replies outside the buckets still get through */
+START_TEST (test_websocket_subscribe_drops_unwanted_buckets)
+{
+	BarApp_t app;
+	BarWsContext_t ctx;
+	BarWsConnection_t conn;
+	char wsi;
+	test_setup_web_app (&app, &ctx);
+	pthread_mutex_init (&ctx.connMutex, NULL);
+	BarWsConnectionListInit (&ctx.clients, 4);
+	memset (&conn, 0, sizeof (conn));
+	ck_assert (BarWsConnectionAttach (&ctx.clients, &conn, &wsi, "socketio", 8));
+
+	BarWsFrame_t *state = BarWsFrameFromString ("2[\"start\"]");
+	BarWsFrame_t *volume = BarWsFrameFromString ("2[\"volume\",5]");
+	BarWsFrame_t *reply = BarWsFrameFromString ("2[\"error\",{}]");
+	BarWsOutQueuePush (&conn.queue, state, BUCKET_STATE, false, false);
+	BarWsOutQueuePush (&conn.queue, volume, BUCKET_VOLUME, false, false);
+	BarWsOutQueuePush (&conn.queue, reply, BAR_WS_FRAME_NO_BUCKET, false, false);
+
+	BarWebsocketSubscribe (&app, &wsi, 1u << BUCKET_VOLUME);
+	ck_assert (BarWsConnectionWants (&conn, BUCKET_VOLUME));
+	ck_assert (!BarWsConnectionWants (&conn, BUCKET_STATE));
+	ck_assert (!BarWsConnectionWants (&conn, BUCKET_STATIONS));
+	ck_assert (BarWsConnectionWants (&conn, BAR_WS_FRAME_NO_BUCKET));
+
+	BarWsFrame_t *f = BarWsOutQueuePop (&conn.queue);
+	ck_assert_ptr_eq (f, volume);
+	BarWsFrameUnref (f);
+	f = BarWsOutQueuePop (&conn.queue);
+	ck_assert_ptr_eq (f, reply);
+	BarWsFrameUnref (f);
+	ck_assert (BarWsOutQueueEmpty (&conn.queue));
+
+	BarWebsocketSubscribe (&app, &wsi, BAR_WS_SUBSCRIBE_ALL);
+	ck_assert_uint_eq (conn.unsubscribed, 0);
+
+	BarWsBucketType_t bucket;
+	ck_assert (BarWsBucketByName ("stations", &bucket));
+	ck_assert_int_eq (bucket, BUCKET_STATIONS);
+	ck_assert (!BarWsBucketByName ("all", &bucket));
+
+	BarWsConnectionDetach (&ctx.clients, &conn);
+	BarWsFrameUnref (state);
+	BarWsFrameUnref (volume);
+	BarWsFrameUnref (reply);
+	pthread_mutex_destroy (&ctx.connMutex);
+	test_teardown_web_app (&app, &ctx);
+}
+END_TEST
+
+START_TEST (test_websocket_disconnect_all_marks_owning_service_threads)
+{
+	BarApp_t app;
+	BarWsContext_t ctx;
+	BarWsConnection_t a, b;
+	char wsiA, wsiB;
+	test_setup_web_app (&app, &ctx);
+	pthread_mutex_init (&ctx.connMutex, NULL);
+	BarWsConnectionListInit (&ctx.clients, 4);
+	ctx.serviceThreads = 3;
+	ck_assert (BarWsConnectionAttach (&ctx.clients, &a, &wsiA, "socketio", 8));
+	ck_assert (BarWsConnectionAttach (&ctx.clients, &b, &wsiB, "socketio", 8));
+	a.tsi = 0;
+	b.tsi = 2;
+
+	/* only the threads owning a client have closes to request */
+	BarWebsocketDisconnectAllClients (&app);
+	ck_assert (a.pendingClose);
+	ck_assert (b.pendingClose);
+	ck_assert (ctx.service[0].writePending);
+	ck_assert (!ctx.service[1].writePending);
+	ck_assert (ctx.service[2].writePending);
+
+	BarWsConnectionDetach (&ctx.clients, &a);
+	BarWsConnectionDetach (&ctx.clients, &b);
+	pthread_mutex_destroy (&ctx.connMutex);
+	test_teardown_web_app (&app, &ctx);
+}
+END_TEST
+
 START_TEST(test_websocket_bridge_both_mode_is_web_active) {
 	BarApp_t app;
 	memset (&app, 0, sizeof (app));
@@ -570,6 +772,60 @@ START_TEST (test_wire_compat_stations_is_array)
 }
 END_TEST
 
+/* Pandora's station list, served in turn by the GET_STATIONS hook below */
+static const char *g_stationListResponse;
+
+static bool test_get_stations_hook (BarApp_t * const app,
+		const PianoRequestType_t type, void * const data,
+		PianoReturn_t * const pRet, CURLcode * const wRet) {
+	PianoRequest_t req;
+	ck_assert_int_eq (type, PIANO_REQUEST_GET_STATIONS);
+	memset (&req, 0, sizeof (req));
+	req.type = type;
+	req.data = data;
+	req.responseData = (char *) g_stationListResponse;
+	*wRet = CURLE_OK;
+	*pRet = PianoResponse (&app->ph, &req);
+	return *pRet == PIANO_RET_OK;
+}
+
+/* "station.refresh" merges into the live list, so a rename goes out as a
+ * stations.delta that client queues keep in order */
+START_TEST (test_websocket_station_refresh_broadcasts_delta)
+{
+	BarApp_t app;
+	BarWsContext_t ctx;
+	test_setup_web_app (&app, &ctx);
+	BarUiPianoCallSetTestHook (test_get_stations_hook);
+
+	/* nothing to diff against yet: full list */
+	g_stationListResponse = "{\"stat\":\"ok\",\"result\":{\"stations\":["
+	        "{\"stationToken\":\"1\",\"stationName\":\"One\"},"
+	        "{\"stationToken\":\"2\",\"stationName\":\"Two\"}]}}";
+	BarSocketIoHandleRefreshStations (&app);
+	ck_assert (strstr (test_bucket_payload (&ctx, BUCKET_STATIONS),
+	        "\"stations\"") != NULL);
+	BarWsMessageFree (ctx.buckets[BUCKET_STATIONS].message);
+	ctx.buckets[BUCKET_STATIONS].message = NULL;
+
+	g_stationListResponse = "{\"stat\":\"ok\",\"result\":{\"stations\":["
+	        "{\"stationToken\":\"1\",\"stationName\":\"Uno\"},"
+	        "{\"stationToken\":\"2\",\"stationName\":\"Two\"}]}}";
+	BarSocketIoHandleRefreshStations (&app);
+	const char *payload = test_bucket_payload (&ctx, BUCKET_STATIONS);
+	ck_assert (strstr (payload, "\"stations.delta\"") != NULL);
+	ck_assert (strstr (payload, "Uno") != NULL);
+	ck_assert (strstr (payload, "\"Two\"") == NULL);
+	ck_assert (ctx.buckets[BUCKET_STATIONS].message->frame->incremental);
+	ck_assert_uint_eq (PianoListCountP (app.ph.stations), 2);
+	ck_assert_str_eq (app.ph.stations->name, "Uno");
+
+	BarUiPianoCallClearTestHook ();
+	PianoDestroy (&app.ph);
+	test_teardown_web_app (&app, &ctx);
+}
+END_TEST
+
 /* Create test suite */
 Suite *websocket_suite(void) {
 	Suite *s;
@@ -585,6 +841,8 @@ Suite *websocket_suite(void) {
 	tcase_add_test(tc_core, test_websocket_broadcast_null);
 	tcase_add_test(tc_core, test_websocket_bridge_singleton_lock_null_app);
 	tcase_add_test(tc_core, test_websocket_bridge_broadcast_process_queues_snapshot_payload);
+	tcase_add_test(tc_core, test_websocket_bridge_process_revisions_in_order);
+	tcase_add_test(tc_core, test_websocket_bridge_process_last_revision_is_latest_state);
 	tcase_add_test(tc_core, test_websocket_bridge_broadcasts_real_player_state_buckets);
 	tcase_add_test(tc_core, test_websocket_bridge_start_stop_and_paused_progress);
 	tcase_add_test(tc_core, test_websocket_bridge_progress_skips_duplicate_elapsed);
@@ -595,6 +853,9 @@ Suite *websocket_suite(void) {
 	tcase_add_test(tc_core, test_websocket_disconnect_all_clients_null_app);
 	tcase_add_test(tc_core, test_websocket_bridge_system_volume_mode_broadcast);
 	tcase_add_test(tc_core, test_websocket_schedule_volume_broadcast_sets_pending_flag);
+	tcase_add_test(tc_core, test_websocket_subscribe_drops_unwanted_buckets);
+	tcase_add_test(tc_core, test_websocket_station_refresh_broadcasts_delta);
+	tcase_add_test(tc_core, test_websocket_disconnect_all_marks_owning_service_threads);
 	tcase_add_test(tc_core, test_websocket_bridge_both_mode_is_web_active);
 	tcase_add_test(tc_core, test_websocket_bridge_print_helpers_and_input_setup);
 	tcase_add_test(tc_core, test_websocket_bridge_predicates_and_cli_noops);
@@ -0,0 +1,151 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/websocket/core/connections.h"
+
+#define CLIENTS 500
+
+/* Stand-in for a wsi: any unique address will do */
+static char fakeWsi[CLIENTS + 1];
+
+/* 500 concurrent clients: all tracked in their own per-session blocks (as
+ * lws hands them out, zeroed), one broadcast frame shared by every queue,
+ * the client over the cap rejected, and arbitrary disconnects in O(1). */
+START_TEST (test_connections_500_clients)
+{
+	BarWsConnectionList_t list;
+	BarWsConnection_t *pss = calloc (CLIENTS + 1, sizeof (*pss));
+	ck_assert_ptr_nonnull (pss);
+
+	BarWsConnectionListInit (&list, CLIENTS);
+	for (size_t i = 0; i < CLIENTS; i++) {
+		ck_assert (BarWsConnectionAttach (&list, &pss[i], &fakeWsi[i],
+				"socketio", 4));
+	}
+	ck_assert_uint_eq (list.count, CLIENTS);
+	ck_assert (BarWsConnectionListFull (&list));
+
+	/* over the cap: refused, block untouched, detaching it is harmless */
+	ck_assert (!BarWsConnectionAttach (&list, &pss[CLIENTS], &fakeWsi[CLIENTS],
+			"socketio", 4));
+	ck_assert (!pss[CLIENTS].linked);
+	BarWsConnectionDetach (&list, &pss[CLIENTS]);
+	ck_assert_uint_eq (list.count, CLIENTS);
+
+	BarWsFrame_t *f = BarWsFrameFromString ("2[\"stop\"]");
+	size_t visited = 0;
+	BarWsConnectionForeach (&list, c) {
+		ck_assert_str_eq (c->protocol, "socketio");
+		ck_assert_int_eq (BarWsOutQueuePush (&c->queue, f, 0, false, true),
+				BAR_WS_OUTQ_QUEUED);
+		++visited;
+	}
+	ck_assert_uint_eq (visited, CLIENTS);
+	ck_assert_uint_eq (atomic_load (&f->refs), CLIENTS + 1);
+
+	/* every other client goes away, releasing its frame reference */
+	for (size_t i = 0; i < CLIENTS; i += 2) {
+		BarWsConnectionDetach (&list, &pss[i]);
+	}
+	ck_assert_uint_eq (list.count, CLIENTS / 2);
+	ck_assert_uint_eq (atomic_load (&f->refs), CLIENTS / 2 + 1);
+	ck_assert_ptr_null (BarWsConnectionFind (&list, &fakeWsi[0]));
+	ck_assert_ptr_eq (BarWsConnectionFind (&list, &fakeWsi[1]), &pss[1]);
+	visited = 0;
+	BarWsConnectionForeach (&list, c) {
+		ck_assert_uint_eq ((size_t) (c - pss) % 2, 1);
+		++visited;
+	}
+	ck_assert_uint_eq (visited, CLIENTS / 2);
+
+	/* freed capacity is usable again */
+	ck_assert (!BarWsConnectionListFull (&list));
+	ck_assert (BarWsConnectionAttach (&list, &pss[CLIENTS], &fakeWsi[CLIENTS],
+			"homeassistant", 4));
+	ck_assert_uint_eq (list.count, CLIENTS / 2 + 1);
+
+	for (size_t i = 1; i <= CLIENTS; i += 2) {
+		BarWsConnectionDetach (&list, &pss[i]);
+	}
+	BarWsConnectionDetach (&list, &pss[CLIENTS]);
+	ck_assert_uint_eq (list.count, 0);
+	ck_assert_ptr_null (list.head);
+	ck_assert_uint_eq (atomic_load (&f->refs), 1);
+
+	BarWsFrameUnref (f);
+	free (pss);
+}
+END_TEST
+
+/* A QuickMix selection split over three fragments is assembled into one
+ * NUL-terminated message; a new message reuses the buffer; one over the
+ * limit is refused and leaves nothing behind. */
+START_TEST (test_connections_rx_fragments)
+{
+	BarWsRxBuffer_t rx = { 0 };
+	const char *parts[] = { "2[\"station.setQuickMix\",{\"stationIds\":[",
+			"\"1\",\"2\",\"3\"", "]}]" };
+
+	for (size_t i = 0; i < 3; i++) {
+		ck_assert (BarWsRxAppend (&rx, parts[i], strlen (parts[i]), i == 0,
+				4096));
+	}
+	ck_assert_str_eq (rx.data, "2[\"station.setQuickMix\","
+			"{\"stationIds\":[\"1\",\"2\",\"3\"]}]");
+	ck_assert_uint_eq (rx.len, strlen (rx.data));
+
+	/* empty final fragment */
+	ck_assert (BarWsRxAppend (&rx, NULL, 0, false, 4096));
+	ck_assert_uint_eq (rx.len, strlen (rx.data));
+
+	char *const kept = rx.data;
+	BarWsRxRelease (&rx, 4096);
+	ck_assert_ptr_eq (rx.data, kept);
+	ck_assert (BarWsRxAppend (&rx, "0", 1, true, 4096));
+	ck_assert_ptr_eq (rx.data, kept);
+	ck_assert_str_eq (rx.data, "0");
+
+	/* limit counts the whole message, not the fragment */
+	char big[3000];
+	memset (big, 'x', sizeof (big));
+	ck_assert (BarWsRxAppend (&rx, big, sizeof (big), true, 4096));
+	ck_assert (!BarWsRxAppend (&rx, big, sizeof (big), false, 4096));
+	ck_assert_uint_eq (rx.len, 0);
+	ck_assert (rx.alloc <= 4096 + 1);
+
+	BarWsRxRelease (&rx, 0);
+	ck_assert_ptr_null (rx.data);
+}
+END_TEST
+
+Suite *ws_connections_suite (void) {
+	Suite *s = suite_create ("ws_connections");
+	TCase *tc = tcase_create ("connection list");
+	tcase_add_test (tc, test_connections_500_clients);
+	tcase_add_test (tc, test_connections_rx_fragments);
+	suite_add_tcase (s, tc);
+	return s;
+}
@@ -0,0 +1,179 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+#include <json-c/json.h>
+
+#include "../../src/websocket/protocol/msgpack.h"
+
+static unsigned char *encode (json_object *obj, size_t *len) {
+	*len = BarMsgpackSize (obj);
+	unsigned char *buf = malloc (*len);
+	ck_assert_ptr_nonnull (buf);
+	ck_assert_ptr_eq (BarMsgpackWrite (obj, buf), buf + *len);
+	return buf;
+}
+
+/* Smallest format for each value, checked byte for byte */
+START_TEST (test_msgpack_encode_formats)
+{
+	static const struct {
+		const char *json;
+		const char *hex;
+	} cases[] = {
+		{"0", "00"}, {"127", "7f"}, {"128", "cc80"}, {"65535", "cdffff"},
+		{"65536", "ce00010000"}, {"4294967296", "cf0000000100000000"},
+		{"-1", "ff"}, {"-32", "e0"}, {"-33", "d0df"}, {"-129", "d1ff7f"},
+		{"-32769", "d2ffff7fff"}, {"-2147483649", "d3ffffffff7fffffff"},
+		{"1.5", "cb3ff8000000000000"}, {"null", "c0"}, {"true", "c3"},
+		{"false", "c2"}, {"\"ab\"", "a26162"}, {"[]", "90"},
+		{"[1,[2]]", "920191" "02"}, {"{\"a\":null}", "81a161c0"},
+	};
+
+	for (size_t i = 0; i < sizeof (cases) / sizeof (*cases); i++) {
+		json_object *obj = json_tokener_parse (cases[i].json);
+		size_t len;
+		unsigned char *buf = encode (obj, &len);
+		char hex[64] = "";
+		for (size_t j = 0; j < len && 2 * j + 2 < sizeof (hex); j++) {
+			sprintf (hex + 2 * j, "%02x", buf[j]);
+		}
+		ck_assert_msg (strcmp (hex, cases[i].hex) == 0, "%s: %s, expected %s",
+				cases[i].json, hex, cases[i].hex);
+		free (buf);
+		json_object_put (obj);
+	}
+}
+END_TEST
+
+/* str8/str16 and array16/map16 kick in past the fix formats, and whatever
+ * is encoded decodes to an equal value */
+START_TEST (test_msgpack_roundtrip)
+{
+	json_object *obj = json_object_new_object ();
+	json_object *list = json_object_new_array ();
+	char name[8];
+	for (int i = 0; i < 20; i++) {
+		snprintf (name, sizeof (name), "k%d", i);
+		json_object_object_add (obj, name, json_object_new_int (i * 1000));
+		json_object_array_add (list, json_object_new_double (i / 4.0));
+	}
+	char longStr[300];
+	memset (longStr, 'x', sizeof (longStr) - 1);
+	longStr[sizeof (longStr) - 1] = '\0';
+	json_object_object_add (obj, "str16", json_object_new_string (longStr));
+	json_object_object_add (obj, "str8", json_object_new_string_len (longStr, 40));
+	json_object_object_add (obj, "list", list);
+
+	size_t len;
+	unsigned char *buf = encode (obj, &len);
+	ck_assert_uint_eq (buf[0], 0xde); /* map16 */
+
+	json_object *back = NULL;
+	ck_assert (BarMsgpackDecode (buf, len, &back));
+	ck_assert (json_object_equal (obj, back));
+
+	/* every proper prefix is rejected, as is a trailing byte */
+	for (size_t i = 0; i < len; i++) {
+		json_object *partial = NULL;
+		ck_assert (!BarMsgpackDecode (buf, i, &partial));
+		ck_assert_ptr_null (partial);
+	}
+	unsigned char *longer = malloc (len + 1);
+	memcpy (longer, buf, len);
+	longer[len] = 0xc0;
+	json_object *trailing = NULL;
+	ck_assert (!BarMsgpackDecode (longer, len + 1, &trailing));
+	ck_assert_ptr_null (trailing);
+
+	free (longer);
+	free (buf);
+	json_object_put (back);
+	json_object_put (obj);
+}
+END_TEST
+
+/* Input from clients: only what JSON can represent, bounded nesting */
+START_TEST (test_msgpack_decode_rejects)
+{
+	json_object *out = NULL;
+
+	/* bin8, ext, 0xc1, integer map key, key with NUL, uint64 > INT64_MAX */
+	static const unsigned char bin[] = {0xc4, 0x01, 0x00};
+	static const unsigned char ext[] = {0xd4, 0x01, 0x00};
+	static const unsigned char unused[] = {0xc1};
+	static const unsigned char intKey[] = {0x81, 0x01, 0x02};
+	static const unsigned char nulKey[] = {0x81, 0xa2, 'a', 0x00, 0xc0};
+	static const unsigned char huge[] = {0xcf, 0xff, 0xff, 0xff, 0xff, 0xff,
+			0xff, 0xff, 0xff};
+	/* array32 claiming more elements than there are bytes */
+	static const unsigned char count[] = {0xdd, 0xff, 0xff, 0xff, 0xff, 0xc0};
+	ck_assert (!BarMsgpackDecode (bin, sizeof (bin), &out));
+	ck_assert (!BarMsgpackDecode (ext, sizeof (ext), &out));
+	ck_assert (!BarMsgpackDecode (unused, sizeof (unused), &out));
+	ck_assert (!BarMsgpackDecode (intKey, sizeof (intKey), &out));
+	ck_assert (!BarMsgpackDecode (nulKey, sizeof (nulKey), &out));
+	ck_assert (!BarMsgpackDecode (huge, sizeof (huge), &out));
+	ck_assert (!BarMsgpackDecode (count, sizeof (count), &out));
+	ck_assert (!BarMsgpackDecode (NULL, 0, &out));
+	ck_assert_ptr_null (out);
+
+	unsigned char deep[BAR_MSGPACK_DEPTH_MAX + 2];
+	memset (deep, 0x91, sizeof (deep) - 1);
+	deep[sizeof (deep) - 1] = 0xc0;
+	ck_assert (!BarMsgpackDecode (deep, sizeof (deep), &out));
+	ck_assert (BarMsgpackDecode (deep + 1, sizeof (deep) - 1, &out));
+	json_object_put (out);
+}
+END_TEST
+
+/* A text event frame converts to ["event", data] */
+START_TEST (test_msgpack_frame_from_text)
+{
+	BarWsFrame_t *text = BarWsFrameFromString ("2[ \"volume\", 50 ]");
+	BarWsFrame_t *bin = BarMsgpackFrameFromText (text);
+	ck_assert_ptr_nonnull (bin);
+	static const unsigned char expect[] = {0x92, 0xa6, 'v', 'o', 'l', 'u',
+			'm', 'e', 0x32};
+	ck_assert_uint_eq (bin->len, sizeof (expect));
+	ck_assert_mem_eq (BarWsFramePayload (bin), expect, sizeof (expect));
+	BarWsFrameUnref (bin);
+	BarWsFrameUnref (text);
+
+	text = BarWsFrameFromString ("0{\"sid\":\"x\"}");
+	ck_assert_ptr_null (BarMsgpackFrameFromText (text));
+	BarWsFrameUnref (text);
+}
+END_TEST
+
+Suite *ws_msgpack_suite (void) {
+	Suite *s = suite_create ("ws_msgpack");
+	TCase *tc = tcase_create ("codec");
+	tcase_add_test (tc, test_msgpack_encode_formats);
+	tcase_add_test (tc, test_msgpack_roundtrip);
+	tcase_add_test (tc, test_msgpack_decode_rejects);
+	tcase_add_test (tc, test_msgpack_frame_from_text);
+	suite_add_tcase (s, tc);
+	return s;
+}
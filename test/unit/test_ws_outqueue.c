@@ -0,0 +1,259 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/websocket/core/outqueue.h"
+
+/* Queues a fresh frame holding s; the queue keeps the only reference */
+static void push (BarWsOutQueue_t *q, const char *s, int bucket,
+		bool disconnectSlow, BarWsOutQueueResult_t expect) {
+	BarWsFrame_t *f = BarWsFrameFromString (s);
+	ck_assert_ptr_nonnull (f);
+	ck_assert_int_eq (BarWsOutQueuePush (q, f, bucket, false, disconnectSlow), expect);
+	BarWsFrameUnref (f);
+}
+
+/* Same for a frame that applies on top of the earlier ones of its bucket */
+static void pushIncremental (BarWsOutQueue_t *q, const char *s, int bucket) {
+	BarWsFrame_t *f = BarWsFrameFromString (s);
+	ck_assert_ptr_nonnull (f);
+	ck_assert_int_eq (BarWsOutQueuePush (q, f, bucket, true, true), BAR_WS_OUTQ_QUEUED);
+	BarWsFrameUnref (f);
+}
+
+/* Pops the next frame and compares its payload */
+static void expectNext (BarWsOutQueue_t *q, const char *s) {
+	BarWsFrame_t *f = BarWsOutQueuePop (q);
+	ck_assert_ptr_nonnull (f);
+	ck_assert_uint_eq (f->len, strlen (s));
+	ck_assert_str_eq (BarWsFrameData (f), s);
+	BarWsFrameUnref (f);
+}
+
+START_TEST (test_outqueue_fifo)
+{
+	BarWsOutQueue_t q;
+	ck_assert (BarWsOutQueueInit (&q, 3));
+
+	/* wraps around the ring */
+	for (int round = 0; round < 3; round++) {
+		push (&q, "a", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_QUEUED);
+		push (&q, "b", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_QUEUED);
+		push (&q, "c", 0, true, BAR_WS_OUTQ_QUEUED);
+		ck_assert_uint_eq (q.stats.depth, 3);
+
+		expectNext (&q, "a");
+		expectNext (&q, "b");
+		push (&q, "d", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_QUEUED);
+		expectNext (&q, "c");
+		expectNext (&q, "d");
+	}
+	ck_assert (BarWsOutQueueEmpty (&q));
+	ck_assert_ptr_null (BarWsOutQueuePop (&q));
+	ck_assert_uint_eq (q.stats.sent, 12);
+	ck_assert_uint_eq (q.stats.highWater, 3);
+
+	BarWsOutQueueDestroy (&q);
+}
+END_TEST
+
+/* A newer frame of the same bucket replaces the unsent one and moves to the
+ * back, so it is never delivered ahead of frames queued before it */
+START_TEST (test_outqueue_coalesces_by_bucket)
+{
+	BarWsOutQueue_t q;
+	ck_assert (BarWsOutQueueInit (&q, 8));
+
+	push (&q, "progress 1", 2, true, BAR_WS_OUTQ_QUEUED);
+	push (&q, "reply", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_QUEUED);
+	push (&q, "progress 2", 2, true, BAR_WS_OUTQ_COALESCED);
+	push (&q, "other reply", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_QUEUED);
+	ck_assert_uint_eq (q.stats.depth, 3);
+	ck_assert_uint_eq (q.stats.coalesced, 1);
+
+	ck_assert_uint_eq (BarWsOutQueueRemoveBucket (&q, BAR_WS_FRAME_NO_BUCKET), 0);
+	expectNext (&q, "reply");
+	expectNext (&q, "progress 2");
+	expectNext (&q, "other reply");
+
+	push (&q, "progress 3", 2, true, BAR_WS_OUTQ_QUEUED);
+	ck_assert_uint_eq (BarWsOutQueueRemoveBucket (&q, 2), 1);
+	ck_assert (BarWsOutQueueEmpty (&q));
+
+	BarWsOutQueueDestroy (&q);
+}
+END_TEST
+
+/* Two station deltas in a row both reach a client that is behind, and a
+ * later full list leaves them alone: each delta needs what came before it */
+START_TEST (test_outqueue_keeps_incremental_frames)
+{
+	BarWsOutQueue_t q;
+	ck_assert (BarWsOutQueueInit (&q, 8));
+
+	push (&q, "stations", 3, true, BAR_WS_OUTQ_QUEUED);
+	pushIncremental (&q, "stations.delta 1", 3);
+	pushIncremental (&q, "stations.delta 2", 3);
+	ck_assert_uint_eq (q.stats.depth, 3);
+	push (&q, "stations again", 3, true, BAR_WS_OUTQ_QUEUED);
+	push (&q, "stations latest", 3, true, BAR_WS_OUTQ_COALESCED);
+	ck_assert_uint_eq (q.stats.coalesced, 1);
+
+	expectNext (&q, "stations");
+	expectNext (&q, "stations.delta 1");
+	expectNext (&q, "stations.delta 2");
+	expectNext (&q, "stations latest");
+	ck_assert (BarWsOutQueueEmpty (&q));
+
+	BarWsOutQueueDestroy (&q);
+}
+END_TEST
+
+/* Two process patches in one client queue are both delivered in order;
+ * other state events only replace what was queued after them */
+START_TEST (test_outqueue_keeps_consecutive_patches)
+{
+	BarWsOutQueue_t q;
+	ck_assert (BarWsOutQueueInit (&q, 8));
+
+	push (&q, "process", 0, true, BAR_WS_OUTQ_QUEUED);
+	pushIncremental (&q, "process.patch 2", 0);
+	pushIncremental (&q, "process.patch 3", 0);
+	push (&q, "start", 0, true, BAR_WS_OUTQ_QUEUED);
+	push (&q, "stop", 0, true, BAR_WS_OUTQ_COALESCED);
+	ck_assert_uint_eq (q.stats.depth, 4);
+
+	expectNext (&q, "process");
+	expectNext (&q, "process.patch 2");
+	expectNext (&q, "process.patch 3");
+	expectNext (&q, "stop");
+	ck_assert (BarWsOutQueueEmpty (&q));
+
+	BarWsOutQueueDestroy (&q);
+}
+END_TEST
+
+/* Drop policy: a full queue keeps the newest frames and never gives up */
+START_TEST (test_outqueue_drops_oldest_when_full)
+{
+	BarWsOutQueue_t q;
+	ck_assert (BarWsOutQueueInit (&q, 2));
+
+	push (&q, "1", BAR_WS_FRAME_NO_BUCKET, false, BAR_WS_OUTQ_QUEUED);
+	push (&q, "2", BAR_WS_FRAME_NO_BUCKET, false, BAR_WS_OUTQ_QUEUED);
+	for (int i = 0; i < 10; i++) {
+		push (&q, "3", BAR_WS_FRAME_NO_BUCKET, false, BAR_WS_OUTQ_DROPPED);
+	}
+	ck_assert_uint_eq (q.stats.depth, 2);
+	ck_assert_uint_eq (q.stats.highWater, 2);
+	ck_assert_uint_eq (q.stats.dropped, 10);
+
+	BarWsOutQueueClear (&q);
+	ck_assert (BarWsOutQueueEmpty (&q));
+	ck_assert_uint_eq (q.stats.dropped, 10);
+
+	BarWsOutQueueDestroy (&q);
+}
+END_TEST
+
+/* Disconnect policy: after a full queue's worth of drops without the client
+ * draining anything it is reported as slow; draining resets the count */
+START_TEST (test_outqueue_reports_slow_consumer)
+{
+	BarWsOutQueue_t q;
+	ck_assert (BarWsOutQueueInit (&q, 2));
+
+	push (&q, "1", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_QUEUED);
+	push (&q, "2", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_QUEUED);
+	push (&q, "3", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_DROPPED);
+	expectNext (&q, "2");
+	push (&q, "4", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_QUEUED);
+	push (&q, "5", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_DROPPED);
+	push (&q, "6", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_DROPPED);
+	push (&q, "7", BAR_WS_FRAME_NO_BUCKET, true, BAR_WS_OUTQ_SLOW);
+	expectNext (&q, "5");
+
+	BarWsOutQueueDestroy (&q);
+}
+END_TEST
+
+/* Fan-out shares one frame: every queue holds a reference to the same
+ * buffer and the last one to let go frees it */
+START_TEST (test_outqueue_fanout_shares_frame)
+{
+	enum { CLIENTS = 8 };
+	BarWsOutQueue_t q[CLIENTS];
+	BarWsFrame_t *f = BarWsFrameFromString ("2[\"stop\"]");
+	ck_assert_ptr_nonnull (f);
+
+	for (int i = 0; i < CLIENTS; i++) {
+		ck_assert (BarWsOutQueueInit (&q[i], 4));
+		ck_assert_int_eq (BarWsOutQueuePush (&q[i], f, 0, false, true), BAR_WS_OUTQ_QUEUED);
+	}
+	ck_assert_uint_eq (atomic_load (&f->refs), CLIENTS + 1);
+
+	BarWsFrame_t *sent = BarWsOutQueuePop (&q[0]);
+	ck_assert_ptr_eq (sent, f);
+	BarWsFrameUnref (sent);
+	for (int i = 1; i < CLIENTS; i++) {
+		BarWsOutQueueDestroy (&q[i]);
+	}
+	BarWsOutQueueDestroy (&q[0]);
+	ck_assert_uint_eq (atomic_load (&f->refs), 1);
+	BarWsFrameUnref (f);
+}
+END_TEST
+
+/* Bucket messages are recycled through the pool */
+START_TEST (test_message_pool_reuses_structs)
+{
+	BarWsMessage_t *a = BarWsMessageNew (MSG_TYPE_BROADCAST_SOCKETIO,
+			BarWsFrameFromString ("x"));
+	ck_assert_ptr_nonnull (a);
+	BarWsMessageFree (a);
+
+	BarWsMessage_t *b = BarWsMessageNew (MSG_TYPE_BROADCAST_SOCKETIO,
+			BarWsFrameFromString ("y"));
+	ck_assert_ptr_eq (a, b);
+	ck_assert_str_eq (BarWsFrameData (b->frame), "y");
+	BarWsMessageFree (b);
+	BarWsMessagePoolDrain ();
+}
+END_TEST
+
+Suite *ws_outqueue_suite (void) {
+	Suite *s = suite_create ("ws_outqueue");
+	TCase *tc = tcase_create ("outbound queue");
+	tcase_add_test (tc, test_outqueue_fifo);
+	tcase_add_test (tc, test_outqueue_coalesces_by_bucket);
+	tcase_add_test (tc, test_outqueue_keeps_incremental_frames);
+	tcase_add_test (tc, test_outqueue_keeps_consecutive_patches);
+	tcase_add_test (tc, test_outqueue_drops_oldest_when_full);
+	tcase_add_test (tc, test_outqueue_reports_slow_consumer);
+	tcase_add_test (tc, test_outqueue_fanout_shares_frame);
+	tcase_add_test (tc, test_message_pool_reuses_structs);
+	suite_add_tcase (s, tc);
+	return s;
+}
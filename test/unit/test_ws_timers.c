@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <check.h>
+
+#include "../../src/websocket/core/timers.h"
+
+START_TEST (test_timers_expire_in_deadline_order)
+{
+	BarWsTimers_t t;
+	BarWsTimersInit (&t);
+	ck_assert_int_eq (BarWsTimersExpired (&t, 1000), -1);
+
+	BarWsTimerArm (&t, BAR_WS_TIMER_VOLUME_POLL, 200);
+	BarWsTimerArm (&t, BAR_WS_TIMER_VOLUME_BROADCAST, 100);
+	ck_assert (BarWsTimerArmed (&t, BAR_WS_TIMER_VOLUME_POLL));
+	ck_assert_int_eq (BarWsTimersExpired (&t, 99), -1);
+	ck_assert_int_eq (BarWsTimersExpired (&t, 250), BAR_WS_TIMER_VOLUME_BROADCAST);
+	ck_assert (!BarWsTimerArmed (&t, BAR_WS_TIMER_VOLUME_BROADCAST));
+	ck_assert_int_eq (BarWsTimersExpired (&t, 250), BAR_WS_TIMER_VOLUME_POLL);
+	ck_assert_int_eq (BarWsTimersExpired (&t, 250), -1);
+	ck_assert_uint_eq (t.count, 0);
+}
+END_TEST
+
+/* rearming moves a deadline either way (debounce) */
+START_TEST (test_timers_rearm_and_disarm)
+{
+	BarWsTimers_t t;
+	BarWsTimersInit (&t);
+
+	BarWsTimerArm (&t, BAR_WS_TIMER_VOLUME_BROADCAST, 100);
+	BarWsTimerArm (&t, BAR_WS_TIMER_VOLUME_POLL, 200);
+	BarWsTimerArm (&t, BAR_WS_TIMER_VOLUME_BROADCAST, 300);
+	ck_assert_uint_eq (t.count, 2);
+	ck_assert_int_eq (BarWsTimersExpired (&t, 250), BAR_WS_TIMER_VOLUME_POLL);
+	ck_assert_int_eq (BarWsTimersExpired (&t, 250), -1);
+
+	BarWsTimerArm (&t, BAR_WS_TIMER_VOLUME_POLL, 400);
+	BarWsTimerDisarm (&t, BAR_WS_TIMER_VOLUME_BROADCAST);
+	BarWsTimerDisarm (&t, BAR_WS_TIMER_VOLUME_BROADCAST);
+	ck_assert_uint_eq (t.count, 1);
+	ck_assert_int_eq (BarWsTimersExpired (&t, 350), -1);
+	ck_assert_int_eq (BarWsTimersExpired (&t, 400), BAR_WS_TIMER_VOLUME_POLL);
+}
+END_TEST
+
+/* nothing armed: sleep as long as allowed */
+START_TEST (test_timers_timeout)
+{
+	BarWsTimers_t t;
+	BarWsTimersInit (&t);
+	ck_assert_int_eq (BarWsTimersTimeout (&t, 1000, 60000), 60000);
+
+	BarWsTimerArm (&t, BAR_WS_TIMER_VOLUME_POLL, 1500);
+	ck_assert_int_eq (BarWsTimersTimeout (&t, 1000, 60000), 500);
+	ck_assert_int_eq (BarWsTimersTimeout (&t, 1000, 100), 100);
+	ck_assert_int_eq (BarWsTimersTimeout (&t, 2000, 60000), 0);
+}
+END_TEST
+
+Suite *ws_timers_suite (void) {
+	Suite *s = suite_create ("ws_timers");
+	TCase *tc = tcase_create ("service thread timers");
+	tcase_add_test (tc, test_timers_expire_in_deadline_order);
+	tcase_add_test (tc, test_timers_rearm_and_disarm);
+	tcase_add_test (tc, test_timers_timeout);
+	suite_add_tcase (s, tc);
+	return s;
+}
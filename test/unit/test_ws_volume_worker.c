@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2025
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <check.h>
+#include <unistd.h>
+
+#include "../../src/websocket/core/timers.h"
+#include "../../src/websocket/core/volume_worker.h"
+
+typedef struct {
+	pthread_mutex_t mutex;
+	int applied;       /* calls of the apply callback */
+	int last;
+} VolumeRecorder_t;
+
+static void recordVolume (int percent, void *userdata) {
+	VolumeRecorder_t *r = userdata;
+	pthread_mutex_lock (&r->mutex);
+	r->applied++;
+	r->last = percent;
+	pthread_mutex_unlock (&r->mutex);
+}
+
+/* a burst is coalesced, and stopping still applies its last value */
+START_TEST (test_volume_worker_applies_last_value)
+{
+	BarWsVolumeWorker_t w;
+	VolumeRecorder_t r = {.applied = 0, .last = -1};
+	pthread_mutex_init (&r.mutex, NULL);
+	ck_assert (BarWsVolumeWorkerStart (&w, 50, recordVolume, &r));
+
+	for (int i = 0; i <= 100; i++) {
+		ck_assert (BarWsVolumeWorkerSet (&w, i));
+	}
+	BarWsVolumeWorkerStop (&w);
+
+	ck_assert_int_eq (r.last, 100);
+	ck_assert_int_le (r.applied, 2);
+	ck_assert (!BarWsVolumeWorkerSet (&w, 5));
+	BarWsVolumeWorkerDestroy (&w);
+	pthread_mutex_destroy (&r.mutex);
+}
+END_TEST
+
+/* a request every millisecond is applied at most once per interval */
+START_TEST (test_volume_worker_bounds_rate)
+{
+	BarWsVolumeWorker_t w;
+	VolumeRecorder_t r = {.applied = 0, .last = -1};
+	pthread_mutex_init (&r.mutex, NULL);
+	ck_assert (BarWsVolumeWorkerStart (&w, 50, recordVolume, &r));
+
+	const uint64_t start = BarWsTimeMs ();
+	int sent = 0;
+	while (BarWsTimeMs () - start < 300) {
+		BarWsVolumeWorkerSet (&w, sent++ % 101);
+		usleep (1000);
+	}
+	const uint64_t elapsed = BarWsTimeMs () - start;
+	BarWsVolumeWorkerStop (&w);
+
+	ck_assert_int_eq (r.last, (sent - 1) % 101);
+	ck_assert_int_gt (r.applied, 1);
+	ck_assert_int_le (r.applied, (int) (elapsed / 50) + 2);
+	BarWsVolumeWorkerDestroy (&w);
+	pthread_mutex_destroy (&r.mutex);
+}
+END_TEST
+
+Suite *ws_volume_worker_suite (void) {
+	Suite *s = suite_create ("ws_volume_worker");
+	TCase *tc = tcase_create ("volume.set coalescing");
+	tcase_add_test (tc, test_volume_worker_applies_last_value);
+	tcase_add_test (tc, test_volume_worker_bounds_rate);
+	suite_add_tcase (s, tc);
+	return s;
+}
@@ -1,7 +1,8 @@
 import { LitElement, html, css } from 'lit';
 import { customElement, state } from 'lit/decorators.js';
 import { SocketService } from './services/socket-service';
-import { resolveStationIdFromStationsList } from './station-sync';
+import { applyStationsDelta, resolveStationIdFromStationsList } from './station-sync';
+import { ProcessSync, readInitialState } from './process-sync';
 import { t, tf } from './i18n';
 import type {
   StationPayload,
@@ -10,6 +11,7 @@ import type {
   AccountPayload,
   GenreCategoryPayload,
   StationModePayload,
+  ProcessPayload,
 } from './protocol';
 import { VolumeControl } from './components/volume-control';
 import { InfoMenu } from './components/info-menu';
@@ -39,6 +41,7 @@ import './components/login-screen';
 @customElement('pianobar-app')
 export class PianobarApp extends LitElement {
   private socket = new SocketService();
+  private processSync = new ProcessSync();
   
   @state() private connected = false;
   @state() private albumArt = '';
@@ -233,10 +236,25 @@ export class PianobarApp extends LitElement {
   
   connectedCallback() {
     super.connectedCallback();
+    this.applyInitialState();
     this.setupSocketListeners();
     this.setupConnectionListener();
   }
   
+  /** Render the state inlined into index.html until the socket delivers its own. */
+  private applyInitialState(): void {
+    const state = readInitialState();
+    if (!state) {
+      return;
+    }
+    this.applyProcessState(this.processSync.full(state.process));
+    this.stations = state.stations;
+    if (this.stations.length > 0) {
+      this.pandoraConnected = true;
+    }
+    this.syncCurrentStationIdFromStationsList();
+  }
+
   /** Fill currentStationId from stations[] when we have a name but id is missing (some payloads omit stationId). */
   private syncCurrentStationIdFromStationsList(): void {
     const resolved = resolveStationIdFromStationsList(
@@ -340,6 +358,20 @@ export class PianobarApp extends LitElement {
       this.syncCurrentStationIdFromStationsList();
     });
     
+    this.socket.on('stations.delta', (data) => {
+      const next = applyStationsDelta(this.stations, data);
+      if (next === null) {
+        // Out of sync (e.g. missed a broadcast); fall back to the full list
+        this.socket.emit('query.stations', null);
+        return;
+      }
+      this.stations = next;
+      if (this.stations.length > 0) {
+        this.pandoraConnected = true;
+      }
+      this.syncCurrentStationIdFromStationsList();
+    });
+    
     this.socket.on('genres', (data) => {
       this.genreCategories = data.categories || [];
       this.genreLoading = false;
@@ -378,72 +410,18 @@ export class PianobarApp extends LitElement {
 
     this.socket.on('process', (data) => {
       console.log('Received process event:', data);
-      // Only treat as "connected to Pandora" when we have active session state (song, playing, or non-empty station)
-      // Avoid setting true on empty/stopped state so pandora.disconnected is not overwritten
-      if (data.song != null || data.playing === true || (data.station && String(data.station).trim() !== '')) {
-        this.pandoraConnected = true;
-      }
-      
-      // Update pause state
-      if (data.paused !== undefined) {
-        this.paused = data.paused;
-      }
-
-      // Update UI with current state
-      if (data.song) {
-        this.albumArt = data.song.coverArt || '';
-        this.songTitle = data.song.title || t('web.ui.not_playing');
-        this.albumName = data.song.album || '';
-        this.artistName = data.song.artist || t('web.ui.em_dash');
-        this.totalTime = data.song.duration || 0;
-        this.playing = data.playing || false;
-        this.rating = data.song.rating || 0;
-        this.songStationName = data.song.songStationName || '';
-        this.currentTrackToken = data.song.trackToken || '';
-
-        // Update elapsed time if provided
-        if (data.elapsed !== undefined) {
-          this.currentTime = data.elapsed;
-        }
-      } else {
-        // No song playing
-        this.albumArt = '';
-        this.songTitle = t('web.ui.not_playing');
-        this.albumName = '';
-        // Check if a station is selected - if not, show helpful message
-        const hasStation = data.station && data.station !== '';
-        this.artistName = hasStation ? t('web.ui.em_dash') : t('web.ui.select_station_to_play');
-        this.playing = false;
-        this.paused = false;
-        this.currentTime = 0;
-        this.totalTime = 0;
-        this.rating = 0;
-        this.songStationName = '';
-        this.currentTrackToken = '';
-      }
-      
-      // Update current station (even if empty)
-      if ('station' in data) {
-        this.currentStation = data.station ?? '';
-      }
-      if ('stationId' in data) {
-        this.currentStationId = String(data.stationId ?? '').trim();
-      }
-      this.syncCurrentStationIdFromStationsList();
-
-      // Update volume control if present
-      if (data.volume !== undefined) {
-        this.volume = data.volume;
-        const volumeControl = this.shadowRoot?.querySelector<VolumeControl>('volume-control');
-        volumeControl?.updateFromServer(data.volume);
-      }
+      this.applyProcessState(this.processSync.full(data));
+    });
 
-      // Update account info
-      if (data.accounts) {
-        this.accounts = data.accounts;
+    this.socket.on('process.patch', (data) => {
+      const next = this.processSync.patch(data);
+      if (next === null) {
+        // Missed a revision (e.g. coalesced while queued); get the full state
+        this.socket.emit('query.process', null);
+        return;
       }
-      if (data.current_account) {
-        this.currentAccountId = data.current_account.id;
+      if (next) {
+        this.applyProcessState(next);
       }
     });
     
@@ -502,6 +480,77 @@ export class PianobarApp extends LitElement {
     });
   }
   
+  /** Apply a full `process` document (received whole or patched). */
+  private applyProcessState(data: ProcessPayload): void {
+    // Only treat as "connected to Pandora" when we have active session state (song, playing, or non-empty station)
+    // Avoid setting true on empty/stopped state so pandora.disconnected is not overwritten
+    if (data.song != null || data.playing === true || (data.station && String(data.station).trim() !== '')) {
+      this.pandoraConnected = true;
+    }
+    
+    // Update pause state
+    if (data.paused !== undefined) {
+      this.paused = data.paused;
+    }
+
+    // Update UI with current state
+    if (data.song) {
+      this.albumArt = data.song.coverArt || '';
+      this.songTitle = data.song.title || t('web.ui.not_playing');
+      this.albumName = data.song.album || '';
+      this.artistName = data.song.artist || t('web.ui.em_dash');
+      this.totalTime = data.song.duration || 0;
+      this.playing = data.playing || false;
+      this.rating = data.song.rating || 0;
+      this.songStationName = data.song.songStationName || '';
+      this.currentTrackToken = data.song.trackToken || '';
+
+      // Update elapsed time if provided
+      if (data.elapsed !== undefined) {
+        this.currentTime = data.elapsed;
+      }
+    } else {
+      // No song playing
+      this.albumArt = '';
+      this.songTitle = t('web.ui.not_playing');
+      this.albumName = '';
+      // Check if a station is selected - if not, show helpful message
+      const hasStation = data.station && data.station !== '';
+      this.artistName = hasStation ? t('web.ui.em_dash') : t('web.ui.select_station_to_play');
+      this.playing = false;
+      this.paused = false;
+      this.currentTime = 0;
+      this.totalTime = 0;
+      this.rating = 0;
+      this.songStationName = '';
+      this.currentTrackToken = '';
+    }
+    
+    // Update current station (even if empty)
+    if ('station' in data) {
+      this.currentStation = data.station ?? '';
+    }
+    if ('stationId' in data) {
+      this.currentStationId = String(data.stationId ?? '').trim();
+    }
+    this.syncCurrentStationIdFromStationsList();
+
+    // Update volume control if present
+    if (data.volume !== undefined) {
+      this.volume = data.volume;
+      const volumeControl = this.shadowRoot?.querySelector<VolumeControl>('volume-control');
+      volumeControl?.updateFromServer(data.volume);
+    }
+
+    // Update account info
+    if (data.accounts) {
+      this.accounts = data.accounts;
+    }
+    if (data.current_account) {
+      this.currentAccountId = data.current_account.id;
+    }
+  }
+
   handlePlayPause() {
     if (this.playing && !this.paused) {
       this.socket.emit('action', 'playback.pause');
@@ -0,0 +1,86 @@
+import type { InitialStatePayload, ProcessPatchPayload, ProcessPayload } from './protocol';
+
+type Json = unknown;
+
+function isObject(value: Json): value is Record<string, Json> {
+  return typeof value === 'object' && value !== null && !Array.isArray(value);
+}
+
+/**
+ * RFC 7386 JSON merge patch: objects merge recursively, `null` removes a
+ * member, anything else (arrays included) replaces. Returns a new value and
+ * leaves `target` untouched.
+ */
+export function applyMergePatch(target: Json, patch: Json): Json {
+  if (!isObject(patch)) {
+    return patch;
+  }
+  const result: Record<string, Json> = isObject(target) ? { ...target } : {};
+  for (const [key, value] of Object.entries(patch)) {
+    if (value === null) {
+      delete result[key];
+    } else {
+      result[key] = applyMergePatch(result[key], value);
+    }
+  }
+  return result;
+}
+
+/**
+ * Tracks the `process` document and its revision. Full `process` events
+ * reset it; `process.patch` events apply on top of the previous revision
+ * only.
+ */
+export class ProcessSync {
+  private state: ProcessPayload | null = null;
+  private revision: number | null = null;
+
+  /** Store a full `process` event and return the document. */
+  full(data: ProcessPayload): ProcessPayload {
+    const { revision, ...doc } = data;
+    this.state = doc;
+    this.revision = typeof revision === 'number' ? revision : null;
+    return doc;
+  }
+
+  /**
+   * Apply a `process.patch` event. Returns the new document, `undefined`
+   * if the patch is stale or there is no base yet (nothing to do), or
+   * `null` on a gap — the caller should then request the full state.
+   */
+  patch(data: ProcessPatchPayload): ProcessPayload | null | undefined {
+    if (this.state === null || this.revision === null) {
+      return undefined;
+    }
+    if (data.revision <= this.revision) {
+      return undefined;
+    }
+    if (data.revision !== this.revision + 1) {
+      return null;
+    }
+    this.state = applyMergePatch(this.state, data.patch) as ProcessPayload;
+    this.revision = data.revision;
+    return this.state;
+  }
+}
+
+/**
+ * Read the state the server put into the page, if any. It lets the first
+ * paint show what is playing before the WebSocket is connected; the
+ * `process` event sent on connect replaces it.
+ */
+export function readInitialState(doc: Document = document): InitialStatePayload | null {
+  const text = doc.getElementById('pianobar-state')?.textContent;
+  if (!text) {
+    return null;
+  }
+  try {
+    const state = JSON.parse(text) as InitialStatePayload;
+    if (!isObject(state) || !isObject(state.process)) {
+      return null;
+    }
+    return { process: state.process, stations: Array.isArray(state.stations) ? state.stations : [] };
+  } catch {
+    return null;
+  }
+}
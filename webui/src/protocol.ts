@@ -11,6 +11,19 @@ export interface StationPayload {
   isQuickMixed?: boolean;
 }
 
+/** Station entry in a `stations.delta` event; `index` is its position in the sorted list. */
+export interface StationDeltaEntry extends StationPayload {
+  index: number;
+}
+
+/** Incremental station list update; `count` is the list length after applying it. */
+export interface StationsDeltaPayload {
+  added: StationDeltaEntry[];
+  changed: StationDeltaEntry[];
+  removed: string[];
+  count: number;
+}
+
 export interface SongPayload {
   title?: string;
   artist?: string;
@@ -28,6 +41,12 @@ export interface SongPayload {
   songStationName?: string;
 }
 
+/** Entry of `query.history.result`, newest first */
+export interface HistorySongPayload extends SongPayload {
+  /** Unix time (seconds) the song finished */
+  playedAt?: number;
+}
+
 export interface AccountPayload {
   id: string;
   label?: string;
@@ -43,6 +62,23 @@ export interface ProcessPayload {
   elapsed?: number;
   current_account?: AccountPayload;
   accounts?: AccountPayload[];
+  /** State revision; `process.patch` events build on it. */
+  revision?: number;
+}
+
+/**
+ * State the server puts into index.html (`webui_inline_state`), as the JSON
+ * text of `<script id="pianobar-state" type="application/json">`.
+ */
+export interface InitialStatePayload {
+  process: ProcessPayload;
+  stations: StationPayload[];
+}
+
+/** RFC 7386 merge patch turning revision `revision - 1` into `revision`. */
+export interface ProcessPatchPayload {
+  revision: number;
+  patch: Partial<Record<keyof ProcessPayload, unknown>>;
 }
 
 export interface ProgressPayload {
@@ -95,12 +131,15 @@ export interface ServerEvents {
   volume: VolumePayload;
   progress: ProgressPayload;
   stations: StationPayload[];
+  'stations.delta': StationsDeltaPayload;
   process: ProcessPayload;
+  'process.patch': ProcessPatchPayload;
   playState: PlayStatePayload;
   error: ErrorPayload;
   'pandora.disconnected': DisconnectedPayload;
   'song.explanation': SongExplanationPayload;
   'query.upcoming.result': SongPayload[];
+  'query.history.result': HistorySongPayload[];
   genres: { categories: GenreCategoryPayload[] };
   /** `searchResults` is the event name the server uses for music/genre search results. */
   searchResults: { categories: unknown[] };
@@ -1,3 +1,5 @@
+import type { StationPayload, StationsDeltaPayload } from './protocol';
+
 /** Row shape from `process` / `stations` payloads used to match name → id. */
 export interface StationRow {
   id: string;
@@ -26,3 +28,32 @@ export function resolveStationIdFromStationsList(
   }
   return undefined;
 }
+
+/**
+ * Applies a `stations.delta` event to the current (sorted) list. Added and
+ * changed entries are (re)inserted at their index, so applying the same delta
+ * twice is harmless. Returns `null` if the result does not match the server's
+ * count — the caller should then request the full list.
+ */
+export function applyStationsDelta(
+  stations: StationPayload[],
+  delta: StationsDeltaPayload
+): StationPayload[] | null {
+  const upserts = [...(delta.added || []), ...(delta.changed || [])];
+  const drop = new Set<string>([
+    ...(delta.removed || []),
+    ...upserts.map((s) => s.id),
+  ]);
+  const next = stations.filter((s) => !drop.has(s.id));
+  upserts.sort((a, b) => a.index - b.index);
+  for (const { index, ...station } of upserts) {
+    if (index < 0 || index > next.length) {
+      return null;
+    }
+    next.splice(index, 0, station);
+  }
+  if (typeof delta.count === 'number' && next.length !== delta.count) {
+    return null;
+  }
+  return next;
+}
@@ -0,0 +1,87 @@
+import { describe, it, expect } from 'vitest';
+import { applyMergePatch, ProcessSync, readInitialState } from '../../src/process-sync';
+
+describe('applyMergePatch', () => {
+  it('follows the RFC 7386 examples', () => {
+    expect(applyMergePatch({ a: 'b' }, { a: 'c' })).toEqual({ a: 'c' });
+    expect(applyMergePatch({ a: 'b' }, { b: 'c' })).toEqual({ a: 'b', b: 'c' });
+    expect(applyMergePatch({ a: 'b' }, { a: null })).toEqual({});
+    expect(applyMergePatch({ a: 'b', b: 'c' }, { a: null })).toEqual({ b: 'c' });
+    expect(applyMergePatch({ a: ['b'] }, { a: 'c' })).toEqual({ a: 'c' });
+    expect(applyMergePatch({ a: { b: 'c' } }, { a: { b: 'd', c: null } })).toEqual({ a: { b: 'd' } });
+    expect(applyMergePatch({ a: [{ b: 'c' }] }, { a: [1] })).toEqual({ a: [1] });
+    expect(applyMergePatch({}, { a: { bb: { ccc: null } } })).toEqual({ a: { bb: {} } });
+  });
+
+  it('does not modify the target', () => {
+    const target = { song: { rating: 0, title: 'T' } };
+    applyMergePatch(target, { song: { rating: 1 } });
+    expect(target.song.rating).toBe(0);
+  });
+});
+
+describe('ProcessSync', () => {
+  const full = {
+    revision: 4,
+    playing: true,
+    song: { title: 'Song', rating: 0 },
+    station: 'Rock',
+  };
+
+  it('strips the revision from full documents', () => {
+    const sync = new ProcessSync();
+    expect(sync.full(full)).toEqual({ playing: true, song: { title: 'Song', rating: 0 }, station: 'Rock' });
+  });
+
+  it('applies the next revision', () => {
+    const sync = new ProcessSync();
+    sync.full(full);
+    const next = sync.patch({ revision: 5, patch: { song: { rating: 1 } } });
+    expect(next?.song).toEqual({ title: 'Song', rating: 1 });
+    expect(next?.station).toBe('Rock');
+  });
+
+  it('ignores stale patches and patches without a base', () => {
+    const sync = new ProcessSync();
+    expect(sync.patch({ revision: 1, patch: { paused: true } })).toBeUndefined();
+    sync.full(full);
+    expect(sync.patch({ revision: 4, patch: { paused: true } })).toBeUndefined();
+  });
+
+  it('reports a gap', () => {
+    const sync = new ProcessSync();
+    sync.full(full);
+    expect(sync.patch({ revision: 6, patch: { paused: true } })).toBeNull();
+    // a full document recovers
+    sync.full({ ...full, revision: 6 });
+    expect(sync.patch({ revision: 7, patch: { paused: true } })?.paused).toBe(true);
+  });
+});
+
+describe('readInitialState', () => {
+  function page(script: string | null): Document {
+    const doc = document.implementation.createHTMLDocument('t');
+    if (script !== null) {
+      const el = doc.createElement('script');
+      el.id = 'pianobar-state';
+      el.type = 'application/json';
+      el.textContent = script;
+      doc.head.appendChild(el);
+    }
+    return doc;
+  }
+
+  it('returns the inlined process and stations', () => {
+    const state = readInitialState(
+      page('{"process":{"revision":3,"volume":40},"stations":[{"id":"a","name":"\\u003cA"}]}')
+    );
+    expect(state?.process.revision).toBe(3);
+    expect(state?.stations[0].name).toBe('<A');
+  });
+
+  it('ignores a missing or broken snapshot', () => {
+    expect(readInitialState(page(null))).toBeNull();
+    expect(readInitialState(page('{"process":'))).toBeNull();
+    expect(readInitialState(page('[]'))).toBeNull();
+  });
+});
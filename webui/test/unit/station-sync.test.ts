@@ -1,5 +1,5 @@
 import { describe, it, expect } from 'vitest';
-import { resolveStationIdFromStationsList } from '../../src/station-sync';
+import { applyStationsDelta, resolveStationIdFromStationsList } from '../../src/station-sync';
 
 describe('resolveStationIdFromStationsList', () => {
   const stations = [
@@ -37,3 +37,40 @@ describe('resolveStationIdFromStationsList', () => {
     ).toBeUndefined();
   });
 });
+
+describe('applyStationsDelta', () => {
+  const stations = [
+    { id: 'A', name: 'Alpha' },
+    { id: 'B', name: 'Bravo' },
+    { id: 'C', name: 'Charlie' },
+  ];
+
+  it('removes, renames and inserts at the given indexes', () => {
+    const next = applyStationsDelta(stations, {
+      added: [{ id: 'D', name: 'Delta', index: 1 }],
+      changed: [{ id: 'A', name: 'Zulu', index: 2 }],
+      removed: ['B'],
+      count: 3,
+    });
+    expect(next?.map((s) => s.id)).toEqual(['C', 'D', 'A']);
+    expect(next?.[2]).toEqual({ id: 'A', name: 'Zulu' });
+  });
+
+  it('is idempotent when the list already contains the update', () => {
+    const delta = {
+      added: [{ id: 'D', name: 'Delta', index: 3 }],
+      changed: [],
+      removed: ['X'],
+      count: 4,
+    };
+    const once = applyStationsDelta(stations, delta);
+    expect(once).not.toBeNull();
+    expect(applyStationsDelta(once!, delta)).toEqual(once);
+  });
+
+  it('returns null when the result does not match the server count', () => {
+    expect(
+      applyStationsDelta(stations, { added: [], changed: [], removed: ['A'], count: 3 })
+    ).toBeNull();
+  });
+});
@@ -1,13 +1,44 @@
 import { defineConfig } from 'vite';
+import { readdirSync, readFileSync, writeFileSync } from 'node:fs';
+import { join } from 'node:path';
+import { brotliCompressSync, gzipSync, constants } from 'node:zlib';
+
+// Write .br and .gz next to each text asset; the server picks the one the
+// browser accepts instead of compressing on every request.
+function precompress() {
+  const compressible = /\.(html|js|css|svg|json|txt)$/;
+  const walk = (dir) => readdirSync(dir, { withFileTypes: true }).flatMap((entry) =>
+    entry.isDirectory() ? walk(join(dir, entry.name)) : [join(dir, entry.name)]);
+  return {
+    name: 'precompress',
+    apply: 'build',
+    writeBundle(options) {
+      for (const file of walk(options.dir)) {
+        if (!compressible.test(file)) continue;
+        const data = readFileSync(file);
+        if (data.length < 1024) continue;
+        const br = brotliCompressSync(data, {
+          params: { [constants.BROTLI_PARAM_QUALITY]: constants.BROTLI_MAX_QUALITY }
+        });
+        const gz = gzipSync(data, { level: 9 });
+        if (br.length < data.length) writeFileSync(`${file}.br`, br);
+        if (gz.length < data.length) writeFileSync(`${file}.gz`, gz);
+      }
+    }
+  };
+}
 
 export default defineConfig({
+  plugins: [precompress()],
   build: {
     outDir: '../dist/webui',
     emptyOutDir: true,
     rollupOptions: {
       output: {
-        entryFileNames: 'app.js',
-        assetFileNames: 'assets/[name].[ext]'
+        // Content-hashed names below assets/ are served as immutable
+        entryFileNames: 'assets/app-[hash].js',
+        chunkFileNames: 'assets/[name]-[hash].js',
+        assetFileNames: 'assets/[name]-[hash].[ext]'
       }
     }
   },